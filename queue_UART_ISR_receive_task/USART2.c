@@ -1,4 +1,5 @@
 #include "USART2.h"
+#include <string.h>
 
 
 // UART Ports:
@@ -7,6 +8,9 @@
 // PA3 = USART2_RX (AF7)
 
 
+static uint32_t usart2_baud_requested = USART2_BAUD;	// Kept for USART2_ClockChanged()
+usart_baud_t usart2_baud;
+
 // This function initializes the USART2 module
 void USART2_Init(void) {
 	// Enable the USART2 clock in the APB1 peripheral clock enable register
@@ -14,7 +18,7 @@ void USART2_Init(void) {
 	// Initialize the TX and RX pins for USART2 communication
 	USART2_Pin_Init();
 	// Set up USART2 with the specified configurations
-	USART_Init(USART2);
+	USART_Init(USART2, usart2_baud_requested, &usart2_baud);
 
 }
 // This function initializes the GPIO pins used for USART2 communication.
@@ -35,9 +39,9 @@ void USART2_Pin_Init(void) {
 
 // This function initializes USART module with specified settings for communication.
 // This function is modular and can be utilized with any USART module passed as an argument.
-void USART_Init (USART_TypeDef * USARTx) {
+void USART_Init (USART_TypeDef * USARTx, uint32_t baud, usart_baud_t *result) {
 	// data format to be set: 8 data bits, no parity, 1 start bit, and 1 stop bit		
-	// baud rate to be set: 9600
+	// baud rate to be set: 'baud'
 	
 	// Disabling USART to allow configuration
 	USARTx->CR1 &= ~USART_CR1_UE;  
@@ -50,15 +54,8 @@ void USART_Init (USART_TypeDef * USARTx) {
 	// STOP bits settings: 00 = 1 Stop bit, 01 = 0.5 Stop bit, 10 = 2 Stop bits, 11 = 1.5 Stop bits
 	USARTx->CR2 &= ~USART_CR2_STOP;
 	
-	// Setting the oversampling mode to 16 
-	// OVER8 = 0 for oversampling by 16, 1 for oversampling by 8
-	USARTx->CR1 &= ~USART_CR1_OVER8;  
-	
-                                    
-	// Setting the baud rate to 9600 using the default APB frequency of 4,000,000 Hz
-	// Calculation depends on the oversampling mode: if OVER8 = 0 (16x), BRR = f_CK / USARTDIV
-	// For 9600 baud with f_CK = 4,000,000 Hz and 16x oversampling: USARTDIV = 4,000,000 / 9,600 = 417
-	USARTx->BRR  = 417; 
+	// Setting the oversampling mode (OVER8) and the baud rate from the current kernel clock
+	USART_SetBaudRate(USARTx, baud, result);
 
 	// Enabling the transmitter and receiver
 	USARTx->CR1  |= (USART_CR1_RE | USART_CR1_TE);  
@@ -78,4 +75,188 @@ void USART_Init (USART_TypeDef * USARTx) {
 	while ( (USARTx->ISR & USART_ISR_REACK) == 0); 
 }
 
+//-------------------------------------------------------------------------------------------
+// Baud rate
+// BRR is computed from the USART kernel clock at the time of the call, so a clock change
+// (e.g. to 80 MHz by system_clock_80MHz()) needs the rate to be set again afterwards.
+// Oversampling by 16 is used while the kernel clock is at least 16x the baud rate; faster
+// rates switch to oversampling by 8, which reaches kernel clock / 8 (10 Mbaud at 80 MHz).
+//-------------------------------------------------------------------------------------------
+static const uint8_t usart_ahb_shift[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9 };
+
+uint32_t USART_KernelClock(USART_TypeDef * USARTx) {
+	uint32_t sel, ppre;
+
+	SystemCoreClockUpdate();	// HCLK, in case the clock was changed since the last update
+	if (USARTx == USART1) {
+		sel  = (RCC->CCIPR & RCC_CCIPR_USART1SEL) >> RCC_CCIPR_USART1SEL_Pos;
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos;	// APB2
+	} else if (USARTx == USART3) {
+		sel  = (RCC->CCIPR & RCC_CCIPR_USART3SEL) >> RCC_CCIPR_USART3SEL_Pos;
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;	// APB1
+	} else {
+		sel  = (RCC->CCIPR & RCC_CCIPR_USART2SEL) >> RCC_CCIPR_USART2SEL_Pos;
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;	// APB1
+	}
+
+	switch (sel) {
+		case 1:  return SystemCoreClock << usart_ahb_shift[(RCC->CFGR & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos];	// SYSCLK
+		case 2:  return USART_HSI16_HZ;
+		case 3:  return USART_LSE_HZ;
+		default: return ppre < 4 ? SystemCoreClock : SystemCoreClock >> (ppre - 3);	// PCLK: APB prescaler 1..16
+	}
+}
+
+int USART_SetBaudRate(USART_TypeDef * USARTx, uint32_t baud, usart_baud_t *result) {
+	uint32_t kernel_hz = USART_KernelClock(USARTx);
+	uint32_t over8 = 0;
+	uint32_t usartdiv = 0;
+	uint32_t actual = 0;
+	int32_t error_ppm = 0;
+
+	if (baud != 0) {
+		// Oversampling by 16: USARTDIV = f_CK / baud, rounded to nearest
+		usartdiv = (uint32_t)(((uint64_t)kernel_hz + baud / 2) / baud);
+		if (usartdiv < 16) {
+			// Oversampling by 8: USARTDIV = 2 * f_CK / baud
+			over8 = 1;
+			usartdiv = (uint32_t)((2 * (uint64_t)kernel_hz + baud / 2) / baud);
+		}
+		if (usartdiv >= 16 && usartdiv <= 0xFFFF) {
+			actual = (uint32_t)(((uint64_t)kernel_hz << over8) / usartdiv);
+			error_ppm = (int32_t)(((int64_t)actual - baud) * 1000000 / baud);
+		}
+	}
+	if (result != NULL) {
+		result->kernel_hz = kernel_hz;
+		result->baud = actual;
+		result->error_ppm = error_ppm;
+		result->over8 = over8;
+	}
+	if (actual == 0 || error_ppm > USART_BAUD_MAX_ERROR_PPM || error_ppm < -USART_BAUD_MAX_ERROR_PPM) {
+		return 0;
+	}
+
+	// With OVER8, BRR[2:0] = USARTDIV[3:0] >> 1 and BRR[3] must be 0
+	uint32_t brr = over8 ? (usartdiv & 0xFFF0) | ((usartdiv & 0xF) >> 1) : usartdiv;
+
+	// BRR and OVER8 can only be written while the USART is disabled
+	uint32_t enabled = USARTx->CR1 & USART_CR1_UE;
+	if (enabled) {
+		while ((USARTx->CR1 & USART_CR1_TE) && !(USARTx->ISR & USART_ISR_TC));	// Let the byte in flight finish
+		USARTx->CR1 &= ~USART_CR1_UE;
+	}
+	USARTx->CR1 = over8 ? (USARTx->CR1 | USART_CR1_OVER8) : (USARTx->CR1 & ~USART_CR1_OVER8);
+	USARTx->BRR = brr;
+	if (enabled) {
+		USARTx->CR1 |= USART_CR1_UE;
+		while ((USARTx->CR1 & USART_CR1_TE) && !(USARTx->ISR & USART_ISR_TEACK));
+	}
+	return 1;
+}
+
+int USART2_SetBaudRate(uint32_t baud) {
+	usart_baud_t result;
+
+	if (!USART_SetBaudRate(USART2, baud, &result)) {
+		return 0;
+	}
+	usart2_baud_requested = baud;
+	usart2_baud = result;
+	return 1;
+}
+
+int USART2_ClockChanged(void) {
+	return USART2_SetBaudRate(usart2_baud_requested);
+}
+
+//------------------------------------------------------------------------------
+// Interrupt-driven reception
+// The RXNE interrupt stores each byte in usart2_rx_buffer; the consumer drains
+// it in bulk. Single producer (interrupt), single consumer (one task):
+// usart2_rx_head is only written by the interrupt and usart2_rx_tail only by
+// the consumer. Both are free-running counters, masked when indexing the buffer.
+// The consumer is woken through the callback by the idle-line interrupt, i.e.
+// once per burst instead of once per byte.
+//------------------------------------------------------------------------------
+static uint8_t usart2_rx_buffer[USART2_RX_BUFFER_SIZE];
+static volatile uint32_t usart2_rx_head = 0;		// Total bytes received
+static volatile uint32_t usart2_rx_tail = 0;		// Total bytes read by the consumer
+static usart2_rx_callback_t usart2_rx_callback;
+
+volatile uint32_t usart2_rx_overrun = 0;
+
+// This function registers the burst callback and enables the idle-line interrupt.
+void USART2_RxInit(usart2_rx_callback_t callback) {
+	usart2_rx_callback = callback;
+	USART2->ICR = USART_ICR_IDLECF;
+	USART2->CR1 |= USART_CR1_IDLEIE;
+}
+
+uint32_t USART2_Read(uint8_t *data, uint32_t max) {
+	uint32_t tail = usart2_rx_tail;
+	uint32_t count = usart2_rx_head - tail;
+	
+	if (count > max) {
+		count = max;
+	}
+	__DMB();	// Read the bytes only after the head that publishes them
+	
+	// At most two copies: up to the end of the buffer, then from its start
+	uint32_t index = tail & (USART2_RX_BUFFER_SIZE - 1);
+	uint32_t first = USART2_RX_BUFFER_SIZE - index;
+	if (first > count) {
+		first = count;
+	}
+	memcpy(data, &usart2_rx_buffer[index], first);
+	memcpy(data + first, usart2_rx_buffer, count - first);
+	
+	__DMB();	// Finish reading before the slots are handed back
+	usart2_rx_tail = tail + count;
+	return count;
+}
+
+uint32_t USART2_RxAvailable(void) {
+	return usart2_rx_head - usart2_rx_tail;
+}
+
+// USART2 interrupt: store received bytes, wake the consumer at the end of each burst
+void USART2_IRQHandler(void) {
+	uint32_t isr = USART2->ISR;
+	uint32_t wake = 0;
+	
+	// Overrun: a byte arrived before the previous one was read
+	if (isr & USART_ISR_ORE) {
+		USART2->ICR = USART_ICR_ORECF;
+		usart2_rx_overrun++;
+	}
+	
+	// Received data: reading RDR clears RXNE
+	if (isr & USART_ISR_RXNE) {
+		uint8_t data = (uint8_t)USART2->RDR;
+		uint32_t head = usart2_rx_head;
+		uint32_t used = head - usart2_rx_tail;
+		
+		if (used < USART2_RX_BUFFER_SIZE) {
+			usart2_rx_buffer[head & (USART2_RX_BUFFER_SIZE - 1)] = data;
+			__DMB();	// Store the byte before publishing it
+			usart2_rx_head = head + 1;
+			// Long burst: wake the consumer at half full, before the ring overflows
+			wake = (used + 1 == USART2_RX_BUFFER_SIZE / 2);
+		} else {
+			usart2_rx_overrun++;	// Ring full: the consumer is behind
+		}
+	}
+	
+	// Idle line: one frame time without reception after a burst
+	if (isr & USART_ISR_IDLE) {
+		USART2->ICR = USART_ICR_IDLECF;
+		wake = 1;
+	}
+	
+	if (wake && usart2_rx_callback) {
+		usart2_rx_callback();
+	}
+}
+
 
@@ -12,8 +12,65 @@ void USART2_Init(void);
 // This function initializes the GPIO pins used for USART2 communication.
 void USART2_Pin_Init(void);
 
+// Baud rate setting, as computed by USART_SetBaudRate()
+typedef struct {
+	uint32_t kernel_hz;	// USART kernel clock the divider was computed from
+	uint32_t baud;		// Nearest rate the divider can produce (0: none)
+	int32_t error_ppm;	// Deviation of 'baud' from the requested rate, in parts per million
+	uint8_t over8;		// 1 - oversampling by 8, for rates above kernel_hz / 16
+} usart_baud_t;
+
+#define USART_BAUD_MAX_ERROR_PPM 20000	// 2 %: beyond this, a rate is refused
+#define USART_HSI16_HZ 16000000
+#define USART_LSE_HZ   32768
+
 // This function initializes USART module with specified settings for communication.
 // This function is modular and can be utilized with any USART module passed as an argument.
-void USART_Init(USART_TypeDef * USARTx);
+// 'result' (may be NULL) receives the baud rate setting, see USART_SetBaudRate().
+void USART_Init(USART_TypeDef * USARTx, uint32_t baud, usart_baud_t *result);
+
+// Kernel clock of USART1..3 as selected in RCC_CCIPR (PCLK by default), from the current
+// clock configuration. Updates SystemCoreClock.
+uint32_t USART_KernelClock(USART_TypeDef * USARTx);
+
+// Program BRR and OVER8 for 'baud' from the current kernel clock, up to kernel clock / 8.
+// Returns 1 once programmed, 0 if the rate is out of range or off by more than
+// USART_BAUD_MAX_ERROR_PPM (the USART is left unchanged). 'result' (may be NULL) receives the
+// nearest rate either way. An enabled USART is briefly disabled after its current byte.
+int USART_SetBaudRate(USART_TypeDef * USARTx, uint32_t baud, usart_baud_t *result);
+
+// Baud rate set by USART2_Init()
+#ifndef USART2_BAUD
+#define USART2_BAUD 9600
+#endif
+
+extern usart_baud_t usart2_baud; // Current USART2 setting
+
+// Change the USART2 baud rate. Returns 1 if applied, 0 if the rate cannot be produced from
+// the current clock (the previous rate is kept).
+int USART2_SetBaudRate(uint32_t baud);
+
+// Recompute the USART2 divider for the current baud rate; call after every clock change.
+// Returns 0 if the rate cannot be produced from the new clock.
+int USART2_ClockChanged(void);
+
+// USART2 receive ring buffer, filled by the RXNE interrupt (size must be a power of two)
+#define USART2_RX_BUFFER_SIZE 128
+
+// Called from the USART2 interrupt once per burst: when the line goes idle after receiving, and
+// when the ring reaches half full during a long burst
+typedef void (*usart2_rx_callback_t)(void);
+
+extern volatile uint32_t usart2_rx_overrun; // Bytes lost: ring full, or USART overrun (ORE)
+
+// This function registers the burst callback. Call after USART2_Init().
+void USART2_RxInit(usart2_rx_callback_t callback);
+
+// Non-blocking bulk read for the single consumer: copies up to 'max' received bytes and
+// returns how many were copied (0 if the ring is empty).
+uint32_t USART2_Read(uint8_t *data, uint32_t max);
+
+// Number of received bytes waiting in the ring
+uint32_t USART2_RxAvailable(void);
 
 #endif /* __STM32L476G_USART2_H */
\ No newline at end of file
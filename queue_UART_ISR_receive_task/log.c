@@ -0,0 +1,93 @@
+#include "log.h"
+#include "stm32l476xx.h"
+#include <stdio.h>
+
+typedef struct {
+	volatile uint32_t sequence;	// Reservation index + 1 once the record is complete
+	uint32_t stamp;			// DWT cycle count when the record was written
+	uint32_t id;
+	uint32_t args[LOG_MAX_ARGS];
+} log_record_t;
+
+static log_record_t log_ring[LOG_RING_SIZE];
+static volatile uint32_t log_head;	// Slots reserved by producers (free-running)
+static volatile uint32_t log_tail;	// Slots consumed (free-running, consumer only)
+
+volatile uint32_t log_dropped;
+
+void log_init(void) {
+	// Enable the cycle counter for the time stamps
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	for (uint32_t i = 0; i < LOG_RING_SIZE; i++) {
+		log_ring[i].sequence = 0;
+	}
+	log_tail = 0;
+	log_head = 0;
+	log_dropped = 0;
+}
+
+// Atomic increment; a plain ++ could lose counts between an interrupt and the code it preempted
+static void log_count_drop(void) {
+	uint32_t value;
+	do {
+		value = __LDREXW(&log_dropped);
+	} while (__STREXW(value + 1, &log_dropped));
+}
+
+void log_write(uint32_t id, uint32_t arg0, uint32_t arg1) {
+	uint32_t stamp = DWT->CYCCNT;
+	uint32_t head;
+
+	// Reserve a slot. A context that preempts us between LDREX and STREX makes the STREX fail.
+	do {
+		head = __LDREXW(&log_head);
+		if (head - log_tail >= LOG_RING_SIZE) {
+			__CLREX();
+			log_count_drop();
+			return;
+		}
+	} while (__STREXW(head + 1, &log_head));
+
+	log_record_t *record = &log_ring[head & (LOG_RING_SIZE - 1)];
+	record->stamp = stamp;
+	record->id = id;
+	record->args[0] = arg0;
+	record->args[1] = arg1;
+	__DMB();	// Contents before the sequence number that publishes them
+	record->sequence = head + 1;
+}
+
+uint32_t log_drain(char *buffer, size_t size) {
+	for (;;) {
+		uint32_t tail = log_tail;
+		log_record_t *record = &log_ring[tail & (LOG_RING_SIZE - 1)];
+
+		// Reserved slots may complete out of order: wait for the oldest one
+		if (record->sequence != tail + 1) {
+			return 0;
+		}
+		__DMB();
+
+		uint32_t us = record->stamp / (SystemCoreClock / 1000000);
+		const char *format = record->id < log_format_count ? log_formats[record->id] : "log id %lu";
+		unsigned long arg0 = record->id < log_format_count ? record->args[0] : record->id;
+		unsigned long arg1 = record->args[1];
+
+		__DMB();	// Finish reading before the slot is handed back
+		log_tail = tail + 1;
+
+		// A line that does not fit is returned truncated. One that cannot be formatted at all
+		// is counted as dropped and the next record taken: returning 0 would read as empty.
+		int length = snprintf(buffer, size, "%lu ", (unsigned long)us);
+		if (length >= 0 && (size_t)length < size) {
+			int message = snprintf(buffer + length, size - length, format, arg0, arg1);
+			length = message < 0 ? -1 : length + message;
+		}
+		if (length > 0 && size > 1) {
+			return (size_t)length < size ? (uint32_t)length : (uint32_t)(size - 1);	// Truncated
+		}
+		log_count_drop();
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef __LOG_H
+#define __LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------
+// Deferred logging
+// Callers in any context (tasks and interrupts) store a log ID, a time stamp and
+// up to LOG_MAX_ARGS binary arguments into a lock-free ring: no formatting, no
+// waiting, a fixed number of instructions. A low-priority consumer later formats
+// the records and transmits them. When the ring is full the record is dropped
+// and counted in log_dropped, so logging never lengthens an interrupt.
+// Many producers, one consumer: slots are reserved with LDREX/STREX and marked
+// as written with a per-slot sequence number.
+//------------------------------------------------------------------------------
+
+#define LOG_RING_SIZE  32	// Records, power of two
+#define LOG_MAX_ARGS   2
+
+// printf-style format string per log ID, defined by the application. Arguments
+// are passed as unsigned long, so use %lu, %lx, %ld or %c conversions.
+extern const char * const log_formats[];
+extern const uint32_t log_format_count;
+
+extern volatile uint32_t log_dropped;	// Records lost because the ring was full
+
+// Enable the time stamp source (DWT cycle counter) and empty the ring
+void log_init(void);
+
+// Record a message: O(1), callable from tasks and interrupts of any priority
+void log_write(uint32_t id, uint32_t arg0, uint32_t arg1);
+
+#define LOG0(id)              log_write((id), 0, 0)
+#define LOG1(id, a0)          log_write((id), (uint32_t)(a0), 0)
+#define LOG2(id, a0, a1)      log_write((id), (uint32_t)(a0), (uint32_t)(a1))
+
+// Consumer: format the oldest record as "<time us> <message>" into 'buffer' and remove it.
+// Returns the length of the line, cut to size - 1 if it does not fit; 0 only if no complete
+// record is waiting. A record that cannot be formatted is counted in log_dropped and skipped.
+uint32_t log_drain(char *buffer, size_t size);
+
+#endif /* __LOG_H */
@@ -1,16 +1,17 @@
 /***************************************************************************
 * File Name:     main.c
 * Description:   This program implements a FreeRTOS-based application 
-*                that utilizes USART2 for serial communication. It includes 
-*                an interrupt handler for receiving UART data, which is 
-*                sent to a queue for processing by a receiver task. The 
+*                that utilizes USART2 for serial communication. The USART2 
+*                driver receives UART data by interrupt into a ring buffer 
+*                and wakes the receiver task once per burst of bytes. The 
 *                receiver task toggles the green LED when the character '1' 
 *                is received, toggles the red LED for '2', and logs an 
 *                error for invalid input. If no data is received within a 
-*                specified timeout, a message is printed indicating the 
-*                absence of data. The main function initializes the system 
-*                clock, USART2, and the LEDs, then starts the FreeRTOS 
-*                scheduler.
+*                specified timeout, a message is logged indicating the 
+*                absence of data. Messages go through the deferred log 
+*                (log.h) and are printed by a low-priority log task. The 
+*                main function initializes the system clock, USART2, and 
+*                the LEDs, then starts the FreeRTOS scheduler.
 * Author:        Shubham Kumar Savita
 * References:    FreeRTOS Documentation, STM32 Reference Manual
 ****************************************************************************/
@@ -22,8 +23,46 @@
 #include "task.h"
 #include "system_clock_80MHz.h"
 #include "led.h"
-#include "queue.h" 
 #include "USART2.h"
+#include "log.h"
+
+// Interrupt priority of the USART2 interrupt, which notifies the receiver task
+// (numerically at least configMAX_SYSCALL_INTERRUPT_PRIORITY >> 4)
+#define RTOS_ISR_PRIORITY 5
+
+// Bytes taken from the receive ring per read
+#define RX_CHUNK_SIZE 16
+
+// Task priorities: printing the log must never delay the receiver
+#define RECEIVER_TASK_PRIORITY 2
+#define LOG_TASK_PRIORITY      1
+
+// Period of the log task while the ring is empty
+#define LOG_DRAIN_PERIOD_MS 10
+
+//------------------------------------------------------------------------------
+// Log messages
+//------------------------------------------------------------------------------
+enum {
+    LOG_SYSTEM_INIT,
+    LOG_RX_BURST,
+    LOG_RX_TIMEOUT,
+    LOG_RX_GREEN,
+    LOG_RX_RED,
+    LOG_RX_INVALID,
+    LOG_RX_OVERRUN,
+};
+
+const char * const log_formats[] = {
+    [LOG_SYSTEM_INIT] = "System Initialized!\n\r",
+    [LOG_RX_BURST]    = "RX burst: %lu bytes waiting.\n\r",
+    [LOG_RX_TIMEOUT]  = "No data received.\n\r",
+    [LOG_RX_GREEN]    = "Data Received: '1' - Toggling GREEN LED.\n\r",
+    [LOG_RX_RED]      = "Data Received: '2' - Toggling RED LED.\n\r",
+    [LOG_RX_INVALID]  = "Invalid input received: 0x%02lx.\n\r",
+    [LOG_RX_OVERRUN]  = "RX overrun: %lu bytes lost.\n\r",
+};
+const uint32_t log_format_count = sizeof(log_formats) / sizeof(log_formats[0]);
 
 //------------------------------------------------------------------------------
 // Function Prototypes
@@ -34,6 +73,8 @@
 *       Only the receiver task will be handled by the RTOS scheduler.
 ******************************************************************/
 void receiverTask (void *argument);
+void logTask (void *argument);
+void uart_rx_burst(void);
 
 // UART modular print function
 void prints(char* message);
@@ -42,25 +83,25 @@ void prints(char* message);
 // Main
 //------------------------------------------------------------------------------
 
-// Queue handle for managing the data queue between the ISR and the receiver task
-QueueHandle_t xQueue;
+// Receiver task handle, notified by the USART2 interrupt
+TaskHandle_t ReceiverTaskHandle;
+TaskHandle_t LogTaskHandle;
 
 int main (void)
 {
     // Configuration
+    NVIC_SetPriority(USART2_IRQn, RTOS_ISR_PRIORITY); // The handler calls into the RTOS
     USART2_Init();  // Initialize USART2 for communication
+    log_init();
     
-    prints("System Initialized!\n\r");
+    LOG0(LOG_SYSTEM_INIT);
 
     // Configure GPIO pins for LEDs
     led_gpio_config(GREEN);
     led_gpio_config(RED);
     led_gpio_config(BLUE);
-1
-    // Create a queue to hold up to 10 integer values (in this case, for UART data)
-    xQueue = xQueueCreate(10, sizeof(int32_t));
 
-    // Update system clock for FreeRTOS timing mechanisms
+    // Update system clock for FreeRTOS timing mechanisms (and the log time stamps)
     SystemCoreClockUpdate();
 
     // Initialize all LEDs to OFF state
@@ -68,8 +109,10 @@ int main (void)
     led_off(RED);
     led_off(BLUE);
 
-    // Create receiver task and start the FreeRTOS scheduler
-    xTaskCreate(receiverTask, "Receiver Task", 100, NULL, 1, NULL);
+    // Create the receiver and log tasks and start the FreeRTOS scheduler
+    xTaskCreate(receiverTask, "Receiver Task", 128, NULL, RECEIVER_TASK_PRIORITY, &ReceiverTaskHandle);
+    xTaskCreate(logTask, "Log Task", 200, NULL, LOG_TASK_PRIORITY, &LogTaskHandle); // snprintf() in log_drain()
+    USART2_RxInit(uart_rx_burst); // After the task exists: the callback notifies it
     vTaskStartScheduler();
     
     // Main loop should never be reached due to the scheduler, 
@@ -78,35 +121,19 @@ int main (void)
 }
 
 //------------------------------------------------------------------------------
-// Interrupt Handler: USART2
+// USART2 receive callback (interrupt context)
 //------------------------------------------------------------------------------
 //
-// This function handles incoming UART data via the USART2 peripheral.
-// The data is passed to a FreeRTOS queue to be processed by the receiver task.
+// Called by the USART2 driver once per burst of received bytes (idle line, or
+// the receive ring half full). The bytes themselves stay in the driver's ring;
+// the receiver task is only told to drain it.
 //
-void USART2_IRQHandler(void)
+void uart_rx_burst(void)
 {
-    uint8_t data;
-
-    // Check if RXNE (Receive Not Empty) interrupt is triggered
-    if(USART2->ISR & USART_ISR_RXNE)
-    {
-        // Read the received data from USART2's receiver data register (RDR)
-        data = USART2->RDR;
-
-        // Try to send the received data to the queue from ISR
-        BaseType_t yield_required = 0;
-        if (!xQueueSendFromISR(xQueue, &data, &yield_required)) 
-        {
-            // Log message if data cannot be sent to the queue
-            prints("Failed to send UART data to the queue.\n\r");
-        }
-        else 
-        {
-            // Log success message
-            prints("Successfully sent data from ISR to Queue!\n\r");
-        }
-    }
+    BaseType_t yield_required = pdFALSE;
+    LOG1(LOG_RX_BURST, USART2_RxAvailable());
+    vTaskNotifyGiveFromISR(ReceiverTaskHandle, &yield_required);
+    portYIELD_FROM_ISR(yield_required);
 }
 
 //------------------------------------------------------------------------------
@@ -114,47 +141,96 @@ void USART2_IRQHandler(void)
 //------------------------------------------------------------------------------
 //
 // This function runs in the RTOS context and is responsible for
-// receiving data from the queue (filled by the ISR) and handling 
+// draining the receive ring (filled by the ISR) and handling 
 // the corresponding LED toggling based on the received input.
 //
 void receiverTask (void *argument)
 {
-    BaseType_t xStatus;
-    uint8_t rx_data = 0;  // Variable to hold received data
+    uint8_t rx_data[RX_CHUNK_SIZE];  // Bytes taken from the receive ring
+    uint32_t overrun_reported = 0;
     
     for (;;)
     {
-        // Receive data from the queue with a timeout of 100 ms
-        // This prevents busy-waiting when the queue is empty
-        xStatus = xQueueReceive(xQueue, &rx_data, pdMS_TO_TICKS(100));
+        // Wait for the next burst with a timeout of 100 ms
+        // This prevents busy-waiting when no data arrives
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
 
-        if(xStatus == pdPASS)
+        uint32_t count = USART2_Read(rx_data, sizeof(rx_data));
+        if (count == 0)
         {
-            // Check the received data and toggle LEDs accordingly
-            if(rx_data == '1')
-            {
-                prints("Data Received: '1' - Toggling GREEN LED.\n\r");
-                led_toggle(GREEN);
-            }
-            else if(rx_data == '2')
-            {
-                prints("Data Received: '2' - Toggling RED LED.\n\r");
-                led_toggle(RED);
-            }
-            else
+            // No data was received within the timeout, log the message
+            LOG0(LOG_RX_TIMEOUT);
+            continue;
+        }
+
+        // Drain the whole burst, one chunk at a time
+        while (count > 0)
+        {
+            for (uint32_t i = 0; i < count; i++)
             {
-                // Invalid input received, log the error
-                prints("Invalid input received.\n\r");
+                // Check the received data and toggle LEDs accordingly
+                if(rx_data[i] == '1')
+                {
+                    LOG0(LOG_RX_GREEN);
+                    led_toggle(GREEN);
+                }
+                else if(rx_data[i] == '2')
+                {
+                    LOG0(LOG_RX_RED);
+                    led_toggle(RED);
+                }
+                else
+                {
+                    // Invalid input received, log the error
+                    LOG1(LOG_RX_INVALID, rx_data[i]);
+                }
             }
+            count = USART2_Read(rx_data, sizeof(rx_data));
         }
-        else
+
+        // Report bytes lost since the last report
+        uint32_t overrun = usart2_rx_overrun;
+        if (overrun != overrun_reported)
         {
-            // No data was received within the timeout, log the message
-            prints("No data received from the queue.\n\r");
+            LOG1(LOG_RX_OVERRUN, overrun - overrun_reported);
+            overrun_reported = overrun;
         }
     }
 }
 
+//------------------------------------------------------------------------------
+// FreeRTOS Task: Log Task
+//------------------------------------------------------------------------------
+//
+// Lowest application priority: formats the records of the deferred log and
+// prints them, so the blocking UART output only ever uses time no other task
+// needs. Records lost to a full log ring are reported as they occur.
+//
+void logTask (void *argument)
+{
+    char line[80];
+    uint32_t dropped_reported = 0;
+
+    for (;;)
+    {
+        while (log_drain(line, sizeof(line)) > 0)
+        {
+            prints(line);
+        }
+
+        uint32_t dropped = log_dropped;
+        if (dropped != dropped_reported)
+        {
+            snprintf(line, sizeof(line), "Log overflow: %lu messages lost.\n\r",
+                     (unsigned long)(dropped - dropped_reported));
+            prints(line);
+            dropped_reported = dropped;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+    }
+}
+
 //------------------------------------------------------------------------------
 // Utility Function: UART Print
 //------------------------------------------------------------------------------
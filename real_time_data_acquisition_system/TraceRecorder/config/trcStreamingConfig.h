@@ -44,6 +44,110 @@ extern "C" {
  */
 #define TRC_CFG_ENTRY_SYMBOL_MAX_LENGTH 28
 
+/**
+ * @def TRC_CFG_EVENT_BUFFER_LOCK_FREE
+ * @brief Set to 1 to write events into the internal event buffer without a
+ * critical section. Space is reserved with LDREX/STREX, so tasks and nested
+ * ISRs write their events concurrently, and the event counter and timestamp
+ * are taken inside the reservation so they stay in buffer order. Each event
+ * is preceded by a commit word in the buffer, and the transfer stops at the
+ * first event that is still being written.
+ *
+ * Requires the stream port internal buffer in direct write mode
+ * (TRC_CFG_STREAM_PORT_USE_INTERNAL_BUFFER 1,
+ * TRC_INTERNAL_EVENT_BUFFER_OPTION_WRITE_MODE_DIRECT), a single core and the
+ * Cortex-M hardware port. Default: 0 (interrupts are masked around each event).
+ */
+#define TRC_CFG_EVENT_BUFFER_LOCK_FREE 0
+
+/**
+ * @def TRC_CFG_EVENT_COMPACT_ENCODING
+ * @brief Set to 1 to stream events in a compact encoding that uses less of
+ * the ITM/SWO bandwidth. The event count is left out, the timestamp is sent
+ * as a variable-length delta from the previous event, and only the 16-bit
+ * event ID (code and parameter count) is kept. An event of two parameters
+ * then takes 11-13 bytes instead of 16.
+ *
+ * Tracealyzer cannot read this encoding directly: the host decoder in
+ * host/trace_decoder.c expands a captured stream back to standard PSF.
+ *
+ * Requires direct streaming (TRC_CFG_STREAM_PORT_USE_INTERNAL_BUFFER 0), a
+ * single core and a 32-bit target. Default: 0 (standard PSF events).
+ */
+#define TRC_CFG_EVENT_COMPACT_ENCODING 0
+
+/**
+ * @def TRC_CFG_EVENT_COMPACT_SYNC_INTERVAL
+ * @brief With TRC_CFG_EVENT_COMPACT_ENCODING, the number of compact events
+ * between two sync events. A sync event is sent in standard PSF form, with
+ * the full event count and timestamp, so the host decoder can start or
+ * recover there. A sync event is also sent after any gap in the event count.
+ */
+#define TRC_CFG_EVENT_COMPACT_SYNC_INTERVAL 256
+
+/**
+ * @def TRC_CFG_EVENT_FILTER
+ * @brief Set to 1 to filter events at runtime, before any buffer space is
+ * taken for them:
+ * - by event class (TRC_EVENT_CLASS_* in trcDefines.h), with
+ *   xTraceEventSetClassMask or vTraceSetFilterMask. Recorder events, symbols
+ *   and object create/delete events are always traced.
+ * - by task or kernel object, with vTraceExcludeTask or
+ *   xTraceEventSetObjectExcluded. Events referring to an excluded object are
+ *   dropped, except its delete event.
+ *
+ * Both can also be changed from the host with CMD_SET_FILTER. Default: 1.
+ */
+#define TRC_CFG_EVENT_FILTER 1
+
+/**
+ * @def TRC_CFG_EVENT_SHEDDING
+ * @brief Set to 1 to drop low-value events while the internal event buffer
+ * is filling up, instead of losing whatever event comes when it is full.
+ * Above TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK percent of the buffer, events of
+ * the classes in TRC_CFG_EVENT_SHEDDING_LOW_CLASSES are dropped, and above
+ * TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK also those in
+ * TRC_CFG_EVENT_SHEDDING_HIGH_CLASSES. Task switch, ISR and recorder events
+ * are never dropped this way.
+ *
+ * Once the buffer is back below the low watermark, TzCtrl records what was
+ * dropped as a User Event on the "Trace load shedding" channel: the number of
+ * events, their classes (TRC_EVENT_CLASS_* in trcDefines.h) and the time from
+ * the first to the last one. It is recorded even while the class mask of
+ * TRC_CFG_EVENT_FILTER excludes User Events.
+ *
+ * Requires the stream port internal buffer
+ * (TRC_CFG_STREAM_PORT_USE_INTERNAL_BUFFER 1). Default: 0.
+ */
+#define TRC_CFG_EVENT_SHEDDING 0
+
+/**
+ * @def TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK
+ * @brief With TRC_CFG_EVENT_SHEDDING, the buffer usage in percent above which
+ * TRC_CFG_EVENT_SHEDDING_LOW_CLASSES are dropped.
+ */
+#define TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK 75
+
+/**
+ * @def TRC_CFG_EVENT_SHEDDING_LOW_CLASSES
+ * @brief With TRC_CFG_EVENT_SHEDDING, the event classes dropped first.
+ */
+#define TRC_CFG_EVENT_SHEDDING_LOW_CLASSES (TRC_EVENT_CLASS_OS_TICK | TRC_EVENT_CLASS_TASK_READY | TRC_EVENT_CLASS_USER)
+
+/**
+ * @def TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK
+ * @brief With TRC_CFG_EVENT_SHEDDING, the buffer usage in percent above which
+ * TRC_CFG_EVENT_SHEDDING_HIGH_CLASSES are dropped as well.
+ */
+#define TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK 90
+
+/**
+ * @def TRC_CFG_EVENT_SHEDDING_HIGH_CLASSES
+ * @brief With TRC_CFG_EVENT_SHEDDING, the event classes also dropped above the
+ * high watermark.
+ */
+#define TRC_CFG_EVENT_SHEDDING_HIGH_CLASSES (TRC_EVENT_CLASS_ALL)
+
 #ifdef __cplusplus
 }
 #endif
@@ -34,9 +34,15 @@
 
 /* Command codes for TzCtrl task */
 #define CMD_SET_ACTIVE      1 /* Start (param1 = 1) or Stop (param1 = 0) */
+#define CMD_SET_FILTER      2 /* Event filter (TRC_CFG_EVENT_FILTER): param1 = CMD_FILTER_*, param2..param5 = value, least significant byte first */
 
 /* The final command code, used to validate commands. */
-#define CMD_LAST_COMMAND 1
+#define CMD_LAST_COMMAND 2
+
+/* Filters set by CMD_SET_FILTER */
+#define CMD_FILTER_CLASS_MASK		0 /* Value is the event class mask (TRC_EVENT_CLASS_*) */
+#define CMD_FILTER_EXCLUDE_OBJECT	1 /* Value is the address of the task or object to exclude */
+#define CMD_FILTER_INCLUDE_OBJECT	2 /* Value is the address of the task or object to trace again */
 
 #define TRC_RECORDER_MODE_SNAPSHOT		0
 #define TRC_RECORDER_MODE_STREAMING		1
@@ -130,6 +136,24 @@
 #define FilterGroup14 (uint16_t)0x4000
 #define FilterGroup15 (uint16_t)0x8000
 
+/* Event classes for the streaming event filter (TRC_CFG_EVENT_FILTER). The
+ * kernel port assigns each event code to one class. */
+#define TRC_EVENT_CLASS_RECORDER		0x0001UL /* Recorder, symbol and object create/delete events, always traced */
+#define TRC_EVENT_CLASS_TASK_SWITCH		0x0002UL /* Task switches */
+#define TRC_EVENT_CLASS_ISR				0x0004UL /* ISR begin and resume */
+#define TRC_EVENT_CLASS_TASK_READY		0x0008UL /* Tasks made ready */
+#define TRC_EVENT_CLASS_OS_TICK			0x0010UL /* OS ticks */
+#define TRC_EVENT_CLASS_TASK			0x0020UL /* Task priority, delay, suspend/resume and notifications */
+#define TRC_EVENT_CLASS_QUEUE			0x0040UL /* Queues, semaphores and mutexes */
+#define TRC_EVENT_CLASS_TIMER			0x0080UL /* Timers and pended function calls */
+#define TRC_EVENT_CLASS_EVENT_GROUP		0x0100UL /* Event groups */
+#define TRC_EVENT_CLASS_STREAM_BUFFER	0x0200UL /* Stream and message buffers */
+#define TRC_EVENT_CLASS_MEMORY			0x0400UL /* Heap allocation */
+#define TRC_EVENT_CLASS_LOW_POWER		0x0800UL /* Low power mode */
+#define TRC_EVENT_CLASS_USER			0x1000UL /* User events (xTracePrint etc.) */
+#define TRC_EVENT_CLASS_APPLICATION		0x2000UL /* State machines, intervals, counters, runnables, stack reports and extensions */
+#define TRC_EVENT_CLASS_ALL				0xFFFFUL
+
 /**
  *
  */
@@ -29,7 +29,6 @@ extern "C" {
  * @{
  */
 
-#define TRC_ENTRY_CREATE_WITH_ADDRESS(_pvAddress, _pxEntryHandle) (xTraceEntryCreate(_pxEntryHandle) == TRC_SUCCESS ? (((TraceEntry_t*)*(_pxEntryHandle))->pvAddress = (_pvAddress), TRC_SUCCESS) : TRC_FAIL)
 #define TRC_ENTRY_SET_STATE(xEntryHandle, uxStateIndex, uxState) TRC_COMMA_EXPR_TO_STATEMENT_EXPR_2(((TraceEntry_t*)(xEntryHandle))->xStates[uxStateIndex] = (uxState), TRC_SUCCESS)
 #define TRC_ENTRY_SET_OPTIONS(xEntryHandle, uiMask) TRC_COMMA_EXPR_TO_STATEMENT_EXPR_2(((TraceEntry_t*)(xEntryHandle))->uiOptions |= (uiMask), TRC_SUCCESS)
 #define TRC_ENTRY_CLEAR_OPTIONS(xEntryHandle, uiMask) TRC_COMMA_EXPR_TO_STATEMENT_EXPR_2(((TraceEntry_t*)(xEntryHandle))->uiOptions &= ~(uiMask), TRC_SUCCESS)
@@ -56,11 +55,26 @@ typedef uint8_t TraceEntryIndex_t;
 
 #define TRC_ENTRY_TABLE_SLOTS ((((TRC_CFG_ENTRY_SLOTS) + (TRC_ENTRY_INDEX_ALIGNMENT_MULTIPLE) - 1) / TRC_ENTRY_INDEX_ALIGNMENT_MULTIPLE) * TRC_ENTRY_INDEX_ALIGNMENT_MULTIPLE)
 
+/* The address index maps entry addresses to entry indexes with open addressing
+ * (linear probing). It has twice as many slots as the entry table, so it is at
+ * most half full and a lookup takes about two probes on average. An empty slot
+ * holds TRC_ENTRY_ADDRESS_INDEX_EMPTY, which must not be a valid entry index. */
+#define TRC_ENTRY_ADDRESS_INDEX_SLOTS ((TRC_ENTRY_TABLE_SLOTS) * 2)
+
+#if (TRC_ENTRY_TABLE_SLOTS >= 256UL)
+typedef uint16_t TraceEntryAddressIndex_t;
+#else
+typedef uint8_t TraceEntryAddressIndex_t;
+#endif
+
+#define TRC_ENTRY_ADDRESS_INDEX_EMPTY ((TraceEntryAddressIndex_t)~(TraceEntryAddressIndex_t)0)
+
 typedef struct EntryIndexTable	/* Aligned because TRC_ENTRY_TABLE_SLOTS is always a multiple that aligns to 64-bit */
 {
 	TraceEntryIndex_t axFreeIndexes[TRC_ENTRY_TABLE_SLOTS];	/* slot count and size is aligned to 64-bit */
+	TraceEntryAddressIndex_t axAddressIndex[TRC_ENTRY_ADDRESS_INDEX_SLOTS];	/* twice an aligned slot count, so also aligned to 64-bit */
 	uint32_t uiFreeIndexCount;
-	uint32_t reserved;			/* alignment */
+	uint32_t uiLongestProbe;	/* Longest distance from an address' hash slot to its slot so far, bounds the lookup */
 } TraceEntryIndexTable_t;
 
 /** Trace Entry Structure */
@@ -129,6 +143,11 @@ traceResult xTraceEntryDelete(TraceEntryHandle_t xEntryHandle);
 /**
  * @brief Finds trace entry mapped to object address.
  * 
+ * The address is looked up in the address index, which is kept up to date by
+ * xTraceEntryCreate(), xTraceEntryCreateWithAddress() and xTraceEntryDelete().
+ * A lookup probes at most uiLongestProbe + 1 slots, regardless of the number
+ * of entries.
+ * 
  * @param[in] pvAddress Address of object.
  * @param[out] pxEntryHandle Pointer to uninitialized trace entry handle.
  * 
@@ -170,8 +189,6 @@ traceResult xTraceEntryGetAtIndex(uint32_t index, TraceEntryHandle_t* pxEntryHan
  */
 traceResult xTraceEntrySetSymbol(const TraceEntryHandle_t xEntryHandle, const char* szSymbol, uint32_t uiLength);
 
-#if ((TRC_CFG_USE_TRACE_ASSERT) == 1)
-
 /**
  * @brief Creates trace entry mapped to memory address.
  * 
@@ -183,6 +200,8 @@ traceResult xTraceEntrySetSymbol(const TraceEntryHandle_t xEntryHandle, const ch
  */
 traceResult xTraceEntryCreateWithAddress(void* const pvAddress, TraceEntryHandle_t* pxEntryHandle);
 
+#if ((TRC_CFG_USE_TRACE_ASSERT) == 1)
+
 /**
  * @brief Sets trace entry state.
  * 
@@ -283,8 +302,6 @@ traceResult xTraceEntryGetOptions(const TraceEntryHandle_t xEntryHandle, uint32_
 
 #else
 
-#define xTraceEntryCreateWithAddress TRC_ENTRY_CREATE_WITH_ADDRESS
-
 #define xTraceEntrySetState TRC_ENTRY_SET_STATE
 #define xTraceEntrySetOptions TRC_ENTRY_SET_OPTIONS
 #define xTraceEntryClearOptions TRC_ENTRY_CLEAR_OPTIONS
@@ -109,14 +109,90 @@ typedef struct TraceCoreEventData	/* Aligned */
 	uint32_t reserved;											/* alignment */
 } TraceCoreEventData_t;
 
+#if (TRC_CFG_EVENT_COMPACT_ENCODING == 1)
+
+/* Compact encoding (TRC_CFG_EVENT_COMPACT_ENCODING), byte by byte:
+ * - Compact event: EventID high byte, EventID low byte, timestamp delta from
+ *   the previous event as LEB128 (7 bits per byte, low bits first, bit 7 set
+ *   on all but the last byte), then the parameters. EventCount is the previous
+ *   one plus one. The first byte is below 0xF0 since no event has more than 14
+ *   parameters.
+ * - TRC_EVENT_COMPACT_SYNC followed by the event in standard PSF form.
+ * - TRC_EVENT_COMPACT_PRELUDE: the PSF header, timestamp info and entry table
+ *   follow after the padding, as on trace start.
+ * - TRC_EVENT_COMPACT_PAD: fills the last ITM word, skipped.
+ */
+#define TRC_EVENT_COMPACT_SYNC 0xF0U
+#define TRC_EVENT_COMPACT_PRELUDE 0xFEU
+#define TRC_EVENT_COMPACT_PAD 0xFFU
+
+/* Room for 3 pending bytes, a marker byte and the largest event, in whole TraceUnsignedBaseType_t */
+#define TRC_EVENT_COMPACT_STAGING_SIZE (TRC_MAX_BLOB_SIZE + sizeof(TraceUnsignedBaseType_t) * (4UL / sizeof(TraceUnsignedBaseType_t) + 1UL))
+
+/**
+ * @internal Trace Event Compact Encoding Structure
+ */
+typedef struct TraceEventCompactData	/* Aligned */
+{
+	TraceUnsignedBaseType_t uxStaging[TRC_EVENT_COMPACT_STAGING_SIZE / sizeof(TraceUnsignedBaseType_t)];	/**< Bytes not yet written, a partial word first */
+	uint32_t uiPendingBytes;		/**< Bytes of the partial word */
+	uint32_t uiLastTimestamp;		/**< Timestamp the next delta is taken from */
+	uint32_t uiEventsToSync;		/**< Compact events left before the next sync event, 0 forces one */
+	uint32_t uiLastEventCount;		/**< EventCount of the previous event */
+	uint32_t uiEventsWritten;		/**< Events written since the last header */
+	uint32_t reserved;				/* alignment */
+} TraceEventCompactData_t;
+
+#endif
+
+#if (TRC_CFG_EVENT_FILTER == 1)
+
+/**
+ * @internal Trace Event Filter Structure
+ */
+typedef struct TraceEventFilterData	/* Aligned */
+{
+	uint32_t uiClassMask;			/**< Event classes traced (TRC_EVENT_CLASS_*) */
+	uint32_t uiExcludedObjects;		/**< Entries with TRC_ENTRY_OPTION_EXCLUDED, objects are only looked up while there are any */
+} TraceEventFilterData_t;
+
+#endif
+
+#if (TRC_CFG_EVENT_SHEDDING == 1)
+
+/**
+ * @internal Trace Event Shedding Structure
+ */
+typedef struct TraceEventShedData	/* Aligned */
+{
+	uint32_t uiEvents;				/**< Events dropped since the last report */
+	uint32_t uiClasses;				/**< Classes of the dropped events (TRC_EVENT_CLASS_*) */
+	uint32_t uiFirstTimestamp;		/**< Timestamp of the first dropped event */
+	uint32_t uiLastTimestamp;		/**< Timestamp of the last dropped event */
+	TraceStringHandle_t xChannel;	/**< User Event channel of the reports */
+} TraceEventShedData_t;
+
+#endif
+
 /** 
  * @internal Trace Event Data Table Structure.
  */
 typedef struct TraceEventDataTable	/* Aligned */
 {
 	TraceCoreEventData_t coreEventData[TRC_CFG_CORE_COUNT]; /**< Holds data about current event for each core/isr depth */
+#if (TRC_CFG_EVENT_COMPACT_ENCODING == 1)
+	TraceEventCompactData_t xCompactData;	/**< */
+#endif
+#if (TRC_CFG_EVENT_FILTER == 1)
+	TraceEventFilterData_t xFilterData;		/**< */
+#endif
+#if (TRC_CFG_EVENT_SHEDDING == 1)
+	TraceEventShedData_t xShedData;			/**< */
+#endif
 } TraceEventDataTable_t;
 
+extern TraceEventDataTable_t* pxTraceEventDataTable;
+
 /**
  * @internal Initialize event trace system.
  * 
@@ -358,6 +434,120 @@ traceResult xTraceEventCreateData6(uint32_t uiEventCode, TraceUnsignedBaseType_t
  */
 traceResult xTraceEventGetSize(const void* const pvAddress, uint32_t* puiSize);
 
+#if (TRC_CFG_EVENT_COMPACT_ENCODING == 1)
+
+/**
+ * @internal Writes out the bytes of the last compact event that do not fill
+ * an ITM word, padded with TRC_EVENT_COMPACT_PAD. Called periodically by
+ * TzCtrl so the last event of a burst reaches the host.
+ * 
+ * @retval TRC_FAIL Failure
+ * @retval TRC_SUCCESS Success
+ */
+traceResult xTraceEventCompactFlush(void);
+
+#endif
+
+#if (TRC_CFG_EVENT_FILTER == 1)
+
+/**
+ * @brief Sets the event classes to trace. Events of other classes are
+ * dropped before any buffer space is taken for them. TRC_EVENT_CLASS_RECORDER
+ * is always traced.
+ *
+ * @param[in] uiClassMask Event classes (TRC_EVENT_CLASS_*).
+ *
+ * @retval TRC_FAIL Failure
+ * @retval TRC_SUCCESS Success
+ */
+traceResult xTraceEventSetClassMask(uint32_t uiClassMask);
+
+/**
+ * @brief Gets the event classes traced.
+ *
+ * @param[out] puiClassMask Event classes (TRC_EVENT_CLASS_*).
+ *
+ * @retval TRC_FAIL Failure
+ * @retval TRC_SUCCESS Success
+ */
+traceResult xTraceEventGetClassMask(uint32_t* puiClassMask);
+
+/**
+ * @brief Excludes a task or kernel object from the trace, or traces it again.
+ * While excluded, the events referring to it are dropped, except its delete
+ * event. The object must be registered, i.e. created after xTraceInitialize.
+ *
+ * @param[in] pvObject Address of the task or object.
+ * @param[in] uiExcluded 1 to exclude, 0 to trace again.
+ *
+ * @retval TRC_FAIL Failure, object not registered
+ * @retval TRC_SUCCESS Success
+ */
+traceResult xTraceEventSetObjectExcluded(void* pvObject, uint32_t uiExcluded);
+
+/**
+ * @brief Applies a filter received with CMD_SET_FILTER: the class mask, or
+ * the exclusion of an object given by its (32-bit) address.
+ *
+ * @param[in] uiFilter Filter to set (CMD_FILTER_*).
+ * @param[in] uiValue Class mask or object address.
+ *
+ * @retval TRC_FAIL Failure, unknown filter or object not registered
+ * @retval TRC_SUCCESS Success
+ */
+traceResult xTraceEventSetFilter(uint32_t uiFilter, uint32_t uiValue);
+
+/**
+ * @internal Looks the object up in the entry table. Use
+ * xTraceEventIsObjectExcluded instead.
+ *
+ * @param[in] pvObject Address of the task or object.
+ *
+ * @returns 1 if the object is excluded, 0 otherwise
+ */
+TraceUnsignedBaseType_t xTraceEventIsObjectExcludedInternal(void* pvObject);
+
+/**
+ * @brief Checks if events referring to a task or object are to be dropped.
+ * Costs a single load while no object is excluded.
+ *
+ * @param[in] pvObject Address of the task or object.
+ */
+#define xTraceEventIsObjectExcluded(pvObject) (xTraceIsRecorderEnabled() && (pxTraceEventDataTable->xFilterData.uiExcludedObjects != 0u) && (xTraceEventIsObjectExcludedInternal((void*)(pvObject)) != 0u))
+
+#else
+
+#define xTraceEventSetClassMask(_uiClassMask) TRC_COMMA_EXPR_TO_STATEMENT_EXPR_2((void)(_uiClassMask), TRC_SUCCESS)
+
+#define xTraceEventGetClassMask(_puiClassMask) TRC_COMMA_EXPR_TO_STATEMENT_EXPR_2(*(_puiClassMask) = (uint32_t)(TRC_EVENT_CLASS_ALL), TRC_SUCCESS)
+
+#define xTraceEventSetObjectExcluded(_pvObject, _uiExcluded) TRC_COMMA_EXPR_TO_STATEMENT_EXPR_3((void)(_pvObject), (void)(_uiExcluded), TRC_SUCCESS)
+
+#define xTraceEventSetFilter(_uiFilter, _uiValue) TRC_COMMA_EXPR_TO_STATEMENT_EXPR_3((void)(_uiFilter), (void)(_uiValue), TRC_SUCCESS)
+
+#define xTraceEventIsObjectExcluded(_pvObject) TRC_COMMA_EXPR_TO_STATEMENT_EXPR_2((void)(_pvObject), 0)
+
+#endif
+
+#if (TRC_CFG_EVENT_SHEDDING == 1)
+
+/**
+ * @internal Records the events dropped by TRC_CFG_EVENT_SHEDDING as a User
+ * Event, once the internal event buffer is back below the low watermark.
+ * The event is recorded even if User Events are masked by TRC_CFG_EVENT_FILTER.
+ * Called periodically by TzCtrl.
+ *
+ * @retval TRC_FAIL Failure
+ * @retval TRC_SUCCESS Success
+ */
+traceResult xTraceEventSheddingCheckStatus(void);
+
+#else
+
+#define xTraceEventSheddingCheckStatus() TRC_COMMA_EXPR_TO_STATEMENT_EXPR_1(TRC_SUCCESS)
+
+#endif
+
 /** @} */
 
 #ifdef __cplusplus
@@ -43,6 +43,10 @@ extern "C" {
 
 /**
  * @brief Trace Event Buffer Structure
+ *
+ * With TRC_CFG_EVENT_BUFFER_LOCK_FREE, uiHead holds the event counter in its
+ * upper 16 bits and the head index in its lower 16 bits, so that both are
+ * updated by one exclusive store, and uiFree, uiSlack and uiNextHead are unused.
  */
 typedef struct TraceEventBuffer	/* Aligned */
 {
@@ -83,6 +87,10 @@ traceResult xTraceEventBufferInitialize(TraceEventBuffer_t *pxTraceEventBuffer,
 /**
  * @brief Allocates a data slot directly from the event buffer.
  *
+ * With TRC_CFG_EVENT_BUFFER_LOCK_FREE, the slot is reserved without a critical
+ * section and uiSize must be at least sizeof(TraceEvent0_t): the EventCount and
+ * TS fields of the event are filled in here, and the caller sets the rest.
+ *
  * @param[in] pxTraceEventBuffer Pointer to initialized trace event buffer.
  * @param[in] uiSize Allocation size
  * @param[out] ppvData Pointer that will hold the area from the buffer.
@@ -165,6 +173,19 @@ traceResult xTraceEventBufferTransferChunk(TraceEventBuffer_t* pxTraceEventBuffe
  */
 traceResult xTraceEventBufferClear(TraceEventBuffer_t* pxTraceEventBuffer);
 
+/**
+ * @internal Gets the number of bytes in the event buffer not yet transferred.
+ * Safe to call from any context, the result may be slightly off if events are
+ * written or transferred meanwhile.
+ *
+ * @param[in] pxTraceEventBuffer Pointer to initialized trace event buffer.
+ * @param[out] puiUsed Bytes in use.
+ *
+ * @retval TRC_FAIL Failure
+ * @retval TRC_SUCCESS Success
+ */
+traceResult xTraceEventBufferGetUsage(const TraceEventBuffer_t* pxTraceEventBuffer, uint32_t* puiUsed);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -162,6 +162,18 @@ traceResult xTraceInternalEventBufferTransferChunk(void);
  */
 traceResult xTraceInternalEventBufferClear(void);
 
+/**
+ * @internal Gets how much of the internal trace event buffer of the current
+ * core is waiting to be transferred. Safe to call from any context.
+ *
+ * @param[out] puiUsed Bytes in use.
+ * @param[out] puiSize Buffer size in bytes.
+ *
+ * @retval TRC_FAIL Failure
+ * @retval TRC_SUCCESS Success
+ */
+traceResult xTraceInternalEventBufferGetUsage(uint32_t* puiUsed, uint32_t* puiSize);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -177,6 +189,7 @@ traceResult xTraceInternalEventBufferClear(void);
 #define xTraceInternalEventBufferTransfer() (void)(TRC_SUCCESS)
 #define xTraceInternalEventBufferTransferChunk(piBytesWritten, uiChunkSize) ((void)(piBytesWritten), (void)(uiChunkSize), TRC_SUCCESS)
 #define xTraceInternalEventBufferClear() (void)(TRC_SUCCESS)
+#define xTraceInternalEventBufferGetUsage(puiUsed, puiSize) TRC_COMMA_EXPR_TO_STATEMENT_EXPR_3(*(puiUsed) = 0u, *(puiSize) = 0u, TRC_SUCCESS)
 
 #endif /* (TRC_USE_INTERNAL_BUFFER == 1)*/
 
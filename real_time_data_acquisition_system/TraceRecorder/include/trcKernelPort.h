@@ -2191,6 +2191,16 @@ TraceHeapHandle_t xTraceKernelPortGetSystemHeapHandle(void);
 
 #define TRC_EVENT_LAST_ID									(PSF_EVENT_DEPENDENCY_REGISTER)
 
+#if (TRC_CFG_EVENT_FILTER == 1)
+
+/* Event class (TRC_EVENT_CLASS_*) of each event code, 0 for recorder events, see trcKernelPort.c */
+extern const uint16_t ausTraceKernelPortEventClass[(TRC_EVENT_LAST_ID) + 1];
+
+/* Event codes after TRC_EVENT_LAST_ID belong to extensions */
+#define TRC_KERNEL_PORT_EVENT_CLASS(uiEventCode) (((uint32_t)(uiEventCode) <= (uint32_t)(TRC_EVENT_LAST_ID)) ? ((ausTraceKernelPortEventClass[(uiEventCode)] != 0u) ? (uint32_t)ausTraceKernelPortEventClass[(uiEventCode)] : (uint32_t)(TRC_EVENT_CLASS_RECORDER)) : (uint32_t)(TRC_EVENT_CLASS_APPLICATION))
+
+#endif
+
 /*** The trace macros for streaming ******************************************/
 
 /* A macro that will update the tick count when returning from tickless idle */
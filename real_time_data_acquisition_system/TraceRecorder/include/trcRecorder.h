@@ -113,6 +113,46 @@ typedef uint8_t traceHandle;
 #define TRC_CFG_USE_GCC_STATEMENT_EXPR 0
 #endif
 
+/* Unless specified in trcStreamingConfig.h events are written in a critical section */
+#ifndef TRC_CFG_EVENT_BUFFER_LOCK_FREE
+#define TRC_CFG_EVENT_BUFFER_LOCK_FREE 0
+#endif
+
+/* Unless specified in trcStreamingConfig.h events are streamed as standard PSF */
+#ifndef TRC_CFG_EVENT_COMPACT_ENCODING
+#define TRC_CFG_EVENT_COMPACT_ENCODING 0
+#endif
+
+#ifndef TRC_CFG_EVENT_COMPACT_SYNC_INTERVAL
+#define TRC_CFG_EVENT_COMPACT_SYNC_INTERVAL 256
+#endif
+
+/* Unless specified in trcStreamingConfig.h all events are traced */
+#ifndef TRC_CFG_EVENT_FILTER
+#define TRC_CFG_EVENT_FILTER 0
+#endif
+
+/* Unless specified in trcStreamingConfig.h events are only lost when the buffer is full */
+#ifndef TRC_CFG_EVENT_SHEDDING
+#define TRC_CFG_EVENT_SHEDDING 0
+#endif
+
+#ifndef TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK
+#define TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK 75
+#endif
+
+#ifndef TRC_CFG_EVENT_SHEDDING_LOW_CLASSES
+#define TRC_CFG_EVENT_SHEDDING_LOW_CLASSES (TRC_EVENT_CLASS_OS_TICK | TRC_EVENT_CLASS_TASK_READY | TRC_EVENT_CLASS_USER)
+#endif
+
+#ifndef TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK
+#define TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK 90
+#endif
+
+#ifndef TRC_CFG_EVENT_SHEDDING_HIGH_CLASSES
+#define TRC_CFG_EVENT_SHEDDING_HIGH_CLASSES (TRC_EVENT_CLASS_ALL)
+#endif
+
 /* Backwards compatibility */
 #undef traceHandle
 #define traceHandle TraceISRHandle_t
@@ -276,6 +316,9 @@ traceResult xTraceDisable(void);
  * with vTraceSetFilterMask allows you to control what events that are recorded,
  * based on the objects they refer to.
  *
+ * Streaming mode has no filter groups, it excludes objects one by one with
+ * vTraceExcludeTask and xTraceEventSetObjectExcluded (TRC_CFG_EVENT_FILTER).
+ *
  * There are 16 filter groups named FilterGroup0 .. FilterGroup15.
  *
  * Note: We don't recommend filtering out the Idle task, so make sure to call 
@@ -336,6 +379,11 @@ void vTraceSetFilterGroup(uint16_t filterGroup);
  * events that are recorded, based on the objects they refer to.
  *
  * See example for vTraceSetFilterGroup.
+ *
+ * In streaming mode (TRC_CFG_EVENT_FILTER), the mask selects event classes
+ * instead: TRC_EVENT_CLASS_* in trcDefines.h, e.g.
+ * vTraceSetFilterMask(TRC_EVENT_CLASS_ALL & ~TRC_EVENT_CLASS_OS_TICK). The
+ * host can change it with CMD_SET_FILTER. See xTraceEventSetClassMask.
  * 
  * @param[in] filterMask Filter mask
  */
@@ -1745,7 +1793,7 @@ traceResult xTraceTzCtrl(void);
  * @param[in] _eventID Event id
  * @param[in] _handle Handle
  */
-#define prvTraceStoreEvent_Handle(_eventID, _handle) xTraceEventCreate1(_eventID, (TraceUnsignedBaseType_t)(_handle))
+#define prvTraceStoreEvent_Handle(_eventID, _handle) (xTraceEventIsObjectExcluded(_handle) ? TRC_SUCCESS : xTraceEventCreate1(_eventID, (TraceUnsignedBaseType_t)(_handle)))
 
 /**
  * @brief Stores an event with one parameter
@@ -1762,7 +1810,7 @@ traceResult xTraceTzCtrl(void);
  * @param[in] _handle Handle
  * @param[in] _param1 Param
  */
-#define prvTraceStoreEvent_HandleParam(_eventID, _handle, _param1) xTraceEventCreate2(_eventID, (TraceUnsignedBaseType_t)(_handle), (TraceUnsignedBaseType_t)(_param1))
+#define prvTraceStoreEvent_HandleParam(_eventID, _handle, _param1) (xTraceEventIsObjectExcluded(_handle) ? TRC_SUCCESS : xTraceEventCreate2(_eventID, (TraceUnsignedBaseType_t)(_handle), (TraceUnsignedBaseType_t)(_param1)))
 
 /**
  * @brief Stores an event with two parameters
@@ -1781,7 +1829,7 @@ traceResult xTraceTzCtrl(void);
  * @param[in] _param1 Param 1
  * @param[in] _param2 Param 2
  */
-#define prvTraceStoreEvent_HandleParamParam(_eventID, _handle, _param1, _param2) xTraceEventCreate3(_eventID, (TraceUnsignedBaseType_t)(_handle), (TraceUnsignedBaseType_t)(_param1), (TraceUnsignedBaseType_t)(_param2))
+#define prvTraceStoreEvent_HandleParamParam(_eventID, _handle, _param1, _param2) (xTraceEventIsObjectExcluded(_handle) ? TRC_SUCCESS : xTraceEventCreate3(_eventID, (TraceUnsignedBaseType_t)(_handle), (TraceUnsignedBaseType_t)(_param1), (TraceUnsignedBaseType_t)(_param2)))
 
 /**
  * @brief Stores an event with three parameters
@@ -1793,6 +1841,16 @@ traceResult xTraceTzCtrl(void);
  */
 #define prvTraceStoreEvent_ParamParamParam(_eventID, _param1, _param2, _param3) xTraceEventCreate3(_eventID, (TraceUnsignedBaseType_t)(_param1), (TraceUnsignedBaseType_t)(_param2), (TraceUnsignedBaseType_t)(_param3))
 
+/**
+ * @brief Excludes a task from the trace (TRC_CFG_EVENT_FILTER). The task then
+ * seems not to run, and its ready and priority events are dropped. Use
+ * xTraceEventSetObjectExcluded to trace it again, or to exclude other kernel
+ * objects.
+ * 
+ * @param[in] handle Task handle
+ */
+#define vTraceExcludeTask(handle) (void)xTraceEventSetObjectExcluded((void*)(handle), 1u)
+
 /**
  * @brief Snapshot mode only. Trace stop hook.
  * 
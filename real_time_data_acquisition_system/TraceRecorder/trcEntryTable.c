@@ -24,11 +24,21 @@
 #define GET_FREE_INDEX_COUNT() pxIndexTable->uiFreeIndexCount
 
 /* Index = (EntryAddress - FirstEntryAddress) / EntrySize */
-#define CALCULATE_ENTRY_INDEX(xEntryHandle) (TraceEntryIndex_t)(((TraceUnsignedBaseType_t)(xEntryHandle) - (TraceUnsignedBaseType_t)&pxEntryTable->axEntries[0]) / sizeof(TraceEntry_t))
+#define CALCULATE_ENTRY_INDEX(xEntryHandle) (TraceEntryIndex_t)(((TraceUnsignedBaseType_t)(uintptr_t)(xEntryHandle) - (TraceUnsignedBaseType_t)(uintptr_t)&pxEntryTable->axEntries[0]) / sizeof(TraceEntry_t))
+
+/* Wraps an address index slot around the end of the table */
+#define NEXT_ADDRESS_INDEX_SLOT(uiSlot) (((uiSlot) + 1u < (uint32_t)(TRC_ENTRY_ADDRESS_INDEX_SLOTS)) ? ((uiSlot) + 1u) : 0u)
+
+/* Number of slots from uiFrom forward to uiTo, around the end of the table */
+#define ADDRESS_INDEX_DISTANCE(uiFrom, uiTo) (((uiTo) >= (uiFrom)) ? ((uiTo) - (uiFrom)) : ((uiTo) + (uint32_t)(TRC_ENTRY_ADDRESS_INDEX_SLOTS) - (uiFrom)))
 
 /* Private function definitions */
 static traceResult prvEntryIndexInitialize(void);
 static traceResult prvEntryIndexTake(TraceEntryIndex_t *pxIndex);
+static traceResult prvEntryCreate(void* const pvAddress, TraceEntryHandle_t* pxEntryHandle);
+static uint32_t prvEntryAddressHash(const void* const pvAddress);
+static void prvEntryAddressInsert(TraceEntryIndex_t xIndex);
+static void prvEntryAddressRemove(TraceEntryIndex_t xIndex);
 
 /* Variables */
 static TraceEntryTable_t *pxEntryTable TRC_CFG_RECORDER_DATA_ATTRIBUTE;
@@ -77,49 +87,8 @@ traceResult xTraceEntryTableInitialize(TraceEntryTable_t* const pxBuffer)
 
 traceResult xTraceEntryCreate(TraceEntryHandle_t *pxEntryHandle)
 {
-	uint32_t i;
-	TraceEntryIndex_t xIndex;
-	TraceEntry_t *pxEntry;
-
-	TRACE_ALLOC_CRITICAL_SECTION();
-
-	/* We always check this */
-	if (xTraceIsComponentInitialized(TRC_RECORDER_COMPONENT_ENTRY) == 0U)
-	{
-		return TRC_FAIL;
-	}
-
-	/* This should never fail */
-	TRC_ASSERT(pxEntryHandle != (void*)0);
-
-	TRACE_ENTER_CRITICAL_SECTION();
-
-	if (prvEntryIndexTake(&xIndex) != TRC_SUCCESS)
-	{
-		(void)xTraceDiagnosticsIncrease(TRC_DIAGNOSTICS_ENTRY_SLOTS_NO_ROOM);
-
-		TRACE_EXIT_CRITICAL_SECTION();
-
-		return TRC_FAIL;
-	}
-
-	pxEntry = &pxEntryTable->axEntries[xIndex];
-	
-	pxEntry->pvAddress = (void*)pxEntry; /* We set a temporary address */
-
-	for (i = 0u; i < (uint32_t)(TRC_ENTRY_TABLE_STATE_COUNT); i++)
-	{
-		pxEntry->xStates[i] = (TraceUnsignedBaseType_t)0;
-	}
-
-	pxEntry->uiOptions = 0u;
-	pxEntry->szSymbol[0] = (char)0; /*cstat !MISRAC2004-6.3 !MISRAC2012-Dir-4.6_a Suppress basic char type usage*/
-
-	*pxEntryHandle = (TraceEntryHandle_t)pxEntry;
-
-	TRACE_EXIT_CRITICAL_SECTION();
-
-	return TRC_SUCCESS;
+	/* A temporary address, the entry itself */
+	return prvEntryCreate((void*)0, pxEntryHandle);
 }
 
 traceResult xTraceEntryDelete(TraceEntryHandle_t xEntryHandle)
@@ -152,6 +121,8 @@ traceResult xTraceEntryDelete(TraceEntryHandle_t xEntryHandle)
 	}
 
 	/* A valid address, so we assume it is OK. */
+	prvEntryAddressRemove(xIndex);
+
 	/* We clear the address field which is used on host to see if entries are active. */
 	((TraceEntry_t*)xEntryHandle)->pvAddress = 0;
 
@@ -165,8 +136,10 @@ traceResult xTraceEntryDelete(TraceEntryHandle_t xEntryHandle)
 
 traceResult xTraceEntryFind(const void* const pvAddress, TraceEntryHandle_t* pxEntryHandle)
 {
-	uint32_t i;
-	TraceEntry_t* pxEntry;
+	uint32_t uiSlot, uiProbe;
+	TraceEntryAddressIndex_t xIndex;
+
+	TRACE_ALLOC_CRITICAL_SECTION();
 
 	/* This should never fail */
 	TRC_ASSERT(xTraceIsComponentInitialized(TRC_RECORDER_COMPONENT_ENTRY));
@@ -177,17 +150,35 @@ traceResult xTraceEntryFind(const void* const pvAddress, TraceEntryHandle_t* pxE
 	/* This should never fail */
 	TRC_ASSERT(pvAddress != (void*)0);
 
-	for (i = 0u; i < (uint32_t)(TRC_ENTRY_TABLE_SLOTS); i++)
+	uiSlot = prvEntryAddressHash(pvAddress);
+
+	/* Locked since an entry deleted from an ISR moves the entries after it */
+	TRACE_ENTER_CRITICAL_SECTION();
+
+	/* No address lies further from its hash slot than the longest probe so far */
+	for (uiProbe = 0u; uiProbe <= pxIndexTable->uiLongestProbe; uiProbe++)
 	{
-		pxEntry = &pxEntryTable->axEntries[i];
-		if (pxEntry->pvAddress == pvAddress)
+		xIndex = pxIndexTable->axAddressIndex[uiSlot];
+		if (xIndex == TRC_ENTRY_ADDRESS_INDEX_EMPTY)
 		{
-			*pxEntryHandle = (TraceEntryHandle_t)pxEntry;
+			/* The end of the run of slots that could hold it */
+			break;
+		}
+
+		if (pxEntryTable->axEntries[xIndex].pvAddress == pvAddress)
+		{
+			*pxEntryHandle = (TraceEntryHandle_t)&pxEntryTable->axEntries[xIndex];
+
+			TRACE_EXIT_CRITICAL_SECTION();
 
 			return TRC_SUCCESS;
 		}
+
+		uiSlot = NEXT_ADDRESS_INDEX_SLOT(uiSlot);
 	}
 
+	TRACE_EXIT_CRITICAL_SECTION();
+
 	return TRC_FAIL;
 }
 
@@ -256,16 +247,16 @@ traceResult xTraceEntryGetAtIndex(uint32_t index, TraceEntryHandle_t* pxEntryHan
 	return TRC_SUCCESS;
 }
 
-#if ((TRC_CFG_USE_TRACE_ASSERT) == 1)
-
 traceResult xTraceEntryCreateWithAddress(void* const pvAddress, TraceEntryHandle_t* pxEntryHandle)
 {
 	/* This should never fail */
 	TRC_ASSERT(pvAddress != (void*)0);
 
-	return TRC_ENTRY_CREATE_WITH_ADDRESS(pvAddress, pxEntryHandle);
+	return prvEntryCreate(pvAddress, pxEntryHandle);
 }
 
+#if ((TRC_CFG_USE_TRACE_ASSERT) == 1)
+
 traceResult xTraceEntrySetState(const TraceEntryHandle_t xEntryHandle, TraceUnsignedBaseType_t uxStateIndex, TraceUnsignedBaseType_t uxState)
 {
 	/* This should never fail */
@@ -401,6 +392,13 @@ static traceResult prvEntryIndexInitialize(void)
 
 	pxIndexTable->uiFreeIndexCount = TRC_ENTRY_TABLE_SLOTS;
 
+	for (i = 0u; i < (uint32_t)(TRC_ENTRY_ADDRESS_INDEX_SLOTS); i++)
+	{
+		pxIndexTable->axAddressIndex[i] = TRC_ENTRY_ADDRESS_INDEX_EMPTY;
+	}
+
+	pxIndexTable->uiLongestProbe = 0u;
+
 	return TRC_SUCCESS;
 }
 
@@ -431,4 +429,129 @@ static traceResult prvEntryIndexTake(TraceEntryIndex_t *pxIndex)
 	return TRC_SUCCESS;
 }
 
+static traceResult prvEntryCreate(void* const pvAddress, TraceEntryHandle_t* pxEntryHandle)
+{
+	uint32_t i;
+	TraceEntryIndex_t xIndex;
+	TraceEntry_t *pxEntry;
+
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	/* We always check this */
+	if (xTraceIsComponentInitialized(TRC_RECORDER_COMPONENT_ENTRY) == 0U)
+	{
+		return TRC_FAIL;
+	}
+
+	/* This should never fail */
+	TRC_ASSERT(pxEntryHandle != (void*)0);
+
+	TRACE_ENTER_CRITICAL_SECTION();
+
+	if (prvEntryIndexTake(&xIndex) != TRC_SUCCESS)
+	{
+		(void)xTraceDiagnosticsIncrease(TRC_DIAGNOSTICS_ENTRY_SLOTS_NO_ROOM);
+
+		TRACE_EXIT_CRITICAL_SECTION();
+
+		return TRC_FAIL;
+	}
+
+	pxEntry = &pxEntryTable->axEntries[xIndex];
+	
+	if (pvAddress != (void*)0)
+	{
+		pxEntry->pvAddress = pvAddress;
+	}
+	else
+	{
+		pxEntry->pvAddress = (void*)pxEntry; /* We set a temporary address */
+	}
+
+	prvEntryAddressInsert(xIndex);
+
+	for (i = 0u; i < (uint32_t)(TRC_ENTRY_TABLE_STATE_COUNT); i++)
+	{
+		pxEntry->xStates[i] = (TraceUnsignedBaseType_t)0;
+	}
+
+	pxEntry->uiOptions = 0u;
+	pxEntry->szSymbol[0] = (char)0; /*cstat !MISRAC2004-6.3 !MISRAC2012-Dir-4.6_a Suppress basic char type usage*/
+
+	*pxEntryHandle = (TraceEntryHandle_t)pxEntry;
+
+	TRACE_EXIT_CRITICAL_SECTION();
+
+	return TRC_SUCCESS;
+}
+
+static uint32_t prvEntryAddressHash(const void* const pvAddress)
+{
+	/* Fibonacci hashing spreads the aligned addresses, which share their low bits,
+	 * and the high half of the 64-bit product scales the hash to the slot count */
+	uint32_t uiHash = (uint32_t)(TraceUnsignedBaseType_t)(uintptr_t)pvAddress * 2654435769UL; /*cstat !MISRAC2004-11.3 !MISRAC2012-Rule-11.4 !MISRAC2012-Rule-11.6 Suppress conversion from pointer to integer check*/
+
+	return (uint32_t)(((uint64_t)uiHash * (uint64_t)(TRC_ENTRY_ADDRESS_INDEX_SLOTS)) >> 32);
+}
+
+static void prvEntryAddressInsert(TraceEntryIndex_t xIndex)
+{
+	/* Critical Section must be active! */
+	uint32_t uiSlot = prvEntryAddressHash(pxEntryTable->axEntries[xIndex].pvAddress);
+	uint32_t uiProbe = 0u;
+
+	/* Never full, there are twice as many slots as entries */
+	while (pxIndexTable->axAddressIndex[uiSlot] != TRC_ENTRY_ADDRESS_INDEX_EMPTY)
+	{
+		uiSlot = NEXT_ADDRESS_INDEX_SLOT(uiSlot);
+		uiProbe++;
+	}
+
+	pxIndexTable->axAddressIndex[uiSlot] = (TraceEntryAddressIndex_t)xIndex;
+
+	if (uiProbe > pxIndexTable->uiLongestProbe)
+	{
+		pxIndexTable->uiLongestProbe = uiProbe;
+	}
+}
+
+static void prvEntryAddressRemove(TraceEntryIndex_t xIndex)
+{
+	/* Critical Section must be active! */
+	uint32_t uiHole, uiSlot, uiHome;
+	TraceEntryAddressIndex_t xMoved;
+
+	uiHole = prvEntryAddressHash(pxEntryTable->axEntries[xIndex].pvAddress);
+	while (pxIndexTable->axAddressIndex[uiHole] != (TraceEntryAddressIndex_t)xIndex)
+	{
+		if (pxIndexTable->axAddressIndex[uiHole] == TRC_ENTRY_ADDRESS_INDEX_EMPTY)
+		{
+			/* This should never happen, every created entry was inserted */
+			return;
+		}
+
+		uiHole = NEXT_ADDRESS_INDEX_SLOT(uiHole);
+	}
+
+	/* Instead of leaving a marker, move back the entries that probed past the
+	 * hole, so that lookups still stop at the first empty slot */
+	uiSlot = NEXT_ADDRESS_INDEX_SLOT(uiHole);
+	while (pxIndexTable->axAddressIndex[uiSlot] != TRC_ENTRY_ADDRESS_INDEX_EMPTY)
+	{
+		xMoved = pxIndexTable->axAddressIndex[uiSlot];
+		uiHome = prvEntryAddressHash(pxEntryTable->axEntries[xMoved].pvAddress);
+
+		/* Its hash slot is at or before the hole, it may move there */
+		if (ADDRESS_INDEX_DISTANCE(uiHome, uiSlot) >= ADDRESS_INDEX_DISTANCE(uiHole, uiSlot))
+		{
+			pxIndexTable->axAddressIndex[uiHole] = xMoved;
+			uiHole = uiSlot;
+		}
+
+		uiSlot = NEXT_ADDRESS_INDEX_SLOT(uiSlot);
+	}
+
+	pxIndexTable->axAddressIndex[uiHole] = TRC_ENTRY_ADDRESS_INDEX_EMPTY;
+}
+
 #endif
@@ -14,6 +14,75 @@
 
 #include <string.h>
 
+#if (TRC_CFG_EVENT_COMPACT_ENCODING == 1)
+
+#if (TRC_USE_INTERNAL_BUFFER == 1)
+#error "TRC_CFG_EVENT_COMPACT_ENCODING requires direct streaming (no internal buffer, so no TRC_CFG_EVENT_BUFFER_LOCK_FREE)."
+#endif
+
+#if ((TRC_CFG_CORE_COUNT) > 1)
+#error "TRC_CFG_EVENT_COMPACT_ENCODING only supports a single core."
+#endif
+
+#if ((TRC_CFG_EVENT_COMPACT_SYNC_INTERVAL) < 1)
+#error "TRC_CFG_EVENT_COMPACT_SYNC_INTERVAL must be at least 1."
+#endif
+
+static void prvTraceEventCompactWrite(const TraceEvent0_t* pxEvent, uint32_t uiSize, int32_t* piBytesWritten);
+static void prvTraceEventCompactPad(int32_t* piBytesWritten);
+static void prvTraceEventCompactPrelude(int32_t* piBytesWritten);
+
+#endif
+
+/* Kernel ports without event classes only have recorder events, which are always traced */
+#ifndef TRC_KERNEL_PORT_EVENT_CLASS
+#define TRC_KERNEL_PORT_EVENT_CLASS(uiEventCode) (TRC_EVENT_CLASS_RECORDER)
+#endif
+
+#if (TRC_CFG_EVENT_FILTER == 1)
+
+#define TRACE_EVENT_FILTER()																\
+	if ((pxTraceEventDataTable->xFilterData.uiClassMask & (uint32_t)TRC_KERNEL_PORT_EVENT_CLASS(uiEventCode)) == 0u) \
+	{																					\
+		return TRC_SUCCESS;																\
+	}
+
+#else
+
+#define TRACE_EVENT_FILTER()
+
+#endif
+
+#if (TRC_CFG_EVENT_SHEDDING == 1)
+
+#if (TRC_USE_INTERNAL_BUFFER == 0)
+#error "TRC_CFG_EVENT_SHEDDING requires the stream port internal buffer (TRC_CFG_STREAM_PORT_USE_INTERNAL_BUFFER 1)."
+#endif
+
+#if ((TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK) >= (TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK)) || ((TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK) > 100)
+#error "TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK must be below TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK, which must be at most 100."
+#endif
+
+/* The trace cannot be read without these, they are only lost when the buffer is full */
+#define TRC_EVENT_SHEDDING_KEPT_CLASSES (TRC_EVENT_CLASS_RECORDER | TRC_EVENT_CLASS_TASK_SWITCH | TRC_EVENT_CLASS_ISR)
+
+#define TRC_EVENT_SHEDDING_LOW_CLASSES ((uint32_t)(TRC_CFG_EVENT_SHEDDING_LOW_CLASSES) & ~(uint32_t)(TRC_EVENT_SHEDDING_KEPT_CLASSES))
+#define TRC_EVENT_SHEDDING_HIGH_CLASSES (((uint32_t)(TRC_CFG_EVENT_SHEDDING_LOW_CLASSES) | (uint32_t)(TRC_CFG_EVENT_SHEDDING_HIGH_CLASSES)) & ~(uint32_t)(TRC_EVENT_SHEDDING_KEPT_CLASSES))
+
+static uint32_t prvTraceEventShed(uint32_t uiClass);
+
+#define TRACE_EVENT_SHED()																	\
+	if (prvTraceEventShed((uint32_t)TRC_KERNEL_PORT_EVENT_CLASS(uiEventCode)) != 0u)	\
+	{																					\
+		return TRC_SUCCESS;																\
+	}
+
+#else
+
+#define TRACE_EVENT_SHED()
+
+#endif
+
 /**
  * @internal Macro helper for setting trace event parameter count.
  */
@@ -45,6 +114,31 @@
 		xTraceTimestampGet(&(pxEvent)->TS) \
 	)
 
+#if (TRC_CFG_EVENT_BUFFER_LOCK_FREE == 1)
+
+/* No critical section: the event buffer reserves space with LDREX/STREX and
+ * fills in EventCount and TS itself (see xTraceEventBufferAlloc) */
+#define TRACE_EVENT_ALLOC_CRITICAL_SECTION()
+
+#define TRACE_EVENT_BEGIN_OFFLINE(size) 														\
+	if (xTraceStreamPortAllocate((uint32_t)(size), (void**)&pxEventData) == TRC_FAIL) /*cstat !MISRAC2004-11.4 !MISRAC2012-Rule-11.3 Suppress pointer checks*/ \
+	{                                            										\
+		return TRC_FAIL; 																\
+	} 																					\
+	pxEventData->EventID = TRC_EVENT_SET_PARAM_COUNT(uiEventCode, ((size) - sizeof(TraceEvent0_t)) / sizeof(TraceUnsignedBaseType_t));
+
+#define TRACE_EVENT_END(size) 															\
+	(void)xTraceStreamPortCommit(pxEventData, (uint32_t)(size), &iBytesCommitted); 					\
+	(void)iBytesCommitted;
+
+#else
+
+#if (TRC_CFG_EVENT_COMPACT_ENCODING == 1)
+#define TRACE_EVENT_COMMIT(size) prvTraceEventCompactWrite((const TraceEvent0_t*)pxEventData, (uint32_t)(size), &iBytesCommitted) /*cstat !MISRAC2004-11.4 !MISRAC2012-Rule-11.3 Suppress pointer checks*/
+#else
+#define TRACE_EVENT_COMMIT(size) (void)xTraceStreamPortCommit(pxEventData, (uint32_t)(size), &iBytesCommitted)
+#endif
+
 #define TRACE_EVENT_BEGIN_OFFLINE(size) 														\
 	TRACE_ENTER_CRITICAL_SECTION();              										\
 	pxTraceEventDataTable->coreEventData[TRC_CFG_GET_CURRENT_CORE()].eventCounter++; 	\
@@ -55,22 +149,27 @@
 	} 																					\
 	SET_BASE_EVENT_DATA(pxEventData, uiEventCode, ((size) - sizeof(TraceEvent0_t)) / sizeof(TraceUnsignedBaseType_t), pxTraceEventDataTable->coreEventData[TRC_CFG_GET_CURRENT_CORE()].eventCounter); /*cstat !MISRAC2012-Rule-11.5 Suppress pointer checks*/
 
+#define TRACE_EVENT_END(size) 															\
+	TRACE_EVENT_COMMIT(size); 																\
+	TRACE_EXIT_CRITICAL_SECTION(); 														\
+	/* We need to use iBytesCommitted for the above call but do not use the value, 		\
+	 * remove potential warnings */ 													\
+	(void)iBytesCommitted;
+
+#define TRACE_EVENT_ALLOC_CRITICAL_SECTION() TRACE_ALLOC_CRITICAL_SECTION()
+
+#endif
+
 #define TRACE_EVENT_BEGIN(size) 														\
 	/* We need to check this */                  										\
 	if (!xTraceIsRecorderEnabled())              										\
 	{ 																					\
 		return TRC_FAIL;                            									\
 	} 																					\
+	TRACE_EVENT_FILTER() 																\
+	TRACE_EVENT_SHED() 																	\
 	TRACE_EVENT_BEGIN_OFFLINE(size)
 
-
-#define TRACE_EVENT_END(size) 															\
-	(void)xTraceStreamPortCommit(pxEventData, (uint32_t)(size), &iBytesCommitted); 					\
-	TRACE_EXIT_CRITICAL_SECTION(); 														\
-	/* We need to use iBytesCommitted for the above call but do not use the value, 		\
-	 * remove potential warnings */ 													\
-	(void)iBytesCommitted;
-
 #define TRACE_EVENT_ADD_1(__p1)									\
 	pxEventData->uxParams[0] = __p1;
 
@@ -137,6 +236,27 @@ traceResult xTraceEventInitialize(TraceEventDataTable_t* pxBuffer)
 		pxTraceEventDataTable->coreEventData[i].eventCounter = 0u;
 	}
 
+#if (TRC_CFG_EVENT_COMPACT_ENCODING == 1)
+	pxTraceEventDataTable->xCompactData.uiPendingBytes = 0u;
+	pxTraceEventDataTable->xCompactData.uiLastTimestamp = 0u;
+	pxTraceEventDataTable->xCompactData.uiEventsToSync = 0u; /* The first event is a sync event */
+	pxTraceEventDataTable->xCompactData.uiLastEventCount = 0u;
+	pxTraceEventDataTable->xCompactData.uiEventsWritten = 0u;
+#endif
+
+#if (TRC_CFG_EVENT_FILTER == 1)
+	pxTraceEventDataTable->xFilterData.uiClassMask = TRC_EVENT_CLASS_ALL;
+	pxTraceEventDataTable->xFilterData.uiExcludedObjects = 0u;
+#endif
+
+#if (TRC_CFG_EVENT_SHEDDING == 1)
+	pxTraceEventDataTable->xShedData.uiEvents = 0u;
+	pxTraceEventDataTable->xShedData.uiClasses = 0u;
+	pxTraceEventDataTable->xShedData.uiFirstTimestamp = 0u;
+	pxTraceEventDataTable->xShedData.uiLastTimestamp = 0u;
+	pxTraceEventDataTable->xShedData.xChannel = 0;
+#endif
+
 	xTraceSetComponentInitialized(TRC_RECORDER_COMPONENT_EVENT);
 
 	return TRC_SUCCESS;
@@ -147,7 +267,7 @@ traceResult xTraceEventCreate0(uint32_t uiEventCode)
 	TraceEvent0_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	TRACE_EVENT_BEGIN(sizeof(TraceEvent0_t));
 	TRACE_EVENT_END(sizeof(TraceEvent0_t));
@@ -160,7 +280,7 @@ traceResult xTraceEventCreate1(uint32_t uiEventCode, TraceUnsignedBaseType_t uxP
 	TraceEvent1_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	TRACE_EVENT_BEGIN(sizeof(TraceEvent1_t));
 
@@ -176,7 +296,7 @@ traceResult xTraceEventCreate2(uint32_t uiEventCode, TraceUnsignedBaseType_t uxP
 	TraceEvent2_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	TRACE_EVENT_BEGIN(sizeof(TraceEvent2_t));
 
@@ -192,7 +312,7 @@ traceResult xTraceEventCreate3(uint32_t uiEventCode, TraceUnsignedBaseType_t uxP
 	TraceEvent3_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	TRACE_EVENT_BEGIN(sizeof(TraceEvent3_t));
 
@@ -208,7 +328,7 @@ traceResult xTraceEventCreate4(uint32_t uiEventCode, TraceUnsignedBaseType_t uxP
 	TraceEvent4_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	TRACE_EVENT_BEGIN(sizeof(TraceEvent4_t));
 
@@ -224,7 +344,7 @@ traceResult xTraceEventCreate5(uint32_t uiEventCode, TraceUnsignedBaseType_t uxP
 	TraceEvent5_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	TRACE_EVENT_BEGIN(sizeof(TraceEvent5_t));
 
@@ -240,7 +360,7 @@ traceResult xTraceEventCreate6(uint32_t uiEventCode, TraceUnsignedBaseType_t uxP
 	TraceEvent6_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	TRACE_EVENT_BEGIN(sizeof(TraceEvent6_t));
 
@@ -256,13 +376,25 @@ traceResult xTraceEventCreateRawBlocking(const void* pxSource, uint32_t ulSize)
 	int32_t iBytesCommitted = 0;
 	void* pxBuffer = (void*)0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	ulSize = TRC_ALIGN_CEIL(ulSize, sizeof(TraceUnsignedBaseType_t));
 
+#if (TRC_CFG_EVENT_BUFFER_LOCK_FREE == 1)
+	while (xTraceStreamPortAllocate(ulSize, (void**)&pxBuffer) == TRC_FAIL) {}
+
+	memcpy(pxBuffer, pxSource, ulSize);
+	while (xTraceStreamPortCommit(pxBuffer, ulSize, &iBytesCommitted) == TRC_FAIL) {}
+	(void)iBytesCommitted;
+#else
 	TRACE_ENTER_CRITICAL_SECTION();
 
 	pxTraceEventDataTable->coreEventData[TRC_CFG_GET_CURRENT_CORE()].eventCounter++;
+
+#if (TRC_CFG_EVENT_COMPACT_ENCODING == 1)
+	prvTraceEventCompactPrelude(&iBytesCommitted);
+#endif
+
 	while (xTraceStreamPortAllocate(ulSize, (void**)&pxBuffer) == TRC_FAIL) {}
 
 	memcpy(pxBuffer, pxSource, ulSize);
@@ -270,6 +402,7 @@ traceResult xTraceEventCreateRawBlocking(const void* pxSource, uint32_t ulSize)
 	(void)iBytesCommitted;
 
 	TRACE_EXIT_CRITICAL_SECTION();
+#endif
 
 	return TRC_SUCCESS;
 }
@@ -279,7 +412,7 @@ traceResult xTraceEventCreateDataOffline0(uint32_t uiEventCode, const TraceUnsig
 	TraceEvent0_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	/* Align payload size and truncate in case it is too big */
 	uxSize = TRC_ALIGN_CEIL(uxSize, sizeof(TraceUnsignedBaseType_t));
@@ -302,7 +435,7 @@ traceResult xTraceEventCreateData0(uint32_t uiEventCode, const TraceUnsignedBase
 	TraceEvent0_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	/* Align payload size and truncate in case it is too big */
 	uxSize = TRC_ALIGN_CEIL(uxSize, sizeof(TraceUnsignedBaseType_t));
@@ -330,7 +463,7 @@ traceResult xTraceEventCreateData1(
 	TraceEvent1_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	/* Align payload size and truncate in case it is too big */
 	uxSize = TRC_ALIGN_CEIL(uxSize, sizeof(TraceUnsignedBaseType_t));
@@ -359,7 +492,7 @@ traceResult xTraceEventCreateData2(
 	TraceEvent2_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	/* Align payload size and truncate in case it is too big */
 	uxSize = TRC_ALIGN_CEIL(uxSize, sizeof(TraceUnsignedBaseType_t));
@@ -389,7 +522,7 @@ traceResult xTraceEventCreateData3(
 	TraceEvent3_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	/* Align payload size and truncate in case it is too big */
 	uxSize = TRC_ALIGN_CEIL(uxSize, sizeof(TraceUnsignedBaseType_t));
@@ -420,7 +553,7 @@ traceResult xTraceEventCreateData4(
 	TraceEvent4_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	/* Align payload size and truncate in case it is too big */
 	uxSize = TRC_ALIGN_CEIL(uxSize, sizeof(TraceUnsignedBaseType_t));
@@ -452,7 +585,7 @@ traceResult xTraceEventCreateData5(
 	TraceEvent5_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	/* Align payload size and truncate in case it is too big */
 	uxSize = TRC_ALIGN_CEIL(uxSize, sizeof(TraceUnsignedBaseType_t));
@@ -485,7 +618,7 @@ traceResult xTraceEventCreateData6(
 	TraceEvent6_t* pxEventData = (void*)0;
 	int32_t iBytesCommitted = 0;
 
-	TRACE_ALLOC_CRITICAL_SECTION();
+	TRACE_EVENT_ALLOC_CRITICAL_SECTION();
 
 	/* Align payload size and truncate in case it is too big */
 	uxSize = TRC_ALIGN_CEIL(uxSize, sizeof(TraceUnsignedBaseType_t));
@@ -517,4 +650,406 @@ traceResult xTraceEventGetSize(const void* const pvAddress, uint32_t* puiSize)
 	return TRC_EVENT_GET_SIZE(pvAddress, puiSize);
 }
 
+#if (TRC_CFG_EVENT_FILTER == 1)
+
+traceResult xTraceEventSetClassMask(uint32_t uiClassMask)
+{
+	if (!xTraceIsComponentInitialized(TRC_RECORDER_COMPONENT_EVENT))
+	{
+		return TRC_FAIL;
+	}
+
+	/* Without recorder events Tracealyzer cannot name anything */
+	pxTraceEventDataTable->xFilterData.uiClassMask = uiClassMask | TRC_EVENT_CLASS_RECORDER;
+
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceEventGetClassMask(uint32_t* puiClassMask)
+{
+	/* This should never fail */
+	TRC_ASSERT(puiClassMask != (void*)0);
+
+	if (!xTraceIsComponentInitialized(TRC_RECORDER_COMPONENT_EVENT))
+	{
+		return TRC_FAIL;
+	}
+
+	*puiClassMask = pxTraceEventDataTable->xFilterData.uiClassMask;
+
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceEventSetObjectExcluded(void* pvObject, uint32_t uiExcluded)
+{
+	TraceEntryHandle_t xEntryHandle;
+	uint32_t uiOptions = 0u;
+
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	if (!xTraceIsComponentInitialized(TRC_RECORDER_COMPONENT_EVENT))
+	{
+		return TRC_FAIL;
+	}
+
+	TRACE_ENTER_CRITICAL_SECTION();
+
+	if (xTraceEntryFind(pvObject, &xEntryHandle) == TRC_FAIL)
+	{
+		TRACE_EXIT_CRITICAL_SECTION();
+
+		return TRC_FAIL;
+	}
+
+	/* This should never fail */
+	TRC_ASSERT_ALWAYS_EVALUATE(xTraceEntryGetOptions(xEntryHandle, &uiOptions) == TRC_SUCCESS);
+
+	/* Only count changes, so the count stays right when called twice */
+	if ((uiExcluded != 0u) && ((uiOptions & TRC_ENTRY_OPTION_EXCLUDED) == 0u))
+	{
+		/* This should never fail */
+		TRC_ASSERT_ALWAYS_EVALUATE(xTraceEntrySetOptions(xEntryHandle, TRC_ENTRY_OPTION_EXCLUDED) == TRC_SUCCESS);
+
+		pxTraceEventDataTable->xFilterData.uiExcludedObjects++;
+	}
+	else if ((uiExcluded == 0u) && ((uiOptions & TRC_ENTRY_OPTION_EXCLUDED) != 0u))
+	{
+		/* This should never fail */
+		TRC_ASSERT_ALWAYS_EVALUATE(xTraceEntryClearOptions(xEntryHandle, TRC_ENTRY_OPTION_EXCLUDED) == TRC_SUCCESS);
+
+		pxTraceEventDataTable->xFilterData.uiExcludedObjects--;
+	}
+	else
+	{
+		/* Already in the requested state */
+	}
+
+	TRACE_EXIT_CRITICAL_SECTION();
+
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceEventSetFilter(uint32_t uiFilter, uint32_t uiValue)
+{
+	traceResult xResult = TRC_FAIL;
+
+	switch (uiFilter)
+	{
+		case CMD_FILTER_CLASS_MASK:
+			xResult = xTraceEventSetClassMask(uiValue);
+			break;
+		case CMD_FILTER_EXCLUDE_OBJECT:
+			xResult = xTraceEventSetObjectExcluded((void*)(uintptr_t)uiValue, 1u); /*cstat !MISRAC2004-11.3 !MISRAC2012-Rule-11.4 !MISRAC2012-Rule-11.6 Suppress conversion from integer to pointer check*/
+			break;
+		case CMD_FILTER_INCLUDE_OBJECT:
+			xResult = xTraceEventSetObjectExcluded((void*)(uintptr_t)uiValue, 0u); /*cstat !MISRAC2004-11.3 !MISRAC2012-Rule-11.4 !MISRAC2012-Rule-11.6 Suppress conversion from integer to pointer check*/
+			break;
+		default:
+			break;
+	}
+
+	return xResult;
+}
+
+TraceUnsignedBaseType_t xTraceEventIsObjectExcludedInternal(void* pvObject)
+{
+	TraceEntryHandle_t xEntryHandle;
+	uint32_t uiOptions = 0u;
+
+	/* xTraceEntryFind takes its own critical section */
+	if (xTraceEntryFind(pvObject, &xEntryHandle) == TRC_FAIL)
+	{
+		return 0u;
+	}
+
+	/* This should never fail */
+	TRC_ASSERT_ALWAYS_EVALUATE(xTraceEntryGetOptions(xEntryHandle, &uiOptions) == TRC_SUCCESS);
+
+	return (uiOptions & TRC_ENTRY_OPTION_EXCLUDED) != 0u ? 1u : 0u;
+}
+
+#endif
+
+#if (TRC_CFG_EVENT_SHEDDING == 1)
+
+/**
+ * @internal Decides if an event of class uiClass is dropped at the current
+ * internal event buffer usage, and counts it if so.
+ *
+ * @returns 1 if the event is to be dropped, 0 otherwise
+ */
+static uint32_t prvTraceEventShed(uint32_t uiClass)
+{
+	TraceEventShedData_t* pxShedData;
+	uint32_t uiUsed = 0u;
+	uint32_t uiSize = 0u;
+	uint32_t uiTimestamp = 0u;
+	uint32_t uiShedClasses;
+
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	/* Task switches and ISRs return here without reading the buffer */
+	if ((uiClass & TRC_EVENT_SHEDDING_HIGH_CLASSES) == 0u)
+	{
+		return 0u;
+	}
+
+	(void)xTraceInternalEventBufferGetUsage(&uiUsed, &uiSize);
+
+	if ((uiUsed * 100u) >= (uiSize * (uint32_t)(TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK)))
+	{
+		uiShedClasses = TRC_EVENT_SHEDDING_HIGH_CLASSES;
+	}
+	else if ((uiUsed * 100u) >= (uiSize * (uint32_t)(TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK)))
+	{
+		uiShedClasses = TRC_EVENT_SHEDDING_LOW_CLASSES;
+	}
+	else
+	{
+		return 0u;
+	}
+
+	if ((uiClass & uiShedClasses) == 0u)
+	{
+		return 0u;
+	}
+
+	pxShedData = &pxTraceEventDataTable->xShedData;
+
+	(void)xTraceTimestampGet(&uiTimestamp);
+
+	/* Locked against drops from interrupts and against xTraceEventSheddingCheckStatus() */
+	TRACE_ENTER_CRITICAL_SECTION();
+
+	if (pxShedData->uiEvents == 0u)
+	{
+		pxShedData->uiFirstTimestamp = uiTimestamp;
+	}
+	pxShedData->uiLastTimestamp = uiTimestamp;
+	pxShedData->uiClasses |= uiClass;
+	pxShedData->uiEvents++;
+
+	TRACE_EXIT_CRITICAL_SECTION();
+
+	return 1u;
+}
+
+traceResult xTraceEventSheddingCheckStatus(void)
+{
+	TraceEventShedData_t* pxShedData;
+	TraceUnsignedBaseType_t uxFrequency = 0u;
+	uint32_t uiUsed = 0u;
+	uint32_t uiSize = 0u;
+	uint32_t uiEvents;
+	uint32_t uiClasses;
+	uint32_t uiTicks;
+	uint32_t uiMicroseconds;
+#if (TRC_CFG_EVENT_FILTER == 1)
+	uint32_t uiClassMask;
+#endif
+
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	/* This should never fail */
+	TRC_ASSERT(xTraceIsComponentInitialized(TRC_RECORDER_COMPONENT_EVENT));
+
+	pxShedData = &pxTraceEventDataTable->xShedData;
+
+	if (pxShedData->uiEvents == 0u)
+	{
+		return TRC_SUCCESS;
+	}
+
+	/* Report once it is over */
+	(void)xTraceInternalEventBufferGetUsage(&uiUsed, &uiSize);
+	if ((uiUsed * 100u) >= (uiSize * (uint32_t)(TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK)))
+	{
+		return TRC_SUCCESS;
+	}
+
+	if (pxShedData->xChannel == 0)
+	{
+		if (xTraceStringRegister("Trace load shedding", &pxShedData->xChannel) == TRC_FAIL)
+		{
+			return TRC_FAIL;
+		}
+	}
+
+	/* The buffer may fill up again and drops continue at any time, so the counts
+	 * are taken and cleared together; later drops go into the next report */
+	TRACE_ENTER_CRITICAL_SECTION();
+
+	uiEvents = pxShedData->uiEvents;
+	uiClasses = pxShedData->uiClasses;
+	uiTicks = pxShedData->uiLastTimestamp - pxShedData->uiFirstTimestamp;
+
+	pxShedData->uiEvents = 0u;
+	pxShedData->uiClasses = 0u;
+	pxShedData->uiFirstTimestamp = 0u;
+	pxShedData->uiLastTimestamp = 0u;
+
+	TRACE_EXIT_CRITICAL_SECTION();
+
+	(void)xTraceTimestampGetFrequency(&uxFrequency);
+	if (uxFrequency >= 1000000u)
+	{
+		uiMicroseconds = uiTicks / (uint32_t)(uxFrequency / 1000000u);
+	}
+	else if (uxFrequency != 0u)
+	{
+		uiMicroseconds = uiTicks * (uint32_t)(1000000u / uxFrequency);
+	}
+	else
+	{
+		uiMicroseconds = 0u;
+	}
+
+#if (TRC_CFG_EVENT_FILTER == 1)
+	/* The marker is a User Event, but it is recorded whatever the class mask:
+	 * User Events pass only while it is written, so no other one slips through */
+	TRACE_ENTER_CRITICAL_SECTION();
+
+	uiClassMask = pxTraceEventDataTable->xFilterData.uiClassMask;
+	pxTraceEventDataTable->xFilterData.uiClassMask = uiClassMask | TRC_EVENT_CLASS_USER;
+#endif
+
+	(void)xTracePrintF(pxShedData->xChannel, "Dropped %u events, classes 0x%04X, over %u us",
+		uiEvents, uiClasses, uiMicroseconds);
+
+#if (TRC_CFG_EVENT_FILTER == 1)
+	pxTraceEventDataTable->xFilterData.uiClassMask = uiClassMask;
+
+	TRACE_EXIT_CRITICAL_SECTION();
+#endif
+
+	return TRC_SUCCESS;
+}
+
+#endif
+
+#if (TRC_CFG_EVENT_COMPACT_ENCODING == 1)
+
+traceResult xTraceEventCompactFlush(void)
+{
+	int32_t iBytesWritten = 0;
+
+	TRACE_ALLOC_CRITICAL_SECTION();
+
+	TRACE_ENTER_CRITICAL_SECTION();
+
+	prvTraceEventCompactPad(&iBytesWritten);
+
+	TRACE_EXIT_CRITICAL_SECTION();
+
+	(void)iBytesWritten;
+
+	return TRC_SUCCESS;
+}
+
+static void prvTraceEventCompactWrite(const TraceEvent0_t* pxEvent, uint32_t uiSize, int32_t* piBytesWritten)
+{
+	/* Critical Section must be active! */
+	TraceEventCompactData_t* pxCompact = &pxTraceEventDataTable->xCompactData;
+	uint8_t* puiStaging = (uint8_t*)pxCompact->uxStaging; /*cstat !MISRAC2004-11.4 !MISRAC2012-Rule-11.3 Suppress pointer checks*/
+	uint32_t uiLength = pxCompact->uiPendingBytes;
+	uint32_t uiDelta = pxEvent->TS - pxCompact->uiLastTimestamp;
+	uint32_t uiWords;
+	uint32_t i;
+
+	if ((pxCompact->uiEventsToSync == 0u) || ((uint16_t)pxEvent->EventCount != (uint16_t)(pxCompact->uiLastEventCount + 1u)))
+	{
+		/* Periodically, and after a gap in the event count, the event in standard form */
+		puiStaging[uiLength] = (uint8_t)TRC_EVENT_COMPACT_SYNC;
+		uiLength++;
+		memcpy(&puiStaging[uiLength], pxEvent, uiSize);
+		uiLength += uiSize;
+
+		pxCompact->uiEventsToSync = TRC_CFG_EVENT_COMPACT_SYNC_INTERVAL;
+	}
+	else
+	{
+		/* High byte first, its parameter count sets it apart from the markers */
+		puiStaging[uiLength] = (uint8_t)(pxEvent->EventID >> 8);
+		puiStaging[uiLength + 1u] = (uint8_t)(pxEvent->EventID & 0xFFU);
+		uiLength += 2u;
+
+		while (uiDelta >= 0x80U)
+		{
+			puiStaging[uiLength] = (uint8_t)((uiDelta & 0x7FU) | 0x80U);
+			uiLength++;
+			uiDelta >>= 7;
+		}
+		puiStaging[uiLength] = (uint8_t)uiDelta;
+		uiLength++;
+
+		memcpy(&puiStaging[uiLength], &((const uint8_t*)pxEvent)[sizeof(TraceEvent0_t)], uiSize - sizeof(TraceEvent0_t));
+		uiLength += uiSize - (uint32_t)sizeof(TraceEvent0_t);
+
+		pxCompact->uiEventsToSync--;
+	}
+
+	pxCompact->uiLastTimestamp = pxEvent->TS;
+	pxCompact->uiLastEventCount = pxEvent->EventCount;
+	pxCompact->uiEventsWritten = 1u;
+
+	/* Whole words go out now, the rest waits for the next event or xTraceEventCompactFlush() */
+	uiWords = uiLength & ~3UL;
+	if (uiWords != 0u)
+	{
+		(void)xTraceStreamPortWriteData(pxCompact->uxStaging, uiWords, piBytesWritten);
+
+		for (i = 0u; i < (uiLength - uiWords); i++)
+		{
+			puiStaging[i] = puiStaging[uiWords + i];
+		}
+	}
+
+	pxCompact->uiPendingBytes = uiLength - uiWords;
+}
+
+static void prvTraceEventCompactPad(int32_t* piBytesWritten)
+{
+	/* Critical Section must be active! */
+	TraceEventCompactData_t* pxCompact = &pxTraceEventDataTable->xCompactData;
+	uint8_t* puiStaging = (uint8_t*)pxCompact->uxStaging; /*cstat !MISRAC2004-11.4 !MISRAC2012-Rule-11.3 Suppress pointer checks*/
+
+	if (pxCompact->uiPendingBytes == 0u)
+	{
+		return;
+	}
+
+	while (pxCompact->uiPendingBytes < 4u)
+	{
+		puiStaging[pxCompact->uiPendingBytes] = (uint8_t)TRC_EVENT_COMPACT_PAD;
+		pxCompact->uiPendingBytes++;
+	}
+
+	(void)xTraceStreamPortWriteData(pxCompact->uxStaging, 4u, piBytesWritten);
+
+	pxCompact->uiPendingBytes = 0u;
+}
+
+static void prvTraceEventCompactPrelude(int32_t* piBytesWritten)
+{
+	/* Critical Section must be active! */
+	TraceEventCompactData_t* pxCompact = &pxTraceEventDataTable->xCompactData;
+	uint8_t* puiStaging = (uint8_t*)pxCompact->uxStaging; /*cstat !MISRAC2004-11.4 !MISRAC2012-Rule-11.3 Suppress pointer checks*/
+
+	/* Only before the first raw block after events: the stream itself starts with the header */
+	if (pxCompact->uiEventsWritten != 0u)
+	{
+		puiStaging[pxCompact->uiPendingBytes] = (uint8_t)TRC_EVENT_COMPACT_PRELUDE;
+		pxCompact->uiPendingBytes++;
+		pxCompact->uiEventsWritten = 0u;
+	}
+
+	/* Raw blocks are written in whole words */
+	prvTraceEventCompactPad(piBytesWritten);
+
+	/* The first event after them is a sync event */
+	pxCompact->uiEventsToSync = 0u;
+}
+
+#endif
+
 #endif
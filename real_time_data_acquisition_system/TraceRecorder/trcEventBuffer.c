@@ -12,6 +12,40 @@
 
 #if (TRC_USE_TRACEALYZER_RECORDER == 1) && (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)
 
+#if (TRC_CFG_EVENT_BUFFER_LOCK_FREE == 1)
+
+#if (TRC_USE_INTERNAL_BUFFER != 1) || (TRC_INTERNAL_EVENT_BUFFER_WRITE_MODE != TRC_INTERNAL_EVENT_BUFFER_OPTION_WRITE_MODE_DIRECT)
+#error "TRC_CFG_EVENT_BUFFER_LOCK_FREE requires the stream port internal buffer in direct write mode."
+#endif
+
+#if ((TRC_CFG_CORE_COUNT) > 1)
+#error "TRC_CFG_EVENT_BUFFER_LOCK_FREE only supports a single core."
+#endif
+
+#if (TRC_CFG_HARDWARE_PORT != TRC_HARDWARE_PORT_ARM_Cortex_M) || (__CORTEX_M < 0x03)
+#error "TRC_CFG_EVENT_BUFFER_LOCK_FREE requires LDREX/STREX (Cortex-M3 and later)."
+#endif
+
+#include <string.h>
+
+/* Every event is preceded by a commit word: the size of the record, including
+ * the commit word, and the flags below. Free space reads as zero, so a commit
+ * word only shows TRC_EVENT_BUFFER_RECORD_COMMITTED once its writer is done. */
+#define TRC_EVENT_BUFFER_RECORD_SIZE_MASK	(0x0000FFFFUL)
+#define TRC_EVENT_BUFFER_RECORD_PADDING		(0x40000000UL)	/* End of the buffer skipped by a wrapping event */
+#define TRC_EVENT_BUFFER_RECORD_COMMITTED	(0x80000000UL)
+
+/* uiHead: event counter in the upper half, head index in the lower half */
+#define TRC_EVENT_BUFFER_HEAD_INDEX(uiHead) ((uiHead) & 0x0000FFFFUL)
+#define TRC_EVENT_BUFFER_HEAD_COUNT(uiHead) ((uiHead) >> 16)
+#define TRC_EVENT_BUFFER_HEAD_NEXT(uiHead, uiIndex) ((((uiHead) + 0x00010000UL) & 0xFFFF0000UL) | (uiIndex))
+
+/* Shared with the other contexts: re-read on every access */
+#define TRC_EVENT_BUFFER_WORD(pxTraceEventBuffer, uiIndex) (*(volatile uint32_t*)&(pxTraceEventBuffer)->puiBuffer[uiIndex]) /*cstat !MISRAC2004-11.4 !MISRAC2012-Rule-11.3 The buffer is word aligned*/
+#define TRC_EVENT_BUFFER_TAIL(pxTraceEventBuffer) (*(volatile uint32_t*)&(pxTraceEventBuffer)->uiTail)
+
+#endif
+
 traceResult xTraceEventBufferInitialize(TraceEventBuffer_t* pxTraceEventBuffer, uint32_t uiOptions,
 	uint8_t* puiBuffer, uint32_t uiSize)
 {
@@ -34,6 +68,17 @@ traceResult xTraceEventBufferInitialize(TraceEventBuffer_t* pxTraceEventBuffer,
 	pxTraceEventBuffer->uiNextHead = 0u;
 	pxTraceEventBuffer->uiTimerWraparounds = 0u;
 
+#if (TRC_CFG_EVENT_BUFFER_LOCK_FREE == 1)
+	/* This should never fail */
+	TRC_ASSERT(uiOptions == TRC_EVENT_BUFFER_OPTION_SKIP);
+
+	/* Indexes must fit in the lower half of uiHead, and records are word aligned */
+	/* This should never fail */
+	TRC_ASSERT((uiSize <= TRC_EVENT_BUFFER_RECORD_SIZE_MASK) && ((uiSize % sizeof(uint32_t)) == 0u));
+
+	(void)memset(puiBuffer, 0, uiSize);
+#endif
+
 	(void)xTraceSetComponentInitialized(TRC_RECORDER_COMPONENT_EVENT_BUFFER);
 
 	return TRC_SUCCESS;
@@ -63,6 +108,8 @@ static traceResult prvTraceEventBufferPop(TraceEventBuffer_t *pxTraceEventBuffer
 	return TRC_SUCCESS;
 }
 
+#if (TRC_CFG_EVENT_BUFFER_LOCK_FREE == 0)
+
 static traceResult prvTraceEventBufferAllocPop(TraceEventBuffer_t *pxTraceEventBuffer)
 {
 	uint32_t uiFreeSize = 0u;
@@ -269,6 +316,8 @@ traceResult xTraceEventBufferAllocCommit(TraceEventBuffer_t *pxTraceEventBuffer,
 	return TRC_SUCCESS;
 }
 
+#endif
+
 traceResult xTraceEventBufferPush(TraceEventBuffer_t *pxTraceEventBuffer, void *pvData, uint32_t uiSize, int32_t *piBytesWritten)
 {
 	uint32_t uiBufferSize;
@@ -392,6 +441,8 @@ traceResult xTraceEventBufferPush(TraceEventBuffer_t *pxTraceEventBuffer, void *
 	return TRC_SUCCESS;
 }
 
+#if (TRC_CFG_EVENT_BUFFER_LOCK_FREE == 0)
+
 traceResult xTraceEventBufferTransferAll(TraceEventBuffer_t* pxTraceEventBuffer, int32_t* piBytesWritten)
 {
 	int32_t iBytesWritten = 0;
@@ -528,6 +579,8 @@ traceResult xTraceEventBufferTransferChunk(TraceEventBuffer_t* pxTraceEventBuffe
 	return TRC_SUCCESS;
 }
 
+#endif
+
 traceResult xTraceEventBufferClear(TraceEventBuffer_t* pxTraceEventBuffer)
 {
 	/* This should never fail */
@@ -539,7 +592,234 @@ traceResult xTraceEventBufferClear(TraceEventBuffer_t* pxTraceEventBuffer)
 	pxTraceEventBuffer->uiSlack = 0u;
 	pxTraceEventBuffer->uiNextHead = 0u;
 
+#if (TRC_CFG_EVENT_BUFFER_LOCK_FREE == 1)
+	(void)memset(pxTraceEventBuffer->puiBuffer, 0, pxTraceEventBuffer->uiSize);
+#endif
+
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceEventBufferGetUsage(const TraceEventBuffer_t* pxTraceEventBuffer, uint32_t* puiUsed)
+{
+	uint32_t uiHead;
+	uint32_t uiTail;
+
+	/* This should never fail */
+	TRC_ASSERT(pxTraceEventBuffer != (void*)0);
+
+	/* This should never fail */
+	TRC_ASSERT(puiUsed != (void*)0);
+
+	/* Read without a critical section, the transfer may move the tail meanwhile */
+#if (TRC_CFG_EVENT_BUFFER_LOCK_FREE == 1)
+	uiHead = TRC_EVENT_BUFFER_HEAD_INDEX(*(volatile uint32_t*)&pxTraceEventBuffer->uiHead);
+#else
+	uiHead = *(volatile uint32_t*)&pxTraceEventBuffer->uiHead;
+#endif
+	uiTail = *(volatile uint32_t*)&pxTraceEventBuffer->uiTail;
+
+	/* When wrapped, the slack at the end of the buffer is counted as used */
+	if (uiHead >= uiTail)
+	{
+		*puiUsed = uiHead - uiTail;
+	}
+	else
+	{
+		*puiUsed = (pxTraceEventBuffer->uiSize - uiTail) + uiHead;
+	}
+
+	return TRC_SUCCESS;
+}
+
+#if (TRC_CFG_EVENT_BUFFER_LOCK_FREE == 1)
+
+traceResult xTraceEventBufferAlloc(TraceEventBuffer_t *pxTraceEventBuffer, uint32_t uiSize, void **ppvData)
+{
+	uint32_t uiBufferSize;
+	uint32_t uiHead;
+	uint32_t uiNewHead;
+	uint32_t uiIndex;
+	uint32_t uiRecord;
+	uint32_t uiPadding;
+	uint32_t uiUsed;
+	uint32_t uiTimestamp = 0u;
+	uint32_t uiDropped;
+	TraceEvent0_t* pxEvent;
+
+	/* This should never fail */
+	TRC_ASSERT(pxTraceEventBuffer != (void*)0);
+
+	/* This should never fail */
+	TRC_ASSERT(ppvData != (void*)0);
+
+	uiBufferSize = pxTraceEventBuffer->uiSize;
+
+	/* This should never fail */
+	TRC_ASSERT((uiSize >= sizeof(TraceEvent0_t)) && ((uiSize + sizeof(uint32_t)) < uiBufferSize));
+
+	/* Reserve the commit word and the event, after padding up to the end of the
+	 * buffer if they do not fit before it. The counter and the timestamp are
+	 * taken between the exclusive load and store: any other writer in between
+	 * (an interrupt clears the exclusive monitor) makes the store fail, and the
+	 * reservation is retried with new values. Events are therefore stored in
+	 * counter and timestamp order. The counter advances even when the buffer
+	 * is full, so dropped events show as gaps, as with the locked buffer. */
+	do
+	{
+		uiHead = __LDREXW(&pxTraceEventBuffer->uiHead);
+		uiIndex = TRC_EVENT_BUFFER_HEAD_INDEX(uiHead);
+		uiRecord = uiIndex;
+		uiPadding = 0u;
+		if ((uiIndex + sizeof(uint32_t) + uiSize) > uiBufferSize)
+		{
+			uiRecord = 0u;
+			uiPadding = uiBufferSize - uiIndex;
+		}
+
+		/* One word always stays free, so that a full buffer is not taken for an empty one */
+		uiUsed = ((uiIndex + uiBufferSize) - TRC_EVENT_BUFFER_TAIL(pxTraceEventBuffer)) % uiBufferSize;
+		if ((uiUsed + uiPadding + sizeof(uint32_t) + uiSize + sizeof(uint32_t)) > uiBufferSize)
+		{
+			uiRecord = uiBufferSize;
+			uiNewHead = TRC_EVENT_BUFFER_HEAD_NEXT(uiHead, uiIndex);
+		}
+		else
+		{
+			uiNewHead = TRC_EVENT_BUFFER_HEAD_NEXT(uiHead, (uiRecord + sizeof(uint32_t) + uiSize) % uiBufferSize);
+		}
+
+		(void)xTraceTimestampGet(&uiTimestamp);
+	} while (__STREXW(uiNewHead, &pxTraceEventBuffer->uiHead) != 0u);
+
+	if (uiRecord == uiBufferSize)
+	{
+		do
+		{
+			uiDropped = __LDREXW(&pxTraceEventBuffer->uiDroppedEvents);
+		} while (__STREXW(uiDropped + 1u, &pxTraceEventBuffer->uiDroppedEvents) != 0u);
+
+		*ppvData = (void*)0;
+
+		return TRC_FAIL;
+	}
+
+	if (uiPadding != 0u)
+	{
+		TRC_EVENT_BUFFER_WORD(pxTraceEventBuffer, uiIndex) = uiPadding | TRC_EVENT_BUFFER_RECORD_PADDING | TRC_EVENT_BUFFER_RECORD_COMMITTED;
+	}
+
+	pxEvent = (TraceEvent0_t*)&pxTraceEventBuffer->puiBuffer[uiRecord + sizeof(uint32_t)]; /*cstat !MISRAC2004-11.4 !MISRAC2012-Rule-11.3 !MISRAC2004-17.4_b We need to access a specific part of the buffer*/
+	pxEvent->EventCount = (uint16_t)TRC_EVENT_BUFFER_HEAD_COUNT(uiNewHead);
+	pxEvent->TS = uiTimestamp;
+
+	*ppvData = pxEvent;
+
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceEventBufferAllocCommit(TraceEventBuffer_t *pxTraceEventBuffer, const void *pvData, uint32_t uiSize, int32_t *piBytesWritten)
+{
+	/* This should never fail */
+	TRC_ASSERT(pvData != (void*)0);
+
+	/* Approximate: an interrupt may update the count between the read and the store */
+	/* This should never fail */
+	TRC_ASSERT_ALWAYS_EVALUATE(xTraceTimestampGetWraparounds(&pxTraceEventBuffer->uiTimerWraparounds) == TRC_SUCCESS);
+
+	/* The event must be complete in memory before the consumer can see the commit */
+	__DMB();
+
+	*(volatile uint32_t*)((uintptr_t)pvData - sizeof(uint32_t)) = (sizeof(uint32_t) + uiSize) | TRC_EVENT_BUFFER_RECORD_COMMITTED; /*cstat !MISRAC2004-11.3 !MISRAC2012-Rule-11.4 The commit word precedes the event*/
+
+	*piBytesWritten = (int32_t)uiSize;
+
+	return TRC_SUCCESS;
+}
+
+/**
+ * @internal Transfers committed events, oldest first, until uiLimit bytes have
+ * been written or an event is still being written. Events are transferred
+ * whole: one that would exceed uiLimit is left for the next call, unless it is
+ * the first one.
+ */
+static traceResult prvTraceEventBufferTransfer(TraceEventBuffer_t* pxTraceEventBuffer, uint32_t uiLimit, int32_t* piBytesWritten)
+{
+	int32_t iBytesWritten;
+	uint32_t uiSumBytesWritten = 0u;
+	uint32_t uiTail;
+	uint32_t uiCommit;
+	uint32_t uiRecordSize;
+	uint32_t uiEventSize;
+
+	/* This should never fail */
+	TRC_ASSERT(pxTraceEventBuffer != (void*)0);
+
+	/* This should never fail */
+	TRC_ASSERT(piBytesWritten != (void*)0);
+
+	uiTail = pxTraceEventBuffer->uiTail;
+
+	for (;;)
+	{
+		uiCommit = TRC_EVENT_BUFFER_WORD(pxTraceEventBuffer, uiTail);
+		if ((uiCommit & TRC_EVENT_BUFFER_RECORD_COMMITTED) == 0u)
+		{
+			/* Empty, or the oldest event is still being written */
+			break;
+		}
+
+		/* Read the event only after its commit word */
+		__DMB();
+
+		uiRecordSize = uiCommit & TRC_EVENT_BUFFER_RECORD_SIZE_MASK;
+		if ((uiCommit & TRC_EVENT_BUFFER_RECORD_PADDING) == 0u)
+		{
+			uiEventSize = uiRecordSize - sizeof(uint32_t);
+			if ((uiSumBytesWritten != 0u) && ((uiSumBytesWritten + uiEventSize) > uiLimit))
+			{
+				break;
+			}
+
+			iBytesWritten = 0;
+			(void)xTraceStreamPortWriteData(&pxTraceEventBuffer->puiBuffer[uiTail + sizeof(uint32_t)], uiEventSize, &iBytesWritten); /*cstat !MISRAC2004-17.4_b We need to access a specific part of the buffer*/
+			if ((uint32_t)iBytesWritten != uiEventSize)
+			{
+				/* Stream port not ready, keep the event */
+				break;
+			}
+
+			uiSumBytesWritten += uiEventSize;
+		}
+
+		/* Free space must read as zero before the writers may reserve it again */
+		(void)memset(&pxTraceEventBuffer->puiBuffer[uiTail], 0, uiRecordSize); /*cstat !MISRAC2004-17.4_b We need to access a specific part of the buffer*/
+		__DMB();
+
+		uiTail = (uiTail + uiRecordSize) % pxTraceEventBuffer->uiSize;
+		TRC_EVENT_BUFFER_TAIL(pxTraceEventBuffer) = uiTail;
+
+		if (uiSumBytesWritten >= uiLimit)
+		{
+			break;
+		}
+	}
+
+	*piBytesWritten = (int32_t)uiSumBytesWritten;
+
 	return TRC_SUCCESS;
 }
 
+traceResult xTraceEventBufferTransferAll(TraceEventBuffer_t* pxTraceEventBuffer, int32_t* piBytesWritten)
+{
+	/* At most one buffer's worth, so events written meanwhile do not keep this going */
+	return prvTraceEventBufferTransfer(pxTraceEventBuffer, pxTraceEventBuffer->uiSize, piBytesWritten);
+}
+
+traceResult xTraceEventBufferTransferChunk(TraceEventBuffer_t* pxTraceEventBuffer, uint32_t uiChunkSize, int32_t* piBytesWritten)
+{
+	return prvTraceEventBufferTransfer(pxTraceEventBuffer, uiChunkSize, piBytesWritten);
+}
+
+#endif
+
 #endif
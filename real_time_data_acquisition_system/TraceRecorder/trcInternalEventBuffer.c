@@ -98,6 +98,22 @@ traceResult xTraceInternalEventBufferTransferChunk(void)
 	return TRC_SUCCESS;
 }
 
+traceResult xTraceInternalEventBufferGetUsage(uint32_t* puiUsed, uint32_t* puiSize)
+{
+	TraceEventBuffer_t* pxEventBuffer;
+
+	/* This should never fail */
+	TRC_ASSERT(xTraceIsComponentInitialized(TRC_RECORDER_COMPONENT_INTERNAL_EVENT_BUFFER));
+
+	/* This should never fail */
+	TRC_ASSERT(puiSize != (void*)0);
+
+	pxEventBuffer = pxInternalEventBuffer->xEventBuffer[TRC_CFG_GET_CURRENT_CORE()];
+	*puiSize = pxEventBuffer->uiSize;
+
+	return xTraceEventBufferGetUsage(pxEventBuffer, puiUsed);
+}
+
 traceResult xTraceInternalEventBufferClear()
 {
 	/* This should never fail */
@@ -168,6 +168,165 @@ static TraceKernelPortData_t* pxKernelPortData TRC_CFG_RECORDER_DATA_ATTRIBUTE;
 
 #define TRC_PORT_MALLOC(size) pvPortMalloc(size)
 
+#if (TRC_CFG_EVENT_FILTER == 1)
+/* Event class of each event code (PSF_EVENT_*), for the streaming event filter.
+ * Codes not listed are 0, which TRC_KERNEL_PORT_EVENT_CLASS takes as a recorder event. */
+const uint16_t ausTraceKernelPortEventClass[(TRC_EVENT_LAST_ID) + 1] =
+{
+	[PSF_EVENT_TASK_PRIORITY] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_PRIO_INHERIT] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_PRIO_DISINHERIT] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_READY] = TRC_EVENT_CLASS_TASK_READY,
+	[PSF_EVENT_NEW_TIME] = TRC_EVENT_CLASS_OS_TICK,
+	[PSF_EVENT_NEW_TIME_SCHEDULER_SUSPENDED] = TRC_EVENT_CLASS_OS_TICK,
+	[PSF_EVENT_ISR_BEGIN] = TRC_EVENT_CLASS_ISR,
+	[PSF_EVENT_ISR_RESUME] = TRC_EVENT_CLASS_ISR,
+	[PSF_EVENT_TS_BEGIN] = TRC_EVENT_CLASS_TASK_SWITCH,
+	[PSF_EVENT_TS_RESUME] = TRC_EVENT_CLASS_TASK_SWITCH,
+	[PSF_EVENT_TASK_ACTIVATE] = TRC_EVENT_CLASS_TASK_SWITCH,
+	[PSF_EVENT_MALLOC] = TRC_EVENT_CLASS_MEMORY,
+	[PSF_EVENT_FREE] = TRC_EVENT_CLASS_MEMORY,
+	[PSF_EVENT_LOWPOWER_BEGIN] = TRC_EVENT_CLASS_LOW_POWER,
+	[PSF_EVENT_LOWPOWER_END] = TRC_EVENT_CLASS_LOW_POWER,
+	[PSF_EVENT_IFE_NEXT] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_IFE_DIRECT] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_QUEUE_SEND] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_GIVE] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_GIVE] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_SEND_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_GIVE_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_GIVE_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_SEND_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_GIVE_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_GIVE_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_SEND_FROMISR] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_GIVE_FROMISR] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_SEND_FROMISR_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_GIVE_FROMISR_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_RECEIVE] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_TAKE] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_TAKE] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_RECEIVE_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_TAKE_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_TAKE_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_RECEIVE_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_TAKE_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_TAKE_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_RECEIVE_FROMISR] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_TAKE_FROMISR] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_RECEIVE_FROMISR_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_TAKE_FROMISR_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_PEEK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_PEEK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_PEEK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_PEEK_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_PEEK_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_PEEK_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_PEEK_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_SEMAPHORE_PEEK_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_PEEK_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_TASK_DELAY_UNTIL] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_DELAY] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_SUSPEND] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_RESUME] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_RESUME_FROMISR] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TIMER_PENDFUNCCALL] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_PENDFUNCCALL_FROMISR] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_PENDFUNCCALL_FAILED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_PENDFUNCCALL_FROMISR_FAILED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_USER_EVENT] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT + 1] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT + 2] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT + 3] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT + 4] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT + 5] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT + 6] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT + 7] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT_FIXED] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT_FIXED + 1] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT_FIXED + 2] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT_FIXED + 3] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT_FIXED + 4] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT_FIXED + 5] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT_FIXED + 6] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_USER_EVENT_FIXED + 7] = TRC_EVENT_CLASS_USER,
+	[PSF_EVENT_TIMER_START] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_RESET] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_STOP] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_CHANGEPERIOD] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_START_FROMISR] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_RESET_FROMISR] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_STOP_FROMISR] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_CHANGEPERIOD_FROMISR] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_START_FAILED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_RESET_FAILED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_STOP_FAILED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_CHANGEPERIOD_FAILED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_START_FROMISR_FAILED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_RESET_FROMISR_FAILED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_STOP_FROMISR_FAILED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_TIMER_CHANGEPERIOD_FROMISR_FAILED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_EVENTGROUP_SYNC] = TRC_EVENT_CLASS_EVENT_GROUP,
+	[PSF_EVENT_EVENTGROUP_WAITBITS] = TRC_EVENT_CLASS_EVENT_GROUP,
+	[PSF_EVENT_EVENTGROUP_CLEARBITS] = TRC_EVENT_CLASS_EVENT_GROUP,
+	[PSF_EVENT_EVENTGROUP_CLEARBITS_FROMISR] = TRC_EVENT_CLASS_EVENT_GROUP,
+	[PSF_EVENT_EVENTGROUP_SETBITS] = TRC_EVENT_CLASS_EVENT_GROUP,
+	[PSF_EVENT_EVENTGROUP_SETBITS_FROMISR] = TRC_EVENT_CLASS_EVENT_GROUP,
+	[PSF_EVENT_EVENTGROUP_SYNC_BLOCK] = TRC_EVENT_CLASS_EVENT_GROUP,
+	[PSF_EVENT_EVENTGROUP_WAITBITS_BLOCK] = TRC_EVENT_CLASS_EVENT_GROUP,
+	[PSF_EVENT_EVENTGROUP_SYNC_FAILED] = TRC_EVENT_CLASS_EVENT_GROUP,
+	[PSF_EVENT_EVENTGROUP_WAITBITS_FAILED] = TRC_EVENT_CLASS_EVENT_GROUP,
+	[PSF_EVENT_QUEUE_SEND_FRONT] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_SEND_FRONT_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_SEND_FRONT_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_SEND_FRONT_FROMISR] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_QUEUE_SEND_FRONT_FROMISR_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_GIVE_RECURSIVE] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_GIVE_RECURSIVE_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_TAKE_RECURSIVE] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_MUTEX_TAKE_RECURSIVE_FAILED] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_TASK_NOTIFY] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_NOTIFY_WAIT] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_NOTIFY_WAIT_BLOCK] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_NOTIFY_WAIT_FAILED] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TASK_NOTIFY_FROM_ISR] = TRC_EVENT_CLASS_TASK,
+	[PSF_EVENT_TIMER_EXPIRED] = TRC_EVENT_CLASS_TIMER,
+	[PSF_EVENT_STREAMBUFFER_SEND] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_STREAMBUFFER_SEND_BLOCK] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_STREAMBUFFER_SEND_FAILED] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_STREAMBUFFER_RECEIVE] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_STREAMBUFFER_RECEIVE_BLOCK] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_STREAMBUFFER_RECEIVE_FAILED] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_STREAMBUFFER_SEND_FROM_ISR] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_STREAMBUFFER_SEND_FROM_ISR_FAILED] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_STREAMBUFFER_RECEIVE_FROM_ISR] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_STREAMBUFFER_RECEIVE_FROM_ISR_FAILED] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_STREAMBUFFER_RESET] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_SEND] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_SEND_BLOCK] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_SEND_FAILED] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_RECEIVE] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_RECEIVE_BLOCK] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_RECEIVE_FAILED] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_SEND_FROM_ISR] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_SEND_FROM_ISR_FAILED] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_RECEIVE_FROM_ISR] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_RECEIVE_FROM_ISR_FAILED] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MESSAGEBUFFER_RESET] = TRC_EVENT_CLASS_STREAM_BUFFER,
+	[PSF_EVENT_MALLOC_FAILED] = TRC_EVENT_CLASS_MEMORY,
+	[PSF_EVENT_FREE_FAILED] = TRC_EVENT_CLASS_MEMORY,
+	[PSF_EVENT_UNUSED_STACK] = TRC_EVENT_CLASS_APPLICATION,
+	[PSF_EVENT_STATEMACHINE_STATECHANGE] = TRC_EVENT_CLASS_APPLICATION,
+	[PSF_EVENT_INTERVAL_START] = TRC_EVENT_CLASS_APPLICATION,
+	[PSF_EVENT_COUNTER_CHANGE] = TRC_EVENT_CLASS_APPLICATION,
+	[PSF_EVENT_COUNTER_LIMIT_EXCEEDED] = TRC_EVENT_CLASS_APPLICATION,
+	[PSF_EVENT_MUTEX_TAKE_RECURSIVE_BLOCK] = TRC_EVENT_CLASS_QUEUE,
+	[PSF_EVENT_INTERVAL_STOP] = TRC_EVENT_CLASS_APPLICATION,
+	[PSF_EVENT_RUNNABLE_START] = TRC_EVENT_CLASS_APPLICATION,
+	[PSF_EVENT_RUNNABLE_STOP] = TRC_EVENT_CLASS_APPLICATION
+};
+#endif
+
 traceResult xTraceKernelPortInitialize(TraceKernelPortDataBuffer_t* pxBuffer)
 {
 	TRC_ASSERT_EQUAL_SIZE(TraceKernelPortDataBuffer_t, TraceKernelPortData_t);
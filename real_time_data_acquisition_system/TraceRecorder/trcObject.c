@@ -148,6 +148,11 @@ traceResult xTraceObjectUnregister(TraceObjectHandle_t xObjectHandle, uint32_t u
 	/* Send the delete event, if possible */
 	(void)xTraceEventCreate2(uiEventCode, (TraceUnsignedBaseType_t)(pvObject), uxState);  /*cstat !MISRAC2004-11.3 !MISRAC2012-Rule-11.4 !MISRAC2012-Rule-11.6 Suppress conversion from pointer to integer check*/
 
+#if (TRC_CFG_EVENT_FILTER == 1)
+	/* Keep the count of excluded objects right */
+	(void)xTraceEventSetObjectExcluded(pvObject, 0u);
+#endif
+
 	return xTraceEntryDelete(xObjectHandle);
 }
 
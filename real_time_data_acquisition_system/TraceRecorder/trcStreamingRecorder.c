@@ -118,6 +118,11 @@ static int32_t prvIsValidCommand(const TraceCommand_t* const cmd);
 /* Executed the received command (Start or Stop) */
 static void prvProcessCommand(const TraceCommand_t* const cmd);
 
+#if (TRC_CFG_EVENT_FILTER == 1)
+/* Sets the event filter from a CMD_SET_FILTER command */
+static void prvProcessFilterCommand(const TraceCommand_t* const cmd);
+#endif
+
 /* Internal function for starting the recorder */
 static void prvSetRecorderEnabled(void);
 
@@ -340,6 +345,9 @@ traceResult xTraceHeaderInitialize(TraceHeaderBuffer_t *pxBuffer)
 		pxHeader->uiOptions |= (1 << 3);
 	}
 
+	/* 5th bit used for TRC_CFG_EVENT_COMPACT_ENCODING, cleared by the host decoder */
+	pxHeader->uiOptions |= (((uint32_t)(TRC_CFG_EVENT_COMPACT_ENCODING)) << 4);
+
 	return TRC_SUCCESS;
 }
 
@@ -470,6 +478,11 @@ traceResult xTraceTzCtrl(void)
 		if (xTraceIsRecorderEnabled())
 		{
 			(void)xTraceInternalEventBufferTransfer();
+
+#if (TRC_CFG_EVENT_COMPACT_ENCODING == 1)
+			/* The last event of a burst may still be waiting for a full word */
+			(void)xTraceEventCompactFlush();
+#endif
 		}
 
 		/* If there was data sent or received (bytes != 0), loop around and repeat, if there is more data to send or receive.
@@ -480,6 +493,7 @@ traceResult xTraceTzCtrl(void)
 	if (xTraceIsRecorderEnabled())
 	{
 		(void)xTraceDiagnosticsCheckStatus();
+		(void)xTraceEventSheddingCheckStatus();
 		(void)xTraceStackMonitorReport();
 	}
 
@@ -488,12 +502,14 @@ traceResult xTraceTzCtrl(void)
 
 void vTraceSetFilterGroup(uint16_t filterGroup)
 {
+	/* No filter groups in streaming mode, see vTraceExcludeTask */
 	(void)filterGroup;
 }
 
 void vTraceSetFilterMask(uint16_t filterMask)
 {
-	(void)filterMask;
+	/* Event classes in streaming mode */
+	(void)xTraceEventSetClassMask((uint32_t)filterMask);
 }
 
 /******************************************************************************/
@@ -564,6 +580,10 @@ static void prvSetRecorderDisabled(void)
 	
 	pxTraceRecorderData->uiRecorderEnabled = 0u;
 
+#if (TRC_CFG_EVENT_COMPACT_ENCODING == 1)
+	(void)xTraceEventCompactFlush();
+#endif
+
 	(void)xTraceStreamPortOnTraceEnd();
 
 	TRACE_EXIT_CRITICAL_SECTION();
@@ -672,11 +692,25 @@ static void prvProcessCommand(const TraceCommand_t* const cmd)
 				prvSetRecorderDisabled();
 			}
 		  	break;
+#if (TRC_CFG_EVENT_FILTER == 1)
+		case CMD_SET_FILTER:
+			prvProcessFilterCommand(cmd);
+			break;
+#endif
 		default:
 		  	break;
 	}
 }
 
+#if (TRC_CFG_EVENT_FILTER == 1)
+static void prvProcessFilterCommand(const TraceCommand_t* const cmd)
+{
+	uint32_t uiValue = (uint32_t)cmd->param2 | ((uint32_t)cmd->param3 << 8) | ((uint32_t)cmd->param4 << 16) | ((uint32_t)cmd->param5 << 24);
+
+	(void)xTraceEventSetFilter((uint32_t)cmd->param1, uiValue);
+}
+#endif
+
 /* Do this in function to avoid unreachable code warnings */
 static traceResult prvVerifySizeAlignment(uint32_t ulSize)
 {
@@ -0,0 +1,121 @@
+#include "bench.h"
+#include "latency.h"
+#include "stm32l476xx.h"
+#include <stdio.h>
+
+// Image size from the linker's region symbols (the symbol addresses are the values)
+#if defined(__ARMCC_VERSION) && !defined(SIMULATION)
+extern char Load$$LR$$LR_IROM1$$Length[];
+extern char Image$$RW_IRAM1$$RW$$Length[];
+extern char Image$$RW_IRAM1$$ZI$$Length[];
+#define BENCH_FOOTPRINT 1
+#else
+#define BENCH_FOOTPRINT 0
+#endif
+
+static uint32_t bench_ticks_per_us = 1;
+static uint32_t bench_last;		// latency_now() at the last update
+static uint64_t bench_elapsed;	// Ticks since the window started
+static uint64_t bench_idle_ticks;	// Ticks spent in WFI during the window
+static uint32_t bench_sample_count;
+static uint64_t bench_convert_ticks;	// Ticks spent converting during the window
+static uint32_t bench_convert_count;
+
+// Extend the 32-bit stamp into the window length. Call with interrupts masked.
+static void bench_update(void) {
+	uint32_t now = latency_now();
+	bench_elapsed += (uint32_t)(now - bench_last);
+	bench_last = now;
+}
+
+void bench_init(uint32_t ticks_per_us) {
+	bench_ticks_per_us = ticks_per_us ? ticks_per_us : 1;
+	bench_last = latency_now();
+	bench_elapsed = 0;
+	bench_idle_ticks = 0;
+	bench_sample_count = 0;
+	bench_convert_ticks = 0;
+	bench_convert_count = 0;
+}
+
+void bench_samples(uint32_t count) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	bench_sample_count += count;
+	__set_PRIMASK(primask);
+}
+
+void bench_convert(uint32_t start, uint32_t end) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	bench_convert_ticks += (uint32_t)(end - start);
+	bench_convert_count++;
+	__set_PRIMASK(primask);
+}
+
+void bench_idle(uint32_t start, uint32_t end) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	bench_update();
+	bench_idle_ticks += (uint32_t)(end - start);
+	__set_PRIMASK(primask);
+}
+
+int bench_due(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	bench_update();
+	uint64_t elapsed_ms = bench_elapsed / bench_ticks_per_us / 1000;
+	__set_PRIMASK(primask);
+	return elapsed_ms >= BENCH_REPORT_PERIOD_MS;
+}
+
+int bench_report(const char *variant, char *buffer, size_t size) {
+	latency_histogram_t e2e;
+	char footprint[48];
+
+	// Close the window
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	bench_update();
+	uint64_t elapsed = bench_elapsed;
+	uint64_t idle = bench_idle_ticks;
+	uint32_t samples = bench_sample_count;
+	uint64_t convert_ticks = bench_convert_ticks;
+	uint32_t converts = bench_convert_count;
+	bench_elapsed = 0;
+	bench_idle_ticks = 0;
+	bench_sample_count = 0;
+	bench_convert_ticks = 0;
+	bench_convert_count = 0;
+	latency_get(LATENCY_STAGE_END_TO_END, &e2e);
+	latency_reset();	// Masked too: the histograms are also recorded from interrupts
+	__set_PRIMASK(primask);
+
+	uint64_t elapsed_us = elapsed / bench_ticks_per_us;
+	uint32_t per_s = elapsed_us ? (uint32_t)((uint64_t)samples * 1000000u / elapsed_us) : 0;
+	uint32_t idle_permille = elapsed ? (uint32_t)(idle * 1000u / elapsed) : 0;
+
+	// Stamp ticks to core cycles: the same count on target (ticks_per_us is SystemCoreClock in MHz),
+	// nanoseconds at the simulated core clock on the host
+	uint64_t convert_cycles = converts
+		? convert_ticks * (SystemCoreClock / 1000000u) / bench_ticks_per_us / converts : 0;
+
+#if BENCH_FOOTPRINT
+	snprintf(footprint, sizeof(footprint), "\"flash_bytes\":%lu,\"ram_bytes\":%lu",
+	         (unsigned long)(uintptr_t)Load$$LR$$LR_IROM1$$Length,
+	         (unsigned long)((uintptr_t)Image$$RW_IRAM1$$RW$$Length + (uintptr_t)Image$$RW_IRAM1$$ZI$$Length));
+#else
+	snprintf(footprint, sizeof(footprint), "\"flash_bytes\":null,\"ram_bytes\":null");
+#endif
+
+	return snprintf(buffer, size,
+	                "{\"bench\":\"%s\",\"window_ms\":%lu,\"samples\":%lu,\"samples_per_s\":%lu,"
+	                "\"e2e_p50_us\":%lu,\"e2e_p99_us\":%lu,\"e2e_max_us\":%lu,\"e2e_n\":%lu,"
+	                "\"convert_cycles\":%lu,\"idle_permille\":%lu,%s}\n\r",
+	                variant, (unsigned long)(elapsed_us / 1000), (unsigned long)samples, (unsigned long)per_s,
+	                (unsigned long)latency_percentile_us(&e2e, 50),
+	                (unsigned long)latency_percentile_us(&e2e, 99),
+	                (unsigned long)e2e.max_us, (unsigned long)e2e.count,
+	                (unsigned long)convert_cycles, (unsigned long)idle_permille, footprint);
+}
@@ -0,0 +1,58 @@
+#ifndef __BENCH_H
+#define __BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------
+// Benchmark report
+// The same module is built into the FreeRTOS and the bare-metal variant, so that
+// both are measured the same way. With BENCHMARK set to 1 (in main.c, or with -D
+// as the rtdas_sim_bench* host targets do), each variant runs the common workload:
+//   - the sensor channel is converted at BENCH_SAMPLE_RATE_HZ on TIM6 triggers,
+//   - every sample is handed to the processing code and counted,
+//   - one "Temperature: <n> C" line, converted from the newest sample, is sent per
+//     BENCH_SAMPLES_PER_LINE samples,
+// and prints one report line every BENCH_REPORT_PERIOD_MS, as a JSON object:
+//   {"bench":"<variant>","window_ms":..,"samples":..,"samples_per_s":..,
+//    "e2e_p50_us":..,"e2e_p99_us":..,"e2e_max_us":..,"e2e_n":..,
+//    "convert_cycles":..,"idle_permille":..,"flash_bytes":..,"ram_bytes":..}
+//  samples        samples processed during the window
+//  e2e_*          conversion of the newest sample until the last byte of its line has
+//                 been sent (the LATENCY_STAGE_END_TO_END histogram of latency.h).
+//                 p50/p99 are bucket upper bounds. Histograms are reset with each report.
+//  convert_cycles core cycles per temperature conversion (ADC code to degrees), averaged
+//                 over the window, including the two stamp reads around it. DWT cycles on
+//                 target; in the host simulation nanoseconds scaled by SystemCoreClock.
+//  idle_permille  share of the window the core spent in WFI
+//  flash/ram      image size from the ARM linker (load region LR_IROM1, RW + ZI of
+//                 RW_IRAM1); null in the host simulation
+// Time is kept with latency_now(); bench_idle() or bench_due() must be called at
+// least once per stamp wrap (4.3 s on the host).
+//------------------------------------------------------------------------------
+
+#define BENCH_SAMPLE_RATE_HZ    320
+#define BENCH_SAMPLES_PER_LINE  32      // One DMA block of the FreeRTOS variant
+#define BENCH_REPORT_PERIOD_MS  10000
+#define BENCH_REPORT_SIZE       256     // Buffer size for bench_report()
+
+// Start the first window; ticks_per_us as for latency_init()
+void bench_init(uint32_t ticks_per_us);
+
+// Count processed samples
+void bench_samples(uint32_t count);
+
+// Account for one temperature conversion, between two latency_now() stamps
+void bench_convert(uint32_t start, uint32_t end);
+
+// Account for time spent sleeping, between two latency_now() stamps
+void bench_idle(uint32_t start, uint32_t end);
+
+// Non-zero once the current window has lasted BENCH_REPORT_PERIOD_MS
+int bench_due(void);
+
+// Format the report of the current window and start the next one.
+// Returns the snprintf() result.
+int bench_report(const char *variant, char *buffer, size_t size);
+
+#endif /* __BENCH_H */
@@ -0,0 +1,145 @@
+#include "clock_manager.h"
+
+volatile uint32_t clock_notify_failures;
+
+static clock_notifier_t clock_notifiers[CLOCK_MAX_NOTIFIERS];
+static uint32_t clock_notifier_count;
+
+// MSIRANGE 0..11
+static const uint32_t clock_msi_range_hz[12] = {
+	100000, 200000, 400000, 800000, 1000000, 2000000,
+	4000000, 8000000, 16000000, 24000000, 32000000, 48000000
+};
+
+#define CLOCK_RANGE2_MAX_HZ 26000000	// Highest HCLK in voltage range 2
+
+//------------------------------------------------------------------------------
+// Voltage range and flash latency
+//------------------------------------------------------------------------------
+
+// Flash wait states for HCLK 'hz': one per 16 MHz in range 1, one per 6 MHz in range 2
+static uint32_t clock_flash_latency(uint32_t hz, int range2) {
+	return (hz - 1) / (range2 ? 6000000 : 16000000);
+}
+
+static void clock_set_flash_latency(uint32_t latency) {
+	FLASH->ACR = (FLASH->ACR & ~FLASH_ACR_LATENCY) | (latency << FLASH_ACR_LATENCY_Pos);
+	while (((FLASH->ACR & FLASH_ACR_LATENCY) >> FLASH_ACR_LATENCY_Pos) != latency); // Takes effect on read-back
+}
+
+// 1 - range 1 (high performance), 2 - range 2 (low power)
+static void clock_set_voltage_range(int range) {
+	RCC->APB1ENR1 |= RCC_APB1ENR1_PWREN;
+	PWR->CR1 = (PWR->CR1 & ~PWR_CR1_VOS) | (range == 1 ? PWR_CR1_VOS_0 : PWR_CR1_VOS_1);
+	while (PWR->SR2 & PWR_SR2_VOSF); // Regulator settled
+}
+
+//------------------------------------------------------------------------------
+// SYSCLK source
+//------------------------------------------------------------------------------
+
+static void clock_switch(uint32_t sw, uint32_t sws) {
+	RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | sw;
+	while ((RCC->CFGR & RCC_CFGR_SWS) != sws);
+}
+
+// PLL from HSI16: 16 MHz / M(2) * N(20) / R(2) = 80 MHz, VCO at 160 MHz
+static void clock_to_pll(void) {
+	if ((RCC->CFGR & RCC_CFGR_SWS) == RCC_CFGR_SWS_PLL) {
+		return;
+	}
+	RCC->CR |= RCC_CR_HSION;
+	while ((RCC->CR & RCC_CR_HSIRDY) == 0);
+
+	RCC->CR &= ~RCC_CR_PLLON; // Configurable only while off
+	while (RCC->CR & RCC_CR_PLLRDY);
+	RCC->PLLCFGR = (RCC->PLLCFGR & ~(RCC_PLLCFGR_PLLSRC | RCC_PLLCFGR_PLLM | RCC_PLLCFGR_PLLN | RCC_PLLCFGR_PLLR))
+	             | RCC_PLLCFGR_PLLSRC_HSI | (1U << RCC_PLLCFGR_PLLM_Pos) | (20U << RCC_PLLCFGR_PLLN_Pos)
+	             | RCC_PLLCFGR_PLLREN;
+	RCC->CR |= RCC_CR_PLLON;
+	while ((RCC->CR & RCC_CR_PLLRDY) == 0);
+
+	clock_switch(RCC_CFGR_SW_PLL, RCC_CFGR_SWS_PLL);
+}
+
+// MSI at 'range'. HSI16 is left running: it may be a peripheral kernel clock.
+static void clock_to_msi(uint32_t range) {
+	RCC->CR |= RCC_CR_MSION;
+	while ((RCC->CR & RCC_CR_MSIRDY) == 0); // MSIRANGE may only change while MSI is ready
+	RCC->CR = (RCC->CR & ~RCC_CR_MSIRANGE) | (range << RCC_CR_MSIRANGE_Pos) | RCC_CR_MSIRGSEL;
+
+	if ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_MSI) {
+		clock_switch(RCC_CFGR_SW_MSI, RCC_CFGR_SWS_MSI);
+		RCC->CR &= ~RCC_CR_PLLON;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Interface
+//------------------------------------------------------------------------------
+
+int clock_register(clock_notifier_t notifier) {
+	if (clock_notifier_count == CLOCK_MAX_NOTIFIERS) {
+		return 0;
+	}
+	clock_notifiers[clock_notifier_count++] = notifier;
+	return 1;
+}
+
+uint32_t clock_get(void) {
+	SystemCoreClockUpdate();
+	return SystemCoreClock;
+}
+
+int clock_set(uint32_t hz) {
+	uint32_t range = 12;
+
+	if (hz < CLOCK_MIN_HZ) {
+		return 0;	// MSI ranges 0-3: less than one cycle per microsecond
+	}
+	if (hz != CLOCK_PLL_HZ) {
+		for (range = 0; range < 12 && clock_msi_range_hz[range] != hz; range++);
+		if (range == 12) {
+			return 0;
+		}
+	}
+	if (hz == clock_get()) {
+		return 1;
+	}
+
+	int range2 = hz <= CLOCK_RANGE2_MAX_HZ; // Wait states are then counted for range 2, which needs more
+	uint32_t latency = clock_flash_latency(hz, range2);
+	uint32_t current = (FLASH->ACR & FLASH_ACR_LATENCY) >> FLASH_ACR_LATENCY_Pos;
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	// Up: range 1 and enough wait states for both the old and the new clock, before switching
+	if (!range2) {
+		clock_set_voltage_range(1);
+	}
+	clock_set_flash_latency(latency > current ? latency : current);
+	RCC->CFGR &= ~(RCC_CFGR_HPRE | RCC_CFGR_PPRE1 | RCC_CFGR_PPRE2);
+
+	if (range == 12) {
+		clock_to_pll();
+	} else {
+		clock_to_msi(range);
+	}
+
+	// Down: fewer wait states, then the low-power range
+	clock_set_flash_latency(latency);
+	if (range2) {
+		clock_set_voltage_range(2);
+	}
+	SystemCoreClockUpdate();
+
+	__set_PRIMASK(primask);
+
+	for (uint32_t i = 0; i < clock_notifier_count; i++) {
+		if (!clock_notifiers[i]()) {
+			clock_notify_failures++;
+		}
+	}
+	return 1;
+}
@@ -0,0 +1,46 @@
+#ifndef __CLOCK_MANAGER_H
+#define __CLOCK_MANAGER_H
+
+#include <stdint.h>
+#include "stm32l476xx.h"
+
+//------------------------------------------------------------------------------
+// Runtime system clock manager
+// SYSCLK runs either from MSI, at one of its ranges from 1 MHz to 48 MHz, or
+// from the PLL at 80 MHz (HSI16 / 2 * 20 / 2). A change follows the order
+// the reference manual requires: voltage range 1 and the higher flash latency
+// before the frequency goes up, the lower latency and range 2 (26 MHz at most)
+// after it has come down. AHB, APB1 and APB2 are left undivided.
+// Every driver whose timing derives from the clock registers a notifier, which
+// is called once SystemCoreClock holds the new frequency. Until then the
+// peripherals run with their old dividers: a byte on the wire or a scan period
+// may come out wrong across the switch.
+// The MSI ranges below 1 MHz (100 to 800 kHz) are refused: the cycle counter
+// scale (LATENCY_TICKS_PER_US), the ADC regulator start-up wait and the
+// reports count whole cycles per microsecond, which would be 0 there.
+// When to run fast and when to run slow is up to the application.
+//------------------------------------------------------------------------------
+
+#define CLOCK_PLL_HZ        80000000
+#define CLOCK_MIN_HZ        1000000	// Slowest SYSCLK accepted by clock_set()
+#define CLOCK_MAX_NOTIFIERS 8
+
+// Re-time a peripheral for the current SystemCoreClock. Returns 0 if it cannot run at that
+// clock (e.g. no baud rate divider within tolerance); the switch is not undone.
+typedef int (*clock_notifier_t)(void);
+
+extern volatile uint32_t clock_notify_failures; // Notifiers that returned 0, over all switches
+
+// Add a notifier, called in registration order after every switch. Returns 0 if the table is full.
+int clock_register(clock_notifier_t notifier);
+
+// Switch SYSCLK to 'hz': CLOCK_PLL_HZ or an MSI range frequency of at least CLOCK_MIN_HZ. Returns 1 once switched and
+// every notifier has been called (also when already at 'hz', without notifying), 0 if 'hz'
+// cannot be produced (nothing changed). Call from thread context only: interrupts are masked
+// while the PLL locks, and the notifiers may wait for peripherals.
+int clock_set(uint32_t hz);
+
+// Current SYSCLK frequency
+uint32_t clock_get(void);
+
+#endif /* __CLOCK_MANAGER_H */
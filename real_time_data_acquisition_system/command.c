@@ -0,0 +1,121 @@
+#include "command.h"
+#include <stddef.h>
+
+static uint8_t command_char(const command_token_t *token, uint32_t offset) {
+	return token->ring[(token->start + offset) & token->mask];
+}
+
+static int command_is_blank(uint8_t c) {
+	return c == ' ' || c == '\t';
+}
+
+static int command_is_eol(uint8_t c) {
+	return c == '\r' || c == '\n';
+}
+
+int command_next(const command_interpreter_t *interpreter, uint32_t *tail, uint32_t head,
+                 command_status_t *status) {
+	const uint8_t *ring = interpreter->ring;
+	uint32_t mask = interpreter->size - 1;
+	uint32_t start = *tail;
+	uint32_t end = start;
+
+	// Find the end of the line
+	while (end != head && !command_is_eol(ring[end & mask])) {
+		end++;
+	}
+	if (end == head) {
+		if (head - start >= interpreter->size) {
+			// The ring is full of one line: it can never complete, drop it
+			*tail = head;
+			*status = COMMAND_TOO_LONG;
+			return 1;
+		}
+		return 0;
+	}
+	*tail = end + 1;
+
+	// Split the line into tokens, in place
+	command_token_t tokens[1 + COMMAND_MAX_ARGS];
+	uint32_t count = 0;
+	uint32_t position = start;
+	while (position != end) {
+		if (command_is_blank(ring[position & mask])) {
+			position++;
+			continue;
+		}
+		if (count == 1 + COMMAND_MAX_ARGS) {
+			*status = COMMAND_BAD_ARGS;
+			return 1;
+		}
+		command_token_t *token = &tokens[count++];
+		token->ring = ring;
+		token->mask = mask;
+		token->start = position;
+		while (position != end && !command_is_blank(ring[position & mask])) {
+			position++;
+		}
+		token->length = position - token->start;
+	}
+	if (count == 0) {
+		*status = COMMAND_EMPTY;
+		return 1;
+	}
+
+	// Dispatch
+	for (uint32_t i = 0; i < interpreter->count; i++) {
+		const command_entry_t *entry = &interpreter->table[i];
+		if (command_token_equals(&tokens[0], entry->name)) {
+			uint32_t argc = count - 1;
+			if (argc < entry->min_args || argc > entry->max_args) {
+				*status = COMMAND_BAD_ARGS;
+			} else {
+				*status = entry->handler(&tokens[1], argc);
+			}
+			return 1;
+		}
+	}
+	*status = COMMAND_UNKNOWN;
+	return 1;
+}
+
+int command_token_equals(const command_token_t *token, const char *text) {
+	uint32_t i;
+
+	for (i = 0; i < token->length; i++) {
+		if (text[i] == '\0' || command_char(token, i) != (uint8_t)text[i]) {
+			return 0;
+		}
+	}
+	return text[i] == '\0';
+}
+
+int32_t command_token_select(const command_token_t *token, const char * const *choices, uint32_t count) {
+	for (uint32_t i = 0; i < count; i++) {
+		if (command_token_equals(token, choices[i])) {
+			return (int32_t)i;
+		}
+	}
+	return -1;
+}
+
+int command_token_to_u32(const command_token_t *token, uint32_t *value) {
+	uint32_t result = 0;
+
+	if (token->length == 0 || token->length > 10) {
+		return 0;
+	}
+	for (uint32_t i = 0; i < token->length; i++) {
+		uint8_t c = command_char(token, i);
+		if (c < '0' || c > '9') {
+			return 0;
+		}
+		uint64_t next = (uint64_t)result * 10 + (c - '0');
+		if (next > UINT32_MAX) {
+			return 0;
+		}
+		result = (uint32_t)next;
+	}
+	*value = result;
+	return 1;
+}
@@ -0,0 +1,71 @@
+#ifndef __COMMAND_H
+#define __COMMAND_H
+
+#include <stdint.h>
+
+//------------------------------------------------------------------------------
+// Command interpreter
+// Lines of text are tokenized in place, in the receive ring they arrived in: a
+// token is a position and a length in the ring, never a copy, and may wrap
+// around the end of the ring. The first token of a line selects an entry of a
+// static command table, the others are passed to its handler as arguments.
+// Lines end with CR or LF, tokens are separated by spaces or tabs, and empty
+// lines are ignored. A line is only parsed once its terminator has arrived, and
+// the ring space is released by the caller after command_next() has returned.
+//------------------------------------------------------------------------------
+
+#define COMMAND_MAX_ARGS 3	// Arguments after the command name
+
+// A token in the ring
+typedef struct {
+	const uint8_t *ring;	// Ring storage
+	uint32_t mask;			// Ring size - 1
+	uint32_t start;			// Free-running position of the first character
+	uint32_t length;
+} command_token_t;
+
+typedef enum {
+	COMMAND_OK,
+	COMMAND_EMPTY,		// Blank line, nothing executed
+	COMMAND_UNKNOWN,	// No table entry for the command name
+	COMMAND_BAD_ARGS,	// Wrong number of arguments, or an argument rejected by the handler
+	COMMAND_OUT_OF_RANGE,	// A well-formed value outside what the hardware can do
+	COMMAND_FAILED,		// Not possible in the current configuration
+	COMMAND_TOO_LONG,	// The line filled the ring without a terminator: discarded
+} command_status_t;
+
+// Handler of one command; args[0] is the first argument after the name
+typedef command_status_t (*command_handler_t)(const command_token_t *args, uint32_t argc);
+
+typedef struct {
+	const char *name;
+	command_handler_t handler;
+	uint8_t min_args;
+	uint8_t max_args;		// At most COMMAND_MAX_ARGS
+	const char *help;		// Arguments and description, for a help command
+} command_entry_t;
+
+// Command table and the ring the lines are read from
+typedef struct {
+	const command_entry_t *table;
+	uint32_t count;
+	const uint8_t *ring;
+	uint32_t size;			// Power of two
+} command_interpreter_t;
+
+// Execute the next complete line between *tail and head (free-running ring positions) and
+// advance *tail past it. Returns 1 with *status set if a line was consumed, 0 if no complete
+// line is waiting (*tail unchanged).
+int command_next(const command_interpreter_t *interpreter, uint32_t *tail, uint32_t head,
+                 command_status_t *status);
+
+// Token helpers for the handlers
+int command_token_equals(const command_token_t *token, const char *text);
+
+// Index of the token in 'choices', -1 if it is none of them
+int32_t command_token_select(const command_token_t *token, const char * const *choices, uint32_t count);
+
+// Decimal number; returns 0 if the token is not one or does not fit into 32 bits
+int command_token_to_u32(const command_token_t *token, uint32_t *value);
+
+#endif /* __COMMAND_H */
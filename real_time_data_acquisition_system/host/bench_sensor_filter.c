@@ -0,0 +1,77 @@
+#include "host_bench.h"
+#include "sensor_filter.h"
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+// Cost per input sample of the median + CIC stage for the configurations main.c
+// can select, fed one frame at a time like the processing task, next to the
+// plain frame average it replaced.
+//   bench_sensor_filter [frames]
+//------------------------------------------------------------------------------
+
+#define BENCH_SAMPLES 4096u
+#define FRAME_SAMPLES 32u	// SAMPLE_FRAME_SAMPLES: one DMA block of a single channel
+
+static uint16_t samples[BENCH_SAMPLES];
+static uint16_t outputs[FRAME_SAMPLES + 1];
+
+static void run_filter(uint32_t median_window, uint32_t order, uint32_t decimation, uint32_t frames) {
+	sensor_filter_t filter;
+	char name[48];
+	int64_t sum = 0;
+
+	sensor_filter_init(&filter, order, decimation, median_window);
+	uint64_t start = host_now_ns();
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		const uint16_t *in = &samples[(frame * FRAME_SAMPLES) % BENCH_SAMPLES];
+		uint32_t count = sensor_filter_process(&filter, in, FRAME_SAMPLES, outputs);
+		sum += count ? outputs[count - 1] : 0;
+	}
+	uint64_t elapsed = host_now_ns() - start;
+
+	snprintf(name, sizeof(name), "median %lu, order %lu, R %lu",
+	         (unsigned long)median_window, (unsigned long)order, (unsigned long)decimation);
+	host_bench_report(name, elapsed, (uint64_t)frames * FRAME_SAMPLES);
+	host_bench_sink += sum;
+}
+
+// The processing before the filter stage: one mean per frame
+static void run_frame_average(uint32_t frames) {
+	int64_t sum = 0;
+
+	uint64_t start = host_now_ns();
+	for (uint32_t frame = 0; frame < frames; frame++) {
+		const uint16_t *in = &samples[(frame * FRAME_SAMPLES) % BENCH_SAMPLES];
+		uint32_t total = 0;
+		for (uint32_t i = 0; i < FRAME_SAMPLES; i++) {
+			total += in[i];
+		}
+		sum += total / FRAME_SAMPLES;
+	}
+	host_bench_report("frame average", host_now_ns() - start, (uint64_t)frames * FRAME_SAMPLES);
+	host_bench_sink += sum;
+}
+
+int main(int argc, char **argv) {
+	static const uint8_t configs[][3] = {
+		// median window, order, decimation
+		{ 0, 1, 1 }, { 0, 1, 8 }, { 0, 2, 8 }, { 0, 3, 8 }, { 0, 3, 64 },
+		{ 3, 1, 8 }, { 3, 2, 8 }, { 5, 2, 8 }, { 5, 3, 64 },
+	};
+	uint32_t frames = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 200000;
+
+	// A noisy mid-scale signal with occasional full-scale spikes
+	srand(1);
+	for (uint32_t i = 0; i < BENCH_SAMPLES; i++) {
+		samples[i] = (uint16_t)(2048 + (rand() % 64) - 32);
+		if ((rand() & 255) == 0) {
+			samples[i] = 4095;
+		}
+	}
+
+	run_frame_average(frames);
+	for (uint32_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+		run_filter(configs[i][0], configs[i][1], configs[i][2], frames);
+	}
+	return 0;
+}
@@ -0,0 +1,41 @@
+#include "host_bench.h"
+#include "temp_convert.h"
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+// Table lookup against the float formula, over every code in turn and over
+// codes in random order (the sampled signal is neither).
+//   bench_temp_convert [rounds]
+//------------------------------------------------------------------------------
+
+#define BENCH_CODES 4096u
+
+static uint16_t random_codes[BENCH_CODES];
+
+static void run(const char *name, int32_t (*convert)(uint32_t), const uint16_t *codes, uint32_t rounds) {
+	int64_t sum = 0;
+	uint64_t start = host_now_ns();
+
+	for (uint32_t round = 0; round < rounds; round++) {
+		for (uint32_t i = 0; i < BENCH_CODES; i++) {
+			sum += convert(codes ? codes[i] : i);
+		}
+	}
+	host_bench_report(name, host_now_ns() - start, (uint64_t)rounds * BENCH_CODES);
+	host_bench_sink += sum;
+}
+
+int main(int argc, char **argv) {
+	uint32_t rounds = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 2000;
+
+	srand(1);
+	for (uint32_t i = 0; i < BENCH_CODES; i++) {
+		random_codes[i] = (uint16_t)(rand() & (TEMP_LUT_SIZE - 1));
+	}
+
+	run("lut, sequential", temp_code_to_centi_c, NULL, rounds);
+	run("float, sequential", temp_code_to_centi_c_float, NULL, rounds);
+	run("lut, random", temp_code_to_centi_c, random_codes, rounds);
+	run("float, random", temp_code_to_centi_c_float, random_codes, rounds);
+	return 0;
+}
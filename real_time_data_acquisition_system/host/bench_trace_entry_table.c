@@ -0,0 +1,299 @@
+#include "test.h"
+#include "host_bench.h"
+#include <trcRecorder.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The module itself, for its address hash and index slot macros. Its pointer casts
+// go through uintptr_t, so the 32-bit base type of trace_stub truncates them without
+// a warning and leaves index differences and the hash as on the target. Its index
+// assertion can be always true for an index type just wide enough for the slot count.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wtype-limits"
+#include "../TraceRecorder/trcEntryTable.c"
+#pragma GCC diagnostic pop
+
+//------------------------------------------------------------------------------
+// Address index of the trace entry table (trcEntryTable.c), built for one
+// TRC_CFG_ENTRY_SLOTS (50, 256 and 1024 under ctest): xTraceEntryFind() against
+// a linear scan of the entries over random create/delete churn, the slot
+// layout after a backward-shift delete across the end of the index, the
+// uiLongestProbe bound, and then the lookup cost of both with the table filled.
+//   bench_trace_entry_table_<slots> [lookups]
+//------------------------------------------------------------------------------
+
+#define POOL_SIZE (TRC_ENTRY_TABLE_SLOTS * 64u)	// Object addresses to pick from
+#define CHURN_STEPS 100000u
+
+volatile int trc_host_critical_nesting;
+
+static TraceEntryIndexTable_t index_table;
+static TraceEntryTable_t entry_table;
+static uint64_t pool[POOL_SIZE];				// Aligned like RTOS objects
+
+// Defined for trcRecorder.h, not used by the entry table
+traceResult xTraceTimestampGet(uint32_t *puiTimestamp) {
+	*puiTimestamp = 0u;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceTimestampGetWraparounds(uint32_t *puiTimerWraparounds) {
+	*puiTimerWraparounds = 0u;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceStreamPortWriteData(void *pvData, uint32_t uiSize, int32_t *piBytesWritten) {
+	*piBytesWritten = (int32_t)uiSize;
+	return TRC_SUCCESS;
+}
+
+static void reset(void) {
+	xTraceEntryIndexTableInitialize(&index_table);
+	xTraceEntryTableInitialize(&entry_table);
+}
+
+// The lookup the index replaced
+static traceResult linear_find(const void *address, TraceEntryHandle_t *handle) {
+	for (uint32_t i = 0; i < TRC_ENTRY_TABLE_SLOTS; i++) {
+		if (entry_table.axEntries[i].pvAddress == address) {
+			*handle = &entry_table.axEntries[i];
+			return TRC_SUCCESS;
+		}
+	}
+	return TRC_FAIL;
+}
+
+static uint32_t entry_index(TraceEntryHandle_t handle) {
+	return (uint32_t)((TraceEntry_t *)handle - entry_table.axEntries);
+}
+
+// First pool address after 'from' whose hash slot is 'slot'
+static void *address_at(uint32_t slot, uint32_t *from) {
+	for (; *from < POOL_SIZE; (*from)++) {
+		if (prvEntryAddressHash(&pool[*from]) == slot) {
+			return &pool[(*from)++];
+		}
+	}
+	return NULL;
+}
+
+// Every live entry is indexed once, with no empty slot between its hash slot and
+// its slot (what a delete without backward shift would leave), and no further
+// from its hash slot than uiLongestProbe
+static int index_consistent(void) {
+	uint32_t live = 0;
+	uint32_t indexed = 0;
+
+	for (uint32_t i = 0; i < TRC_ENTRY_TABLE_SLOTS; i++) {
+		live += (entry_table.axEntries[i].pvAddress != NULL);
+	}
+	for (uint32_t slot = 0; slot < TRC_ENTRY_ADDRESS_INDEX_SLOTS; slot++) {
+		TraceEntryAddressIndex_t index = index_table.axAddressIndex[slot];
+		if (index == TRC_ENTRY_ADDRESS_INDEX_EMPTY) {
+			continue;
+		}
+		if (index >= TRC_ENTRY_TABLE_SLOTS || entry_table.axEntries[index].pvAddress == NULL) {
+			return 0;
+		}
+		uint32_t home = prvEntryAddressHash(entry_table.axEntries[index].pvAddress);
+		if (ADDRESS_INDEX_DISTANCE(home, slot) > index_table.uiLongestProbe) {
+			return 0;
+		}
+		for (uint32_t s = home; s != slot; s = NEXT_ADDRESS_INDEX_SLOT(s)) {
+			if (index_table.axAddressIndex[s] == TRC_ENTRY_ADDRESS_INDEX_EMPTY) {
+				return 0;
+			}
+		}
+		indexed++;
+	}
+	return indexed == live;
+}
+
+//------------------------------------------------------------------------------
+// Random create/delete/find, every lookup checked against the linear scan
+//------------------------------------------------------------------------------
+
+static void test_cross_check(void) {
+	enum { OBJECTS = TRC_ENTRY_TABLE_SLOTS * 2 };	// Half of them fit at a time
+	static TraceEntryHandle_t handles[OBJECTS];
+	static uint8_t live[OBJECTS];
+	uint32_t mismatches = 0;
+	uint32_t full = 0;
+
+	reset();
+	memset(live, 0, sizeof(live));
+	srand(1);
+	for (uint32_t step = 0; step < CHURN_STEPS; step++) {
+		uint32_t k = (uint32_t)rand() % OBJECTS;
+		if (live[k]) {
+			CHECK(xTraceEntryDelete(handles[k]) == TRC_SUCCESS);
+			live[k] = 0;
+		} else if (xTraceEntryCreateWithAddress(&pool[k], &handles[k]) == TRC_SUCCESS) {
+			live[k] = 1;
+		} else {
+			full++;
+		}
+
+		TraceEntryHandle_t hashed, scanned;
+		uint32_t q = (uint32_t)rand() % OBJECTS;
+		traceResult found = xTraceEntryFind(&pool[q], &hashed);
+		if (found != linear_find(&pool[q], &scanned) || found != (live[q] ? TRC_SUCCESS : TRC_FAIL) ||
+		    (found == TRC_SUCCESS && hashed != scanned)) {
+			mismatches++;
+		}
+
+		// Entries created without an address are found by their own
+		if (rand() % 50 == 0 && xTraceEntryCreate(&hashed) == TRC_SUCCESS) {
+			CHECK(xTraceEntryFind(hashed, &scanned) == TRC_SUCCESS && scanned == hashed);
+			CHECK(xTraceEntryDelete(hashed) == TRC_SUCCESS);
+		}
+		if (step % 64u == 0u) {
+			CHECK(index_consistent());
+		}
+	}
+	CHECK(mismatches == 0);
+	CHECK(full > 0);		// The table did run full
+	CHECK(index_consistent());
+
+	// Deleting everything leaves no marker behind
+	for (uint32_t k = 0; k < OBJECTS; k++) {
+		if (live[k]) {
+			CHECK(xTraceEntryDelete(handles[k]) == TRC_SUCCESS);
+		}
+	}
+	for (uint32_t slot = 0; slot < TRC_ENTRY_ADDRESS_INDEX_SLOTS; slot++) {
+		CHECK(index_table.axAddressIndex[slot] == TRC_ENTRY_ADDRESS_INDEX_EMPTY);
+	}
+	CHECK(index_table.uiFreeIndexCount == TRC_ENTRY_TABLE_SLOTS);
+}
+
+//------------------------------------------------------------------------------
+// Backward-shift delete and the probe bound, on a cluster around the end
+//------------------------------------------------------------------------------
+
+static void test_backward_shift(void) {
+	const uint32_t h = TRC_ENTRY_ADDRESS_INDEX_SLOTS - 1u;	// Last slot, the cluster wraps to 0
+	const uint32_t s1 = NEXT_ADDRESS_INDEX_SLOT(h);
+	const uint32_t s2 = NEXT_ADDRESS_INDEX_SLOT(s1);
+	const uint32_t s3 = NEXT_ADDRESS_INDEX_SLOT(s2);
+	TraceEntryHandle_t a, b, c, e, found;
+	uint32_t from = 0;
+
+	// A, B and C hash to h, E to two slots later
+	void *addr_a = address_at(h, &from);
+	void *addr_b = address_at(h, &from);
+	void *addr_c = address_at(h, &from);
+	void *addr_absent = address_at(h, &from);
+	from = 0;
+	void *addr_e = address_at(s2, &from);
+	CHECK(addr_a && addr_b && addr_c && addr_absent && addr_e);
+	if (!(addr_a && addr_b && addr_c && addr_absent && addr_e)) {
+		return;
+	}
+
+	reset();
+	CHECK(index_table.uiLongestProbe == 0);
+	CHECK(xTraceEntryCreateWithAddress(addr_a, &a) == TRC_SUCCESS);
+	CHECK(xTraceEntryCreateWithAddress(addr_b, &b) == TRC_SUCCESS);
+	CHECK(xTraceEntryCreateWithAddress(addr_e, &e) == TRC_SUCCESS);
+	CHECK(xTraceEntryCreateWithAddress(addr_c, &c) == TRC_SUCCESS);
+
+	// h: A, s1: B, s2: E, s3: C, three slots past its hash slot
+	CHECK(index_table.axAddressIndex[h] == entry_index(a));
+	CHECK(index_table.axAddressIndex[s1] == entry_index(b));
+	CHECK(index_table.axAddressIndex[s2] == entry_index(e));
+	CHECK(index_table.axAddressIndex[s3] == entry_index(c));
+	CHECK(index_table.uiLongestProbe == 3);
+
+	// A miss walks the cluster and fails
+	CHECK(xTraceEntryFind(addr_absent, &found) == TRC_FAIL);
+
+	// B and C move back a slot each; E, at its hash slot, stays
+	CHECK(xTraceEntryDelete(a) == TRC_SUCCESS);
+	CHECK(index_table.axAddressIndex[h] == entry_index(b));
+	CHECK(index_table.axAddressIndex[s1] == entry_index(c));
+	CHECK(index_table.axAddressIndex[s2] == entry_index(e));
+	CHECK(index_table.axAddressIndex[s3] == TRC_ENTRY_ADDRESS_INDEX_EMPTY);
+	CHECK(index_table.uiLongestProbe == 3);		// Only ever grows
+	CHECK(index_consistent());
+
+	CHECK(xTraceEntryFind(addr_a, &found) == TRC_FAIL);
+	CHECK(xTraceEntryFind(addr_b, &found) == TRC_SUCCESS && found == b);
+	CHECK(xTraceEntryFind(addr_c, &found) == TRC_SUCCESS && found == c);
+	CHECK(xTraceEntryFind(addr_e, &found) == TRC_SUCCESS && found == e);
+
+	// Deleting the entry at its hash slot moves nothing it must not
+	CHECK(xTraceEntryDelete(e) == TRC_SUCCESS);
+	CHECK(index_table.axAddressIndex[s2] == TRC_ENTRY_ADDRESS_INDEX_EMPTY);
+	CHECK(xTraceEntryFind(addr_c, &found) == TRC_SUCCESS && found == c);
+	CHECK(index_consistent());
+}
+
+//------------------------------------------------------------------------------
+// Lookup cost with the configured number of objects
+//------------------------------------------------------------------------------
+
+static void bench_lookup(uint32_t lookups) {
+	const uint32_t objects = TRC_CFG_ENTRY_SLOTS;
+	TraceEntryHandle_t handle, found = NULL;
+	uint32_t probes = 0;
+	char name[48];
+	int64_t sum = 0;
+
+	reset();
+	for (uint32_t k = 0; k < objects; k++) {
+		CHECK(xTraceEntryCreateWithAddress(&pool[k], &handle) == TRC_SUCCESS);
+	}
+	CHECK(index_consistent());
+
+	// Probes per hit, over every object
+	for (uint32_t slot = 0; slot < TRC_ENTRY_ADDRESS_INDEX_SLOTS; slot++) {
+		TraceEntryAddressIndex_t index = index_table.axAddressIndex[slot];
+		if (index != TRC_ENTRY_ADDRESS_INDEX_EMPTY) {
+			probes += ADDRESS_INDEX_DISTANCE(prvEntryAddressHash(entry_table.axEntries[index].pvAddress), slot) + 1u;
+		}
+	}
+	printf("%u objects: %.2f probes per hit, longest probe %u\n",
+	       objects, (double)probes / objects, index_table.uiLongestProbe);
+
+	uint64_t start = host_now_ns();
+	for (uint32_t i = 0; i < lookups; i++) {
+		sum += linear_find(&pool[(i * 7u) % objects], &found);
+		sum += (intptr_t)found;
+	}
+	snprintf(name, sizeof(name), "%u slots: hit, linear", objects);
+	host_bench_report(name, host_now_ns() - start, lookups);
+
+	start = host_now_ns();
+	for (uint32_t i = 0; i < lookups; i++) {
+		sum += xTraceEntryFind(&pool[(i * 7u) % objects], &found);
+		sum += (intptr_t)found;
+	}
+	snprintf(name, sizeof(name), "%u slots: hit, hash index", objects);
+	host_bench_report(name, host_now_ns() - start, lookups);
+
+	start = host_now_ns();
+	for (uint32_t i = 0; i < lookups; i++) {
+		sum += linear_find(&pool[objects + i % 64u], &found);
+	}
+	snprintf(name, sizeof(name), "%u slots: miss, linear", objects);
+	host_bench_report(name, host_now_ns() - start, lookups);
+
+	start = host_now_ns();
+	for (uint32_t i = 0; i < lookups; i++) {
+		sum += xTraceEntryFind(&pool[objects + i % 64u], &found);
+	}
+	snprintf(name, sizeof(name), "%u slots: miss, hash index", objects);
+	host_bench_report(name, host_now_ns() - start, lookups);
+
+	host_bench_sink += sum;
+}
+
+int main(int argc, char **argv) {
+	uint32_t lookups = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 2000000u;
+
+	test_cross_check();
+	test_backward_shift();
+	bench_lookup(lookups);
+	return test_result();
+}
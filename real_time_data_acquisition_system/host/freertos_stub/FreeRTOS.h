@@ -0,0 +1,19 @@
+#ifndef __HOST_FREERTOS_STUB_H
+#define __HOST_FREERTOS_STUB_H
+
+//------------------------------------------------------------------------------
+// Native host tests: the part of the FreeRTOS API used by the RTOS-agnostic
+// modules (msg_pool.c). Critical sections are no-ops, since these tests run on
+// a single thread, and a failed configASSERT() is counted instead of halting.
+//------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef unsigned long UBaseType_t;
+typedef long BaseType_t;
+
+extern int host_assert_failures;
+#define configASSERT(x) do { if ((x) == 0) { host_assert_failures++; } } while (0)
+
+#endif /* __HOST_FREERTOS_STUB_H */
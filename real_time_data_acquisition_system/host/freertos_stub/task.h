@@ -0,0 +1,9 @@
+#ifndef __HOST_TASK_STUB_H
+#define __HOST_TASK_STUB_H
+
+#include "FreeRTOS.h"
+
+#define taskENTER_CRITICAL_FROM_ISR()     ((UBaseType_t)0)
+#define taskEXIT_CRITICAL_FROM_ISR(x)     ((void)(x))
+
+#endif /* __HOST_TASK_STUB_H */
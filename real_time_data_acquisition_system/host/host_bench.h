@@ -0,0 +1,36 @@
+#ifndef __HOST_BENCH_H
+#define __HOST_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+//------------------------------------------------------------------------------
+// Timing for the host benchmarks. Host figures only compare implementations
+// with each other; cycle counts on the target come from bench.c. Times are also
+// given in cycles of a core at SystemCoreClock = HOST_BENCH_CORE_CLOCK_HZ, to set
+// them against the target's cycle counts.
+//------------------------------------------------------------------------------
+
+#ifndef HOST_BENCH_CORE_CLOCK_HZ
+#define HOST_BENCH_CORE_CLOCK_HZ 80000000u	// SystemCoreClock on the PLL (system_clock_80MHz.c)
+#endif
+
+static inline uint64_t host_now_ns(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+// Results are summed into this, so the compiler cannot drop the work being timed
+static volatile int64_t host_bench_sink;
+
+static inline void host_bench_report(const char *name, uint64_t elapsed_ns, uint64_t operations) {
+	double ns = (double)elapsed_ns / (double)operations;
+
+	printf("%-32s %10.2f ns/op %10.2f cycles/op at %u MHz  (%llu ops)\n", name,
+	       ns, ns * (HOST_BENCH_CORE_CLOCK_HZ / 1000000u) / 1000.0,
+	       HOST_BENCH_CORE_CLOCK_HZ / 1000000u, (unsigned long long)operations);
+}
+
+#endif /* __HOST_BENCH_H */
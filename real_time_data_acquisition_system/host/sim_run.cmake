@@ -0,0 +1,28 @@
+#-------------------------------------------------------------------------------
+# Run one host simulation on a stimulus script and check its UART capture.
+#   cmake -DSIM=<executable> -DSCRIPT=<script> -DOUT=<capture file>
+#         -DEXPECT=<regex>[;<regex>...] -P sim_run.cmake
+# Fails if the simulation does not reach the script's 'end', or if any of the
+# expressions is missing from the capture.
+#-------------------------------------------------------------------------------
+execute_process(
+	COMMAND ${CMAKE_COMMAND} -E env SIM_SCRIPT=${SCRIPT} SIM_UART_OUT=${OUT} ${SIM}
+	RESULT_VARIABLE result
+	OUTPUT_VARIABLE output
+	ERROR_VARIABLE output
+	TIMEOUT 120)
+message("${output}")
+if(NOT result EQUAL 0)
+	message(FATAL_ERROR "${SIM} failed: ${result}")
+endif()
+if(NOT output MATCHES "sim: [0-9]+ ms")
+	message(FATAL_ERROR "${SIM} stopped before the end of ${SCRIPT}")
+endif()
+
+file(READ ${OUT} capture)
+string(REPLACE "\\;" ";" EXPECT "${EXPECT}")	# Separators escaped by add_test()
+foreach(pattern IN LISTS EXPECT)
+	if(NOT capture MATCHES "${pattern}")
+		message(FATAL_ERROR "UART capture ${OUT} has no match for '${pattern}'")
+	endif()
+endforeach()
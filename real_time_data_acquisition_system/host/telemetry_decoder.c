@@ -0,0 +1,69 @@
+#include "telemetry_decoder.h"
+
+void telemetry_decoder_init(telemetry_decoder_t *decoder) {
+	decoder->length = 0;
+	decoder->overflow = 0;
+	decoder->have_sequence = 0;
+	decoder->last_sequence = 0;
+	decoder->packets = 0;
+	decoder->corrupted = 0;
+	decoder->lost = 0;
+	decoder->duplicates = 0;
+	decoder->resyncs = 0;
+}
+
+// A delimiter was received: decode, check and deliver the frame collected so far
+static void telemetry_decoder_end_frame(telemetry_decoder_t *decoder,
+                                        telemetry_packet_handler_t handler, void *context) {
+	uint8_t decoded[TELEMETRY_MAX_FRAME];
+	telemetry_packet_t packet;
+
+	if (decoder->overflow) {
+		decoder->corrupted++;
+		return;
+	}
+	if (decoder->length == 0) {
+		return; // Back-to-back delimiters, e.g. while resynchronising
+	}
+
+	size_t length = cobs_decode(decoder->frame, decoder->length, decoded);
+	if (length == 0 || !telemetry_parse(decoded, length, &packet)) {
+		decoder->corrupted++;
+		return;
+	}
+
+	// A forward jump in the 16-bit sequence number beyond +1 means packets went missing
+	if (decoder->have_sequence) {
+		uint16_t gap = (uint16_t)(packet.sequence - decoder->last_sequence - 1);
+		if (packet.sequence == decoder->last_sequence) {
+			decoder->duplicates++;
+			return;
+		} else if (gap <= TELEMETRY_DECODER_MAX_GAP) {
+			decoder->lost += gap;
+		} else {
+			decoder->resyncs++;
+		}
+	}
+	decoder->have_sequence = 1;
+	decoder->last_sequence = packet.sequence;
+	decoder->packets++;
+
+	if (handler) {
+		handler(&packet, context);
+	}
+}
+
+void telemetry_decoder_feed(telemetry_decoder_t *decoder, const uint8_t *data, size_t length,
+                            telemetry_packet_handler_t handler, void *context) {
+	for (size_t i = 0; i < length; i++) {
+		if (data[i] == 0x00) {
+			telemetry_decoder_end_frame(decoder, handler, context);
+			decoder->length = 0;
+			decoder->overflow = 0;
+		} else if (decoder->length < sizeof(decoder->frame)) {
+			decoder->frame[decoder->length++] = data[i];
+		} else {
+			decoder->overflow = 1;
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef __TELEMETRY_DECODER_H
+#define __TELEMETRY_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "../telemetry.h"
+
+//------------------------------------------------------------------------------
+// Host-side decoder for the binary telemetry stream (see telemetry.h).
+// Bytes read from the serial port are fed in arbitrary chunks; complete packets
+// are reassembled at the 0x00 delimiters, checked and handed to a callback.
+// Build on the host together with ../telemetry.c.
+//------------------------------------------------------------------------------
+
+// Largest forward jump of the sequence number still counted as lost packets. Anything
+// beyond, and any backward jump, is taken as a restart of the sender: the decoder
+// resynchronises on the new number instead of counting ~65535 lost packets.
+#define TELEMETRY_DECODER_MAX_GAP 1024
+
+typedef void (*telemetry_packet_handler_t)(const telemetry_packet_t *packet, void *context);
+
+typedef struct {
+	uint8_t frame[TELEMETRY_MAX_FRAME];	// Encoded bytes of the frame being received
+	size_t length;
+	int overflow;				// Frame too long: skip bytes up to the next delimiter
+	int have_sequence;
+	uint16_t last_sequence;
+
+	// Statistics
+	uint32_t packets;		// Valid packets delivered
+	uint32_t corrupted;		// Frames rejected by COBS decoding, length or CRC check
+	uint32_t lost;			// Packets missing according to gaps in the sequence numbers
+	uint32_t duplicates;		// Packets repeating the previous sequence number, not delivered
+	uint32_t resyncs;		// Sequence jumps taken as a restart of the sender
+} telemetry_decoder_t;
+
+void telemetry_decoder_init(telemetry_decoder_t *decoder);
+
+// Feed received bytes; 'handler' is called once per valid packet
+void telemetry_decoder_feed(telemetry_decoder_t *decoder, const uint8_t *data, size_t length,
+                            telemetry_packet_handler_t handler, void *context);
+
+#endif /* __TELEMETRY_DECODER_H */
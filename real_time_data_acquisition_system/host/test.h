@@ -0,0 +1,27 @@
+#ifndef __HOST_TEST_H
+#define __HOST_TEST_H
+
+#include <stdio.h>
+
+//------------------------------------------------------------------------------
+// Checks for the host tests: a failed check is reported with its location and
+// the test goes on; main() returns test_result(), non-zero if any check failed.
+//------------------------------------------------------------------------------
+
+static int test_failures;
+
+#define CHECK(condition) do {                                                      \
+	if (!(condition)) {                                                            \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		test_failures++;                                                           \
+	}                                                                              \
+} while (0)
+
+static inline int test_result(void) {
+	if (test_failures) {
+		fprintf(stderr, "%d check(s) failed\n", test_failures);
+	}
+	return test_failures != 0;
+}
+
+#endif /* __HOST_TEST_H */
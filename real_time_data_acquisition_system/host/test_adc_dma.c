@@ -0,0 +1,243 @@
+#include "test.h"
+#include "sensor_ADC_driver.h"
+#include "sim_hw.h"
+
+// Vector handlers of the driver under test
+void ADC1_2_IRQHandler(void);
+void DMA1_Channel1_IRQHandler(void);
+
+//------------------------------------------------------------------------------
+// DMA ping-pong acquisition of sensor_ADC_driver.c against the register blocks of
+// the host simulation. Only the register thread runs (it answers ADSTP): the
+// tests raise the DMA and ADC flags themselves and call the handlers, so every
+// hand-off is deterministic.
+//------------------------------------------------------------------------------
+
+static uint32_t handed_out[8];
+static uint32_t handed_out_count;
+
+static void block_ready(uint32_t block_index) {
+	if (handed_out_count < 8) {
+		handed_out[handed_out_count] = block_index;
+	}
+	handed_out_count++;
+}
+
+// Raise DMA1 channel 1 flags and enter its handler; the clear writes to IFCR do not reach
+// ISR in RAM, so drop the flags afterwards (as sim_dma_interrupt() does)
+static void dma_interrupt(uint32_t flags) {
+	DMA1->ISR |= flags | DMA_ISR_GIF1;
+	DMA1_Channel1_IRQHandler();
+	DMA1->ISR &= ~(flags | DMA_ISR_GIF1);
+	DMA1->IFCR = 0;
+}
+
+static void test_init(void) {
+	ADC_DMA_Init(block_ready);
+
+	CHECK(RCC->AHB1ENR & RCC_AHB1ENR_DMA1EN);
+	CHECK((DMA1_CSELR->CSELR & DMA_CSELR_C1S) == 0);
+	CHECK(DMA1_Channel1->CPAR == (uint32_t)&ADC1->DR);
+	CHECK(DMA1_Channel1->CMAR == (uint32_t)ADC_DMA_GetBlock(0));
+	CHECK(DMA1_Channel1->CNDTR == ADC_DMA_BUFFER_SAMPLES);
+	CHECK(DMA1_Channel1->CCR == (DMA_CCR_CIRC | DMA_CCR_MINC | DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0 |
+	                             DMA_CCR_HTIE | DMA_CCR_TCIE));
+	CHECK((ADC1->CFGR & (ADC_CFGR_DMAEN | ADC_CFGR_DMACFG | ADC_CFGR_CONT)) ==
+	      (ADC_CFGR_DMAEN | ADC_CFGR_DMACFG | ADC_CFGR_CONT));
+	CHECK((ADC1->IER & ADC_IER_EOC) == 0);
+	CHECK(ADC1->IER & ADC_IER_OVR);
+	CHECK(ADC_DMA_GetBlock(1) == ADC_DMA_GetBlock(0) + ADC_DMA_BLOCK_SAMPLES);
+}
+
+static void test_start(void) {
+	DMA1_Channel1->CNDTR = 5;	// Left over from an earlier run
+	ADC_DMA_Start();
+
+	CHECK(DMA1_Channel1->CCR & DMA_CCR_EN);
+	CHECK(DMA1_Channel1->CNDTR == ADC_DMA_BUFFER_SAMPLES);
+	CHECK(ADC1->CR & ADC_CR_ADSTART);
+}
+
+// Blocks alternate 0, 1, 0, ...; a block still held when it fills again is an overrun
+static void test_hand_off(void) {
+	handed_out_count = 0;
+	adc_dma_block_count = 0;
+	adc_dma_overrun_count = 0;
+
+	dma_interrupt(DMA_ISR_HTIF1);
+	dma_interrupt(DMA_ISR_TCIF1);
+	CHECK(handed_out_count == 2 && handed_out[0] == 0 && handed_out[1] == 1);
+	CHECK(adc_dma_block_count == 2 && adc_dma_overrun_count == 0);
+
+	// Block 0 is still held by the consumer: overwritten, counted, not handed out again
+	dma_interrupt(DMA_ISR_HTIF1);
+	CHECK(handed_out_count == 2);
+	CHECK(adc_dma_block_count == 3 && adc_dma_overrun_count == 1);
+
+	ADC_DMA_ReleaseBlock(0);
+	ADC_DMA_ReleaseBlock(1);
+	dma_interrupt(DMA_ISR_HTIF1);
+	CHECK(handed_out_count == 3 && handed_out[2] == 0);
+	CHECK(adc_dma_overrun_count == 1);
+
+	// Both halves pending in one interrupt (a late handler): block 0 first, then block 1
+	ADC_DMA_ReleaseBlock(0);
+	dma_interrupt(DMA_ISR_HTIF1 | DMA_ISR_TCIF1);
+	CHECK(handed_out_count == 5 && handed_out[3] == 0 && handed_out[4] == 1);
+	CHECK(adc_dma_block_count == 6 && adc_dma_overrun_count == 1);
+
+	// Unrelated channel flags do not hand out anything
+	ADC_DMA_ReleaseBlock(0);
+	ADC_DMA_ReleaseBlock(1);
+	dma_interrupt(0);
+	CHECK(handed_out_count == 5 && adc_dma_block_count == 6);
+}
+
+// An ADC overrun restarts the sequence and the DMA at the start of block 0
+static void test_adc_overrun(void) {
+	adc_ovr_count = 0;
+	DMA1_Channel1->CNDTR = 17;	// Somewhere in block 0
+
+	ADC1->ISR |= ADC_ISR_OVR;
+	ADC1_2_IRQHandler();
+	ADC1->ISR &= ~ADC_ISR_OVR;
+
+	CHECK(adc_ovr_count == 1);
+	CHECK(DMA1_Channel1->CNDTR == ADC_DMA_BUFFER_SAMPLES);
+	CHECK(DMA1_Channel1->CCR & DMA_CCR_EN);
+	CHECK(ADC1->CR & ADC_CR_ADSTART);
+
+	// No overrun flag: nothing to recover
+	ADC1_2_IRQHandler();
+	CHECK(adc_ovr_count == 1);
+}
+
+// A scan of three channels: each block holds a whole number of scans
+static void test_scan_blocks(void) {
+	static const adc_scan_channel_t table[] = {
+		{ 6, ADC_SMP_640_5 },
+		{ ADC_CHANNEL_VREFINT, ADC_SMP_247_5 },
+		{ ADC_CHANNEL_TEMPSENSOR, ADC_SMP_247_5 },
+	};
+	uint32_t length = (ADC_DMA_BLOCK_SAMPLES / 3) * 3;
+
+	ADC_DMA_Stop();
+	ADC_Scan_Configure(table, 3);
+	ADC_DMA_Start();
+
+	CHECK(ADC_DMA_GetBlockLength() == length);
+	CHECK(DMA1_Channel1->CNDTR == 2 * length);
+	CHECK(ADC_DMA_GetBlock(1) == ADC_DMA_GetBlock(0) + length);
+	CHECK(((ADC1->SQR1 & ADC_SQR1_L) >> ADC_SQR1_L_Pos) == 2);
+}
+
+// A channel past the last one is refused before anything is programmed
+static void test_scan_bad_channel(void) {
+	static const adc_scan_channel_t table[] = {
+		{ 6, ADC_SMP_640_5 },
+		{ ADC_CHANNEL_VBAT + 1, ADC_SMP_247_5 },
+	};
+	uint32_t sqr1 = ADC1->SQR1;
+	uint32_t length = ADC_Scan_GetLength();
+
+	ADC_DMA_Stop();
+	ADC_Scan_Configure(table, 2);
+	CHECK(ADC1->SQR1 == sqr1);
+	CHECK(ADC_Scan_GetLength() == length);
+}
+
+// The scan rate is capped at one scan per conversion time of the sequence, here the table of
+// test_scan_blocks() at 80 MHz, where the internal channels need 640.5 cycles for their 4 and
+// 5 us: 3 * 640.5 + 3 * 12.5 = 1959 ADC clock cycles
+static void test_timer_max_rate(void) {
+	static const adc_scan_channel_t table[] = {
+		{ 6, ADC_SMP_640_5 },
+		{ ADC_CHANNEL_VREFINT, ADC_SMP_247_5 },
+		{ ADC_CHANNEL_TEMPSENSOR, ADC_SMP_247_5 },
+	};
+	uint32_t clock_hz = SystemCoreClock;
+
+	ADC_DMA_Stop();
+	ADC123_COMMON->CCR = (ADC123_COMMON->CCR & ~ADC_CCR_CKMODE) | ADC_CCR_CKMODE_0;	// HCLK/1
+	SystemCoreClock = 80000000;
+	ADC_Scan_Configure(table, 3);
+
+	uint32_t max_rate = ADC_Timer_GetMaxRate();
+	CHECK(max_rate == 80000000u * 2 / 3918);
+	CHECK(ADC_Timer_Init(1000) == 1000);
+	CHECK(ADC_Timer_SetRate(max_rate) != 0 && ADC_Timer_GetRate() <= max_rate);
+	CHECK(ADC_Timer_SetRate(max_rate + 1) == 0);
+	CHECK(ADC_Timer_SetRate(SystemCoreClock) == 0);
+	CHECK(ADC_Timer_SetRate(0) == 0);
+
+	// HCLK/2 halves the ADC clock and the limit with it
+	ADC123_COMMON->CCR |= ADC_CCR_CKMODE_1;
+	ADC123_COMMON->CCR &= ~ADC_CCR_CKMODE_0;
+	CHECK(ADC_Timer_GetMaxRate() == max_rate / 2);
+	CHECK(ADC_Timer_SetRate(max_rate) == 0);
+
+	// A lower HCLK after a clock change: the requested rate is checked again, against the
+	// table's 247.5 cycles, which cover 4 and 5 us at 4 MHz. The timer stops rather than run
+	// on the period computed for the old clock.
+	ADC123_COMMON->CCR = (ADC123_COMMON->CCR & ~ADC_CCR_CKMODE) | ADC_CCR_CKMODE_0;
+	CHECK(ADC_Timer_SetRate(20000) != 0);
+	TIM6->CR1 |= TIM_CR1_CEN;
+	SystemCoreClock = 4000000;
+	CHECK(ADC_ClockChanged() == 0);
+	CHECK(ADC_Timer_GetMaxRate() == 4000000u * 2 / 2346);
+	CHECK(ADC_Timer_GetRate() == 0);
+	CHECK((TIM6->CR1 & TIM_CR1_CEN) == 0);
+
+	// A rate that fits the new clock programs the timer again
+	CHECK(ADC_Timer_SetRate(1000) == 1000);
+	CHECK(ADC_Timer_GetRate() == 1000);
+
+	SystemCoreClock = clock_hz;
+}
+
+// Sampling times of the internal channels follow the ADC clock: at least 4 us for VREFINT and
+// 5 us for the temperature sensor, never less than the table asks for, and external inputs as
+// the table says
+static void test_scan_sampling_times(void) {
+	static const adc_scan_channel_t table[] = {
+		{ 6, ADC_SMP_2_5 },
+		{ ADC_CHANNEL_VREFINT, ADC_SMP_2_5 },
+		{ ADC_CHANNEL_TEMPSENSOR, ADC_SMP_2_5 },
+		{ ADC_CHANNEL_VBAT, ADC_SMP_247_5 },
+	};
+	uint32_t clock_hz = SystemCoreClock;
+
+	ADC_DMA_Stop();
+	ADC123_COMMON->CCR = (ADC123_COMMON->CCR & ~ADC_CCR_CKMODE) | ADC_CCR_CKMODE_0;	// HCLK/1
+	SystemCoreClock = 80000000;
+	ADC_Scan_Configure(table, 4);
+	CHECK(((ADC1->SMPR1 >> (3 * 6)) & 7u) == ADC_SMP_2_5);
+	CHECK(((ADC1->SMPR1 >> (3 * ADC_CHANNEL_VREFINT)) & 7u) == ADC_SMP_640_5);	// 320 cycles
+	CHECK(((ADC1->SMPR2 >> (3 * (ADC_CHANNEL_TEMPSENSOR - 10))) & 7u) == ADC_SMP_640_5);	// 400
+	CHECK(((ADC1->SMPR2 >> (3 * (ADC_CHANNEL_VBAT - 10))) & 7u) == ADC_SMP_640_5);	// 960
+
+	// 4 MHz: 16, 20 and 48 cycles
+	SystemCoreClock = 4000000;
+	ADC_ClockChanged();
+	CHECK(((ADC1->SMPR1 >> (3 * 6)) & 7u) == ADC_SMP_2_5);
+	CHECK(((ADC1->SMPR1 >> (3 * ADC_CHANNEL_VREFINT)) & 7u) == ADC_SMP_24_5);
+	CHECK(((ADC1->SMPR2 >> (3 * (ADC_CHANNEL_TEMPSENSOR - 10))) & 7u) == ADC_SMP_24_5);
+	CHECK(((ADC1->SMPR2 >> (3 * (ADC_CHANNEL_VBAT - 10))) & 7u) == ADC_SMP_247_5);	// The table's
+
+	SystemCoreClock = clock_hz;
+	ADC_ClockChanged();
+}
+
+int main(void) {
+	sim_hw_init();	// Register thread only: no hardware thread, no conversions
+
+	test_init();
+	test_start();
+	test_hand_off();
+	test_adc_overrun();
+	test_scan_blocks();
+	test_scan_bad_channel();
+	test_timer_max_rate();
+	test_scan_sampling_times();
+	return test_result();
+}
@@ -0,0 +1,146 @@
+#include "test.h"
+#include "command.h"
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Command interpreter: lines split across the end of the ring, incomplete and
+// overlong lines, argument counts, number parsing, and the handler statuses
+// command_task() reports (a rate above the conversion limit is out of range).
+//------------------------------------------------------------------------------
+
+#define RING_SIZE 32u
+#define RATE_LIMIT_HZ 68201u	// ADC_Timer_GetMaxRate() for the main.c scan table at 80 MHz
+
+static uint8_t ring[RING_SIZE];
+static uint32_t head;
+static uint32_t tail;
+
+static uint32_t rate_hz;
+static uint32_t calls;
+
+static command_status_t command_rate(const command_token_t *args, uint32_t argc) {
+	uint32_t rate;
+
+	calls++;
+	if (argc > 0) {
+		if (!command_token_to_u32(&args[0], &rate)) {
+			return COMMAND_BAD_ARGS;
+		}
+		if (rate == 0 || rate > RATE_LIMIT_HZ) {
+			return COMMAND_OUT_OF_RANGE;
+		}
+		rate_hz = rate;
+	}
+	return COMMAND_OK;
+}
+
+static command_status_t command_mode(const command_token_t *args, uint32_t argc) {
+	static const char * const names[] = { "idle", "monitor", "log" };
+
+	calls++;
+	return command_token_select(&args[0], names, 3) < 0 ? COMMAND_BAD_ARGS : COMMAND_OK;
+}
+
+static const command_entry_t table[] = {
+	{ "rate", command_rate, 0, 1, "[<Hz>]" },
+	{ "mode", command_mode, 1, 1, "idle|monitor|log" },
+};
+
+static const command_interpreter_t interpreter = { table, 2, ring, RING_SIZE };
+
+// Append text to the ring as the receive interrupt would
+static void receive(const char *text) {
+	for (size_t i = 0; text[i] != '\0'; i++) {
+		ring[head++ & (RING_SIZE - 1)] = (uint8_t)text[i];
+	}
+}
+
+// Run one line through the interpreter; returns its status, -1 if none was complete
+static int execute(const char *text) {
+	command_status_t status;
+
+	receive(text);
+	if (!command_next(&interpreter, &tail, head, &status)) {
+		return -1;
+	}
+	return (int)status;
+}
+
+static void reset(uint32_t position) {
+	head = tail = position;
+	rate_hz = 0;
+	calls = 0;
+}
+
+static void test_dispatch(void) {
+	reset(0);
+	CHECK(execute("rate 2000\n") == COMMAND_OK && rate_hz == 2000);
+	CHECK(execute("  mode\tmonitor \r") == COMMAND_OK);
+	CHECK(execute("rate\n") == COMMAND_OK && rate_hz == 2000);
+	CHECK(execute("\n") == COMMAND_EMPTY);
+	CHECK(execute("speed 3\n") == COMMAND_UNKNOWN);
+	CHECK(execute("rat 3\n") == COMMAND_UNKNOWN);
+	CHECK(execute("rates 3\n") == COMMAND_UNKNOWN);
+	CHECK(calls == 3);
+	CHECK(tail == head);
+}
+
+static void test_arguments(void) {
+	reset(0);
+	CHECK(execute("mode\n") == COMMAND_BAD_ARGS);				// Below min_args
+	CHECK(execute("rate 1 2\n") == COMMAND_BAD_ARGS);			// Above max_args
+	CHECK(execute("rate 1 2 3 4\n") == COMMAND_BAD_ARGS);		// More tokens than COMMAND_MAX_ARGS
+	CHECK(calls == 0);
+	CHECK(execute("mode fast\n") == COMMAND_BAD_ARGS);
+	CHECK(execute("rate 12a\n") == COMMAND_BAD_ARGS);
+	CHECK(execute("rate 4294967296\n") == COMMAND_BAD_ARGS);	// Does not fit in 32 bits
+	CHECK(execute("rate 4294967295\n") == COMMAND_OUT_OF_RANGE);
+	CHECK(rate_hz == 0);
+}
+
+static void test_rate_limit(void) {
+	char line[24];
+
+	reset(0);
+	snprintf(line, sizeof(line), "rate %u\n", RATE_LIMIT_HZ);
+	CHECK(execute(line) == COMMAND_OK && rate_hz == RATE_LIMIT_HZ);
+	snprintf(line, sizeof(line), "rate %u\n", RATE_LIMIT_HZ + 1);
+	CHECK(execute(line) == COMMAND_OUT_OF_RANGE && rate_hz == RATE_LIMIT_HZ);
+	CHECK(execute("rate 0\n") == COMMAND_OUT_OF_RANGE);
+}
+
+// Lines are only parsed once complete, and tokens may wrap around the end of the ring
+static void test_partial_and_wrap(void) {
+	reset(RING_SIZE - 6);
+	CHECK(execute("rate 12") == -1);
+	CHECK(tail == RING_SIZE - 6);
+	CHECK(execute("345\r\n") == COMMAND_OK && rate_hz == 12345);
+	CHECK(execute("") == COMMAND_EMPTY);	// The LF after the CR
+	CHECK(tail == head);
+
+	// Free-running positions across the 32-bit wrap
+	reset(UINT32_MAX - 3);
+	CHECK(execute("rate 77\n") == COMMAND_OK && rate_hz == 77);
+	CHECK(tail == head);
+}
+
+// A line that fills the ring without a terminator is dropped, and the next line parses
+static void test_too_long(void) {
+	char line[RING_SIZE + 1];
+
+	reset(5);
+	memset(line, 'x', RING_SIZE);
+	line[RING_SIZE] = '\0';
+	CHECK(execute(line) == COMMAND_TOO_LONG);
+	CHECK(tail == head);
+	CHECK(execute("rate 9\n") == COMMAND_OK && rate_hz == 9);
+}
+
+int main(void) {
+	test_dispatch();
+	test_arguments();
+	test_rate_limit();
+	test_partial_and_wrap();
+	test_too_long();
+	return test_result();
+}
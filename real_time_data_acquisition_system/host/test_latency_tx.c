@@ -0,0 +1,104 @@
+#include "test.h"
+#include "latency.h"
+
+//------------------------------------------------------------------------------
+// Transmit completion tracking of latency.c: lines registered with the TX ring
+// position of their end are closed only once the driver reports that position
+// sent, in order, across the wrap of the free-running positions, and stamped
+// one frame time earlier for each byte sent after them. Lines beyond
+// LATENCY_TX_LINES are counted, not measured.
+//------------------------------------------------------------------------------
+
+#define TICKS_PER_US 1000u				// LATENCY_HOST_CLOCK: nanoseconds
+#define MS (1000u * TICKS_PER_US)
+#define FRAME_TICKS MS					// An exaggerated frame time, well above the test's run time
+#define SLACK_US 5000u					// Run time allowed between registering and closing
+
+static latency_histogram_t tx, e2e;
+
+static void get(void) {
+	latency_get(LATENCY_STAGE_TX, &tx);
+	latency_get(LATENCY_STAGE_END_TO_END, &e2e);
+}
+
+// 'count' values recorded, the last one at least 'us' and at most SLACK_US more
+static int recorded(const latency_histogram_t *hist, uint32_t count, uint32_t us) {
+	return hist->count == count && hist->max_us >= us && hist->max_us <= us + SLACK_US;
+}
+
+// Lines close at their own position, stamped back by the bytes sent after them
+static void test_completion(uint32_t base) {
+	latency_init(TICKS_PER_US);
+	uint32_t now = latency_now();
+
+	latency_tx_queued(base + 100u, now - 200u * MS, now - 100u * MS);
+	latency_tx_queued(base + 120u, now - 400u * MS, now - 300u * MS);
+
+	// Part of the first line sent: nothing closes
+	latency_tx_sent(base + 99u, FRAME_TICKS);
+	get();
+	CHECK(tx.count == 0 && e2e.count == 0);
+
+	// The first line and 10 bytes of the second: the first is stamped 10 frames back
+	latency_tx_sent(base + 110u, FRAME_TICKS);
+	get();
+	CHECK(recorded(&tx, 1, 90000u));
+	CHECK(recorded(&e2e, 1, 190000u));
+
+	// The second line, with nothing after it
+	latency_tx_sent(base + 120u, FRAME_TICKS);
+	get();
+	CHECK(recorded(&tx, 2, 300000u));
+	CHECK(recorded(&e2e, 2, 400000u));
+
+	// Nothing left to close
+	latency_tx_sent(base + 200u, FRAME_TICKS);
+	get();
+	CHECK(tx.count == 2 && e2e.count == 2);
+}
+
+// Several lines closed by one completion
+static void test_batch(void) {
+	latency_init(TICKS_PER_US);
+	uint32_t now = latency_now();
+
+	for (uint32_t i = 1; i <= 4u; i++) {
+		latency_tx_queued(i * 10u, now, now);
+	}
+	latency_tx_sent(35u, 0);
+	get();
+	CHECK(tx.count == 3 && e2e.count == 3);
+	latency_tx_sent(40u, 0);
+	get();
+	CHECK(tx.count == 4 && e2e.count == 4);
+}
+
+// A full table: further lines are counted as untracked, the others still close
+static void test_full(void) {
+	latency_init(TICKS_PER_US);
+	uint32_t now = latency_now();
+	uint32_t untracked = latency_tx_untracked;
+
+	for (uint32_t i = 1; i <= LATENCY_TX_LINES + 2u; i++) {
+		latency_tx_queued(i, now, now);
+	}
+	CHECK(latency_tx_untracked - untracked == 2u);
+	latency_tx_sent(LATENCY_TX_LINES + 2u, 0);
+	get();
+	CHECK(tx.count == LATENCY_TX_LINES && e2e.count == LATENCY_TX_LINES);
+
+	// Room again
+	latency_tx_queued(LATENCY_TX_LINES + 3u, now, now);
+	latency_tx_sent(LATENCY_TX_LINES + 3u, 0);
+	get();
+	CHECK(tx.count == LATENCY_TX_LINES + 1u);
+	CHECK(latency_tx_untracked - untracked == 2u);
+}
+
+int main(void) {
+	test_completion(0);
+	test_completion(0xFFFFFFA0u);	// Ring positions wrapping between and within the lines
+	test_batch();
+	test_full();
+	return test_result();
+}
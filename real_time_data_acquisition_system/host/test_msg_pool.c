@@ -0,0 +1,100 @@
+#include "test.h"
+#include "msg_pool.h"
+
+//------------------------------------------------------------------------------
+// Message pool: allocation until exhaustion, LIFO reuse, usage counters, and the
+// assertions on bad releases, which must also leave the free list intact.
+//------------------------------------------------------------------------------
+
+int host_assert_failures;
+
+static void test_alloc_free(void) {
+	char *blocks[MSG_POOL_BLOCKS];
+	msg_pool_stats_t stats;
+
+	msg_pool_init();
+	for (uint32_t i = 0; i < MSG_POOL_BLOCKS; i++) {
+		blocks[i] = msg_pool_alloc();
+		CHECK(blocks[i] != NULL);
+		for (uint32_t j = 0; j < i; j++) {
+			CHECK(blocks[j] != blocks[i]);
+		}
+	}
+	CHECK(msg_pool_alloc() == NULL);
+
+	msg_pool_get_stats(&stats);
+	CHECK(stats.in_use == MSG_POOL_BLOCKS);
+	CHECK(stats.high_water == MSG_POOL_BLOCKS);
+	CHECK(stats.exhausted == 1);
+
+	msg_pool_free(blocks[3]);
+	CHECK(msg_pool_alloc() == blocks[3]);	// Last freed, first reused
+
+	for (uint32_t i = 0; i < MSG_POOL_BLOCKS; i++) {
+		msg_pool_free(blocks[i]);
+	}
+	msg_pool_get_stats(&stats);
+	CHECK(stats.in_use == 0);
+	CHECK(host_assert_failures == 0);
+}
+
+static void test_bad_free(void) {
+	char outside[MSG_BLOCK_SIZE];
+	msg_pool_stats_t stats;
+
+	msg_pool_init();
+	char *a = msg_pool_alloc();
+	char *b = msg_pool_alloc();
+
+	// Not a pool block, or not the start of one
+	host_assert_failures = 0;
+	msg_pool_free(outside);
+	CHECK(host_assert_failures == 1);
+	msg_pool_free(a + 1);
+	CHECK(host_assert_failures == 2);
+
+	// Released twice
+	msg_pool_free(a);
+	CHECK(host_assert_failures == 2);
+	msg_pool_free(a);
+	CHECK(host_assert_failures == 3);
+
+	// The rejected releases changed nothing: one block in use, the others each handed out once
+	msg_pool_get_stats(&stats);
+	CHECK(stats.in_use == 1);
+
+	char *blocks[MSG_POOL_BLOCKS - 1];
+	for (uint32_t i = 0; i < MSG_POOL_BLOCKS - 1; i++) {
+		blocks[i] = msg_pool_alloc();
+		CHECK(blocks[i] != NULL && blocks[i] != b);
+		for (uint32_t j = 0; j < i; j++) {
+			CHECK(blocks[j] != blocks[i]);
+		}
+	}
+	CHECK(msg_pool_alloc() == NULL);
+}
+
+// Constant strings are never returned to the pool
+static void test_release(void) {
+	uart_msg_t msg = { "Mode: Idle", MSG_OWNER_CONST, 0, 0, 0, 0 };
+	msg_pool_stats_t stats;
+
+	msg_pool_init();
+	host_assert_failures = 0;
+	uart_msg_release(&msg);
+	CHECK(host_assert_failures == 0);
+
+	msg.text = msg_pool_alloc();
+	msg.owner = MSG_OWNER_POOL;
+	uart_msg_release(&msg);
+	msg_pool_get_stats(&stats);
+	CHECK(stats.in_use == 0);
+	CHECK(host_assert_failures == 0);
+}
+
+int main(void) {
+	test_alloc_free();
+	test_bad_free();
+	test_release();
+	return test_result();
+}
@@ -0,0 +1,176 @@
+#include "test.h"
+#include "sensor_filter.h"
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+// Output of the median + CIC stage, fed in blocks of varying size the way the
+// processing task feeds it one frame at a time: one output per 'decimation'
+// inputs however the blocks fall, a step settling exactly on the input value
+// once the decimation^order gain is removed (full scale at the largest gain
+// included), and spikes removed by the median window wherever a block boundary
+// falls relative to them. Splitting the input into blocks must never change the
+// output.
+//------------------------------------------------------------------------------
+
+#define STREAM_SAMPLES 4096u
+#define MAX_OUTPUTS (STREAM_SAMPLES + 1u)
+
+static uint16_t input[STREAM_SAMPLES];
+static uint16_t whole[MAX_OUTPUTS];		// Output of the stream in one call
+static uint16_t blocked[MAX_OUTPUTS];	// Output of the same stream in blocks
+
+// The stream in blocks of 1 to 'max_block' samples; checks the outputs of every block
+// and returns the total
+static uint32_t process_in_blocks(sensor_filter_t *filter, const uint16_t *in, uint32_t count,
+                                  uint32_t max_block, uint16_t *out) {
+	uint32_t outputs = 0;
+	uint32_t consumed = 0;
+
+	while (consumed < count) {
+		uint32_t block = 1u + (uint32_t)rand() % max_block;
+		if (block > count - consumed) {
+			block = count - consumed;
+		}
+		uint32_t expected = (filter->phase + block) / filter->decimation;
+		uint32_t n = sensor_filter_process(filter, &in[consumed], block, &out[outputs]);
+		CHECK(n == expected);
+		CHECK(n <= block / filter->decimation + 1u);
+		outputs += n;
+		consumed += block;
+	}
+	return outputs;
+}
+
+// One output per 'decimation' inputs over the whole stream, in any blocking, and the same
+// outputs as in a single call
+static void test_decimation(void) {
+	static const uint8_t configs[][3] = {
+		// median window, order, decimation
+		{ 0, 1, 1 }, { 0, 1, 8 }, { 0, 2, 8 }, { 3, 2, 8 }, { 5, 3, 7 }, { 3, 3, 64 },
+	};
+
+	for (uint32_t i = 0; i < STREAM_SAMPLES; i++) {
+		input[i] = (uint16_t)(rand() & 0xFFFu);
+	}
+	for (uint32_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+		sensor_filter_t filter;
+		uint32_t decimation = configs[c][2];
+
+		sensor_filter_init(&filter, configs[c][1], decimation, configs[c][0]);
+		uint32_t n_whole = sensor_filter_process(&filter, input, STREAM_SAMPLES, whole);
+		CHECK(n_whole == STREAM_SAMPLES / decimation);
+
+		for (uint32_t max_block = 1; max_block <= 33u; max_block += 8u) {
+			sensor_filter_init(&filter, configs[c][1], decimation, configs[c][0]);
+			uint32_t n_blocked = process_in_blocks(&filter, input, STREAM_SAMPLES, max_block, blocked);
+			CHECK(n_blocked == n_whole);
+			for (uint32_t i = 0; i < n_whole && i < n_blocked; i++) {
+				if (blocked[i] != whole[i]) {
+					CHECK(blocked[i] == whole[i]);
+					break;
+				}
+			}
+		}
+	}
+}
+
+// A step settles on the new input value 'order' outputs after the output period it falls
+// into, and moves monotonically in between (every CIC coefficient is positive)
+static void test_step(uint32_t order, uint32_t decimation, uint16_t from, uint16_t to) {
+	const uint32_t step_at = 40u * decimation + decimation / 3u;	// Not on an output boundary
+	const uint32_t count = 60u * decimation;
+	sensor_filter_t filter;
+
+	for (uint32_t i = 0; i < count; i++) {
+		input[i] = i < step_at ? from : to;
+	}
+	sensor_filter_init(&filter, order, decimation, 0);
+	uint32_t n = process_in_blocks(&filter, input, count, 10u, whole);	// 10: one channel of a 3-channel scan block
+	CHECK(n == 60u);
+
+	uint32_t step_output = step_at / decimation;	// First output with the new value in its period
+	for (uint32_t k = 0; k < n; k++) {
+		if (k >= order && k < step_output) {
+			CHECK(whole[k] == from);	// Settled on the old value, once the filter has filled
+		} else if (k >= step_output + order) {
+			CHECK(whole[k] == to);
+		} else if (k > step_output) {
+			CHECK(from < to ? whole[k] >= whole[k - 1u] : whole[k] <= whole[k - 1u]);
+		}
+	}
+}
+
+// Spikes shorter than half the median window vanish, at any position relative to the block
+// boundaries; with the median on, the output stays exactly on the signal level
+static void test_spike_rejection(uint32_t median_window) {
+	const uint16_t level = 2000u;
+	const uint32_t block = 10u;
+	const uint32_t spike_length = median_window / 2u;
+
+	for (uint32_t offset = 0; offset < block; offset++) {
+		sensor_filter_t filter;
+		uint32_t count = 0;
+
+		// Fill the median window first: samples pass unchanged until it is full
+		for (uint32_t i = 0; i < 16u; i++) {
+			input[count++] = level;
+		}
+		// Spikes of both polarities starting at each offset in a block, the longest ones
+		// straddling the boundary between two blocks
+		for (uint32_t repeat = 0; repeat < 8u; repeat++) {
+			while ((count % block) != offset) {
+				input[count++] = level;
+			}
+			for (uint32_t s = 0; s < spike_length; s++) {
+				input[count++] = (repeat & 1u) ? 4095u : 0u;
+			}
+			for (uint32_t i = 0; i < median_window + block; i++) {
+				input[count++] = level;
+			}
+		}
+
+		sensor_filter_init(&filter, 2, 8, median_window);
+		uint32_t n = 0;
+		for (uint32_t i = 0; i < count; i += block) {
+			uint32_t length = (count - i < block) ? count - i : block;
+			n += sensor_filter_process(&filter, &input[i], length, &whole[n]);
+		}
+		CHECK(n == count / 8u);
+		for (uint32_t k = 2; k < n; k++) {	// After the order-2 start-up from zero
+			if (whole[k] != level) {
+				CHECK(whole[k] == level);
+				break;
+			}
+		}
+	}
+
+	// Without the median the same spike does reach the output
+	sensor_filter_t filter;
+	for (uint32_t i = 0; i < 64u; i++) {
+		input[i] = (i == 30u) ? 4095u : level;
+	}
+	sensor_filter_init(&filter, 2, 8, 0);
+	uint32_t n = sensor_filter_process(&filter, input, 64u, whole);
+	uint32_t disturbed = 0;
+	for (uint32_t k = 0; k < n; k++) {
+		disturbed += whole[k] != level;
+	}
+	CHECK(n == 8u && disturbed > 0);
+}
+
+int main(void) {
+	srand(1);
+	test_decimation();
+
+	// The configuration of main.c, the boxcar, and the largest gain at full scale
+	test_step(2, 8, 1000, 3000);
+	test_step(2, 8, 3000, 1000);
+	test_step(1, 8, 0, 4095);
+	test_step(3, 64, 0, 4095);
+	test_step(3, 64, 4095, 0);
+	test_step(3, 5, 123, 3210);
+
+	test_spike_rejection(3);
+	test_spike_rejection(5);
+	return test_result();
+}
@@ -0,0 +1,134 @@
+#include "test.h"
+#include "telemetry_decoder.h"
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Telemetry decoder: packets split across reads, corrupted frames, and the
+// sequence checks (gap, wrap-around, duplicate, restart of the sender).
+//------------------------------------------------------------------------------
+
+static uint16_t delivered[16];
+static uint32_t delivered_count;
+
+static void on_packet(const telemetry_packet_t *packet, void *context) {
+	if (delivered_count < 16) {
+		delivered[delivered_count] = packet->sequence;
+	}
+	delivered_count++;
+}
+
+// Encode a packet and feed it in two pieces, as a serial read might return it
+static void feed_packet(telemetry_decoder_t *decoder, uint16_t sequence) {
+	telemetry_packet_t packet = { sequence, 1000u + sequence, 1, { { 17, 2048, 2500 } } };
+	uint8_t frame[TELEMETRY_MAX_FRAME];
+	size_t length = telemetry_encode(&packet, frame);
+
+	telemetry_decoder_feed(decoder, frame, length / 2, on_packet, NULL);
+	telemetry_decoder_feed(decoder, frame + length / 2, length - length / 2, on_packet, NULL);
+}
+
+static void start(telemetry_decoder_t *decoder) {
+	telemetry_decoder_init(decoder);
+	delivered_count = 0;
+}
+
+static void test_round_trip(void) {
+	telemetry_packet_t packet = { 7, 123456, 2, { { 6, 1234, -321 }, { 17, 4095, 32767 } } };
+	telemetry_packet_t parsed;
+	uint8_t frame[TELEMETRY_MAX_FRAME];
+	uint8_t decoded[TELEMETRY_MAX_FRAME];
+	size_t length = telemetry_encode(&packet, frame);
+
+	CHECK(length <= TELEMETRY_MAX_FRAME && frame[length - 1] == 0x00);
+	CHECK(memchr(frame, 0x00, length - 1) == NULL);
+	size_t decoded_length = cobs_decode(frame, length - 1, decoded);
+	CHECK(telemetry_parse(decoded, decoded_length, &parsed));
+	CHECK(parsed.sequence == 7 && parsed.timestamp == 123456 && parsed.count == 2);
+	CHECK(parsed.entries[0].channel == 6 && parsed.entries[0].raw == 1234 && parsed.entries[0].value == -321);
+	CHECK(parsed.entries[1].channel == 17 && parsed.entries[1].raw == 4095 && parsed.entries[1].value == 32767);
+}
+
+static void test_gap(void) {
+	telemetry_decoder_t decoder;
+
+	start(&decoder);
+	feed_packet(&decoder, 10);
+	feed_packet(&decoder, 11);
+	feed_packet(&decoder, 14);	// 12 and 13 missing
+	CHECK(decoder.packets == 3 && decoder.lost == 2);
+
+	// Wrap-around of the 16-bit counter is not a gap
+	start(&decoder);
+	feed_packet(&decoder, 0xFFFE);
+	feed_packet(&decoder, 0xFFFF);
+	feed_packet(&decoder, 0);
+	feed_packet(&decoder, 2);
+	CHECK(decoder.packets == 4 && decoder.lost == 1 && decoder.resyncs == 0);
+}
+
+static void test_duplicate(void) {
+	telemetry_decoder_t decoder;
+
+	start(&decoder);
+	feed_packet(&decoder, 20);
+	feed_packet(&decoder, 20);
+	feed_packet(&decoder, 21);
+	CHECK(decoder.packets == 2 && decoder.duplicates == 1);
+	CHECK(decoder.lost == 0 && decoder.resyncs == 0);
+	CHECK(delivered_count == 2 && delivered[0] == 20 && delivered[1] == 21);
+}
+
+static void test_restart(void) {
+	telemetry_decoder_t decoder;
+
+	// Backward jump: the sender restarted from 0
+	start(&decoder);
+	feed_packet(&decoder, 500);
+	feed_packet(&decoder, 0);
+	feed_packet(&decoder, 1);
+	CHECK(decoder.packets == 3 && decoder.lost == 0 && decoder.resyncs == 1);
+
+	// Forward jump beyond TELEMETRY_DECODER_MAX_GAP: also a restart, not 40000 lost packets
+	start(&decoder);
+	feed_packet(&decoder, 40000);
+	feed_packet(&decoder, 0);
+	CHECK(decoder.lost == 0 && decoder.resyncs == 1);
+
+	// Largest gap still counted as loss
+	start(&decoder);
+	feed_packet(&decoder, 100);
+	feed_packet(&decoder, 100 + TELEMETRY_DECODER_MAX_GAP + 1);
+	CHECK(decoder.lost == TELEMETRY_DECODER_MAX_GAP && decoder.resyncs == 0);
+}
+
+static void test_corrupted(void) {
+	telemetry_packet_t packet = { 30, 0, 1, { { 6, 100, 200 } } };
+	telemetry_decoder_t decoder;
+	uint8_t frame[TELEMETRY_MAX_FRAME];
+	uint8_t noise[TELEMETRY_MAX_FRAME + 8];
+
+	start(&decoder);
+	size_t length = telemetry_encode(&packet, frame);
+	frame[2] ^= 0x40;	// Flipped bit: the CRC no longer matches
+	telemetry_decoder_feed(&decoder, frame, length, on_packet, NULL);
+	CHECK(decoder.corrupted == 1 && decoder.packets == 0);
+
+	// A frame longer than any packet is skipped up to its delimiter
+	memset(noise, 0x55, sizeof(noise));
+	telemetry_decoder_feed(&decoder, noise, sizeof(noise), on_packet, NULL);
+	noise[0] = 0x00;
+	telemetry_decoder_feed(&decoder, noise, 1, on_packet, NULL);
+	CHECK(decoder.corrupted == 2);
+
+	feed_packet(&decoder, 31);
+	CHECK(decoder.packets == 1 && delivered_count == 1 && delivered[0] == 31);
+}
+
+int main(void) {
+	test_round_trip();
+	test_gap();
+	test_duplicate();
+	test_restart();
+	test_corrupted();
+	return test_result();
+}
@@ -0,0 +1,39 @@
+#include "test.h"
+#include "temp_convert.h"
+#include <math.h>
+
+//------------------------------------------------------------------------------
+// Every one of the 4096 table entries against the sensor formula, computed here
+// in double precision and rounded to nearest (halves up), and against the float
+// path, which truncates and so may differ by one hundredth of a degree.
+//------------------------------------------------------------------------------
+
+static int32_t reference_centi_c(uint32_t code) {
+	double uv = (double)code * TEMP_SENSOR_UV_PER_CODE - TEMP_SENSOR_OFFSET_UV;
+	return (int32_t)floor(uv * 100.0 / TEMP_SENSOR_UV_PER_DEGREE + 0.5);	// Halves round up, as in the table
+}
+
+int main(void) {
+	int32_t previous = temp_code_to_centi_c(0);
+
+	for (uint32_t code = 0; code < TEMP_LUT_SIZE; code++) {
+		int32_t centi_c = temp_code_to_centi_c(code);
+		int32_t error = centi_c - temp_code_to_centi_c_float(code);
+
+		CHECK(centi_c == reference_centi_c(code));
+		CHECK(error >= -1 && error <= 1);
+		if (code > 0) {
+			CHECK(centi_c >= previous);	// Monotonic: one code is 8.1 hundredths of a degree
+		}
+		previous = centi_c;
+	}
+
+	// End points: 0.5 V below zero, and the top code at 3.31695 V
+	CHECK(temp_code_to_centi_c(0) == -5000);
+	CHECK(temp_code_to_centi_c(TEMP_LUT_SIZE - 1) == 28170);
+
+	// Codes outside 12 bits wrap instead of reading past the table
+	CHECK(temp_code_to_centi_c(TEMP_LUT_SIZE) == temp_code_to_centi_c(0));
+	CHECK(temp_code_to_centi_c(0xFFFFFFFFu) == temp_code_to_centi_c(TEMP_LUT_SIZE - 1));
+	return test_result();
+}
@@ -0,0 +1,196 @@
+#include "test.h"
+#include "trace_decoder.h"
+#include <trcRecorder.h>
+#include <stdlib.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Round trip of the compact trace encoding: events are created with trcEvent.c
+// built with TRC_CFG_EVENT_COMPACT_ENCODING, the stream it writes is decoded
+// with trace_decoder.c in chunks of varying size, and the result must equal the
+// standard PSF the recorder builds each event in, which is what it commits
+// without the encoding. Covers every parameter count, time stamp deltas of all
+// LEB128 lengths, dropped events, a raw block (prelude) in the middle of the
+// events, and EventCount jumps the decoder has to resynchronise on.
+//------------------------------------------------------------------------------
+
+#define STREAM_SIZE 262144u
+#define PRELUDE_SIZE (TRACE_PSF_HEADER_SIZE + TRACE_PSF_TIMESTAMP_SIZE + TRACE_PSF_ENTRIES_SIZE + ENTRIES_DATA_SIZE)
+#define ENTRIES_DATA_SIZE (2u * (4u + 4u * 3u + 4u + 8u))	// Two entries, three states, 8-byte symbols
+#define PSF_OPTION_COMPACT (1u << 4)
+
+typedef struct {
+	uint8_t data[STREAM_SIZE];
+	uint32_t length;
+} stream_t;
+
+volatile int trc_host_critical_nesting;
+
+static stream_t plain;		// Standard PSF, as the recorder builds the events
+static stream_t compact;	// What the stream port receives
+static stream_t decoded;
+
+static TraceEventDataTable_t event_data;
+static TraceUnsignedBaseType_t event_buffer[256 / sizeof(TraceUnsignedBaseType_t)];
+static uint32_t now;
+static int refuse_allocation;
+
+traceResult xTraceTimestampGet(uint32_t *puiTimestamp) {
+	*puiTimestamp = now;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceTimestampGetWraparounds(uint32_t *puiTimerWraparounds) {
+	*puiTimerWraparounds = 0u;
+	return TRC_SUCCESS;
+}
+
+// One static buffer, as xTraceStaticBufferGet() outside of ISRs
+traceResult xTraceStreamPortAllocate(uint32_t uiSize, void **ppvData) {
+	if (refuse_allocation || uiSize > sizeof(event_buffer)) {
+		return TRC_FAIL;
+	}
+	*ppvData = event_buffer;
+	return TRC_SUCCESS;
+}
+
+static void append(stream_t *stream, const void *data, uint32_t length) {
+	CHECK(stream->length + length <= STREAM_SIZE);
+	if (stream->length + length <= STREAM_SIZE) {
+		memcpy(&stream->data[stream->length], data, length);
+		stream->length += length;
+	}
+}
+
+traceResult xTraceStreamPortWriteData(void *pvData, uint32_t uiSize, int32_t *piBytesWritten) {
+	append(&compact, pvData, uiSize);
+	*piBytesWritten = (int32_t)uiSize;
+	return TRC_SUCCESS;
+}
+
+static void decoded_output(const uint8_t *data, size_t length, void *context) {
+	append(&decoded, data, (uint32_t)length);
+}
+
+// PSF header, time stamp info and an entry table with two entries, as on trace start
+static void make_prelude(uint8_t *prelude, uint32_t options) {
+	static const uint8_t identifier[4] = { 0x00, 0x46, 0x53, 0x50 };
+	uint32_t entries[3] = { 2u, 8u, 3u };	// Count, symbol size, state count
+
+	for (uint32_t i = 0; i < PRELUDE_SIZE; i++) {
+		prelude[i] = (uint8_t)(i * 37u + 11u);
+	}
+	memcpy(prelude, identifier, sizeof(identifier));
+	memcpy(&prelude[8], &options, sizeof(options));
+	memcpy(&prelude[TRACE_PSF_HEADER_SIZE + TRACE_PSF_TIMESTAMP_SIZE], entries, sizeof(entries));
+}
+
+// The time stamp moves on by a delta of 1 to 5 LEB128 bytes, or not at all
+static void advance_time(void) {
+	static const uint32_t ranges[] = { 1u, 0x80u, 0x4000u, 0x200000u, 0x10000000u, 0xFFFFFFFFu };
+	uint32_t r = (uint32_t)rand();
+
+	now += r % ranges[r % (sizeof(ranges) / sizeof(ranges[0]))];
+}
+
+// Create an event with 'count' parameters; the recorder built it in event_buffer
+static void event(uint32_t code, uint32_t count) {
+	TraceUnsignedBaseType_t p[6];
+	traceResult result = TRC_FAIL;
+
+	for (uint32_t i = 0; i < 6; i++) {
+		p[i] = (TraceUnsignedBaseType_t)rand() * 2654435761u;
+	}
+	advance_time();
+	switch (count) {
+	case 0: result = xTraceEventCreate0(code); break;
+	case 1: result = xTraceEventCreate1(code, p[0]); break;
+	case 2: result = xTraceEventCreate2(code, p[0], p[1]); break;
+	case 3: result = xTraceEventCreate3(code, p[0], p[1], p[2]); break;
+	case 4: result = xTraceEventCreate4(code, p[0], p[1], p[2], p[3]); break;
+	case 5: result = xTraceEventCreate5(code, p[0], p[1], p[2], p[3], p[4]); break;
+	default: result = xTraceEventCreate6(code, p[0], p[1], p[2], p[3], p[4], p[5]); break;
+	}
+	if (result == TRC_SUCCESS) {
+		append(&plain, event_buffer, (uint32_t)(sizeof(TraceEvent0_t) + count * sizeof(TraceUnsignedBaseType_t)));
+	}
+}
+
+// 'events' events of random parameter count, every 'drop_every'-th one dropped
+// by a full stream port; returns the number dropped
+static uint32_t events(uint32_t events, uint32_t drop_every) {
+	uint32_t dropped = 0;
+
+	for (uint32_t i = 0; i < events; i++) {
+		refuse_allocation = drop_every != 0u && (i % drop_every) == drop_every - 1u;
+		dropped += (uint32_t)refuse_allocation;
+		event(0x30u + (uint32_t)rand() % 0x200u, (uint32_t)rand() % 7u);
+	}
+	refuse_allocation = 0;
+	return dropped;
+}
+
+static void test_round_trip(void) {
+	uint8_t prelude[PRELUDE_SIZE];
+	trace_decoder_t decoder;
+	uint32_t lost = 0;
+
+	srand(7);
+	memset(&compact, 0, sizeof(compact));
+	memset(&plain, 0, sizeof(plain));
+	memset(&decoded, 0, sizeof(decoded));
+	xTraceEventInitialize(&event_data);
+
+	// Trace start: the prelude goes out before the first event
+	make_prelude(prelude, PSF_OPTION_COMPACT);
+	append(&compact, prelude, PRELUDE_SIZE);
+	make_prelude(prelude, 0);
+	append(&plain, prelude, PRELUDE_SIZE);
+
+	lost += events(3000, 97);
+
+	// A raw block (a restarted trace) between events, then sync events again
+	make_prelude(prelude, PSF_OPTION_COMPACT);
+	CHECK(xTraceEventCreateRawBlocking(prelude, PRELUDE_SIZE) == TRC_SUCCESS);
+	make_prelude(prelude, 0);
+	append(&plain, prelude, PRELUDE_SIZE);
+	lost += events(1000, 0);
+
+	// A forward jump is lost events; a backward or implausibly long one a count restart
+	event_data.coreEventData[0].eventCounter += 1000u;
+	lost += 1000u;
+	lost += events(500, 0);
+	event_data.coreEventData[0].eventCounter -= 50u;
+	lost += events(500, 0);
+	event_data.coreEventData[0].eventCounter += 40000u;
+	lost += events(500, 0);
+
+	xTraceEventCompactFlush();
+	CHECK(trc_host_critical_nesting == 0);
+
+	// Captured bytes arrive in chunks of 1 to 23
+	trace_decoder_init(&decoder);
+	for (uint32_t i = 0; i < compact.length; ) {
+		uint32_t chunk = 1u + (uint32_t)rand() % 23u;
+		if (chunk > compact.length - i) {
+			chunk = compact.length - i;
+		}
+		trace_decoder_feed(&decoder, &compact.data[i], chunk, decoded_output, NULL);
+		i += chunk;
+	}
+
+	printf("%u PSF bytes, %u compact bytes (%.0f %%), %u events, %u sync events\n",
+	       plain.length, compact.length, 100.0 * compact.length / plain.length, decoder.events, decoder.syncs);
+	CHECK(decoded.length == plain.length);
+	CHECK(memcmp(decoded.data, plain.data, plain.length) == 0);
+	CHECK(compact.length < plain.length);
+	CHECK(decoder.corrupted == 0);
+	CHECK(decoder.lost == lost);
+	CHECK(decoder.resyncs == 2);
+	CHECK(decoder.syncs >= decoder.events / (TRC_CFG_EVENT_COMPACT_SYNC_INTERVAL + 1u));
+}
+
+int main(void) {
+	test_round_trip();
+	return test_result();
+}
@@ -0,0 +1,291 @@
+#include "test.h"
+#include <trcRecorder.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Lock-free event buffer of the trace recorder (TRC_CFG_EVENT_BUFFER_LOCK_FREE,
+// trcEventBuffer.c): the padding record left when an event wraps around the end
+// of the buffer, a transfer stopping at an event still being written, and then
+// writer threads reserving and committing concurrently while another thread
+// drains the buffer. Every event must arrive whole, once, in counter and time
+// stamp order, with the counter gaps matching the dropped events.
+//   test_trace_event_buffer [events per writer]
+//------------------------------------------------------------------------------
+
+#define WRITERS 4
+#define STRESS_BUFFER_SIZE 1024u
+#define EVENT_SIZE(params) (sizeof(TraceEvent0_t) + (params) * sizeof(uint32_t))
+
+volatile int trc_host_critical_nesting;
+static uint32_t timestamp;
+
+traceResult xTraceTimestampGet(uint32_t *puiTimestamp) {
+	*puiTimestamp = __atomic_add_fetch(&timestamp, 1u, __ATOMIC_SEQ_CST);
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceTimestampGetWraparounds(uint32_t *puiTimerWraparounds) {
+	*puiTimerWraparounds = 0u;
+	return TRC_SUCCESS;
+}
+
+// Only the locked buffer (xTraceEventBufferPush) sizes events by their header
+traceResult xTraceEventGetSize(const void *pvAddress, uint32_t *puiSize) {
+	*puiSize = 0u;
+	return TRC_FAIL;
+}
+
+//------------------------------------------------------------------------------
+// Stream port: checks every event handed over by the transfer
+//------------------------------------------------------------------------------
+
+typedef struct {
+	uint32_t events;
+	uint32_t gaps;				// Missing event counts
+	uint32_t torn;				// Parameters not matching the header
+	uint32_t out_of_order;		// Per-writer sequence or time stamp not increasing
+	uint32_t refused;			// Writes refused to exercise the retry
+	uint16_t last_count;
+	uint32_t last_timestamp;
+	uint32_t next_sequence[WRITERS];
+	uint32_t refuse_every;		// Refuse every n-th write, 0 = never
+} stream_check_t;
+
+static stream_check_t check;
+
+static uint32_t parameter(uint32_t writer, uint32_t sequence, uint32_t index) {
+	return (writer << 28) ^ (sequence * 2654435761u) ^ (index * 0x9E3779B9u);
+}
+
+traceResult xTraceStreamPortWriteData(void *pvData, uint32_t uiSize, int32_t *piBytesWritten) {
+	const TraceEvent0_t *event = pvData;
+	const uint32_t *params = (const uint32_t *)(event + 1);
+	uint32_t writer = event->EventID & 0xFu;
+	uint32_t count = (event->EventID >> 4) & 0xFu;
+
+	if (check.refuse_every != 0u && (check.events + check.refused) % check.refuse_every == check.refuse_every - 1u) {
+		check.refused++;
+		*piBytesWritten = 0;
+		return TRC_SUCCESS;
+	}
+
+	if (writer >= WRITERS || uiSize != EVENT_SIZE(count)) {
+		check.torn++;
+	} else {
+		uint32_t sequence = params[0];
+		for (uint32_t i = 1; i < count; i++) {
+			if (params[i] != parameter(writer, sequence, i)) {
+				check.torn++;
+				break;
+			}
+		}
+		if (sequence != check.next_sequence[writer]) {
+			check.out_of_order++;
+		}
+		check.next_sequence[writer] = sequence + 1u;
+	}
+
+	if (check.events != 0u) {
+		check.gaps += (uint16_t)(event->EventCount - check.last_count - 1u);
+		if (event->TS <= check.last_timestamp) {
+			check.out_of_order++;
+		}
+	}
+	check.last_count = event->EventCount;
+	check.last_timestamp = event->TS;
+	check.events++;
+
+	*piBytesWritten = (int32_t)uiSize;
+	return TRC_SUCCESS;
+}
+
+static int buffer_is_clear(const uint8_t *buffer, uint32_t size) {
+	for (uint32_t i = 0; i < size; i++) {
+		if (buffer[i] != 0u) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// Reserve an event with 'count' parameters (the first always a sequence number)
+static TraceEvent0_t *reserve(TraceEventBuffer_t *buffer, uint32_t writer, uint32_t count, uint32_t sequence) {
+	TraceEvent0_t *event;
+
+	if (xTraceEventBufferAlloc(buffer, EVENT_SIZE(count), (void **)&event) == TRC_FAIL) {
+		return NULL;
+	}
+	uint32_t *params = (uint32_t *)(event + 1);
+	event->EventID = (uint16_t)((count << 4) | writer);
+	if (count > 0u) {
+		params[0] = sequence;
+	}
+	for (uint32_t i = 1; i < count; i++) {
+		params[i] = parameter(writer, sequence, i);
+	}
+	return event;
+}
+
+static void commit(TraceEventBuffer_t *buffer, TraceEvent0_t *event, uint32_t count) {
+	int32_t written = 0;
+
+	xTraceEventBufferAllocCommit(buffer, event, EVENT_SIZE(count), &written);
+}
+
+//------------------------------------------------------------------------------
+// Wrap-around: an event that does not fit before the end leaves a padding record
+//------------------------------------------------------------------------------
+
+static void test_wrap_padding(void) {
+	static uint8_t storage[64] __attribute__((aligned(4)));
+	const uint32_t padding_word = 0x80000000u | 0x40000000u | 16u;	// COMMITTED | PADDING | size
+	TraceEventBuffer_t buffer;
+	int32_t written;
+	uint32_t word;
+
+	memset(&check, 0, sizeof(check));
+	memset(storage, 0x5A, sizeof(storage));
+	xTraceEventBufferInitialize(&buffer, TRC_EVENT_BUFFER_OPTION_SKIP, storage, sizeof(storage));
+	CHECK(buffer_is_clear(storage, sizeof(storage)));
+
+	// Two records of 4 + 20 bytes at 0 and 24; the third would need the 16 bytes at the end
+	// as padding and 24 at the start, which the first record still holds
+	TraceEvent0_t *a = reserve(&buffer, 0, 3, 0);
+	TraceEvent0_t *b = reserve(&buffer, 0, 3, 1);
+	CHECK(a == (TraceEvent0_t *)&storage[4] && b == (TraceEvent0_t *)&storage[28]);
+	commit(&buffer, a, 3);
+	commit(&buffer, b, 3);
+	CHECK(reserve(&buffer, 0, 3, 2) == NULL);
+	CHECK(buffer.uiDroppedEvents == 1);
+
+	// Transfers stop at the chunk size, whole events only
+	xTraceEventBufferTransferChunk(&buffer, EVENT_SIZE(3), &written);
+	CHECK(written == (int32_t)EVENT_SIZE(3) && check.events == 1);
+	CHECK(reserve(&buffer, 0, 3, 2) == NULL);	// Still no room for padding + event
+	xTraceEventBufferTransferChunk(&buffer, EVENT_SIZE(3), &written);
+	CHECK(check.events == 2);
+
+	// Now it wraps: committed padding at 48, the event at the start
+	TraceEvent0_t *c = reserve(&buffer, 0, 3, 2);
+	CHECK(c == (TraceEvent0_t *)&storage[4]);
+	memcpy(&word, &storage[48], sizeof(word));
+	CHECK(word == padding_word);
+
+	// The padding is consumed, the event still being written is not
+	xTraceEventBufferTransferAll(&buffer, &written);
+	CHECK(written == 0 && check.events == 2);
+	CHECK(buffer.uiTail == 0);
+	commit(&buffer, c, 3);
+	xTraceEventBufferTransferAll(&buffer, &written);
+	CHECK(written == (int32_t)EVENT_SIZE(3) && check.events == 3);
+
+	// In order, untorn, and the two failed reservations are the counter gap
+	CHECK(check.torn == 0 && check.out_of_order == 0);
+	CHECK(buffer.uiDroppedEvents == 2 && check.gaps == 2);
+	CHECK(c->EventCount == 0 && check.last_count == 5);		// Zeroed after the transfer
+	CHECK(buffer_is_clear(storage, sizeof(storage)));
+}
+
+//------------------------------------------------------------------------------
+// Concurrent writers and one reader
+//------------------------------------------------------------------------------
+
+typedef struct {
+	TraceEventBuffer_t *buffer;
+	uint32_t writer;
+	uint32_t events;
+	uint32_t written;
+	uint32_t dropped;
+} writer_t;
+
+static volatile int writers_running;
+
+static uint32_t next_random(uint32_t *state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static void *writer_thread(void *argument) {
+	writer_t *w = argument;
+	uint32_t random = 0x12345u + w->writer * 7919u;
+
+	for (uint32_t i = 0; i < w->events; i++) {
+		uint32_t count = 1u + next_random(&random) % 6u;
+		TraceEvent0_t *event = reserve(w->buffer, w->writer, count, w->written);
+		if (event == NULL) {
+			w->dropped++;
+			sched_yield();
+			continue;
+		}
+		if ((next_random(&random) & 63u) == 0u) {
+			sched_yield();	// Pre-empted between reservation and commit
+		}
+		commit(w->buffer, event, count);
+		w->written++;
+	}
+	__atomic_sub_fetch(&writers_running, 1, __ATOMIC_SEQ_CST);
+	return NULL;
+}
+
+static void test_concurrent(uint32_t events_per_writer) {
+	static uint8_t storage[STRESS_BUFFER_SIZE] __attribute__((aligned(4)));
+	TraceEventBuffer_t buffer;
+	pthread_t threads[WRITERS];
+	writer_t writers[WRITERS];
+	uint32_t random = 99u;
+	uint32_t written = 0;
+	uint32_t dropped = 0;
+	int32_t bytes;
+
+	memset(&check, 0, sizeof(check));
+	check.refuse_every = 97u;
+	xTraceEventBufferInitialize(&buffer, TRC_EVENT_BUFFER_OPTION_SKIP, storage, sizeof(storage));
+
+	writers_running = WRITERS;
+	for (uint32_t i = 0; i < WRITERS; i++) {
+		writers[i] = (writer_t){ &buffer, i, events_per_writer, 0, 0 };
+		pthread_create(&threads[i], NULL, writer_thread, &writers[i]);
+	}
+
+	// Drain in chunks of varying size while the writers run, then what is left
+	while (__atomic_load_n(&writers_running, __ATOMIC_SEQ_CST) != 0) {
+		xTraceEventBufferTransferChunk(&buffer, 8u + next_random(&random) % 256u, &bytes);
+		if (bytes == 0) {
+			sched_yield();
+		}
+	}
+	for (uint32_t i = 0; i < WRITERS; i++) {
+		pthread_join(threads[i], NULL);
+		written += writers[i].written;
+		dropped += writers[i].dropped;
+	}
+	check.refuse_every = 0;
+	do {
+		xTraceEventBufferTransferAll(&buffer, &bytes);
+	} while (bytes != 0);
+
+	printf("%u events written, %u dropped, %u delivered, %u writes refused by the stream port\n",
+	       written, dropped, check.events, check.refused);
+	CHECK(check.events == written);
+	CHECK(check.torn == 0);
+	CHECK(check.out_of_order == 0);
+	CHECK(buffer.uiDroppedEvents == dropped);
+	CHECK(check.gaps == dropped);
+	CHECK(check.refused > 0);
+	for (uint32_t i = 0; i < WRITERS; i++) {
+		CHECK(check.next_sequence[i] == writers[i].written);
+	}
+	CHECK(buffer_is_clear(storage, sizeof(storage)));
+}
+
+int main(int argc, char **argv) {
+	uint32_t events_per_writer = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 20000u;
+
+	test_wrap_padding();
+	test_concurrent(events_per_writer);
+	return test_result();
+}
@@ -0,0 +1,219 @@
+#include "test.h"
+#include <trcRecorder.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Event filter of trcEvent.c (TRC_CFG_EVENT_FILTER): events of classes outside
+// the class mask are dropped, recorder events never are. Events referring to
+// an object excluded with TRC_ENTRY_OPTION_EXCLUDED are dropped by the
+// prvTraceStoreEvent_Handle* paths and recorded again once it is included,
+// other objects are not affected. CMD_SET_FILTER, as dispatched by
+// xTraceEventSetFilter(), sets the same mask and exclusions.
+//------------------------------------------------------------------------------
+
+// Event codes of the test
+#define CODE_RECORDER    0x01u
+#define CODE_TASK_SWITCH 0x35u
+#define CODE_QUEUE       0x50u
+#define CODE_USER        0x90u
+
+// Object addresses as on the target: 32 bits, aligned
+#define TASK_A  ((void *)(uintptr_t)0x20000100u)
+#define TASK_B  ((void *)(uintptr_t)0x20000200u)
+#define QUEUE_A ((void *)(uintptr_t)0x20000300u)
+#define UNKNOWN ((void *)(uintptr_t)0x20000400u)
+
+volatile int trc_host_critical_nesting;
+
+static TraceEntryIndexTable_t index_table;
+static TraceEntryTable_t entry_table;
+static TraceEventDataTable_t event_data;
+static TraceUnsignedBaseType_t last_param;	// First parameter of the last event committed
+static uint32_t committed[256];				// Events committed, by code
+
+uint32_t xTraceHostEventClass(uint32_t uiEventCode) {
+	switch (uiEventCode) {
+	case CODE_TASK_SWITCH: return TRC_EVENT_CLASS_TASK_SWITCH;
+	case CODE_QUEUE: return TRC_EVENT_CLASS_QUEUE;
+	case CODE_USER: return TRC_EVENT_CLASS_USER;
+	default: return TRC_EVENT_CLASS_RECORDER;
+	}
+}
+
+traceResult xTraceTimestampGet(uint32_t *puiTimestamp) {
+	*puiTimestamp = 0u;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceTimestampGetWraparounds(uint32_t *puiTimerWraparounds) {
+	*puiTimerWraparounds = 0u;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceTimestampGetFrequency(TraceUnsignedBaseType_t *puxFrequency) {
+	*puxFrequency = 80000000u;
+	return TRC_SUCCESS;
+}
+
+static TraceUnsignedBaseType_t event_buffer[TRC_MAX_BLOB_SIZE / sizeof(TraceUnsignedBaseType_t)];
+
+traceResult xTraceStreamPortAllocate(uint32_t uiSize, void **ppvData) {
+	(void)uiSize;
+	*ppvData = event_buffer;
+	return TRC_SUCCESS;
+}
+
+// Committed straight to the stream port, without the internal buffer
+traceResult xTraceStreamPortWriteData(void *pvData, uint32_t uiSize, int32_t *piBytesWritten) {
+	const TraceEvent1_t *event = pvData;
+
+	committed[event->EventID & 0xFFu]++;
+	if (uiSize >= sizeof(TraceEvent1_t)) {
+		last_param = event->uxParams[0];
+	}
+	*piBytesWritten = (int32_t)uiSize;
+	return TRC_SUCCESS;
+}
+
+// Number of 'code' events committed by creating one
+static uint32_t kept(uint32_t code) {
+	uint32_t before = committed[code];
+
+	xTraceEventCreate1(code, 0);
+	return committed[code] - before;
+}
+
+// Number of events committed by one event of each object path for 'object'
+static uint32_t kept_for(void *object) {
+	uint32_t before = committed[CODE_TASK_SWITCH] + committed[CODE_QUEUE];
+
+	last_param = 0;
+	prvTraceStoreEvent_Handle(CODE_TASK_SWITCH, object);
+	if (committed[CODE_TASK_SWITCH] + committed[CODE_QUEUE] != before) {
+		CHECK(last_param == (TraceUnsignedBaseType_t)(uintptr_t)object);
+	}
+	prvTraceStoreEvent_HandleParam(CODE_QUEUE, object, 1);
+	prvTraceStoreEvent_HandleParamParam(CODE_QUEUE, object, 1, 2);
+	return committed[CODE_TASK_SWITCH] + committed[CODE_QUEUE] - before;
+}
+
+static void setup(void) {
+	TraceEntryHandle_t entry;
+
+	memset(committed, 0, sizeof(committed));
+	CHECK(xTraceEntryIndexTableInitialize(&index_table) == TRC_SUCCESS);
+	CHECK(xTraceEntryTableInitialize(&entry_table) == TRC_SUCCESS);
+	CHECK(xTraceEventInitialize(&event_data) == TRC_SUCCESS);
+	CHECK(xTraceEntryCreateWithAddress(TASK_A, &entry) == TRC_SUCCESS);
+	CHECK(xTraceEntryCreateWithAddress(TASK_B, &entry) == TRC_SUCCESS);
+	CHECK(xTraceEntryCreateWithAddress(QUEUE_A, &entry) == TRC_SUCCESS);
+}
+
+static void test_class_mask(void) {
+	uint32_t mask = 0;
+
+	setup();
+
+	// Everything by default
+	CHECK(xTraceEventGetClassMask(&mask) == TRC_SUCCESS && mask == TRC_EVENT_CLASS_ALL);
+	CHECK(kept(CODE_RECORDER) == 1 && kept(CODE_TASK_SWITCH) == 1);
+	CHECK(kept(CODE_QUEUE) == 1 && kept(CODE_USER) == 1);
+
+	// Masked classes go, recorder events stay
+	CHECK(xTraceEventSetClassMask(TRC_EVENT_CLASS_TASK_SWITCH) == TRC_SUCCESS);
+	CHECK(xTraceEventGetClassMask(&mask) == TRC_SUCCESS);
+	CHECK(mask == (TRC_EVENT_CLASS_TASK_SWITCH | TRC_EVENT_CLASS_RECORDER));
+	CHECK(kept(CODE_RECORDER) == 1 && kept(CODE_TASK_SWITCH) == 1);
+	CHECK(kept(CODE_QUEUE) == 0 && kept(CODE_USER) == 0);
+
+	CHECK(xTraceEventSetClassMask(0) == TRC_SUCCESS);
+	CHECK(kept(CODE_RECORDER) == 1 && kept(CODE_TASK_SWITCH) == 0);
+
+	// Back again
+	CHECK(xTraceEventSetClassMask(TRC_EVENT_CLASS_ALL) == TRC_SUCCESS);
+	CHECK(kept(CODE_QUEUE) == 1 && kept(CODE_USER) == 1);
+
+	CHECK(trc_host_critical_nesting == 0);
+}
+
+static void test_excluded_objects(void) {
+	const TraceEventFilterData_t *filter = &event_data.xFilterData;
+	TraceEntryHandle_t entry;
+	uint32_t options = 0;
+
+	setup();
+
+	// Nothing excluded: every path records
+	CHECK(kept_for(TASK_A) == 3 && kept_for(TASK_B) == 3 && kept_for(UNKNOWN) == 3);
+
+	// Excluding marks the entry, and drops that object's events only
+	CHECK(xTraceEventSetObjectExcluded(TASK_A, 1) == TRC_SUCCESS);
+	CHECK(filter->uiExcludedObjects == 1);
+	CHECK(xTraceEntryFind(TASK_A, &entry) == TRC_SUCCESS);
+	CHECK(xTraceEntryGetOptions(entry, &options) == TRC_SUCCESS);
+	CHECK(options & TRC_ENTRY_OPTION_EXCLUDED);
+	CHECK(kept_for(TASK_A) == 0);
+	CHECK(kept_for(TASK_B) == 3 && kept_for(QUEUE_A) == 3 && kept_for(UNKNOWN) == 3);
+
+	// Counted once, however often it is excluded
+	CHECK(xTraceEventSetObjectExcluded(TASK_A, 1) == TRC_SUCCESS);
+	CHECK(filter->uiExcludedObjects == 1);
+	CHECK(xTraceEventSetObjectExcluded(QUEUE_A, 1) == TRC_SUCCESS);
+	CHECK(filter->uiExcludedObjects == 2);
+	CHECK(kept_for(TASK_A) == 0 && kept_for(QUEUE_A) == 0 && kept_for(TASK_B) == 3);
+
+	// Objects without an entry cannot be excluded
+	CHECK(xTraceEventSetObjectExcluded(UNKNOWN, 1) == TRC_FAIL);
+	CHECK(filter->uiExcludedObjects == 2);
+
+	// Included again: back in the trace
+	CHECK(xTraceEventSetObjectExcluded(TASK_A, 0) == TRC_SUCCESS);
+	CHECK(xTraceEventSetObjectExcluded(TASK_A, 0) == TRC_SUCCESS);
+	CHECK(filter->uiExcludedObjects == 1);
+	CHECK(xTraceEntryGetOptions(entry, &options) == TRC_SUCCESS);
+	CHECK((options & TRC_ENTRY_OPTION_EXCLUDED) == 0);
+	CHECK(kept_for(TASK_A) == 3 && kept_for(QUEUE_A) == 0);
+	CHECK(xTraceEventSetObjectExcluded(QUEUE_A, 0) == TRC_SUCCESS);
+	CHECK(filter->uiExcludedObjects == 0);
+	CHECK(kept_for(QUEUE_A) == 3);
+
+	// The class mask still applies to the objects traced
+	CHECK(xTraceEventSetClassMask(TRC_EVENT_CLASS_TASK_SWITCH) == TRC_SUCCESS);
+	CHECK(kept_for(TASK_A) == 1);
+
+	CHECK(trc_host_critical_nesting == 0);
+}
+
+// CMD_SET_FILTER as received from the host, through xTraceEventSetFilter()
+static void test_set_filter_command(void) {
+	uint32_t mask = 0;
+
+	setup();
+
+	CHECK(xTraceEventSetFilter(CMD_FILTER_CLASS_MASK, TRC_EVENT_CLASS_QUEUE) == TRC_SUCCESS);
+	CHECK(xTraceEventGetClassMask(&mask) == TRC_SUCCESS);
+	CHECK(mask == (TRC_EVENT_CLASS_QUEUE | TRC_EVENT_CLASS_RECORDER));
+	CHECK(kept(CODE_QUEUE) == 1 && kept(CODE_TASK_SWITCH) == 0 && kept(CODE_USER) == 0);
+	CHECK(xTraceEventSetFilter(CMD_FILTER_CLASS_MASK, TRC_EVENT_CLASS_ALL) == TRC_SUCCESS);
+	CHECK(xTraceEventGetClassMask(&mask) == TRC_SUCCESS && mask == TRC_EVENT_CLASS_ALL);
+
+	// Objects by their 32-bit address
+	CHECK(xTraceEventSetFilter(CMD_FILTER_EXCLUDE_OBJECT, 0x20000200u) == TRC_SUCCESS);
+	CHECK(event_data.xFilterData.uiExcludedObjects == 1);
+	CHECK(kept_for(TASK_B) == 0 && kept_for(TASK_A) == 3);
+	CHECK(xTraceEventSetFilter(CMD_FILTER_INCLUDE_OBJECT, 0x20000200u) == TRC_SUCCESS);
+	CHECK(event_data.xFilterData.uiExcludedObjects == 0);
+	CHECK(kept_for(TASK_B) == 3);
+
+	CHECK(xTraceEventSetFilter(CMD_FILTER_EXCLUDE_OBJECT, 0x20000400u) == TRC_FAIL);
+	CHECK(xTraceEventSetFilter(CMD_FILTER_INCLUDE_OBJECT + 1u, 0) == TRC_FAIL);
+
+	CHECK(trc_host_critical_nesting == 0);
+}
+
+int main(void) {
+	test_class_mask();
+	test_excluded_objects();
+	test_set_filter_command();
+	return test_result();
+}
@@ -0,0 +1,242 @@
+#include "test.h"
+#include <trcRecorder.h>
+#include <stdarg.h>
+#include <string.h>
+
+//------------------------------------------------------------------------------
+// Load shedding of trcEvent.c (TRC_CFG_EVENT_SHEDDING): the internal buffer is
+// filled past the low and then the high watermark with events that are always
+// kept, and events of every class are created at each level. The dropped ones
+// must be exactly the configured classes, and xTraceEventSheddingCheckStatus()
+// must report them in one marker event once the buffer has drained below the
+// low watermark, with the count, classes and duration of the drops. The
+// marker is kept even while the class mask of TRC_CFG_EVENT_FILTER drops all
+// other user events.
+//------------------------------------------------------------------------------
+
+#define BUFFER_SIZE 1000u
+#define EVENT_SIZE (sizeof(TraceEvent1_t))
+#define TIMESTAMP_HZ 80000000u
+#define TICKS_PER_EVENT 400u		// 5 us
+
+// Event codes of the test, one per class
+#define CODE_RECORDER    0x01u
+#define CODE_TASK_READY  0x30u
+#define CODE_OS_TICK     0x31u
+#define CODE_TASK_SWITCH 0x35u
+#define CODE_QUEUE       0x50u
+#define CODE_USER        0x90u
+
+volatile int trc_host_critical_nesting;
+
+static TraceEventDataTable_t event_data;
+static TraceUnsignedBaseType_t event_buffer[TRC_MAX_BLOB_SIZE / sizeof(TraceUnsignedBaseType_t)];
+static uint32_t used;		// Bytes in the internal buffer
+static uint32_t now;
+static uint32_t committed[256];	// Events committed, by code
+static uint32_t strings;
+static uint32_t markers;
+static char marker[96];
+
+uint32_t xTraceHostEventClass(uint32_t uiEventCode) {
+	switch (uiEventCode) {
+	case CODE_TASK_READY: return TRC_EVENT_CLASS_TASK_READY;
+	case CODE_OS_TICK: return TRC_EVENT_CLASS_OS_TICK;
+	case CODE_TASK_SWITCH: return TRC_EVENT_CLASS_TASK_SWITCH;
+	case CODE_QUEUE: return TRC_EVENT_CLASS_QUEUE;
+	case CODE_USER: return TRC_EVENT_CLASS_USER;
+	default: return TRC_EVENT_CLASS_RECORDER;
+	}
+}
+
+traceResult xTraceTimestampGet(uint32_t *puiTimestamp) {
+	*puiTimestamp = now;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceTimestampGetWraparounds(uint32_t *puiTimerWraparounds) {
+	*puiTimerWraparounds = 0u;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceTimestampGetFrequency(TraceUnsignedBaseType_t *puxFrequency) {
+	*puxFrequency = TIMESTAMP_HZ;
+	return TRC_SUCCESS;
+}
+
+// Internal buffer: only its fill level matters here
+traceResult xTraceStreamPortAllocate(uint32_t uiSize, void **ppvData) {
+	if (used + uiSize > BUFFER_SIZE) {
+		return TRC_FAIL;
+	}
+	*ppvData = event_buffer;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceStreamPortCommit(void *pvData, uint32_t uiSize, int32_t *piBytesCommitted) {
+	const TraceEvent0_t *event = pvData;
+
+	committed[event->EventID & 0xFFu]++;
+	used += uiSize;
+	*piBytesCommitted = (int32_t)uiSize;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceStreamPortWriteData(void *pvData, uint32_t uiSize, int32_t *piBytesWritten) {
+	*piBytesWritten = (int32_t)uiSize;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceInternalEventBufferGetUsage(uint32_t *puiUsed, uint32_t *puiSize) {
+	*puiUsed = used;
+	*puiSize = BUFFER_SIZE;
+	return TRC_SUCCESS;
+}
+
+traceResult xTraceStringRegister(const char *szString, TraceStringHandle_t *pString) {
+	strings++;
+	*pString = (TraceStringHandle_t)0x2000u;
+	return TRC_SUCCESS;
+}
+
+// The marker is a user event on the channel registered for it, counted once committed
+traceResult xTracePrintF(TraceStringHandle_t xChannel, const char *szFormat, ...) {
+	va_list args;
+	uint32_t before = committed[CODE_USER];
+
+	CHECK(xChannel == (TraceStringHandle_t)0x2000u);
+	va_start(args, szFormat);
+	vsnprintf(marker, sizeof(marker), szFormat, args);
+	va_end(args);
+	xTraceEventCreate1(CODE_USER, (TraceUnsignedBaseType_t)(uintptr_t)xChannel);
+	markers += committed[CODE_USER] - before;
+	return TRC_SUCCESS;
+}
+
+static void event(uint32_t code) {
+	now += TICKS_PER_EVENT;
+	xTraceEventCreate1(code, now);
+}
+
+// Task switches, never shed, until the buffer is at least 'percent' full
+static void fill_to(uint32_t percent) {
+	while (used * 100u < BUFFER_SIZE * percent) {
+		event(CODE_TASK_SWITCH);
+	}
+}
+
+// One event of every class; returns the codes committed
+static uint32_t one_of_each(void) {
+	static const uint32_t codes[] = {
+		CODE_RECORDER, CODE_TASK_READY, CODE_OS_TICK, CODE_TASK_SWITCH, CODE_QUEUE, CODE_USER
+	};
+	uint32_t before[256];
+	uint32_t kept = 0;
+
+	memcpy(before, committed, sizeof(before));
+	for (uint32_t i = 0; i < sizeof(codes) / sizeof(codes[0]); i++) {
+		event(codes[i]);
+		if (committed[codes[i]] != before[codes[i]]) {
+			kept |= 1u << i;
+		}
+	}
+	return kept;
+}
+
+// The marker xTraceEventSheddingCheckStatus() printed last
+static int marker_is(uint32_t events, uint32_t classes, uint32_t first, uint32_t last) {
+	char expected[96];
+
+	snprintf(expected, sizeof(expected), "Dropped %u events, classes 0x%04X, over %u us",
+	         events, classes, (last - first) / (TIMESTAMP_HZ / 1000000u));
+	return strcmp(marker, expected) == 0;
+}
+
+#define KEPT(recorder, ready, tick, task_switch, queue, user) \
+	((recorder) | (ready) << 1 | (tick) << 2 | (task_switch) << 3 | (queue) << 4 | (user) << 5)
+
+static void test_shedding(void) {
+	const TraceEventShedData_t *shed = &event_data.xShedData;
+
+	xTraceEventInitialize(&event_data);
+
+	// Below the low watermark everything is kept, and there is nothing to report
+	CHECK(one_of_each() == KEPT(1, 1, 1, 1, 1, 1));
+	CHECK(xTraceEventSheddingCheckStatus() == TRC_SUCCESS);
+	CHECK(markers == 0 && strings == 0);
+
+	// Above the low watermark ticks, ready and user events go
+	fill_to(TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK);
+	uint32_t first = now + 2u * TICKS_PER_EVENT;	// The ready event
+	CHECK(one_of_each() == KEPT(1, 0, 0, 1, 1, 0));
+	CHECK(shed->uiEvents == 3);
+
+	// Above the high watermark everything but recorder events and task switches
+	fill_to(TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK);
+	CHECK(one_of_each() == KEPT(1, 0, 0, 1, 0, 0));
+	uint32_t last = now;	// The user event
+	CHECK(shed->uiEvents == 7);
+	CHECK(shed->uiFirstTimestamp == first && shed->uiLastTimestamp == last);
+
+	// No report while the buffer is still above the low watermark
+	CHECK(xTraceEventSheddingCheckStatus() == TRC_SUCCESS);
+	CHECK(markers == 0);
+
+	// Drained: one marker, and the counts start over
+	used = BUFFER_SIZE * TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK / 100u - EVENT_SIZE;
+	CHECK(xTraceEventSheddingCheckStatus() == TRC_SUCCESS);
+	CHECK(markers == 1 && strings == 1);
+	printf("%s\n", marker);
+	CHECK(marker_is(7, TRC_CFG_EVENT_SHEDDING_LOW_CLASSES | TRC_EVENT_CLASS_QUEUE, first, last));
+	CHECK(shed->uiEvents == 0 && shed->uiClasses == 0);
+	CHECK(shed->uiFirstTimestamp == 0 && shed->uiLastTimestamp == 0);
+
+	CHECK(xTraceEventSheddingCheckStatus() == TRC_SUCCESS);
+	CHECK(markers == 1);
+
+	// A second episode goes into a report of its own, on the same channel
+	fill_to(TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK);
+	first = now + 2u * TICKS_PER_EVENT;
+	CHECK(one_of_each() == KEPT(1, 0, 0, 1, 1, 0));
+	last = now;
+	used = 0;
+	CHECK(xTraceEventSheddingCheckStatus() == TRC_SUCCESS);
+	CHECK(markers == 2 && strings == 1);
+	CHECK(marker_is(3, TRC_CFG_EVENT_SHEDDING_LOW_CLASSES, first, last));
+
+	CHECK(trc_host_critical_nesting == 0);
+}
+
+// User events masked: the marker still comes, and the mask is as before afterwards
+static void test_marker_filtered(void) {
+	const uint32_t mask = TRC_EVENT_CLASS_ALL & ~(uint32_t)TRC_EVENT_CLASS_USER;
+	uint32_t current = 0;
+
+	xTraceEventInitialize(&event_data);
+	used = 0;
+	markers = 0;
+	CHECK(xTraceEventSetClassMask(mask) == TRC_SUCCESS);
+
+	// User events go to the filter now, not to shedding
+	fill_to(TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK);
+	uint32_t first = now + 2u * TICKS_PER_EVENT;
+	CHECK(one_of_each() == KEPT(1, 0, 0, 1, 1, 0));
+	uint32_t last = first + TICKS_PER_EVENT;	// The tick event
+	CHECK(event_data.xShedData.uiEvents == 2);
+
+	used = 0;
+	CHECK(xTraceEventSheddingCheckStatus() == TRC_SUCCESS);
+	CHECK(markers == 1);
+	CHECK(marker_is(2, TRC_EVENT_CLASS_TASK_READY | TRC_EVENT_CLASS_OS_TICK, first, last));
+
+	CHECK(xTraceEventGetClassMask(&current) == TRC_SUCCESS && current == mask);
+	CHECK(one_of_each() == KEPT(1, 1, 1, 1, 1, 0));
+
+	CHECK(trc_host_critical_nesting == 0);
+}
+
+int main(void) {
+	test_shedding();
+	test_marker_filtered();
+	return test_result();
+}
@@ -0,0 +1,237 @@
+#include <string.h>
+#include "trace_decoder.h"
+
+#define TRACE_PSF_OPTION_64BIT   (1UL << 3)
+#define TRACE_PSF_OPTION_COMPACT (1UL << 4)
+
+// TRACE_PSF_ENDIANESS_IDENTIFIER as sent by a little-endian target
+static const uint8_t trace_psf_identifier[4] = { 0x00, 0x46, 0x53, 0x50 };
+
+static uint32_t trace_read_u32(const uint8_t *p) {
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void trace_write_u32(uint8_t *p, uint32_t value) {
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	p[2] = (uint8_t)(value >> 16);
+	p[3] = (uint8_t)(value >> 24);
+}
+
+void trace_decoder_init(trace_decoder_t *decoder) {
+	decoder->state = TRACE_DECODER_HEADER;
+	decoder->length = 0;
+	decoder->remaining = 0;
+	decoder->have_reference = 0;
+	decoder->last_count = 0;
+	decoder->last_timestamp = 0;
+	decoder->events = 0;
+	decoder->syncs = 0;
+	decoder->lost = 0;
+	decoder->resyncs = 0;
+	decoder->corrupted = 0;
+}
+
+//------------------------------------------------------------------------------
+// Prelude: header, timestamp info and entry table
+//------------------------------------------------------------------------------
+
+static void trace_decoder_end_header(trace_decoder_t *decoder, trace_output_t output, void *context) {
+	uint32_t options = trace_read_u32(&decoder->record[8]); // After uiPSF, uiVersion and uiPlatform
+
+	if ((options & TRACE_PSF_OPTION_COMPACT) == 0 || (options & TRACE_PSF_OPTION_64BIT)) {
+		decoder->state = TRACE_DECODER_PASSTHROUGH;
+	} else {
+		trace_write_u32(&decoder->record[8], options & ~TRACE_PSF_OPTION_COMPACT);
+		decoder->state = TRACE_DECODER_TIMESTAMP;
+		decoder->remaining = TRACE_PSF_TIMESTAMP_SIZE;
+	}
+	output(decoder->record, TRACE_PSF_HEADER_SIZE, context);
+}
+
+static void trace_decoder_end_entries(trace_decoder_t *decoder, trace_output_t output, void *context) {
+	uint32_t count = trace_read_u32(&decoder->record[0]);
+	uint32_t symbol_size = trace_read_u32(&decoder->record[4]);
+	uint32_t state_count = trace_read_u32(&decoder->record[8]);
+
+	// Address, states, options and symbol of each entry in use
+	decoder->remaining = count * (4 + 4 * state_count + 4 + symbol_size);
+	decoder->state = decoder->remaining ? TRACE_DECODER_ENTRY : TRACE_DECODER_EVENTS;
+	decoder->have_reference = 0; // The event count has moved on with the raw blocks
+	output(decoder->record, TRACE_PSF_ENTRIES_SIZE, context);
+}
+
+//------------------------------------------------------------------------------
+// Events
+//------------------------------------------------------------------------------
+
+// Size of the event being received: 0 while not known yet, -1 if it is not an event
+static int trace_decoder_event_length(const trace_decoder_t *decoder) {
+	const uint8_t *record = decoder->record;
+
+	if (record[0] == TRACE_COMPACT_SYNC) {
+		if (decoder->length < 3) {
+			return 0;
+		}
+		int parameters = record[2] >> 4; // Top of the EventID high byte
+		return parameters > 14 ? -1 : 1 + TRACE_PSF_EVENT_SIZE + 4 * parameters;
+	}
+
+	// EventID high byte, low byte, then the delta up to its last byte
+	for (size_t i = 2; i < decoder->length; i++) {
+		if ((record[i] & 0x80) == 0) {
+			return (int)(i + 1) + 4 * (record[0] >> 4);
+		}
+		if (i == 6) {
+			return -1; // A 32-bit delta takes 5 bytes at most
+		}
+	}
+	return 0;
+}
+
+static void trace_decoder_end_event(trace_decoder_t *decoder, trace_output_t output, void *context) {
+	const uint8_t *record = decoder->record;
+	uint8_t event[TRACE_PSF_MAX_EVENT];
+
+	if (record[0] == TRACE_COMPACT_SYNC) {
+		uint16_t count = (uint16_t)(record[3] | (record[4] << 8));
+
+		// A forward jump in the 16-bit event count beyond +1 means events were dropped on the target
+		if (decoder->have_reference) {
+			uint16_t gap = (uint16_t)(count - decoder->last_count - 1);
+			if (gap <= TRACE_DECODER_MAX_GAP) {
+				decoder->lost += gap;
+			} else {
+				decoder->resyncs++;
+			}
+		}
+		decoder->have_reference = 1;
+		decoder->last_count = count;
+		decoder->last_timestamp = trace_read_u32(&record[5]);
+		decoder->syncs++;
+		decoder->events++;
+		output(&record[1], decoder->length - 1, context);
+		return;
+	}
+
+	if (!decoder->have_reference) {
+		decoder->corrupted += (uint32_t)decoder->length; // Nothing to take the count and time from
+		return;
+	}
+
+	uint32_t delta = 0;
+	size_t i = 2;
+	for (unsigned shift = 0; ; shift += 7) {
+		delta |= (uint32_t)(record[i] & 0x7F) << shift;
+		if ((record[i++] & 0x80) == 0) {
+			break;
+		}
+	}
+	decoder->last_count++;
+	decoder->last_timestamp += delta;
+
+	event[0] = record[1];
+	event[1] = record[0];
+	event[2] = (uint8_t)decoder->last_count;
+	event[3] = (uint8_t)(decoder->last_count >> 8);
+	trace_write_u32(&event[4], decoder->last_timestamp);
+	memcpy(&event[TRACE_PSF_EVENT_SIZE], &record[i], decoder->length - i);
+	decoder->events++;
+	output(event, TRACE_PSF_EVENT_SIZE + decoder->length - i, context);
+}
+
+static void trace_decoder_event_byte(trace_decoder_t *decoder, uint8_t byte,
+                                     trace_output_t output, void *context) {
+	if (decoder->length == 0) {
+		if (byte == TRACE_COMPACT_PAD) {
+			return;
+		}
+		if (byte == TRACE_COMPACT_PRELUDE) {
+			decoder->state = TRACE_DECODER_PRELUDE;
+			return;
+		}
+		if (byte > TRACE_COMPACT_SYNC) {
+			decoder->corrupted++;
+			return;
+		}
+	}
+	decoder->record[decoder->length++] = byte;
+
+	int length = trace_decoder_event_length(decoder);
+	if (length < 0) {
+		decoder->corrupted += (uint32_t)decoder->length;
+		decoder->length = 0;
+	} else if (length > 0 && decoder->length == (size_t)length) {
+		trace_decoder_end_event(decoder, output, context);
+		decoder->length = 0;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Interface
+//------------------------------------------------------------------------------
+
+void trace_decoder_feed(trace_decoder_t *decoder, const uint8_t *data, size_t length,
+                        trace_output_t output, void *context) {
+	size_t i = 0;
+
+	while (i < length) {
+		switch (decoder->state) {
+		case TRACE_DECODER_HEADER:
+			// Resynchronise on the PSF identifier (its first byte does not occur again in it)
+			if (decoder->length < sizeof(trace_psf_identifier) && data[i] != trace_psf_identifier[decoder->length]) {
+				decoder->corrupted += (uint32_t)decoder->length;
+				decoder->length = 0;
+				if (data[i] != trace_psf_identifier[0]) {
+					decoder->corrupted++;
+					i++;
+					break;
+				}
+			}
+			decoder->record[decoder->length++] = data[i++];
+			if (decoder->length == TRACE_PSF_HEADER_SIZE) {
+				decoder->length = 0;
+				trace_decoder_end_header(decoder, output, context);
+			}
+			break;
+
+		case TRACE_DECODER_TIMESTAMP:
+		case TRACE_DECODER_ENTRY: {
+			size_t run = length - i < decoder->remaining ? length - i : decoder->remaining;
+			output(&data[i], run, context);
+			i += run;
+			decoder->remaining -= (uint32_t)run;
+			if (decoder->remaining == 0) {
+				decoder->state = decoder->state == TRACE_DECODER_TIMESTAMP ? TRACE_DECODER_ENTRIES : TRACE_DECODER_EVENTS;
+			}
+			break;
+		}
+
+		case TRACE_DECODER_ENTRIES:
+			decoder->record[decoder->length++] = data[i++];
+			if (decoder->length == TRACE_PSF_ENTRIES_SIZE) {
+				decoder->length = 0;
+				trace_decoder_end_entries(decoder, output, context);
+			}
+			break;
+
+		case TRACE_DECODER_EVENTS:
+			trace_decoder_event_byte(decoder, data[i++], output, context);
+			break;
+
+		case TRACE_DECODER_PRELUDE:
+			// Padding up to the word the header starts in
+			if (data[i] == TRACE_COMPACT_PAD) {
+				i++;
+			} else {
+				decoder->state = TRACE_DECODER_HEADER;
+			}
+			break;
+
+		case TRACE_DECODER_PASSTHROUGH:
+			output(&data[i], length - i, context);
+			i = length;
+			break;
+		}
+	}
+}
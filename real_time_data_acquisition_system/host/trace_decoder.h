@@ -0,0 +1,70 @@
+#ifndef __TRACE_DECODER_H
+#define __TRACE_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------
+// Host-side decoder for the compact trace encoding (TRC_CFG_EVENT_COMPACT_ENCODING
+// in TraceRecorder/config/trcStreamingConfig.h). Bytes captured from the ITM
+// port are fed in arbitrary chunks and come out as standard PSF, ready for
+// Tracealyzer: the header, timestamp info and entry table pass through (the
+// compact option bit cleared), compact events get back their EventCount and
+// full timestamp, sync events lose their marker and padding is dropped.
+// Decoding starts at the first PSF header; a stream without the compact option
+// bit is passed through unchanged. 32-bit targets only.
+//------------------------------------------------------------------------------
+
+// Must match TraceRecorder/include/trcEvent.h
+#define TRACE_COMPACT_SYNC     0xF0
+#define TRACE_COMPACT_PRELUDE  0xFE
+#define TRACE_COMPACT_PAD      0xFF
+
+#define TRACE_PSF_HEADER_SIZE    32 // TraceHeader_t
+#define TRACE_PSF_TIMESTAMP_SIZE 28 // TraceTimestampData_t
+#define TRACE_PSF_ENTRIES_SIZE   12 // Entry count, symbol size and state count
+#define TRACE_PSF_EVENT_SIZE     8  // EventID, EventCount, TS
+#define TRACE_PSF_MAX_EVENT      64 // TRC_MAX_BLOB_SIZE
+
+// Largest forward jump of EventCount at a sync event still counted as lost events: half
+// the 16-bit range. A longer jump is a backward one (a target restart or a count reset)
+// and the decoder resynchronises on the new count instead of counting ~65535 lost events.
+#define TRACE_DECODER_MAX_GAP    0x7FFF
+
+// Receives decoded PSF bytes
+typedef void (*trace_output_t)(const uint8_t *data, size_t length, void *context);
+
+typedef enum {
+	TRACE_DECODER_HEADER,      // Looking for and collecting the PSF header
+	TRACE_DECODER_TIMESTAMP,   // Passing the timestamp info through
+	TRACE_DECODER_ENTRIES,     // Collecting the entry table size
+	TRACE_DECODER_ENTRY,       // Passing the entries through
+	TRACE_DECODER_EVENTS,      // Compact and sync events
+	TRACE_DECODER_PRELUDE,     // Padding before a new header
+	TRACE_DECODER_PASSTHROUGH  // Standard PSF stream
+} trace_decoder_state_t;
+
+typedef struct {
+	trace_decoder_state_t state;
+	uint8_t record[1 + TRACE_PSF_MAX_EVENT]; // Header, entry table size or event being received
+	size_t length;
+	uint32_t remaining;  // Bytes left to pass through
+	int have_reference;  // A sync event has been seen since the header
+	uint16_t last_count;
+	uint32_t last_timestamp;
+
+	// Statistics
+	uint32_t events;     // Events delivered, sync events included
+	uint32_t syncs;      // Sync events
+	uint32_t lost;       // Events missing according to gaps in EventCount
+	uint32_t resyncs;    // EventCount jumps taken as a restart of the count
+	uint32_t corrupted;  // Bytes skipped: no header found, unknown marker or no sync event yet
+} trace_decoder_t;
+
+void trace_decoder_init(trace_decoder_t *decoder);
+
+// Feed captured bytes; 'output' is called with the decoded PSF bytes
+void trace_decoder_feed(trace_decoder_t *decoder, const uint8_t *data, size_t length,
+                        trace_output_t output, void *context);
+
+#endif /* __TRACE_DECODER_H */
@@ -0,0 +1,41 @@
+#ifndef TRC_CONFIG_H
+#define TRC_CONFIG_H
+
+//------------------------------------------------------------------------------
+// Recorder configuration of the host tests: streaming mode on one core, as on
+// the target. Options under test are switched on by each test target with -D.
+//------------------------------------------------------------------------------
+
+#define TRC_CFG_HARDWARE_PORT TRC_HARDWARE_PORT_ARM_Cortex_M
+#define TRC_CFG_RECORDER_MODE TRC_RECORDER_MODE_STREAMING
+#define TRC_CFG_CORE_COUNT 1
+#define TRC_CFG_GET_CURRENT_CORE() 0
+#define TRC_CFG_RECORDER_DATA_ATTRIBUTE
+#define TRC_CFG_USE_TRACE_ASSERT 1
+
+#ifndef TRC_CFG_ENTRY_SLOTS
+#define TRC_CFG_ENTRY_SLOTS 50
+#endif
+#define TRC_CFG_ENTRY_SYMBOL_MAX_LENGTH 28
+
+#ifndef TRC_CFG_EVENT_BUFFER_LOCK_FREE
+#define TRC_CFG_EVENT_BUFFER_LOCK_FREE 0
+#endif
+#ifndef TRC_CFG_EVENT_COMPACT_ENCODING
+#define TRC_CFG_EVENT_COMPACT_ENCODING 0
+#endif
+#ifndef TRC_CFG_EVENT_COMPACT_SYNC_INTERVAL
+#define TRC_CFG_EVENT_COMPACT_SYNC_INTERVAL 256
+#endif
+#ifndef TRC_CFG_EVENT_FILTER
+#define TRC_CFG_EVENT_FILTER 0
+#endif
+#ifndef TRC_CFG_EVENT_SHEDDING
+#define TRC_CFG_EVENT_SHEDDING 0
+#endif
+#define TRC_CFG_EVENT_SHEDDING_LOW_WATERMARK 75
+#define TRC_CFG_EVENT_SHEDDING_LOW_CLASSES (TRC_EVENT_CLASS_OS_TICK | TRC_EVENT_CLASS_TASK_READY | TRC_EVENT_CLASS_USER)
+#define TRC_CFG_EVENT_SHEDDING_HIGH_WATERMARK 90
+#define TRC_CFG_EVENT_SHEDDING_HIGH_CLASSES (TRC_EVENT_CLASS_ALL)
+
+#endif /* TRC_CONFIG_H */
@@ -0,0 +1,40 @@
+#ifndef TRC_HARDWARE_PORT_H
+#define TRC_HARDWARE_PORT_H
+
+#include <stdint.h>
+
+//------------------------------------------------------------------------------
+// Host stand-in for the Cortex-M hardware port. 32-bit base types, as on the
+// target, so events have the layout the decoders expect. LDREX/STREX work as in
+// sim/stm32l476xx.h: STREX is a compare-and-swap against the value the same
+// thread loaded, so host threads contend the way pre-empting contexts do. The
+// critical section only counts its nesting, for the tests to check.
+//------------------------------------------------------------------------------
+
+#define TRC_BASE_TYPE int32_t
+#define TRC_UNSIGNED_BASE_TYPE uint32_t
+
+#define __CORTEX_M 4
+
+static __thread uint32_t trc_host_exclusive_value;
+
+static inline uint32_t trc_host_ldrexw(volatile uint32_t *addr) {
+	trc_host_exclusive_value = __atomic_load_n(addr, __ATOMIC_SEQ_CST);
+	return trc_host_exclusive_value;
+}
+
+static inline uint32_t trc_host_strexw(uint32_t value, volatile uint32_t *addr) {
+	return !__sync_bool_compare_and_swap(addr, trc_host_exclusive_value, value);
+}
+
+#define __LDREXW(addr)          trc_host_ldrexw(addr)
+#define __STREXW(value, addr)   trc_host_strexw((value), (addr))
+#define __DMB()                 __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+extern volatile int trc_host_critical_nesting;
+
+#define TRACE_ALLOC_CRITICAL_SECTION()
+#define TRACE_ENTER_CRITICAL_SECTION() (trc_host_critical_nesting++)
+#define TRACE_EXIT_CRITICAL_SECTION() (trc_host_critical_nesting--)
+
+#endif /* TRC_HARDWARE_PORT_H */
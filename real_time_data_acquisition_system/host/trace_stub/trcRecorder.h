@@ -0,0 +1,86 @@
+#ifndef TRC_RECORDER_H
+#define TRC_RECORDER_H
+
+//------------------------------------------------------------------------------
+// Host stand-in for TraceRecorder/include/trcRecorder.h
+// Lets the host tests compile single recorder modules (trcEventBuffer.c,
+// trcEntryTable.c, trcEvent.c, ...) natively: the module headers are the real
+// ones, the configuration is trcConfig.h next to this file (overridable with
+// -D), and the services the modules call on the rest of the recorder (time
+// stamps, stream port, diagnostics) are declared here and defined by each test.
+// TRC_ASSERT is always on and aborts.
+//------------------------------------------------------------------------------
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <trcDefines.h>
+#include <trcTypes.h>	// trcConfig.h and trcHardwarePort.h of this directory
+
+#define TRC_USE_TRACEALYZER_RECORDER 1
+
+#ifndef TRC_USE_INTERNAL_BUFFER
+#define TRC_USE_INTERNAL_BUFFER 0
+#endif
+#ifndef TRC_INTERNAL_EVENT_BUFFER_WRITE_MODE
+#define TRC_INTERNAL_EVENT_BUFFER_WRITE_MODE TRC_INTERNAL_EVENT_BUFFER_OPTION_WRITE_MODE_DIRECT
+#endif
+
+#define TRC_ASSERT(e) do {                                                         \
+	if (!(e)) {                                                                    \
+		fprintf(stderr, "%s:%d: TRC_ASSERT failed: %s\n", __FILE__, __LINE__, #e);  \
+		abort();                                                                   \
+	}                                                                              \
+} while (0)
+#define TRC_ASSERT_ALWAYS_EVALUATE(e) TRC_ASSERT(e)
+#define TRC_ASSERT_CUSTOM_ON_FAIL(e, on_fail) if (!(e)) { on_fail; }
+#define TRC_ASSERT_EQUAL_SIZE(x, y)
+
+#include <trcDiagnostics.h>
+
+// Every component counts as initialized; diagnostics are not kept
+#define xTraceSetComponentInitialized(uiComponentBit) ((void)(uiComponentBit))
+#define xTraceIsComponentInitialized(uiComponentBit) ((void)(uiComponentBit), 1u)
+#define xTraceDiagnosticsIncrease(xType) ((void)(xType), TRC_SUCCESS)
+#define xTraceDiagnosticsDecrease(xType) ((void)(xType), TRC_SUCCESS)
+#define xTraceDiagnosticsSetIfHigher(xType, xValue) ((void)(xType), (void)(xValue), TRC_SUCCESS)
+
+/* Maximum event size */
+#define TRC_MAX_BLOB_SIZE (16UL * sizeof(TraceUnsignedBaseType_t))
+
+#define xTraceIsRecorderEnabled() (1)
+
+// Recorder services, defined by the test. Without the internal buffer, events are
+// committed straight to the stream port as with the ARM_ITM port.
+traceResult xTraceTimestampGet(uint32_t *puiTimestamp);
+traceResult xTraceTimestampGetWraparounds(uint32_t *puiTimerWraparounds);
+traceResult xTraceTimestampGetFrequency(TraceUnsignedBaseType_t *puxFrequency);
+traceResult xTraceStringRegister(const char *szString, TraceStringHandle_t *pString);
+traceResult xTracePrintF(TraceStringHandle_t xChannel, const char *szFormat, ...);
+traceResult xTraceStreamPortAllocate(uint32_t uiSize, void **ppvData);
+traceResult xTraceStreamPortWriteData(void *pvData, uint32_t uiSize, int32_t *piBytesWritten);
+#if (TRC_USE_INTERNAL_BUFFER == 0)
+#define xTraceStreamPortCommit xTraceStreamPortWriteData
+#else
+traceResult xTraceStreamPortCommit(void *pvData, uint32_t uiSize, int32_t *piBytesCommitted);
+traceResult xTraceInternalEventBufferGetUsage(uint32_t *puiUsed, uint32_t *puiSize);
+#endif
+
+// Event class of each event code, TRC_EVENT_CLASS_*; the kernel port table needs FreeRTOS
+uint32_t xTraceHostEventClass(uint32_t uiEventCode);
+#define TRC_KERNEL_PORT_EVENT_CLASS(uiEventCode) xTraceHostEventClass(uiEventCode)
+
+#include <trcUtility.h>
+#include <trcEntryTable.h>
+#include <trcEvent.h>
+#include <trcEventBuffer.h>
+
+// Events referring to a task or object, as in TraceRecorder/include/trcRecorder.h (streaming
+// mode), with the handle cast through uintptr_t for the 64-bit host
+#define prvTraceStoreEvent_Handle(_eventID, _handle) (xTraceEventIsObjectExcluded(_handle) ? TRC_SUCCESS : xTraceEventCreate1(_eventID, (TraceUnsignedBaseType_t)(uintptr_t)(_handle)))
+#define prvTraceStoreEvent_HandleParam(_eventID, _handle, _param1) (xTraceEventIsObjectExcluded(_handle) ? TRC_SUCCESS : xTraceEventCreate2(_eventID, (TraceUnsignedBaseType_t)(uintptr_t)(_handle), (TraceUnsignedBaseType_t)(_param1)))
+#define prvTraceStoreEvent_HandleParamParam(_eventID, _handle, _param1, _param2) (xTraceEventIsObjectExcluded(_handle) ? TRC_SUCCESS : xTraceEventCreate3(_eventID, (TraceUnsignedBaseType_t)(uintptr_t)(_handle), (TraceUnsignedBaseType_t)(_param1), (TraceUnsignedBaseType_t)(_param2)))
+
+#endif /* TRC_RECORDER_H */
@@ -0,0 +1,132 @@
+#include "latency.h"
+#include <stdio.h>
+#include <string.h>
+
+static latency_histogram_t latency_hist[LATENCY_STAGES];
+static uint32_t latency_ticks_per_us = 1;
+
+// Lines waiting for transmit completion: added by the writer, removed by the TX interrupt
+typedef struct {
+	uint32_t end;		// Ring position just past the last byte
+	uint32_t sampled;	// Stamp of the reported sample
+	uint32_t queued;	// Stamp of the start of the TX stage
+} latency_tx_line_t;
+
+static latency_tx_line_t latency_tx_lines[LATENCY_TX_LINES];
+static volatile uint32_t latency_tx_head;	// Lines registered
+static volatile uint32_t latency_tx_tail;	// Lines closed
+volatile uint32_t latency_tx_untracked;
+
+static const char * const latency_names[LATENCY_STAGES] = {
+	"acq", "queue", "proc", "tx", "e2e"
+};
+
+void latency_init(uint32_t ticks_per_us) {
+#ifndef LATENCY_HOST_CLOCK
+	// Enable the cycle counter (the trace recorder may have done so already)
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+	latency_ticks_per_us = ticks_per_us ? ticks_per_us : 1;
+	latency_reset();
+}
+
+void latency_record(latency_stage_t stage, uint32_t start, uint32_t end) {
+	latency_histogram_t *hist = &latency_hist[stage];
+	uint32_t us = (end - start) / latency_ticks_per_us;	// Modulo 2^32: correct across counter wrap
+	uint32_t bucket = 0;
+
+	// Bucket = floor(log2(us)), clamped to the last bucket
+	for (uint32_t v = us >> 1; v != 0 && bucket < LATENCY_BUCKETS - 1; v >>= 1) {
+		bucket++;
+	}
+
+	if (hist->count == 0 || us < hist->min_us) {
+		hist->min_us = us;
+	}
+	if (us > hist->max_us) {
+		hist->max_us = us;
+	}
+	hist->sum_us += us;
+	hist->buckets[bucket]++;
+	hist->count++;
+}
+
+void latency_tx_queued(uint32_t end, uint32_t sampled, uint32_t queued) {
+	uint32_t head = latency_tx_head;
+
+	if (head - latency_tx_tail == LATENCY_TX_LINES) {
+		latency_tx_untracked++;
+		return;
+	}
+	latency_tx_line_t *line = &latency_tx_lines[head & (LATENCY_TX_LINES - 1)];
+	line->end = end;
+	line->sampled = sampled;
+	line->queued = queued;
+	latency_tx_head = head + 1;
+}
+
+void latency_tx_sent(uint32_t sent, uint32_t frame_ticks) {
+	uint32_t now = latency_now();
+	uint32_t tail = latency_tx_tail;
+
+	while (tail != latency_tx_head) {
+		const latency_tx_line_t *line = &latency_tx_lines[tail & (LATENCY_TX_LINES - 1)];
+		uint32_t after = sent - line->end;	// Bytes sent after the line's last one
+		if ((int32_t)after < 0) {
+			break;	// Not sent yet; neither is any later line
+		}
+		uint32_t done = now - after * frame_ticks;
+		latency_record(LATENCY_STAGE_TX, line->queued, done);
+		latency_record(LATENCY_STAGE_END_TO_END, line->sampled, done);
+		tail++;
+	}
+	latency_tx_tail = tail;
+}
+
+void latency_get(latency_stage_t stage, latency_histogram_t *out) {
+	*out = latency_hist[stage];
+}
+
+void latency_reset(void) {
+	memset(latency_hist, 0, sizeof(latency_hist));
+}
+
+uint32_t latency_percentile_us(const latency_histogram_t *hist, uint32_t percent) {
+	uint32_t total = 0;
+	uint32_t bucket;
+
+	for (bucket = 0; bucket < LATENCY_BUCKETS; bucket++) {
+		total += hist->buckets[bucket];
+	}
+	if (total == 0) {
+		return 0;
+	}
+
+	// Rank of the percentile sample, rounded up
+	uint32_t rank = (uint32_t)(((uint64_t)total * percent + 99) / 100);
+	uint32_t seen = 0;
+	for (bucket = 0; bucket < LATENCY_BUCKETS - 1; bucket++) {
+		seen += hist->buckets[bucket];
+		if (seen >= rank) {
+			uint32_t bound = 2UL << bucket;
+			return bound < hist->max_us ? bound : hist->max_us;	// No bound beyond the worst case seen
+		}
+	}
+	return hist->max_us;	// Open-ended last bucket
+}
+
+const char *latency_stage_name(latency_stage_t stage) {
+	return stage < LATENCY_STAGES ? latency_names[stage] : "?";
+}
+
+int latency_format(latency_stage_t stage, char *buffer, size_t size) {
+	latency_histogram_t hist;
+
+	latency_get(stage, &hist);
+	return snprintf(buffer, size, "%s %lu/%lu/%luus n=%lu\n\r", latency_stage_name(stage),
+	                (unsigned long)latency_percentile_us(&hist, 50),
+	                (unsigned long)latency_percentile_us(&hist, 99),
+	                (unsigned long)hist.max_us,
+	                (unsigned long)hist.count);
+}
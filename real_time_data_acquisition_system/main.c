@@ -1,9 +1,19 @@
 #include <stdio.h>
+#include <stdarg.h>
 #include "string.h"
 #include "sensor_ADC_driver.h"
 #include "usart2_driver.h"
 #include "button.h"
 #include "led.h"
+#include "msg_pool.h"
+#include "temp_convert.h"
+#include "sample_frame.h"
+#include "sensor_filter.h"
+#include "telemetry.h"
+#include "latency.h"
+#include "bench.h"
+#include "command.h"
+#include "clock_manager.h"
 #include "RTE_Components.h"
 #include CMSIS_device_header
 #include "FreeRTOS.h"
@@ -11,28 +21,151 @@
 #include "queue.h"
 #include "semphr.h"
 #include "trcRecorder.h"
+#ifdef SIMULATION
+#include "sim_hw.h"
+#endif
+
+// Benchmark build: 1 - run the common workload of bench.h from startup and print its report
+#ifndef BENCHMARK
+#define BENCHMARK 0
+#endif
 
 // Constants
-#define QUEUE_LENGTH 1
-#define TEMP_BUFFER_LENGTH 25 
-#define QUEUE_ITEM_SIZE sizeof(uint32_t)
+#define TEMPERATURE_QUEUE_LENGTH SAMPLE_FRAME_QUEUE_DEPTH // Sample frames buffered between acquisition and processing
+#define UART_QUEUE_LENGTH MSG_POOL_BLOCKS // Enough for every pool block to be queued at once
+#define SENSOR_ADC_CHANNEL 6 // PA1 (ADC12_IN6)
+
+// Acquisition mode: 0 - one software-triggered conversion per wakeup, 1 - continuous DMA ping-pong blocks
+#define ACQUISITION_MODE_DMA 1
+
+// DMA mode scan timing: 1 - one scan per TIM6 period at ADC_SCAN_RATE_HZ, 0 - back-to-back conversions
+#define ACQUISITION_TIMER_TRIGGER 1
+#if BENCHMARK
+#define ADC_SCAN_RATE_HZ BENCH_SAMPLE_RATE_HZ
+#else
+#define ADC_SCAN_RATE_HZ 1000 // Scans per second; one scan of the table below takes about 0.3 ms
+#endif
+
+// Filter stage applied to every channel before conversion: median despike window (0 = off),
+// CIC order (1 = boxcar) and decimation ratio (input samples per filtered value)
+// (the benchmark workload converts every sample, unfiltered)
+#if BENCHMARK
+#define FILTER_MEDIAN_WINDOW 0
+#define FILTER_ORDER 1
+#define FILTER_DECIMATION 1
+#else
+#define FILTER_MEDIAN_WINDOW 3
+#define FILTER_ORDER 2
+#define FILTER_DECIMATION (ACQUISITION_MODE_DMA ? 8 : 1)
+#endif
+
+// Hand-off for the button and sample paths: 1 - direct-to-task notifications, 0 - semaphore and queue.
+// Notifications are the default because frames are processed in place instead of being copied through
+// temperatureQ, and button presses are counted. Whether they also wake the tasks sooner has not been
+// measured: compare the "queue" stage of the latency report (the sample hand-off's ISR-to-task wake
+// time in either mode) between the two host builds, rtdas_sim and rtdas_sim_queues, or on the board.
+#ifndef USE_TASK_NOTIFICATIONS
+#define USE_TASK_NOTIFICATIONS 1
+#endif
+#define NOTIFY_FRAME_READY (1UL << 0) // Notification bit of the processing task: frames are waiting
+
+// What the sample path does when processing falls behind (sample_policy_t): BLOCK, DROP_NEWEST,
+// DROP_OLDEST or LATEST (mailbox holding only the newest frame). Interrupt producers and the
+// frame ring cannot wait, so BLOCK only differs from DROP_NEWEST for the queue fed by a task.
+#define SAMPLE_OVERFLOW_POLICY SAMPLE_POLICY_DROP_NEWEST
+
+// Interrupt priority of the ISRs that call into the RTOS (must not be above configMAX_SYSCALL_INTERRUPT_PRIORITY)
+#define RTOS_ISR_PRIORITY 5
+
+// Interval of the sampling and latency statistics report in Log mode (text output only)
+#define STATS_REPORT_PERIOD_MS 10000
+
+// Output format at startup: 0 - text lines, 1 - binary COBS/CRC16 telemetry packets
+#define TELEMETRY_BINARY_DEFAULT 0
+
+// Text output reports the newest filtered temperature at most once per period: a line for every
+// filtered value (ADC_SCAN_RATE_HZ / FILTER_DECIMATION, 125 per second) would be several times
+// what USART2 carries at 9600 baud. Binary telemetry carries every filtered value.
+#if BENCHMARK
+#define TEXT_REPORT_PERIOD_MS 0 // The benchmark workload sends one line per DMA block
+#else
+#define TEXT_REPORT_PERIOD_MS 500
+#endif
+
+// Channels converted in each scan (DMA mode), in conversion order; only the sensor for the benchmark
+#define SCAN_CHANNEL_COUNT (BENCHMARK ? 1 : 3)
+
+#if ACQUISITION_MODE_DMA && (ADC_DMA_BLOCK_SAMPLES > SAMPLE_FRAME_SAMPLES)
+#error "A DMA block must fit into one sample frame"
+#endif
+#if BENCHMARK && !(ACQUISITION_MODE_DMA && ACQUISITION_TIMER_TRIGGER && !TELEMETRY_BINARY_DEFAULT)
+#error "The benchmark workload needs timer-triggered DMA acquisition and text output"
+#endif
+#if BENCHMARK && (ADC_DMA_BLOCK_SAMPLES / SCAN_CHANNEL_COUNT != BENCH_SAMPLES_PER_LINE)
+#error "The benchmark workload sends one line per BENCH_SAMPLES_PER_LINE samples, i.e. per DMA block"
+#endif
+#if BENCHMARK && (configUSE_IDLE_HOOK != 1)
+#error "The benchmark measures idle time in vApplicationIdleHook(): set configUSE_IDLE_HOOK to 1"
+#endif
+#if SCAN_CHANNEL_COUNT > SAMPLE_FRAME_MAX_CHANNELS
+#error "Too many scan channels for one sample frame"
+#endif
+#if (SAMPLE_FRAME_MAX_CHANNELS > TELEMETRY_MAX_ENTRIES) || (TELEMETRY_MAX_FRAME > MSG_BLOCK_SIZE)
+#error "A telemetry packet must hold every frame channel and fit into one message pool block"
+#endif
+
+// Temperature conversion: 1 - fixed-point calibration table, 0 - floating-point formula
+#define TEMP_CONVERSION_FIXED_POINT 1
 
 // Global variables
-uint32_t temperature_C; // temperature in Celsius
-float voltage_raw; // raw voltage value from sensor
-float voltage; // voltage in mV (stored after conversion)
+int32_t temperature_C; // temperature in Celsius
+int32_t temperature_centi_C; // temperature in hundredths of a degree Celsius
+uint32_t adc_code; // raw ADC code from sensor
+uint32_t frame_sequence; // sequence number of the next sample frame
+uint32_t channel_filtered[SAMPLE_FRAME_MAX_CHANNELS]; // latest filtered value per channel, in frame order
+sensor_filter_t channel_filter[SAMPLE_FRAME_MAX_CHANNELS]; // filter state per channel
+uint32_t vdda_mV; // supply voltage derived from VREFINT
+
+#if ACQUISITION_MODE_DMA
+// Scan table: external sensor, internal reference (for VDDA) and internal temperature sensor.
+// The internal channels need a long sampling time (datasheet minimum: 4 us for VREFINT, 5 us
+// for the temperature sensor); 247.5 cycles at 4 MHz is about 62 us. At faster clocks the
+// driver raises it to what the minimum takes (640.5 cycles at 80 MHz).
+static const adc_scan_channel_t scan_table[SCAN_CHANNEL_COUNT] = {
+    { SENSOR_ADC_CHANNEL,     ADC_SMP_640_5 },
+#if !BENCHMARK
+    { ADC_CHANNEL_VREFINT,    ADC_SMP_247_5 },
+    { ADC_CHANNEL_TEMPSENSOR, ADC_SMP_247_5 },
+#endif
+};
+#endif
+
+// Current mode (0 - Idle, 1 - Monitor, 2 - Log); the benchmark acquires from startup
+volatile uint8_t current_mode = BENCHMARK ? 1 : 0;
 
-// Current mode (0 - Idle, 1 - Monitor, 2 - Log)
-volatile uint8_t current_mode = 0;
+// Output format (0 - text, 1 - binary telemetry)
+volatile uint8_t telemetry_binary = TELEMETRY_BINARY_DEFAULT;
+uint16_t telemetry_sequence; // sequence number of the next telemetry packet
 
 //------------------------------------------------------------------------------
 // Function Prototypes
 //------------------------------------------------------------------------------
 void send_string_via_usart(const char *str);
+void send_bytes_via_usart(const uint8_t *data, uint32_t length);
 void sensor_acquisition(void *argument);
 void data_processing(void *argument);
 void button_task(void *argument);
 void uart_logging(void *argument);
+void adc_block_ready(uint32_t block_index);
+void send_const_msg(const char *str);
+void uart_tx_space_available(void);
+void report_baud_rate(void);
+void set_mode(uint8_t mode);
+void command_task(void *argument);
+void uart_rx_ready(void);
+int trace_clock_changed(void);
+int systick_clock_changed(void);
+int cycle_counter_clock_changed(void);
 
 //------------------------------------------------------------------------------
 // Task handles 
@@ -41,50 +174,126 @@ TaskHandle_t SensorTaskHandle;
 TaskHandle_t ProcessingTaskHandle;
 TaskHandle_t ButtonTaskHandle;
 TaskHandle_t UartTaskHandle;
+TaskHandle_t CommandTaskHandle;
 
 //------------------------------------------------------------------------------
 // Queue handles 
 //------------------------------------------------------------------------------
-QueueHandle_t temperatureQ;
+QueueHandle_t temperatureQ; // sample_frame_t items (USE_TASK_NOTIFICATIONS == 0)
 QueueHandle_t uartQ;
 
+#if USE_TASK_NOTIFICATIONS
+sample_frame_ring_t frameRing; // Frames waiting for the processing task
+#endif
+
 //------------------------------------------------------------------------------
 // Semaphore and mutex handle  :: code implements binary semaphore
 //------------------------------------------------------------------------------
 SemaphoreHandle_t ButtonSemaphore;
+SemaphoreHandle_t UartTxSemaphore; // Given by the USART2 TX DMA interrupt when ring space is freed
+
+//------------------------------------------------------------------------------
+// Trace handles :: ISR-to-task wake latency is visible in Tracealyzer as the gap
+// between the ISR event and the woken task starting to run
+//------------------------------------------------------------------------------
+#if (TRC_USE_TRACEALYZER_RECORDER == 1)
+TraceISRHandle_t ButtonISRTrace;
+TraceISRHandle_t AdcBlockISRTrace;
+
+// ISR trace markers, only active once the ISR has been registered (debug sessions with tracing)
+#define TRACE_ISR_BEGIN(handle) do { if (handle) { xTraceISRBegin(handle); } } while (0)
+#define TRACE_ISR_END(handle, yield) do { if (handle) { xTraceISREnd(yield); } } while (0)
+#else
+#define TRACE_ISR_BEGIN(handle)
+#define TRACE_ISR_END(handle, yield)
+#endif
+
+// Task stack depth in words. The host simulation runs each task on a pthread, which needs a
+// much larger stack than the target.
+#ifdef SIMULATION
+#define TASK_STACK(words) ((words) + SIM_TASK_STACK_EXTRA)
+#else
+#define TASK_STACK(words) (words)
+#endif
 
 /**
  * @brief   freeRTOS based temperature data acquisition system.
  */
 int main (void)
 {
+#ifdef SIMULATION
+    sim_hw_init(); // Register model first: the drivers below poll status flags
+#endif
+
     // Configuration
     config_button_pin();
+    NVIC_SetPriority(EXTI0_IRQn, RTOS_ISR_PRIORITY); // The handler calls into the RTOS
     config_EXTI();
     led_gpio_config();
 
     // Initializations
     ADC_Init();
     USART2_Init();
+    USART2_TxInit(uart_tx_space_available);
     SystemCoreClockUpdate();  // Required for FreeRTOS to know the system clock frequency
+    report_baud_rate();
+    latency_init(LATENCY_TICKS_PER_US);
+    bench_init(LATENCY_TICKS_PER_US);
+
+    // Everything timed from the system clock follows clock_set()
+    clock_register(USART2_ClockChanged);
+    clock_register(ADC_ClockChanged);
+    clock_register(systick_clock_changed);
+    clock_register(cycle_counter_clock_changed);
+    clock_register(trace_clock_changed);
 
     // Only enable tracing in debug mode to reduce RAM usage in standalone mode 
     if (CoreDebug->DHCSR & CoreDebug_DHCSR_C_DEBUGEN_Msk) {
         xTraceEnable(TRC_START);
+#if (TRC_USE_TRACEALYZER_RECORDER == 1)
+        xTraceISRRegister("EXTI0 Button", RTOS_ISR_PRIORITY, &ButtonISRTrace);
+        xTraceISRRegister("DMA1 ADC Block", RTOS_ISR_PRIORITY, &AdcBlockISRTrace);
+#endif
     }
 
     led_off(); // LED initial state
 
-    temperatureQ = xQueueCreate(QUEUE_LENGTH, QUEUE_ITEM_SIZE);
-    uartQ = xQueueCreate(QUEUE_LENGTH, QUEUE_ITEM_SIZE);
+    msg_pool_init();
 
-    // Create tasks
-    xTaskCreate(sensor_acquisition, "Sensor Acquisition Task", 100, NULL, 1, &SensorTaskHandle);
-    xTaskCreate(data_processing, "Data Processing Task", 100, NULL, 1, &ProcessingTaskHandle);
-    xTaskCreate(button_task, "Button Task", 100, NULL, 1, &ButtonTaskHandle);
-    xTaskCreate(uart_logging, "UART Logging Task", 200, NULL, 3, &UartTaskHandle);
+    for (uint32_t c = 0; c < SAMPLE_FRAME_MAX_CHANNELS; c++) {
+        sensor_filter_init(&channel_filter[c], FILTER_ORDER, FILTER_DECIMATION, FILTER_MEDIAN_WINDOW);
+    }
+
+#if USE_TASK_NOTIFICATIONS
+    sample_frame_ring_init(&frameRing);
+#else
+    temperatureQ = sample_frame_queue_create(SAMPLE_OVERFLOW_POLICY == SAMPLE_POLICY_LATEST ? 1 : TEMPERATURE_QUEUE_LENGTH);
+#endif
+    uartQ = xQueueCreate(UART_QUEUE_LENGTH, sizeof(uart_msg_t));
 
+    // Created before the tasks, so the ISRs never see a NULL handle
     ButtonSemaphore = xSemaphoreCreateBinary();
+    UartTxSemaphore = xSemaphoreCreateBinary();
+
+#if ACQUISITION_MODE_DMA
+    ADC_DMA_Init(adc_block_ready);
+    ADC_Scan_Configure(scan_table, SCAN_CHANNEL_COUNT);
+#if ACQUISITION_TIMER_TRIGGER
+    ADC_Timer_Init(ADC_SCAN_RATE_HZ);
+#endif
+#endif
+
+    // Create tasks
+    xTaskCreate(sensor_acquisition, "Sensor Acquisition Task", TASK_STACK(200), NULL, 1, &SensorTaskHandle); // snprintf() for the stats report
+    xTaskCreate(data_processing, "Data Processing Task", TASK_STACK(100), NULL, 1, &ProcessingTaskHandle);
+    xTaskCreate(button_task, "Button Task", TASK_STACK(100), NULL, 1, &ButtonTaskHandle);
+    xTaskCreate(uart_logging, "UART Logging Task", TASK_STACK(200), NULL, 3, &UartTaskHandle);
+    xTaskCreate(command_task, "Command Task", TASK_STACK(200), NULL, 1, &CommandTaskHandle); // vsnprintf() for the replies
+    USART2_RxInit(uart_rx_ready); // After the task exists: the callback notifies it
+
+#ifdef SIMULATION
+    sim_hw_start(); // Peripheral models, scripted stimulus and UART capture
+#endif
 
     // Start the Scheduler
     vTaskStartScheduler();
@@ -96,58 +305,481 @@ int main (void)
 // Function Definitions
 //------------------------------------------------------------------------------
 
-// Send string over UART
+// Report the USART2 baud rate actually produced from the current clock, and its error.
+// Queued without waiting (the scheduler may not run yet); also call after a clock change.
+void report_baud_rate(void) {
+    char line[48];
+    snprintf(line, sizeof(line), "USART2: %lu baud, %ld ppm\n\r",
+             (unsigned long)usart2_baud.baud, (long)usart2_baud.error_ppm);
+    USART2_WriteString(line);
+}
+
+// Send string over UART: queue it in the USART2 TX ring, which is drained by DMA.
+// The calling task only blocks while the ring is full, never on the wire itself.
 void send_string_via_usart(const char *str) {
-    while (*str) {
-        while (!(USART2->ISR & USART_ISR_TXE)); // Wait until TXE (Transmit Data Register Empty)
-        USART2->TDR = *str++; // Load the next character into TDR
+    send_bytes_via_usart((const uint8_t *)str, strlen(str));
+}
+
+// Largest piece queued at once. USART2_Write() takes all or nothing, so anything longer than
+// the free ring space would never fit; half the ring also lets the copy overlap the DMA.
+#define UART_TX_CHUNK (USART2_TX_BUFFER_SIZE / 2)
+
+static void send_via_usart(const uint8_t *data, uint32_t length, const uart_msg_t *timed);
+
+// Send binary data over UART, same queuing as send_string_via_usart()
+void send_bytes_via_usart(const uint8_t *data, uint32_t length) {
+    send_via_usart(data, length, NULL);
+}
+
+// Queue 'data' in chunks; a timed message is registered for transmit latency together with
+// its last chunk (see below)
+static void send_via_usart(const uint8_t *data, uint32_t length, const uart_msg_t *timed) {
+    while (length > 0) {
+        uint32_t chunk = (length < UART_TX_CHUNK) ? length : UART_TX_CHUNK;
+        for (;;) {
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            uint32_t written = USART2_Write(data, chunk);
+            if (written && timed != NULL && chunk == length) {
+                latency_tx_queued(USART2_TxHead(), timed->stamp, timed->queued);
+            }
+            __set_PRIMASK(primask);
+            if (written) {
+                break;
+            }
+            xSemaphoreTake(UartTxSemaphore, portMAX_DELAY); // Wait for the DMA to free ring space
+        }
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Clock change notifiers (clock_manager.h) for the timing owned by the application
+//------------------------------------------------------------------------------
+
+// RTOS tick: the port programs SysTick from the clock once, at scheduler start
+int systick_clock_changed(void) {
+    SysTick->LOAD = SystemCoreClock / configTICK_RATE_HZ - 1;
+    SysTick->VAL = 0;
+    return 1;
+}
+
+// Latency and benchmark stamps count core cycles: restart both at the new rate
+int cycle_counter_clock_changed(void) {
+    latency_init(LATENCY_TICKS_PER_US);
+    bench_init(LATENCY_TICKS_PER_US);
+    return 1;
+}
+
+// Trace time stamps count core cycles as well. A streaming session announces the frequency
+// once, when it starts: events recorded at another clock are scaled wrongly in Tracealyzer.
+int trace_clock_changed(void) {
+#if (TRC_USE_TRACEALYZER_RECORDER == 1) && (TRC_CFG_RECORDER_MODE == TRC_RECORDER_MODE_STREAMING)
+    if (xTraceIsRecorderInitialized()) {
+        xTraceTimestampSetFrequency(SystemCoreClock);
+    }
+#endif
+    return 1;
+}
+
+//------------------------------------------------------------------------------
+// Transmit latency: a message reporting samples is stamped when it enters uartQ.
+// The UART task registers it with the TX ring position of its end when writing
+// its last chunk, and the DMA transfer-complete callback closes the measurement
+// once the DMA has handed that byte to the USART (latency_tx_sent() in latency.h),
+// one frame before it has left the wire.
+//------------------------------------------------------------------------------
+
+// Queue a message that reports samples converted at 'stamp'
+static void send_timed_msg(uart_msg_t *msg, uint32_t stamp) {
+    msg->timed = 1;
+    msg->stamp = stamp;
+    msg->queued = latency_now();
+    xQueueSend(uartQ, msg, portMAX_DELAY); // The UART task returns the block to the pool
+}
+
+// Time of one 10-bit frame at the current baud rate, in latency stamp ticks
+static uint32_t usart_frame_ticks(void) {
+    if (usart2_baud.baud == 0) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)LATENCY_TICKS_PER_US * 10000000u / usart2_baud.baud);
+}
+
+// USART2 TX callback (interrupt context): a DMA transfer finished and ring space was freed
+void uart_tx_space_available(void) {
+    BaseType_t priorityStatus = pdFALSE;
+    latency_tx_sent(USART2_TxTail(), usart_frame_ticks());
+    xSemaphoreGiveFromISR(UartTxSemaphore, &priorityStatus);
+    portYIELD_FROM_ISR(priorityStatus);
+}
+
+// Queue a string literal for the UART task (not returned to the message pool)
+void send_const_msg(const char *str) {
+    uart_msg_t msg = { str, MSG_OWNER_CONST, 0, 0, 0, 0 };
+    xQueueSend(uartQ, &msg, portMAX_DELAY);
+}
+
+// Format a message into a pool block and queue it for the UART task
+static void send_formatted_msg(const char *format, ...) {
+    char *block = msg_pool_alloc();
+    if (block == NULL) {
+        send_const_msg("Message pool exhausted\n\r");
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vsnprintf(block, MSG_BLOCK_SIZE, format, args);
+    va_end(args);
+    uart_msg_t msg = { block, MSG_OWNER_POOL, 0, 0, 0, 0 };
+    xQueueSend(uartQ, &msg, portMAX_DELAY); // The UART task returns the block to the pool
+}
+
+//------------------------------------------------------------------------------
+// Sample frame hand-off between acquisition and processing
+// With task notifications, frames are filled in place in frameRing and the
+// processing task is woken by the NOTIFY_FRAME_READY bit. Otherwise one static
+// frame is filled and copied through temperatureQ.
+//------------------------------------------------------------------------------
+
+// Producer: frame to fill, or NULL if the new frame is dropped (counted in sample_frame_drops)
+static sample_frame_t *frame_acquire(void) {
+#if USE_TASK_NOTIFICATIONS
+    return sample_frame_ring_acquire_policy(&frameRing, SAMPLE_OVERFLOW_POLICY);
+#else
+    static sample_frame_t frame;
+    return &frame;
+#endif
+}
+
+// Producer (interrupt context): hand a filled frame to the processing task
+static BaseType_t frame_publish_from_isr(sample_frame_t *frame, BaseType_t *priorityStatus) {
+    frame->stamp_queued = latency_now();
+    latency_record(LATENCY_STAGE_ACQUIRE, frame->stamp_sampled, frame->stamp_queued);
+#if USE_TASK_NOTIFICATIONS
+    sample_frame_ring_commit(&frameRing);
+    return xTaskNotifyFromISR(ProcessingTaskHandle, NOTIFY_FRAME_READY, eSetBits, priorityStatus);
+#else
+    return sample_frame_send_policy_from_isr(temperatureQ, frame, SAMPLE_OVERFLOW_POLICY, priorityStatus);
+#endif
+}
+
+// Producer (task context): hand a filled frame to the processing task
+static BaseType_t frame_publish(sample_frame_t *frame) {
+    frame->stamp_queued = latency_now();
+    latency_record(LATENCY_STAGE_ACQUIRE, frame->stamp_sampled, frame->stamp_queued);
+#if USE_TASK_NOTIFICATIONS
+    sample_frame_ring_commit(&frameRing);
+    return xTaskNotify(ProcessingTaskHandle, NOTIFY_FRAME_READY, eSetBits);
+#else
+    return sample_frame_send_policy(temperatureQ, frame, SAMPLE_OVERFLOW_POLICY, portMAX_DELAY);
+#endif
+}
+
+// Consumer: block until the next frame is available
+static sample_frame_t *frame_wait(void) {
+#if USE_TASK_NOTIFICATIONS && SAMPLE_POLICY_DISCARDS_WAITING(SAMPLE_OVERFLOW_POLICY)
+    // The producer may discard waiting frames: take a copy instead of processing in place
+    static sample_frame_t frame;
+    while (!sample_frame_ring_take(&frameRing, &frame)) {
+        xTaskNotifyWait(0, NOTIFY_FRAME_READY, NULL, portMAX_DELAY);
+    }
+    return &frame;
+#elif USE_TASK_NOTIFICATIONS
+    sample_frame_t *frame;
+    while ((frame = sample_frame_ring_peek(&frameRing)) == NULL) {
+        xTaskNotifyWait(0, NOTIFY_FRAME_READY, NULL, portMAX_DELAY);
+    }
+    return frame;
+#else
+    static sample_frame_t frame;
+    while (!sample_frame_receive(temperatureQ, &frame, portMAX_DELAY)) {
+        send_const_msg("Failed to receive data from Queue\n\r");
+    }
+    return &frame;
+#endif
+}
+
+// Consumer: the frame returned by frame_wait() has been processed
+static void frame_done(void) {
+#if USE_TASK_NOTIFICATIONS && !SAMPLE_POLICY_DISCARDS_WAITING(SAMPLE_OVERFLOW_POLICY)
+    sample_frame_ring_release(&frameRing);
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Statistics report: sampling quality (timer-triggered acquisition), frames
+// dropped by the overflow policy and the latency histograms of every pipeline
+// stage, one message pool block per line. Lines are queued without waiting, so
+// a slow UART never holds up the acquisition task: they are dropped instead.
+//------------------------------------------------------------------------------
+static void report_stats_line(char *block) {
+    uart_msg_t msg = { block, MSG_OWNER_POOL, 0, 0, 0, 0 };
+    if (xQueueSend(uartQ, &msg, 0) != pdPASS) {
+        msg_pool_free(block); // Otherwise the UART task returns the block to the pool
+    }
+}
+
+static void report_stats(void) {
+    char *block;
+
+#if ACQUISITION_MODE_DMA && ACQUISITION_TIMER_TRIGGER
+    adc_jitter_stats_t stats;
+    ADC_Jitter_GetStats(&stats);
+    block = msg_pool_alloc();
+    if (block) {
+        snprintf(block, MSG_BLOCK_SIZE, "Jit %luus late %lu ovr %lu\n\r",
+                 (unsigned long)((uint64_t)stats.jitter_max_cycles * 1000000u / SystemCoreClock),
+                 (unsigned long)stats.late, (unsigned long)adc_ovr_count);
+        report_stats_line(block);
+    }
+#endif
+
+    block = msg_pool_alloc();
+    if (block) {
+        snprintf(block, MSG_BLOCK_SIZE, "Drop %s %lu\n\r", sample_policy_name(SAMPLE_OVERFLOW_POLICY),
+                 (unsigned long)sample_frame_drops[SAMPLE_OVERFLOW_POLICY]);
+        report_stats_line(block);
+    }
+
+    for (uint32_t stage = 0; stage < LATENCY_STAGES; stage++) {
+        block = msg_pool_alloc();
+        if (block == NULL) {
+            break; // Pool exhausted: the rest is reported next time
+        }
+        latency_format((latency_stage_t)stage, block, MSG_BLOCK_SIZE);
+        report_stats_line(block);
+    }
+}
+
+// Called by the acquisition task on every wakeup: report every STATS_REPORT_PERIOD_MS in Log mode
+static void report_stats_when_due(TickType_t *last_report) {
+    if (current_mode == 2 && !telemetry_binary &&
+        xTaskGetTickCount() - *last_report >= pdMS_TO_TICKS(STATS_REPORT_PERIOD_MS)) {
+        *last_report = xTaskGetTickCount();
+        report_stats();
     }
 }
 
+#if BENCHMARK
+volatile uint32_t bench_reports_dropped; // Reports not queued because uartQ was full
+
+// Called by the acquisition task on every wakeup: benchmark report every BENCH_REPORT_PERIOD_MS.
+// Queued without waiting, like the statistics, so the report never stalls the acquisition task.
+static void report_bench_when_due(void) {
+    static char report[BENCH_REPORT_SIZE]; // Queued by reference; rewritten only a whole period later
+    if (bench_due()) {
+        bench_report("freertos", report, sizeof(report));
+        uart_msg_t msg = { report, MSG_OWNER_CONST, 0, 0, 0, 0 };
+        if (xQueueSend(uartQ, &msg, 0) != pdPASS) {
+            bench_reports_dropped++;
+        }
+    }
+}
+#endif
+
+#if (configUSE_IDLE_HOOK == 1)
+// Idle task: sleep until the next interrupt, at the latest the tick, and account the time as idle.
+// Interrupts are masked around WFI (it still wakes on a pending interrupt) so that the handler
+// runs after the idle time is taken, as in the bare-metal variant.
+void vApplicationIdleHook(void) {
+    __disable_irq();
+    uint32_t start = latency_now();
+    __WFI();
+    bench_idle(start, latency_now());
+    __enable_irq();
+}
+#endif
+
+#if ACQUISITION_MODE_DMA
+// Task 1: Sensor data acquisition.
+// Conversions run under DMA (paced by TIM6 in timer mode) while in Monitor or Log mode, so this
+// task only starts and stops the acquisition when the mode changes, and reports the sampling
+// statistics in Log mode.
+void sensor_acquisition(void *argument) {
+    uint8_t running = 0;
+    TickType_t last_report = xTaskGetTickCount();
+    for (;;) {
+        uint8_t active = (current_mode == 1 || current_mode == 2);
+        if (active && !running) {
+            ADC_DMA_Start();
+            running = 1;
+        } else if (!active && running) {
+            ADC_DMA_Stop();
+            running = 0;
+        }
+        report_stats_when_due(&last_report);
+#if BENCHMARK
+        report_bench_when_due();
+#endif
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+}
+
+// DMA block callback (interrupt context): split the filled block into per-channel buffers of a
+// sample frame and hand it to the processing task. The block goes straight back to the DMA once
+// it has been copied.
+void adc_block_ready(uint32_t block_index) {
+    BaseType_t priorityStatus = pdFALSE;
+    TRACE_ISR_BEGIN(AdcBlockISRTrace);
+
+    sample_frame_t *frame = frame_acquire();
+    if (frame == NULL) {
+        ADC_DMA_ReleaseBlock(block_index); // Processing is behind: drop this block
+    } else {
+        frame->count = (uint8_t)ADC_Scan_Deinterleave(ADC_DMA_GetBlock(block_index), frame->samples);
+        frame->stamp_sampled = ADC_DMA_GetBlockStamp(block_index);
+        ADC_DMA_ReleaseBlock(block_index);
+
+        frame->sequence = frame_sequence++;
+        frame->timestamp = xTaskGetTickCountFromISR();
+        frame->channel_count = SCAN_CHANNEL_COUNT;
+        for (uint32_t c = 0; c < SCAN_CHANNEL_COUNT; c++) {
+            frame->channels[c] = scan_table[c].channel;
+        }
+
+        frame_publish_from_isr(frame, &priorityStatus); // Drops are counted by the policy
+    }
+
+    TRACE_ISR_END(AdcBlockISRTrace, priorityStatus);
+    portYIELD_FROM_ISR(priorityStatus); // Trigger context switch if needed
+}
+#else
 // Task 1: Sensor data acquisition.
+// One conversion per wakeup, sent as a single-sample frame.
 void sensor_acquisition(void *argument) {
+    TickType_t last_report = xTaskGetTickCount();
     for (;;) {
         if (current_mode == 1 || current_mode == 2) {  // Monitor or Log mode
 					led_on();
             // Start ADC conversion
             ADC1->CR |= ADC_CR_ADSTART;
 
-            voltage_raw = adc_result;
-            if (!xQueueSend(temperatureQ, &voltage_raw, portMAX_DELAY)) {
-                const char *error_msg = "Failed to send data to Queue\n\r";
-                xQueueSend(uartQ, &error_msg, portMAX_DELAY);
+            adc_code = adc_result;
+            sample_frame_t *frame = frame_acquire();
+            if (frame != NULL) {
+                frame->samples[0] = (uint16_t)adc_code;
+                frame->count = 1;
+                frame->channel_count = 1;
+                frame->channels[0] = SENSOR_ADC_CHANNEL;
+                frame->sequence = frame_sequence++;
+                frame->timestamp = xTaskGetTickCount();
+                frame->stamp_sampled = adc_result_stamp;
+                frame_publish(frame); // Drops are counted by the policy, never reported from here
             }
 
             // Stop ADC conversion
             ADC1->CR &= ~ADC_CR_ADSTART;
         }
+        report_stats_when_due(&last_report);
         vTaskDelay(pdMS_TO_TICKS(500)); // Wait before next read
     }
 }
+#endif
+
+// Convert an ADC code to temperature in hundredths of a degree; timed for the benchmark report
+static int32_t convert_temperature(uint32_t adc_code_received) {
+    uint32_t start = latency_now();
+#if TEMP_CONVERSION_FIXED_POINT
+    int32_t centi_C = temp_code_to_centi_c(adc_code_received);
+#else
+    int32_t centi_C = temp_code_to_centi_c_float(adc_code_received);
+#endif
+    bench_convert(start, latency_now());
+    return centi_C;
+}
+
+// Convert an ADC code to temperature and queue the formatted message for the UART task.
+// 'stamp' is the latency stamp of the samples, carried along for the end-to-end measurement.
+static void report_temperature(uint32_t adc_code_received, uint32_t stamp) {
+    // Calculate temperature
+    temperature_centi_C = convert_temperature(adc_code_received);
+    temperature_C = temperature_centi_C / 100;
+
+    // Format the temperature message into a pool block
+    char *temp_msg = msg_pool_alloc();
+    if (temp_msg) {
+        snprintf(temp_msg, MSG_BLOCK_SIZE, "Temperature: %d C\n\r", (int)temperature_C);
+        uart_msg_t msg = { temp_msg, MSG_OWNER_POOL, 0, 0, 0, 0 };
+        send_timed_msg(&msg, stamp);
+    } else {
+        send_const_msg("Message pool exhausted\n\r");
+    }
+}
+
+// Text output: whether the next temperature line is due (TEXT_REPORT_PERIOD_MS)
+static int text_report_due(void) {
+    static TickType_t last_report;
+    static uint8_t reported;
+    TickType_t now = xTaskGetTickCount();
+    if (reported && now - last_report < pdMS_TO_TICKS(TEXT_REPORT_PERIOD_MS)) {
+        return 0;
+    }
+    last_report = now;
+    reported = 1;
+    return 1;
+}
+
+// Encode the newest value of every channel of a frame as one binary telemetry packet
+static void report_telemetry(const telemetry_packet_t *packet, uint32_t stamp) {
+    char *block = msg_pool_alloc();
+    if (block) {
+        uart_msg_t msg = { block, MSG_OWNER_POOL, 0, 0, 0, 0 };
+        msg.length = (uint8_t)telemetry_encode(packet, (uint8_t *)block);
+        send_timed_msg(&msg, stamp);
+    } else {
+        send_const_msg("Message pool exhausted\n\r");
+    }
+}
 
 // Task 2: Processing the sensor data.
+// Woken once per sample frame, i.e. once per scan block. Each channel runs through its filter
+// (median despike + decimating CIC), and the newest filtered value is converted: into every
+// telemetry packet, or into a text line every TEXT_REPORT_PERIOD_MS.
 void data_processing(void *argument) {
+    static uint16_t filtered[SAMPLE_FRAME_SAMPLES + 1];
+    static telemetry_packet_t packet;
     for (;;) {
-        float voltage_data_received = 0;
-        // Receive data for processing
-        if (!xQueueReceive(temperatureQ, &voltage_data_received, portMAX_DELAY)) {
-            const char *error_msg = "Failed to receive data from Queue\n\r";
-            xQueueSend(uartQ, &error_msg, portMAX_DELAY);
-        } else {
-            // Calculate temperature
-            voltage = (0.00081 * voltage_data_received);
-            temperature_C = (voltage - 0.5) * 100;
-
-            // Format the temperature message
-            char *temp_msg = pvPortMalloc(TEMP_BUFFER_LENGTH * sizeof(char));
-            if (temp_msg) {
-                snprintf(temp_msg, TEMP_BUFFER_LENGTH, "Temperature: %u C\n\r", temperature_C);
-                xQueueSend(uartQ, &temp_msg, portMAX_DELAY); // Send pointer to queue
-            } else {
-                const char *error_msg = "Memory allocation failed for temp_msg\n\r";
-                xQueueSend(uartQ, &error_msg, portMAX_DELAY);
+        // Wait for the next frame; it is processed in place and then released
+        sample_frame_t *frame = frame_wait();
+        uint32_t stamp_start = latency_now();
+        latency_record(LATENCY_STAGE_QUEUE, frame->stamp_queued, stamp_start);
+
+        packet.count = 0;
+        for (uint32_t c = 0; c < frame->channel_count; c++) {
+            uint32_t outputs = sensor_filter_process(&channel_filter[c], SAMPLE_FRAME_CHANNEL(frame, c),
+                                                     frame->count, filtered);
+            if (outputs == 0) {
+                continue; // Not enough samples yet for the next decimated value
             }
+            channel_filtered[c] = filtered[outputs - 1];
+
+            telemetry_entry_t *entry = &packet.entries[packet.count++];
+            entry->channel = frame->channels[c];
+            entry->raw = (uint16_t)channel_filtered[c];
+            entry->value = (int16_t)channel_filtered[c];
+
+            if (frame->channels[c] == SENSOR_ADC_CHANNEL) {
+                if (telemetry_binary) {
+                    entry->value = (int16_t)convert_temperature(channel_filtered[c]);
+                } else if (text_report_due()) {
+                    report_temperature(channel_filtered[c], frame->stamp_sampled);
+                }
+            } else if (frame->channels[c] == ADC_CHANNEL_VREFINT) {
+                vdda_mV = ADC_Vdda_mV(channel_filtered[c]);
+                entry->value = (int16_t)vdda_mV;
+            }
+        }
+
+        if (telemetry_binary && packet.count > 0) {
+            packet.sequence = telemetry_sequence++;
+            packet.timestamp = frame->timestamp;
+            report_telemetry(&packet, frame->stamp_sampled);
         }
+        latency_record(LATENCY_STAGE_PROCESS, stamp_start, latency_now());
+        bench_samples(frame->count * frame->channel_count);
+        frame_done();
 				led_off();
     }
 }
@@ -156,40 +788,54 @@ void data_processing(void *argument) {
 void button_task(void *argument) {
     for (;;) {
         /* Wait for notification from ISR */
+#if USE_TASK_NOTIFICATIONS
+        ulTaskNotifyTake(pdFALSE, portMAX_DELAY); // One mode step per press, presses are counted
+#else
         xSemaphoreTake(ButtonSemaphore, portMAX_DELAY);
+#endif
 
         // Cycle through modes on each button press
-        current_mode = (current_mode + 1) % 3;  // Cycle through modes: 0, 1, 2
-
-        // Indicate the mode change via UART
-        const char *mode_msg;
-        switch (current_mode) {
-            case 0:
-                mode_msg = "Mode: Idle\n\r";
-                led_off();
-                break;
-            case 1:
-                mode_msg = "Mode: Monitor\n\r";
-                led_on();
-                break;
-            case 2:
-                mode_msg = "Mode: Log\n\r";
-                led_on();
-                break;
-            default:
-                mode_msg = "Unknown Mode\n\r";
-                break;
-        }
-        xQueueSend(uartQ, &mode_msg, portMAX_DELAY);
+        set_mode((current_mode + 1) % 3);  // Cycle through modes: 0, 1, 2
     }
 }
 
+// Switch the mode (button or "mode" command) and indicate the change via UART
+void set_mode(uint8_t mode) {
+    current_mode = mode;
+
+    const char *mode_msg;
+    switch (current_mode) {
+        case 0:
+            mode_msg = "Mode: Idle\n\r";
+            led_off();
+            break;
+        case 1:
+            mode_msg = "Mode: Monitor\n\r";
+            led_on();
+            break;
+        case 2:
+            mode_msg = "Mode: Log\n\r";
+            led_on();
+            break;
+        default:
+            mode_msg = "Unknown Mode\n\r";
+            break;
+    }
+    send_const_msg(mode_msg);
+}
+
 // Interrupt Handler for EXTI0 (button press)
 void EXTI0_IRQHandler(void) {
     if ((EXTI->PR1 & EXTI_PR1_PIF0) == EXTI_PR1_PIF0) {
         EXTI->PR1 |= EXTI_PR1_PIF0;  // Clear interrupt flag
         BaseType_t priorityStatus = pdFALSE;
+        TRACE_ISR_BEGIN(ButtonISRTrace);
+#if USE_TASK_NOTIFICATIONS
+        vTaskNotifyGiveFromISR(ButtonTaskHandle, &priorityStatus);
+#else
         xSemaphoreGiveFromISR(ButtonSemaphore, &priorityStatus);
+#endif
+        TRACE_ISR_END(ButtonISRTrace, priorityStatus);
         portYIELD_FROM_ISR(priorityStatus); // Trigger context switch if needed
     }
 }
@@ -197,11 +843,145 @@ void EXTI0_IRQHandler(void) {
 // Task 4: UART logging task.
 void uart_logging(void *argument) {
     for (;;) {
-        char *uart_msg;
+        uart_msg_t uart_msg;
         // Dequeue messages and send via UART
         if (xQueueReceive(uartQ, &uart_msg, portMAX_DELAY)) {
-            send_string_via_usart(uart_msg);
-            vPortFree(uart_msg); // Free memory after use
+            const uint8_t *data = (const uint8_t *)uart_msg.text;
+            uint32_t length = uart_msg.length ? uart_msg.length : strlen(uart_msg.text);
+            send_via_usart(data, length, uart_msg.timed ? &uart_msg : NULL);
+            uart_msg_release(&uart_msg); // Return pool blocks; constant strings are not freed
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Command interface on the USART2 RX line: one command per line, parsed in
+// place in the driver's receive ring (command.h)
+//   mode idle|monitor|log      switch the mode, as the button does
+//   rate [<Hz>]                show or change the scan rate (timer-triggered DMA)
+//   format text|binary         output format
+//   clock [<Hz>]               show or change the system clock (80000000 or an MSI range from 1000000)
+//   stats                      print the statistics report now
+//   help                       list the commands
+//------------------------------------------------------------------------------
+static const char * const mode_names[] = { "idle", "monitor", "log" };
+static const char * const format_names[] = { "text", "binary" };
+
+static command_status_t command_mode(const command_token_t *args, uint32_t argc) {
+    int32_t mode = command_token_select(&args[0], mode_names, 3);
+    if (mode < 0) {
+        return COMMAND_BAD_ARGS;
+    }
+    set_mode((uint8_t)mode);
+    return COMMAND_OK;
+}
+
+static command_status_t command_rate(const command_token_t *args, uint32_t argc) {
+#if ACQUISITION_MODE_DMA && ACQUISITION_TIMER_TRIGGER
+    uint32_t rate;
+    if (argc > 0) {
+        if (!command_token_to_u32(&args[0], &rate)) {
+            return COMMAND_BAD_ARGS;
+        }
+        if (ADC_Timer_SetRate(rate) == 0) {
+            // Past one scan per conversion time, or beyond what TIM6 can divide down to
+            send_formatted_msg("Rate: 1..%lu Hz\n\r", (unsigned long)ADC_Timer_GetMaxRate());
+            return COMMAND_OUT_OF_RANGE;
+        }
+    }
+    send_formatted_msg("Rate: %lu Hz\n\r", (unsigned long)ADC_Timer_GetRate());
+    return COMMAND_OK;
+#else
+    return COMMAND_FAILED; // Scans are not paced by the timer
+#endif
+}
+
+static command_status_t command_format(const command_token_t *args, uint32_t argc) {
+    int32_t format = command_token_select(&args[0], format_names, 2);
+    if (format < 0) {
+        return COMMAND_BAD_ARGS;
+    }
+    telemetry_binary = (uint8_t)format;
+    return COMMAND_OK;
+}
+
+static command_status_t command_clock(const command_token_t *args, uint32_t argc) {
+    uint32_t hz;
+    if (argc > 0) {
+        if (!command_token_to_u32(&args[0], &hz)) {
+            return COMMAND_BAD_ARGS;
+        }
+        if (!clock_set(hz)) {
+            return COMMAND_OUT_OF_RANGE; // Not a producible frequency, or below CLOCK_MIN_HZ
+        }
+    }
+    send_formatted_msg("Clock: %lu Hz\n\r", (unsigned long)clock_get());
+    report_baud_rate();
+    return COMMAND_OK;
+}
+
+static command_status_t command_stats(const command_token_t *args, uint32_t argc) {
+    report_stats();
+    return COMMAND_OK;
+}
+
+static command_status_t command_help(const command_token_t *args, uint32_t argc);
+
+static const command_entry_t command_table[] = {
+    { "mode",   command_mode,   1, 1, "idle|monitor|log" },
+    { "rate",   command_rate,   0, 1, "[<Hz>]" },
+    { "format", command_format, 1, 1, "text|binary" },
+    { "clock",  command_clock,  0, 1, "[<Hz>]" },
+    { "stats",  command_stats,  0, 0, "" },
+    { "help",   command_help,   0, 0, "" },
+};
+#define COMMAND_COUNT (sizeof(command_table) / sizeof(command_table[0]))
+
+static command_status_t command_help(const command_token_t *args, uint32_t argc) {
+    for (uint32_t i = 0; i < COMMAND_COUNT; i++) {
+        send_formatted_msg("%s %s\n\r", command_table[i].name, command_table[i].help);
+    }
+    return COMMAND_OK;
+}
+
+// USART2 RX callback (interrupt context): a line has ended, or the line went idle
+void uart_rx_ready(void) {
+    BaseType_t priorityStatus = pdFALSE;
+    vTaskNotifyGiveFromISR(CommandTaskHandle, &priorityStatus);
+    portYIELD_FROM_ISR(priorityStatus);
+}
+
+// Task 5: execute every complete line, then hand its ring space back to the driver
+void command_task(void *argument) {
+    command_interpreter_t interpreter = { command_table, COMMAND_COUNT, USART2_RxRing(), USART2_RX_BUFFER_SIZE };
+    uint32_t tail = USART2_RxTail();
+    command_status_t status;
+
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        uint32_t head = USART2_RxHead();
+        while (command_next(&interpreter, &tail, head, &status)) {
+            USART2_RxRelease(tail);
+            switch (status) {
+                case COMMAND_UNKNOWN:
+                    send_const_msg("Unknown command, try help\n\r");
+                    break;
+                case COMMAND_BAD_ARGS:
+                    send_const_msg("Invalid arguments\n\r");
+                    break;
+                case COMMAND_OUT_OF_RANGE:
+                    send_const_msg("Out of range\n\r");
+                    break;
+                case COMMAND_FAILED:
+                    send_const_msg("Not available\n\r");
+                    break;
+                case COMMAND_TOO_LONG:
+                    send_const_msg("Line too long\n\r");
+                    break;
+                default:
+                    break;
+            }
         }
     }
 }
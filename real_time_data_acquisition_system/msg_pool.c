@@ -0,0 +1,90 @@
+#include "msg_pool.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+//------------------------------------------------------------------------------
+// Static message pool
+// The free blocks form a singly linked list threaded through msg_pool_next[],
+// so allocation and release are a pop/push on the list head. Both run inside a
+// short interrupt-masking critical section, which works from task and ISR context.
+// An allocated block is marked MSG_POOL_IN_USE in msg_pool_next[], which lets
+// msg_pool_free() catch a block released twice.
+//------------------------------------------------------------------------------
+#define MSG_POOL_NONE   0xFFU
+#define MSG_POOL_IN_USE 0xFEU
+
+static char msg_pool_blocks[MSG_POOL_BLOCKS][MSG_BLOCK_SIZE];
+static uint8_t msg_pool_next[MSG_POOL_BLOCKS];
+static uint8_t msg_pool_head = MSG_POOL_NONE;
+static msg_pool_stats_t msg_pool_stats;
+
+void msg_pool_init(void) {
+	for (uint32_t i = 0; i < MSG_POOL_BLOCKS; i++) {
+		msg_pool_next[i] = (i + 1 < MSG_POOL_BLOCKS) ? (uint8_t)(i + 1) : MSG_POOL_NONE;
+	}
+	msg_pool_head = 0;
+	msg_pool_stats.in_use = 0;
+	msg_pool_stats.high_water = 0;
+	msg_pool_stats.exhausted = 0;
+}
+
+char *msg_pool_alloc(void) {
+	char *block = NULL;
+	UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+
+	if (msg_pool_head != MSG_POOL_NONE) {
+		uint8_t index = msg_pool_head;
+		msg_pool_head = msg_pool_next[index];
+		msg_pool_next[index] = MSG_POOL_IN_USE;
+		block = msg_pool_blocks[index];
+
+		msg_pool_stats.in_use++;
+		if (msg_pool_stats.in_use > msg_pool_stats.high_water) {
+			msg_pool_stats.high_water = msg_pool_stats.in_use;
+		}
+	} else {
+		msg_pool_stats.exhausted++;
+	}
+
+	taskEXIT_CRITICAL_FROM_ISR(saved);
+	return block;
+}
+
+void msg_pool_free(char *block) {
+	uintptr_t offset = (uintptr_t)block - (uintptr_t)msg_pool_blocks;
+
+	// Reject anything that is not the start of a pool block
+	int in_pool = (uintptr_t)block >= (uintptr_t)msg_pool_blocks &&
+	              offset < sizeof(msg_pool_blocks) && (offset % MSG_BLOCK_SIZE) == 0;
+	configASSERT(in_pool);
+	if (!in_pool) {
+		return;
+	}
+
+	uint8_t index = (uint8_t)(offset / MSG_BLOCK_SIZE);
+	UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+
+	// A block already on the free list would be linked in twice and handed out twice
+	configASSERT(msg_pool_next[index] == MSG_POOL_IN_USE);
+	if (msg_pool_next[index] != MSG_POOL_IN_USE) {
+		taskEXIT_CRITICAL_FROM_ISR(saved);
+		return;
+	}
+
+	msg_pool_next[index] = msg_pool_head;
+	msg_pool_head = index;
+	msg_pool_stats.in_use--;
+	taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+void uart_msg_release(const uart_msg_t *msg) {
+	if (msg->owner == MSG_OWNER_POOL) {
+		msg_pool_free((char *)msg->text);
+	}
+}
+
+void msg_pool_get_stats(msg_pool_stats_t *stats) {
+	UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+	*stats = msg_pool_stats;
+	taskEXIT_CRITICAL_FROM_ISR(saved);
+}
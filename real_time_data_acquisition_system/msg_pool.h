@@ -0,0 +1,50 @@
+#ifndef __MSG_POOL_H
+#define __MSG_POOL_H
+
+#include <stdint.h>
+
+// Pool geometry: fixed-size blocks for formatted UART messages
+#define MSG_POOL_BLOCKS  8
+#define MSG_BLOCK_SIZE   32
+
+// Who owns the text of a queued message
+typedef enum {
+	MSG_OWNER_POOL = 0,	// Block taken from the message pool, returned after transmission
+	MSG_OWNER_CONST		// String literal in flash, never freed
+} msg_owner_t;
+
+// Item carried by uartQ
+typedef struct {
+	const char *text;
+	uint8_t owner;		// msg_owner_t
+	uint8_t length;		// Bytes to send for binary data, 0 for NUL-terminated text
+	uint8_t timed;		// 1 if the stamps below are valid (the message reports samples)
+	uint32_t stamp;		// Latency stamp of the samples reported
+	uint32_t queued;	// Latency stamp of the entry into uartQ
+} uart_msg_t;
+
+// Pool usage counters
+typedef struct {
+	uint32_t in_use;	// Blocks currently allocated
+	uint32_t high_water;	// Largest number of blocks allocated at the same time
+	uint32_t exhausted;	// Allocations that failed because the pool was empty
+} msg_pool_stats_t;
+
+// Build the free list. Must be called before the first allocation.
+void msg_pool_init(void);
+
+// Take a block of MSG_BLOCK_SIZE bytes; returns NULL when the pool is exhausted.
+// O(1) and safe to call from tasks and interrupts.
+char *msg_pool_alloc(void);
+
+// Return a block to the pool. Pointers that do not belong to the pool and blocks that are
+// already free fail configASSERT(), and are ignored when assertions are compiled out.
+void msg_pool_free(char *block);
+
+// Release a dequeued message: pool blocks go back to the pool, constant strings are left alone
+void uart_msg_release(const uart_msg_t *msg);
+
+// Snapshot of the usage counters
+void msg_pool_get_stats(msg_pool_stats_t *stats);
+
+#endif /* __MSG_POOL_H */
@@ -0,0 +1,161 @@
+#include "sample_frame.h"
+#include "stm32l476xx.h"
+#include <string.h>
+
+volatile uint32_t sample_frame_drops[SAMPLE_POLICIES];
+
+static const char * const sample_policy_names[SAMPLE_POLICIES] = {
+	"block", "drop-newest", "drop-oldest", "latest"
+};
+
+const char *sample_policy_name(sample_policy_t policy) {
+	return policy < SAMPLE_POLICIES ? sample_policy_names[policy] : "?";
+}
+
+QueueHandle_t sample_frame_queue_create(UBaseType_t depth) {
+	return xQueueCreate(depth, sizeof(sample_frame_t));
+}
+
+BaseType_t sample_frame_send(QueueHandle_t queue, const sample_frame_t *frame, TickType_t wait) {
+	return xQueueSend(queue, frame, wait);
+}
+
+BaseType_t sample_frame_send_from_isr(QueueHandle_t queue, const sample_frame_t *frame, BaseType_t *higher_priority_woken) {
+	return xQueueSendFromISR(queue, frame, higher_priority_woken);
+}
+
+BaseType_t sample_frame_receive(QueueHandle_t queue, sample_frame_t *frame, TickType_t wait) {
+	return xQueueReceive(queue, frame, wait);
+}
+
+//------------------------------------------------------------------------------
+// Overflow policies on a queue
+// Drop-oldest receives the oldest item into a scratch frame to make room. The
+// consumer may empty the queue in between, so the send is simply retried.
+//------------------------------------------------------------------------------
+static sample_frame_t sample_frame_scratch;	// Discarded frames (one producer)
+
+BaseType_t sample_frame_send_policy(QueueHandle_t queue, const sample_frame_t *frame,
+                                    sample_policy_t policy, TickType_t wait) {
+	switch (policy) {
+		case SAMPLE_POLICY_DROP_OLDEST:
+			while (xQueueSend(queue, frame, 0) != pdPASS) {
+				if (xQueueReceive(queue, &sample_frame_scratch, 0) == pdPASS) {
+					sample_frame_drops[policy]++;
+				}
+			}
+			return pdPASS;
+		case SAMPLE_POLICY_LATEST:
+			if (uxQueueMessagesWaiting(queue) != 0) {
+				sample_frame_drops[policy]++;
+			}
+			return xQueueOverwrite(queue, frame);
+		case SAMPLE_POLICY_DROP_NEWEST:
+			wait = 0;
+			break;
+		default:
+			break;
+	}
+	if (xQueueSend(queue, frame, wait) != pdPASS) {
+		sample_frame_drops[policy]++;
+		return pdFALSE;
+	}
+	return pdPASS;
+}
+
+BaseType_t sample_frame_send_policy_from_isr(QueueHandle_t queue, const sample_frame_t *frame,
+                                             sample_policy_t policy, BaseType_t *higher_priority_woken) {
+	switch (policy) {
+		case SAMPLE_POLICY_DROP_OLDEST:
+			while (xQueueSendFromISR(queue, frame, higher_priority_woken) != pdPASS) {
+				if (xQueueReceiveFromISR(queue, &sample_frame_scratch, higher_priority_woken) == pdPASS) {
+					sample_frame_drops[policy]++;
+				}
+			}
+			return pdPASS;
+		case SAMPLE_POLICY_LATEST:
+			if (uxQueueMessagesWaitingFromISR(queue) != 0) {
+				sample_frame_drops[policy]++;
+			}
+			return xQueueOverwriteFromISR(queue, frame, higher_priority_woken);
+		default:
+			break;
+	}
+	// Block and drop-newest alike: an interrupt cannot wait
+	if (xQueueSendFromISR(queue, frame, higher_priority_woken) != pdPASS) {
+		sample_frame_drops[policy]++;
+		return pdFALSE;
+	}
+	return pdPASS;
+}
+
+//------------------------------------------------------------------------------
+// Frame ring
+// head and tail are free-running counters, each written by one side only. The
+// memory barrier keeps the frame contents ordered before the index update that
+// publishes (or frees) the slot.
+// The exception are the policies that discard waiting frames: the producer then
+// advances tail itself. It does so with interrupts masked, and the consumer takes
+// frames out with interrupts masked (sample_frame_ring_take()), so a frame is
+// never discarded while it is being read.
+//------------------------------------------------------------------------------
+void sample_frame_ring_init(sample_frame_ring_t *ring) {
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+sample_frame_t *sample_frame_ring_acquire(sample_frame_ring_t *ring) {
+	if (ring->head - ring->tail >= SAMPLE_FRAME_QUEUE_DEPTH) {
+		return NULL;
+	}
+	return &ring->frames[ring->head % SAMPLE_FRAME_QUEUE_DEPTH];
+}
+
+sample_frame_t *sample_frame_ring_acquire_policy(sample_frame_ring_t *ring, sample_policy_t policy) {
+	if (SAMPLE_POLICY_DISCARDS_WAITING(policy)) {
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		uint32_t waiting = ring->head - ring->tail;
+		uint32_t discard = (policy == SAMPLE_POLICY_LATEST) ? waiting :
+		                   (waiting >= SAMPLE_FRAME_QUEUE_DEPTH) ? waiting - SAMPLE_FRAME_QUEUE_DEPTH + 1 : 0;
+		ring->tail += discard;
+		sample_frame_drops[policy] += discard;
+		__set_PRIMASK(primask);
+	}
+
+	sample_frame_t *frame = sample_frame_ring_acquire(ring);
+	if (frame == NULL) {
+		sample_frame_drops[policy]++;
+	}
+	return frame;
+}
+
+void sample_frame_ring_commit(sample_frame_ring_t *ring) {
+	portMEMORY_BARRIER();
+	ring->head++;
+}
+
+sample_frame_t *sample_frame_ring_peek(sample_frame_ring_t *ring) {
+	if (ring->head == ring->tail) {
+		return NULL;
+	}
+	portMEMORY_BARRIER();
+	return &ring->frames[ring->tail % SAMPLE_FRAME_QUEUE_DEPTH];
+}
+
+void sample_frame_ring_release(sample_frame_ring_t *ring) {
+	portMEMORY_BARRIER();
+	ring->tail++;
+}
+
+int sample_frame_ring_take(sample_frame_ring_t *ring, sample_frame_t *frame) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	int taken = (ring->head != ring->tail);
+	if (taken) {
+		memcpy(frame, &ring->frames[ring->tail % SAMPLE_FRAME_QUEUE_DEPTH], sizeof(*frame));
+		ring->tail++;
+	}
+	__set_PRIMASK(primask);
+	return taken;
+}
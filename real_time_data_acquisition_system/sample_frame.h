@@ -0,0 +1,94 @@
+#ifndef __SAMPLE_FRAME_H
+#define __SAMPLE_FRAME_H
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "queue.h"
+
+// Samples carried by one frame (all channels together), channels per frame,
+// and default number of frames a queue can hold
+#define SAMPLE_FRAME_SAMPLES       32
+#define SAMPLE_FRAME_MAX_CHANNELS  4
+#define SAMPLE_FRAME_QUEUE_DEPTH   4
+
+// A batch of consecutive samples from one or more ADC channels plus metadata.
+// One queue item carries a whole frame, so the send/receive cost is paid once per frame.
+// The per-channel buffers are stored back to back: channel c starts at samples[c * count].
+typedef struct {
+	uint32_t sequence;	// Frame counter, incremented by the producer for every frame
+	TickType_t timestamp;	// Tick count when the frame was completed
+	uint32_t stamp_sampled;	// Latency stamp (latency_now()) of the newest conversion
+	uint32_t stamp_queued;	// Latency stamp of the hand-off to the processing task
+	uint8_t channel_count;	// Number of per-channel buffers (1 for single-channel acquisition)
+	uint8_t count;		// Samples per channel
+	uint8_t channels[SAMPLE_FRAME_MAX_CHANNELS];	// ADC input channel of each buffer
+	uint16_t samples[SAMPLE_FRAME_SAMPLES];
+} sample_frame_t;
+
+// Per-channel buffer 'index' of a frame
+#define SAMPLE_FRAME_CHANNEL(frame, index)  (&(frame)->samples[(index) * (frame)->count])
+
+// Overflow policy of the sample path: what the producer does when the processing side is behind
+typedef enum {
+	SAMPLE_POLICY_BLOCK = 0,	// Wait for room (tasks only: an interrupt cannot wait and drops the new frame)
+	SAMPLE_POLICY_DROP_NEWEST,	// Discard the new frame
+	SAMPLE_POLICY_DROP_OLDEST,	// Discard the oldest waiting frame to make room
+	SAMPLE_POLICY_LATEST,		// Keep only the newest frame: mailbox of depth 1 (xQueueOverwrite)
+	SAMPLE_POLICIES
+} sample_policy_t;
+
+// Policies under which the producer discards frames that are already waiting
+#define SAMPLE_POLICY_DISCARDS_WAITING(policy) \
+	((policy) == SAMPLE_POLICY_DROP_OLDEST || (policy) == SAMPLE_POLICY_LATEST)
+
+// Frames discarded, counted under the policy that discarded them
+extern volatile uint32_t sample_frame_drops[SAMPLE_POLICIES];
+
+// Short policy name for reports
+const char *sample_policy_name(sample_policy_t policy);
+
+// Create a queue holding 'depth' frames; SAMPLE_POLICY_LATEST needs a depth of 1
+QueueHandle_t sample_frame_queue_create(UBaseType_t depth);
+
+// Send/receive a whole frame (copied by value into/out of the queue storage)
+BaseType_t sample_frame_send(QueueHandle_t queue, const sample_frame_t *frame, TickType_t wait);
+BaseType_t sample_frame_send_from_isr(QueueHandle_t queue, const sample_frame_t *frame, BaseType_t *higher_priority_woken);
+BaseType_t sample_frame_receive(QueueHandle_t queue, sample_frame_t *frame, TickType_t wait);
+
+// Send a frame under an overflow policy, counting what is dropped. Returns pdFALSE if the new
+// frame was dropped. 'wait' only applies to SAMPLE_POLICY_BLOCK. Single producer per queue.
+BaseType_t sample_frame_send_policy(QueueHandle_t queue, const sample_frame_t *frame,
+                                    sample_policy_t policy, TickType_t wait);
+BaseType_t sample_frame_send_policy_from_isr(QueueHandle_t queue, const sample_frame_t *frame,
+                                             sample_policy_t policy, BaseType_t *higher_priority_woken);
+
+// Single-producer/single-consumer ring of frames, for hand-off by task notification instead of a
+// queue. Frames are filled and read in place: no copy into or out of kernel-owned storage.
+typedef struct {
+	sample_frame_t frames[SAMPLE_FRAME_QUEUE_DEPTH];
+	volatile uint32_t head;	// Frames committed by the producer
+	volatile uint32_t tail;	// Frames released by the consumer
+} sample_frame_ring_t;
+
+void sample_frame_ring_init(sample_frame_ring_t *ring);
+
+// Producer: slot to fill, or NULL if the ring is full; commit publishes the filled slot
+sample_frame_t *sample_frame_ring_acquire(sample_frame_ring_t *ring);
+void sample_frame_ring_commit(sample_frame_ring_t *ring);
+
+// Producer: slot to fill under an overflow policy, or NULL (counted as a drop). When the ring is
+// full, SAMPLE_POLICY_DROP_OLDEST discards the oldest waiting frame; SAMPLE_POLICY_LATEST
+// discards every waiting frame, so at most one is ever waiting. BLOCK does not wait here and
+// returns NULL like DROP_NEWEST; a task producer may retry.
+// With the policies that discard waiting frames, the consumer must use sample_frame_ring_take().
+sample_frame_t *sample_frame_ring_acquire_policy(sample_frame_ring_t *ring, sample_policy_t policy);
+
+// Consumer: oldest committed frame, or NULL if the ring is empty; release frees its slot
+sample_frame_t *sample_frame_ring_peek(sample_frame_ring_t *ring);
+void sample_frame_ring_release(sample_frame_ring_t *ring);
+
+// Consumer: copy the oldest committed frame out and free its slot at once, with interrupts
+// masked so that the producer cannot discard it halfway. Returns 0 if the ring is empty.
+int sample_frame_ring_take(sample_frame_ring_t *ring, sample_frame_t *frame);
+
+#endif /* __SAMPLE_FRAME_H */
@@ -1,8 +1,12 @@
 #include "sensor_ADC_driver.h"
+#include "latency.h"
 #include "stm32l476xx.h"
 #include <stdint.h>
 
 volatile uint32_t adc_result = 0; //Definition of global variable 'adc_result' declared in "ADC.h"
+volatile uint32_t adc_result_stamp = 0;
+
+static void ADC_DMA_Overrun(void);
 
 //-------------------------------------------------------------------------------------------
 // ADC1 Wakeup
@@ -26,10 +30,10 @@ void ADC1_Wakeup (void) {
 	
 	// 3. Wait for ADC voltage regulator start-up time (T_ADCVREG_STUP) 
 	//    T_ADCVREG_STUP for STM32L476x MCUs is 20 us
-	//    The default processor clock is 4MHz provided by MSI. 
+	//    The loop count follows the current processor clock (SystemCoreClock), 4MHz MSI after reset.
   //    Note: The following implementation for generating a 20 us delay is not optimally precise.
   //    It is, however, adequate for satisfying the minimum required start-up time.
-	wait_time = 20 * (4000000 / 1000000);
+	wait_time = 20 * (SystemCoreClock / 1000000);
 	while(wait_time != 0) {
 		wait_time--;
 	} 
@@ -50,7 +54,8 @@ void ADC_Common_Configuration(){
 	//   -10: HCLK/2 (Synchronous clock mode)
 	//   -11: HCLK/4 (Synchronous clock mode)	 
 	//   In this sample, HCLK/1 (01) is selected, meaning that the ADC input clock is 
-	//	 synchronous to AHB clock, equivalent to the default processor clock 4MHz
+	//	 synchronous to AHB clock: 4MHz MSI after reset, up to 80MHz (the ADC maximum) with the
+	//	 clock manager. Sampling times are set in ADC clock cycles, so they get shorter as HCLK rises.
 	ADC123_COMMON->CCR &= ~ADC_CCR_CKMODE;   //clear both bits first
 	ADC123_COMMON->CCR |=  ADC_CCR_CKMODE_0; // set CKMODE[1:0] to 01
 	//ADC123_COMMON->CCR |=  ADC_CCR_CKMODE_1 | ADC_CCR_CKMODE_0; // set CKMODE[1:0] to 11
@@ -58,6 +63,7 @@ void ADC_Common_Configuration(){
 	// 2. Configure the ADC clock prescaler through ADC_CCR register, field PRESC[3:0]
 	//    ADC_CCR register, field PRESC[3:0] values:
 	//    -0000: input ADC clock not divided
+	//    PRESC only divides the asynchronous clock (CKMODE = 00), so it has no effect here
   //    For information about other configuration values, refer to the reference manual	
 	ADC123_COMMON->CCR &= ~ADC_CCR_PRESC; 
 	ADC123_COMMON->CCR |= ADC_CCR_PRESC_3 | ADC_CCR_PRESC_1 | ADC_CCR_PRESC_0 ; //divided by 256
@@ -177,18 +183,645 @@ void ADC_Init(void){
 //-------------------------------------------------------------------------------------------
 void ADC1_2_IRQHandler(void){    
 	
+	// Overrun: a conversion result was not read (by the DMA) before the next one completed
+	if ((ADC1->ISR & ADC_ISR_OVR) == ADC_ISR_OVR) {
+		ADC1->ISR |= ADC_ISR_OVR;
+		ADC_DMA_Overrun();
+	}
+	
 	// Check if the interrupt is triggered by ADC1 End of Conversion (EOC) 
-	if ((ADC1->ISR & ADC_ISR_EOC) == ADC_ISR_EOC) {
+	// (only while EOC is enabled: with DMA acquisition DR belongs to the DMA)
+	if ((ADC1->IER & ADC_IER_EOC) && (ADC1->ISR & ADC_ISR_EOC) == ADC_ISR_EOC) {
 		
 	// Clear the interrupt by writing 1 to it or by reading the corresponding ADC1_DR register
   ADC1->ISR |= ADC_ISR_EOC;
 	// Read the sampled data from ADC1_DR and store it in the global variable 'adc_result'
 	adc_result = ADC1->DR;
+	adc_result_stamp = latency_now();
+	}
+
+}
+
+
+//-------------------------------------------------------------------------------------------
+// 	DMA ping-pong acquisition
+//  DMA1 Channel 1 (request 0 = ADC1) copies every conversion into adc_dma_buffer in circular
+//  mode. The buffer is split into two blocks: the half-transfer interrupt hands out block 0
+//  while the DMA fills block 1, the transfer-complete interrupt hands out block 1 while the
+//  DMA wraps around to block 0. The CPU is therefore interrupted once per block instead of
+//  once per conversion.
+//-------------------------------------------------------------------------------------------
+static uint16_t adc_dma_buffer[ADC_DMA_BUFFER_SAMPLES];
+static uint32_t adc_dma_block_length = ADC_DMA_BLOCK_SAMPLES;	// Samples per block, a whole number of scans
+static volatile uint8_t adc_dma_block_owned[2];	// 1 while a block is held by the consumer
+static uint32_t adc_dma_block_stamp[2];			// Latency stamp of each block's completion
+static adc_block_callback_t adc_block_callback;
+
+volatile uint32_t adc_dma_block_count = 0;
+volatile uint32_t adc_dma_overrun_count = 0;
+volatile uint32_t adc_ovr_count = 0;
+
+static uint8_t adc_timer_triggered;	// 1 once ADC_Timer_Init() has selected the TIM6 trigger
+static void ADC_Jitter_Sample(void);
+static void ADC_Jitter_Restart(void);
+static void ADC_Scan_WriteSamplingTimes(void);
+static void ADC_DMA_Restart(void);
+
+//-------------------------------------------------------------------------------------------
+// 	Configure DMA1 Channel 1 and ADC1 for continuous conversions into the ping-pong buffer.
+//  Must be called after ADC_Init() and while no conversion is ongoing (ADSTART = 0).
+//-------------------------------------------------------------------------------------------
+void ADC_DMA_Init(adc_block_callback_t callback){
+	
+	adc_block_callback = callback;
+	
+	// 1. Enable the clock of DMA1
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+	
+	// 2. Disable the channel: CPAR, CMAR and CNDTR can only be written while EN = 0
+	DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+	
+	// 3. Route request 0 (ADC1) to DMA1 Channel 1 via DMA1_CSELR, field C1S[3:0] = 0000
+	DMA1_CSELR->CSELR &= ~DMA_CSELR_C1S;
+	
+	// 4. Source (ADC1 data register), destination (sample buffer) and number of transfers
+	DMA1_Channel1->CPAR  = (uint32_t) &ADC1->DR;
+	DMA1_Channel1->CMAR  = (uint32_t) adc_dma_buffer;
+	DMA1_Channel1->CNDTR = 2 * adc_dma_block_length;
+	
+	// 5. Channel configuration
+	//    DIR = 0: read from peripheral;  CIRC = 1: circular mode
+	//    PINC = 0, MINC = 1: fixed peripheral address, incremented memory address
+	//    PSIZE = MSIZE = 01: 16-bit transfers
+	//    HTIE, TCIE: interrupt on half transfer (block 0 full) and transfer complete (block 1 full)
+	DMA1_Channel1->CCR = DMA_CCR_CIRC | DMA_CCR_MINC | DMA_CCR_PSIZE_0 | DMA_CCR_MSIZE_0 |
+	                     DMA_CCR_HTIE | DMA_CCR_TCIE;
+	
+	// The handler calls into the RTOS, so its priority must be numerically at or above
+	// configMAX_SYSCALL_INTERRUPT_PRIORITY (the NVIC reset priority 0 is not allowed).
+	NVIC_SetPriority(DMA1_Channel1_IRQn, 5);
+	NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+	
+	// 6. Samples are collected by the DMA, so the per-conversion interrupt is no longer needed.
+	//    The overrun interrupt stays enabled to count conversions lost by the DMA.
+	ADC1->IER &= ~ADC_IER_EOC;
+	ADC1->IER |= ADC_IER_OVR;
+	
+	// 7. Sampling time of channel 6: SMP6[2:0] = 111 (640.5 ADC clock cycles)
+	//    With the 4 MHz ADC clock one conversion takes (640.5 + 12.5) / 4 MHz = 163 us,
+	//    i.e. about 6.1 kHz in continuous mode.
+	ADC1->SMPR1 |= ADC_SMPR1_SMP6;
+	
+	// 8. DMAEN = 1: generate a DMA request per conversion
+	//    DMACFG = 1: DMA circular mode (requests keep coming after the last transfer)
+	//    CONT = 1: continuous conversion mode
+	ADC1->CFGR |= ADC_CFGR_DMAEN | ADC_CFGR_DMACFG | ADC_CFGR_CONT;
+}
+
+// Start continuous conversions; the first block handed out is always block 0
+void ADC_DMA_Start(void){
+	adc_dma_block_owned[0] = 0;
+	adc_dma_block_owned[1] = 0;
+	
+	DMA1_Channel1->CNDTR = 2 * adc_dma_block_length;
+	DMA1->IFCR = DMA_IFCR_CGIF1;		// Clear any stale channel 1 flags
+	DMA1_Channel1->CCR |= DMA_CCR_EN;
+	
+	ADC1->ISR |= ADC_ISR_OVR;
+	ADC1->CR |= ADC_CR_ADSTART;		// Timer mode: the ADC now waits for the first trigger
+	
+	if (adc_timer_triggered) {
+		ADC_Jitter_Restart();
+		TIM6->CNT = 0;
+		TIM6->CR1 |= TIM_CR1_CEN;
+	}
+}
+
+// Stop conversions and the DMA channel
+void ADC_DMA_Stop(void){
+	if (adc_timer_triggered) {
+		TIM6->CR1 &= ~TIM_CR1_CEN;
+	}
+	
+	ADC1->CR |= ADC_CR_ADSTP;
+	while((ADC1->CR & ADC_CR_ADSTART) == ADC_CR_ADSTART); // ADSTART is cleared once the ADC has stopped
+	
+	DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+}
+
+// Address of the samples of a block handed out by the block callback
+const uint16_t *ADC_DMA_GetBlock(uint32_t block_index){
+	return &adc_dma_buffer[block_index * adc_dma_block_length];
+}
+
+// Number of samples in each block
+uint32_t ADC_DMA_GetBlockLength(void){
+	return adc_dma_block_length;
+}
+
+// Latency stamp of the last conversion of a block
+uint32_t ADC_DMA_GetBlockStamp(uint32_t block_index){
+	return adc_dma_block_stamp[block_index];
+}
+
+// Give a block back to the driver once its samples have been consumed
+void ADC_DMA_ReleaseBlock(uint32_t block_index){
+	adc_dma_block_owned[block_index] = 0;
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Block hand-off, called from the DMA interrupt when a block has been filled.
+//  If the consumer still holds the block from the previous round, the DMA has just overwritten
+//  samples that were in use: count an overrun and do not hand the same block out twice.
+//-------------------------------------------------------------------------------------------
+static void ADC_DMA_BlockComplete(uint32_t block_index){
+	adc_dma_block_count++;
+	if (adc_timer_triggered) {
+		ADC_Jitter_Sample();
 	}
+	
+	if (adc_dma_block_owned[block_index]) {
+		adc_dma_overrun_count++;
+		return;
+	}
+	
+	adc_dma_block_owned[block_index] = 1;
+	adc_dma_block_stamp[block_index] = latency_now();	// The last conversion just landed
+	if (adc_block_callback) {
+		adc_block_callback(block_index);
+	}
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Overrun recovery, called from the ADC interrupt.
+//  With OVRMOD = 0 the ADC stops issuing DMA requests after an overrun, and the lost
+//  conversion would shift every later sample to the wrong scan channel. Restart the sequence
+//  and the DMA from the start of block 0 so the buffer is aligned to the scan again. The
+//  blocks held by the consumer are left alone; an in-flight block is simply refilled.
+//-------------------------------------------------------------------------------------------
+static void ADC_DMA_Overrun(void){
+	adc_ovr_count++;
+	
+	ADC1->CR |= ADC_CR_ADSTP;
+	while((ADC1->CR & ADC_CR_ADSTART) == ADC_CR_ADSTART);
+	ADC_DMA_Restart();
+}
+
+// Start the stopped sequence again, with the DMA from the start of block 0
+static void ADC_DMA_Restart(void){
+	DMA1_Channel1->CCR &= ~DMA_CCR_EN;
+	DMA1_Channel1->CNDTR = 2 * adc_dma_block_length;
+	DMA1->IFCR = DMA_IFCR_CGIF1;
+	DMA1_Channel1->CCR |= DMA_CCR_EN;
+	
+	ADC1->ISR |= ADC_ISR_OVR;
+	ADC1->CR |= ADC_CR_ADSTART;
+	if (adc_timer_triggered) {
+		ADC_Jitter_Restart();	// The next block interval includes the restart
+	}
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Interrupt Handler for DMA1 Channel 1 (ADC1)
+//-------------------------------------------------------------------------------------------
+void DMA1_Channel1_IRQHandler(void){
+	
+	// Half transfer: block 0 is full, the DMA continues with block 1
+	if ((DMA1->ISR & DMA_ISR_HTIF1) == DMA_ISR_HTIF1) {
+		DMA1->IFCR = DMA_IFCR_CHTIF1;
+		ADC_DMA_BlockComplete(0);
+	}
+	
+	// Transfer complete: block 1 is full, the DMA wraps around to block 0
+	if ((DMA1->ISR & DMA_ISR_TCIF1) == DMA_ISR_TCIF1) {
+		DMA1->IFCR = DMA_IFCR_CTCIF1;
+		ADC_DMA_BlockComplete(1);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------------
+// 	Timer-triggered acquisition
+//  TIM6 runs at the scan rate and its update event is routed to TRGO (MMS = 010). ADC1 starts
+//  one regular sequence on each rising edge of TIM6_TRGO (EXTSEL = 1101, EXTEN = 01), so the
+//  sampling period is set by the timer alone and does not depend on interrupt or task timing.
+//
+//  Jitter is measured on the DMA block interrupts against the DWT cycle counter: every block
+//  holds the same number of scans, so blocks should arrive exactly one block period apart. The
+//  conversion instants themselves are hardware-timed; what this catches is late hand-off
+//  (interrupt latency, masked interrupts) and lost triggers.
+//-------------------------------------------------------------------------------------------
+static uint32_t adc_timer_rate_hz;
+static uint32_t adc_timer_requested_hz;	// Rate asked for, kept across clock changes
+static uint32_t adc_jitter_last;			// DWT->CYCCNT at the previous block, 0 = none yet
+static uint32_t adc_jitter_expected;		// Block period in CPU cycles
+static uint32_t adc_jitter_scan;			// Scan (trigger) period in CPU cycles
+static adc_jitter_stats_t adc_jitter;
+
+// Counter clock of TIM6: PCLK1, doubled by hardware when the APB1 prescaler is not 1
+static uint32_t ADC_Timer_ClockHz(void){
+	uint32_t ppre1 = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;
+	
+	if (ppre1 < 4) {
+		return SystemCoreClock;		// 0xx: HCLK not divided
+	}
+	return (SystemCoreClock >> (ppre1 - 3)) * 2;	// 100: /2, 101: /4, 110: /8, 111: /16
+}
 
+// ADC kernel clock in synchronous mode: HCLK divided by 1, 2 or 4 (CKMODE = 01, 10, 11)
+static uint32_t ADC_ClockHz(void){
+	uint32_t ckmode = (ADC123_COMMON->CCR & ADC_CCR_CKMODE) >> ADC_CCR_CKMODE_Pos;
+	
+	if (ckmode < 2) {
+		return SystemCoreClock;		// 01: HCLK/1, as ADC_Common_Configuration() selects
+	}
+	return SystemCoreClock >> (ckmode - 1);
 }
 
+// Sampling time of each SMPx code, in half ADC clock cycles
+static const uint16_t adc_smp_half_cycles[8] = { 5, 13, 25, 49, 95, 185, 495, 1281 };
+
+// Duration of one scan of the programmed sequence, in half ADC clock cycles: the sampling
+// time of each rank (SMPx) plus 12.5 cycles of successive approximation at 12 bits
+static uint32_t ADC_Scan_HalfCycles(void){
+	uint32_t sqr[4] = { ADC1->SQR1, ADC1->SQR2, ADC1->SQR3, ADC1->SQR4 };
+	uint32_t length = ((sqr[0] & ADC_SQR1_L) >> ADC_SQR1_L_Pos) + 1;
+	uint32_t total = 0;
+	
+	for (uint32_t rank = 0; rank < length; rank++) {
+		uint32_t channel = (sqr[(rank + 1) / 5] >> (6 * ((rank + 1) % 5))) & 0x1FUL;
+		uint32_t smp;
+		if (channel < 10) {
+			smp = (ADC1->SMPR1 >> (3 * channel)) & 7UL;
+		} else {
+			smp = (ADC1->SMPR2 >> (3 * (channel - 10))) & 7UL;
+		}
+		total += adc_smp_half_cycles[smp] + 25;
+	}
+	return total;
+}
 
+//-------------------------------------------------------------------------------------------
+// 	Fastest scan rate: one scan must be converted before the next trigger. Triggers that
+//  arrive during a scan are lost, and well above this rate the DMA interrupts alone would
+//  keep the CPU busy. Follows the sequence, its sampling times and the current HCLK.
+//-------------------------------------------------------------------------------------------
+uint32_t ADC_Timer_GetMaxRate(void){
+	return (uint32_t)((uint64_t)ADC_ClockHz() * 2 / ADC_Scan_HalfCycles());
+}
 
+// Block period in CPU cycles at the current scan rate
+static void ADC_Jitter_UpdateExpected(void){
+	uint64_t period_ticks = (uint64_t)(TIM6->PSC + 1) * (TIM6->ARR + 1);
+	uint64_t scans = adc_dma_block_length / ADC_Scan_GetLength();
+	
+	adc_jitter_scan = (uint32_t)(period_ticks * SystemCoreClock / ADC_Timer_ClockHz());
+	adc_jitter_expected = (uint32_t)(scans * adc_jitter_scan);
+	adc_jitter.expected_cycles = adc_jitter_expected;
+}
 
+// Forget the previous block time, e.g. after a start or a rate change
+static void ADC_Jitter_Restart(void){
+	adc_jitter_last = 0;
+}
 
+// Called for every filled block in timer mode
+static void ADC_Jitter_Sample(void){
+	uint32_t now = DWT->CYCCNT;
+	uint32_t last = adc_jitter_last;
+	
+	adc_jitter_last = now ? now : 1;
+	if (last == 0) {
+		return;
+	}
+	
+	uint32_t interval = now - last;		// Modulo 2^32: correct across counter wrap
+	int32_t deviation = (int32_t)(interval - adc_jitter_expected);
+	uint32_t magnitude = deviation < 0 ? (uint32_t)-deviation : (uint32_t)deviation;
+	
+	if (adc_jitter.intervals == 0 || interval < adc_jitter.min_cycles) {
+		adc_jitter.min_cycles = interval;
+	}
+	if (interval > adc_jitter.max_cycles) {
+		adc_jitter.max_cycles = interval;
+	}
+	if (magnitude > adc_jitter.jitter_max_cycles) {
+		adc_jitter.jitter_max_cycles = magnitude;
+	}
+	// More than one scan late: the hand-off slipped by a whole trigger period
+	if (deviation > 0 && (uint32_t)deviation > adc_jitter_scan) {
+		adc_jitter.late++;
+	}
+	adc_jitter.intervals++;
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Configure TIM6 as the conversion trigger and switch ADC1 from continuous to triggered mode.
+//  Must be called after ADC_DMA_Init() and ADC_Scan_Configure(), while no conversion is ongoing.
+//-------------------------------------------------------------------------------------------
+uint32_t ADC_Timer_Init(uint32_t scan_rate_hz){
+	
+	// 1. Enable the clock of TIM6 and stop the counter
+	RCC->APB1ENR1 |= RCC_APB1ENR1_TIM6EN;
+	TIM6->CR1 = 0;
+	
+	// 2. ARPE = 1: ARR is buffered, so rate changes take effect at the next update, never mid-period
+	//    MMS[2:0] = 010: the update event is output on TRGO
+	TIM6->CR1 = TIM_CR1_ARPE;
+	TIM6->CR2 = (TIM6->CR2 & ~TIM_CR2_MMS) | TIM_CR2_MMS_1;
+	
+	// 3. Program the period, then load PSC and ARR with an update event while the ADC is idle
+	uint32_t actual = ADC_Timer_SetRate(scan_rate_hz);
+	TIM6->EGR = TIM_EGR_UG;
+	TIM6->SR = 0;
+	
+	// 4. Conversion mode: CONT = 0, one sequence per trigger
+	//    EXTSEL[3:0] = 1101: TIM6_TRGO;  EXTEN[1:0] = 01: hardware trigger on the rising edge
+	ADC1->CFGR &= ~(ADC_CFGR_CONT | ADC_CFGR_EXTSEL | ADC_CFGR_EXTEN);
+	ADC1->CFGR |= (13UL << ADC_CFGR_EXTSEL_Pos) | ADC_CFGR_EXTEN_0;
+	
+	// 5. Cycle counter for the jitter measurement
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	
+	adc_timer_triggered = 1;
+	ADC_Jitter_Reset();
+	return actual;
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Set the scan rate. May be called at any time, also while acquiring: the new period starts
+//  at the next timer update, and a timer stopped by ADC_ClockChanged() runs again. Returns the
+//  rate actually programmed, 0 if the timer cannot produce it or it exceeds
+//  ADC_Timer_GetMaxRate().
+//-------------------------------------------------------------------------------------------
+uint32_t ADC_Timer_SetRate(uint32_t scan_rate_hz){
+	uint32_t clock_hz = ADC_Timer_ClockHz();
+	uint32_t max_rate_hz = ADC_Timer_GetMaxRate();
+	
+	if (scan_rate_hz == 0 || scan_rate_hz > clock_hz || scan_rate_hz > max_rate_hz) {
+		return 0;
+	}
+	
+	// Period in timer ticks, split into a 16-bit prescaler and a 16-bit auto-reload value
+	uint32_t period_ticks = clock_hz / scan_rate_hz;
+	uint32_t prescaler = (period_ticks - 1) / 65536;
+	uint32_t reload = period_ticks / (prescaler + 1) - 1;
+	if (reload < 1) {
+		return 0;	// ARR = 0 stops the timer: the rate is within one tick of the timer clock
+	}
+	if (clock_hz / ((prescaler + 1) * (reload + 1)) > max_rate_hz) {
+		return 0;	// Rounding of the period would push the rate past the conversion time
+	}
+	
+	TIM6->PSC = prescaler;
+	TIM6->ARR = reload;
+	
+	adc_timer_requested_hz = scan_rate_hz;
+	
+	adc_timer_rate_hz = clock_hz / ((prescaler + 1) * (reload + 1));
+	ADC_Jitter_UpdateExpected();
+	ADC_Jitter_Restart();
+	if (ADC1->CR & ADC_CR_ADSTART) {
+		TIM6->CR1 |= TIM_CR1_CEN;	// Acquiring: the counter may have been stopped on a clock change
+	}
+	return adc_timer_rate_hz;
+}
+
+// Scan rate programmed by the last ADC_Timer_SetRate()
+uint32_t ADC_Timer_GetRate(void){
+	return adc_timer_rate_hz;
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Re-time the driver after a change of the system clock: the sampling times of the internal
+//  channels are recomputed for the new ADC clock, then the TIM6 period for the requested scan
+//  rate, and with it the jitter expectation in CPU cycles. SMPRx can only be written with no
+//  conversion ongoing, so a running sequence is stopped for it and restarted from block 0.
+//  If the rate cannot be produced from the new clock, PSC and ARR would still hold the period
+//  for the old one: TIM6 is stopped instead, ADC_Timer_GetRate() reads 0 and the call returns
+//  0, until ADC_Timer_SetRate() sets a rate that fits.
+//-------------------------------------------------------------------------------------------
+int ADC_ClockChanged(void){
+	uint32_t primask = __get_PRIMASK();
+	int retimed = 1;
+	
+	__disable_irq();	// The DMA and overrun interrupts restart the sequence themselves
+	uint32_t running = (ADC1->CFGR & ADC_CFGR_DMAEN) && (ADC1->CR & ADC_CR_ADSTART);
+	if (running) {
+		ADC1->CR |= ADC_CR_ADSTP;
+		while((ADC1->CR & ADC_CR_ADSTART) == ADC_CR_ADSTART);
+	}
+	ADC_Scan_WriteSamplingTimes();
+	
+	// Free-running conversions only get faster or slower with the ADC clock
+	if (adc_timer_triggered && ADC_Timer_SetRate(adc_timer_requested_hz) == 0) {
+		TIM6->CR1 &= ~TIM_CR1_CEN;
+		adc_timer_rate_hz = 0;
+		retimed = 0;
+	}
+	if (running) {
+		ADC_DMA_Restart();
+	}
+	__set_PRIMASK(primask);
+	return retimed;
+}
+
+// Copy of the jitter statistics since the last reset
+void ADC_Jitter_GetStats(adc_jitter_stats_t *stats){
+	*stats = adc_jitter;
+}
+
+// Clear the jitter statistics
+void ADC_Jitter_Reset(void){
+	uint32_t expected = adc_jitter_expected;
+	
+	adc_jitter = (adc_jitter_stats_t){0};
+	adc_jitter.expected_cycles = expected;
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Multi-channel scan
+//  The regular sequence is programmed from a channel table. With DMA acquisition, each block
+//  holds a whole number of scans, interleaved in sequence order:
+//  [ch0 ch1 .. chN-1] [ch0 ch1 .. chN-1] ...
+//-------------------------------------------------------------------------------------------
+static uint8_t adc_scan_length = 1;
+static adc_scan_channel_t adc_scan_table[ADC_SCAN_MAX_CHANNELS];	// As configured, for clock changes
+static uint32_t adc_scan_table_length;							// 0 until ADC_Scan_Configure()
+
+// GPIO pin behind each external ADC1 input channel (ADC12_IN1 .. ADC12_IN16)
+#define ADC_CHANNEL_PINS 17
+static GPIO_TypeDef * const adc_channel_port[ADC_CHANNEL_PINS] = {
+	0, GPIOC, GPIOC, GPIOC, GPIOC, GPIOA, GPIOA, GPIOA, GPIOA,
+	GPIOA, GPIOA, GPIOA, GPIOA, GPIOC, GPIOC, GPIOB, GPIOB
+};
+static const uint8_t adc_channel_pin[ADC_CHANNEL_PINS] = {
+	0, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 6, 7, 4, 5, 0, 1
+};
+
+// Configure the GPIO pin of an external channel as analog input with the analog switch closed
+static void ADC_Channel_Pin_Init(uint32_t channel){
+	if (channel >= ADC_CHANNEL_PINS || adc_channel_port[channel] == 0) {
+		return;		// Internal or nonexistent channel: no pin behind it
+	}
+	
+	GPIO_TypeDef *port = adc_channel_port[channel];
+	uint32_t pin = adc_channel_pin[channel];
+	
+	if (port == GPIOA) {
+		RCC->AHB2ENR |= RCC_AHB2ENR_GPIOAEN;
+	} else if (port == GPIOB) {
+		RCC->AHB2ENR |= RCC_AHB2ENR_GPIOBEN;
+	} else {
+		RCC->AHB2ENR |= RCC_AHB2ENR_GPIOCEN;
+	}
+	port->MODER |= 0b11UL<<(2*pin);	// Analog mode (11)
+	port->ASCR  |= 1UL<<pin;		// Connect analog switch to the ADC input
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Sampling times. The internal channels need a minimum sampling time in microseconds
+//  (datasheet: ts_vrefint 4 us, ts_sens 5 us, ts_vbat 12 us), so the number of ADC clock
+//  cycles they need follows the ADC clock: the table's setting is raised where it is too short
+//  at the current clock, and recomputed by ADC_ClockChanged().
+//-------------------------------------------------------------------------------------------
+
+// Shortest SMPx code meeting the minimum sampling time of a channel at the current ADC clock
+static uint32_t ADC_Scan_MinSamplingTime(uint32_t channel){
+	uint32_t minimum_ns;
+	
+	if (channel == ADC_CHANNEL_VREFINT) {
+		minimum_ns = 4000;
+	} else if (channel == ADC_CHANNEL_TEMPSENSOR) {
+		minimum_ns = 5000;
+	} else if (channel == ADC_CHANNEL_VBAT) {
+		minimum_ns = 12000;
+	} else {
+		return ADC_SMP_2_5;		// External inputs: the table's setting, chosen for the source
+	}
+	
+	// half cycles / (2 * f_ADC) >= minimum, compared in units of 1/(2e9 * f_ADC) s
+	uint64_t needed = (uint64_t)minimum_ns * 2 * ADC_ClockHz();
+	uint32_t smp = ADC_SMP_2_5;
+	while (smp < ADC_SMP_640_5 && (uint64_t)adc_smp_half_cycles[smp] * 1000000000u < needed) {
+		smp++;
+	}
+	return smp;
+}
+
+// Program SMPx for every channel of the configured table, 3 bits per channel: channels 0-9
+// in SMPR1, channels 10-18 in SMPR2. Must be called while no conversion is ongoing.
+static void ADC_Scan_WriteSamplingTimes(void){
+	uint32_t smpr1 = ADC1->SMPR1;
+	uint32_t smpr2 = ADC1->SMPR2;
+	
+	for (uint32_t rank = 0; rank < adc_scan_table_length; rank++) {
+		uint32_t channel = adc_scan_table[rank].channel;
+		uint32_t smp = adc_scan_table[rank].sampling_time;
+		uint32_t minimum = ADC_Scan_MinSamplingTime(channel);
+		
+		if (smp < minimum) {
+			smp = minimum;
+		}
+		if (channel < 10) {
+			smpr1 &= ~(7UL << (3 * channel));
+			smpr1 |= smp << (3 * channel);
+		} else {
+			smpr2 &= ~(7UL << (3 * (channel - 10)));
+			smpr2 |= smp << (3 * (channel - 10));
+		}
+	}
+	ADC1->SMPR1 = smpr1;
+	ADC1->SMPR2 = smpr2;
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Program the regular sequence from a channel table.
+//  Must be called while no conversion is ongoing (ADSTART = 0), and after ADC_DMA_Init() when
+//  DMA acquisition is used, since it overrides the sampling time set there.
+//-------------------------------------------------------------------------------------------
+void ADC_Scan_Configure(const adc_scan_channel_t *table, uint32_t length){
+	uint32_t sqr[4] = {0, 0, 0, 0};
+	
+	if (length == 0 || length > ADC_SCAN_MAX_CHANNELS) {
+		return;
+	}
+	for (uint32_t rank = 0; rank < length; rank++) {
+		if (table[rank].channel > ADC_CHANNEL_VBAT) {
+			return;		// ADC1 has no channel above 18; the table is left unprogrammed
+		}
+	}
+	
+	// 1. Sequence length in ADC1_SQR1, L[3:0] = number of conversions - 1
+	sqr[0] = (length - 1) << ADC_SQR1_L_Pos;
+	
+	for (uint32_t rank = 0; rank < length; rank++) {
+		uint32_t channel = table[rank].channel;
+		
+		// 2. Channel of each rank. SQ1..SQ4 live in SQR1 after the L field, SQ5..SQ9 in SQR2,
+		//    SQ10..SQ14 in SQR3 and SQ15..SQ16 in SQR4, 5 bits each at 6-bit spacing.
+		sqr[(rank + 1) / 5] |= channel << (6 * ((rank + 1) % 5));
+		
+		// 3. Sampling time, written below for the whole table
+		adc_scan_table[rank] = table[rank];
+		
+		// 4. Route the input: enable the internal path, or set the external pin to analog mode
+		if (channel == ADC_CHANNEL_VREFINT) {
+			ADC123_COMMON->CCR |= ADC_CCR_VREFEN;
+		} else if (channel == ADC_CHANNEL_TEMPSENSOR) {
+			ADC123_COMMON->CCR |= ADC_CCR_TSEN;
+		} else if (channel == ADC_CHANNEL_VBAT) {
+			ADC123_COMMON->CCR |= ADC_CCR_VBATEN;
+		} else {
+			ADC_Channel_Pin_Init(channel);
+		}
+	}
+	
+	ADC1->SQR1 = sqr[0];
+	ADC1->SQR2 = sqr[1];
+	ADC1->SQR3 = sqr[2];
+	ADC1->SQR4 = sqr[3];
+	adc_scan_table_length = length;
+	ADC_Scan_WriteSamplingTimes();
+	
+	// 5. Each DMA block holds as many complete scans as fit
+	adc_scan_length = (uint8_t)length;
+	adc_dma_block_length = (ADC_DMA_BLOCK_SAMPLES / length) * length;
+}
+
+// Number of channels in the programmed sequence
+uint32_t ADC_Scan_GetLength(void){
+	return adc_scan_length;
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Split an interleaved block into per-channel buffers:
+//  out[c * scans + s] = block[s * channels + c]. Returns the number of scans in the block.
+//-------------------------------------------------------------------------------------------
+uint32_t ADC_Scan_Deinterleave(const uint16_t *block, uint16_t *out){
+	uint32_t channels = adc_scan_length;
+	uint32_t scans = adc_dma_block_length / channels;
+	
+	for (uint32_t c = 0; c < channels; c++) {
+		for (uint32_t s = 0; s < scans; s++) {
+			out[c * scans + s] = block[s * channels + c];
+		}
+	}
+	return scans;
+}
+
+//-------------------------------------------------------------------------------------------
+// 	Supply voltage from a VREFINT reading
+//  VREFINT_CAL is the VREFINT conversion result measured in production at VDDA = 3.0 V, so
+//  VDDA = 3.0 V * VREFINT_CAL / VREFINT_DATA.
+//-------------------------------------------------------------------------------------------
+#define VREFINT_CAL_ADDR   ((const uint16_t *) 0x1FFF75AAUL)
+#define VREFINT_CAL_VREF   3000U	// mV
+
+uint32_t ADC_Vdda_mV(uint32_t vrefint_code){
+	if (vrefint_code == 0) {
+		return 0;
+	}
+	return (VREFINT_CAL_VREF * (uint32_t)(*VREFINT_CAL_ADDR)) / vrefint_code;
+}
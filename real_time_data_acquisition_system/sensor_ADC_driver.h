@@ -5,6 +5,7 @@
 
 
 extern volatile uint32_t adc_result; //Declaration of global variable to store sampled ADC data 
+extern volatile uint32_t adc_result_stamp; // Latency stamp of adc_result, taken in the EOC interrupt
 //extern  uint32_t temperature_C;
 
 // Modular function to wake up ADC1 from the deep-power-down mode 
@@ -20,6 +21,105 @@ void ADC_Common_Configuration(void);
 // Modular function to initialize ADC
 void ADC_Init(void);
 
+// DMA ping-pong acquisition: the DMA buffer is split into two blocks of ADC_DMA_BLOCK_SAMPLES
+#define ADC_DMA_BLOCK_SAMPLES   32
+#define ADC_DMA_BUFFER_SAMPLES  (2 * ADC_DMA_BLOCK_SAMPLES)
+
+// Called from the DMA interrupt each time a block has been filled
+typedef void (*adc_block_callback_t)(uint32_t block_index);
+
+extern volatile uint32_t adc_dma_block_count;   // Blocks filled by the DMA
+extern volatile uint32_t adc_dma_overrun_count; // Blocks overwritten while still held by the consumer
+extern volatile uint32_t adc_ovr_count;         // ADC overruns: conversions lost before the DMA read them
+
+// Modular function to configure DMA1 Channel 1 and ADC1 for continuous block acquisition
+void ADC_DMA_Init(adc_block_callback_t callback);
+
+// Start/stop continuous DMA acquisition
+void ADC_DMA_Start(void);
+void ADC_DMA_Stop(void);
+
+// Access a block handed out by the callback, and release it once processed
+const uint16_t *ADC_DMA_GetBlock(uint32_t block_index);
+void ADC_DMA_ReleaseBlock(uint32_t block_index);
+
+// Number of samples in each block (ADC_DMA_BLOCK_SAMPLES rounded down to whole scans)
+uint32_t ADC_DMA_GetBlockLength(void);
+
+// Latency stamp of the last conversion of a block, taken in the DMA interrupt
+uint32_t ADC_DMA_GetBlockStamp(uint32_t block_index);
+
+// Timer-triggered acquisition: TIM6 TRGO starts one scan per period
+// Jitter of the DMA block hand-off, in CPU cycles
+typedef struct {
+	uint32_t intervals;         // Block intervals measured
+	uint32_t expected_cycles;   // Nominal block period
+	uint32_t min_cycles;        // Shortest block interval
+	uint32_t max_cycles;        // Longest block interval
+	uint32_t jitter_max_cycles; // Largest deviation from the nominal period
+	uint32_t late;              // Intervals more than one scan period too long
+} adc_jitter_stats_t;
+
+// Modular function to trigger the DMA acquisition from TIM6 instead of continuous conversions;
+// returns the scan rate actually programmed
+uint32_t ADC_Timer_Init(uint32_t scan_rate_hz);
+
+// Change the scan rate (also while running); returns the rate actually programmed, 0 if out of range
+uint32_t ADC_Timer_SetRate(uint32_t scan_rate_hz);
+uint32_t ADC_Timer_GetRate(void);
+
+// Fastest scan rate the programmed sequence can be converted at with the current ADC clock
+uint32_t ADC_Timer_GetMaxRate(void);
+
+// Re-time the sampling times of the internal channels and the scan timer for the current clock;
+// call after every clock change (clock manager notifier). Returns 0, with TIM6 stopped and a
+// scan rate of 0, if the requested rate cannot be produced from the new clock.
+int ADC_ClockChanged(void);
+
+// Jitter statistics since the last reset (or start of acquisition)
+void ADC_Jitter_GetStats(adc_jitter_stats_t *stats);
+void ADC_Jitter_Reset(void);
+
+// Multi-channel scan: up to 16 conversions per sequence
+#define ADC_SCAN_MAX_CHANNELS   16
+
+// Internal ADC1 input channels
+#define ADC_CHANNEL_VREFINT     0   // Internal voltage reference, used to derive VDDA
+#define ADC_CHANNEL_TEMPSENSOR  17  // Internal temperature sensor
+#define ADC_CHANNEL_VBAT        18  // VBAT / 3
+
+// Sampling time codes for SMPx[2:0], in ADC clock cycles
+typedef enum {
+	ADC_SMP_2_5 = 0,
+	ADC_SMP_6_5,
+	ADC_SMP_12_5,
+	ADC_SMP_24_5,
+	ADC_SMP_47_5,
+	ADC_SMP_92_5,
+	ADC_SMP_247_5,
+	ADC_SMP_640_5
+} adc_sampling_time_t;
+
+// One entry of the scan channel table, in conversion order
+typedef struct {
+	uint8_t channel;        // ADC input channel number (0-18)
+	uint8_t sampling_time;  // adc_sampling_time_t
+} adc_scan_channel_t;
+
+// Modular function to program the regular sequence (SQR1-SQR4) and per-channel sampling times.
+// Internal channels get at least their minimum sampling time at the current ADC clock.
+// Tables that are empty, longer than ADC_SCAN_MAX_CHANNELS or name a channel above 18 are ignored.
+void ADC_Scan_Configure(const adc_scan_channel_t *table, uint32_t length);
+
+// Number of channels in the programmed sequence
+uint32_t ADC_Scan_GetLength(void);
+
+// Split an interleaved DMA block into per-channel buffers; returns the scans per channel
+uint32_t ADC_Scan_Deinterleave(const uint16_t *block, uint16_t *out);
+
+// Supply voltage VDDA in mV, computed from a VREFINT conversion result and its factory calibration
+uint32_t ADC_Vdda_mV(uint32_t vrefint_code);
+
 
 
 #endif /* __STM32L476G_ADC_H */
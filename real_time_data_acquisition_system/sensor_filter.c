@@ -0,0 +1,95 @@
+#include "sensor_filter.h"
+
+//------------------------------------------------------------------------------
+// Streaming sensor filter
+// Integer only: the median stage sorts a copy of at most 5 samples, and the CIC
+// stage uses wrap-around 32-bit arithmetic, which gives exact results as long as
+// the final output (input * decimation^order) fits in 32 bits.
+//------------------------------------------------------------------------------
+
+void sensor_filter_init(sensor_filter_t *filter, uint32_t order, uint32_t decimation, uint32_t median_window) {
+	if (order < 1) order = 1;
+	if (order > SENSOR_FILTER_MAX_ORDER) order = SENSOR_FILTER_MAX_ORDER;
+	if (decimation < 1) decimation = 1;
+	if (decimation > SENSOR_FILTER_MAX_DECIMATION) decimation = SENSOR_FILTER_MAX_DECIMATION;
+	if (median_window >= 5) {
+		median_window = 5;
+	} else if (median_window >= 3) {
+		median_window = 3;
+	} else {
+		median_window = 0;
+	}
+
+	filter->order = (uint8_t)order;
+	filter->decimation = (uint8_t)decimation;
+	filter->median_window = (uint8_t)median_window;
+	filter->median_count = 0;
+	filter->median_index = 0;
+	filter->phase = 0;
+
+	filter->gain = 1;
+	for (uint32_t k = 0; k < SENSOR_FILTER_MAX_ORDER; k++) {
+		filter->integrator[k] = 0;
+		filter->comb_delay[k] = 0;
+		if (k < order) {
+			filter->gain *= decimation;
+		}
+	}
+}
+
+// Median despike: replace each sample by the median of the last median_window samples.
+// Samples pass through unchanged until the window has filled up.
+static uint16_t sensor_filter_median(sensor_filter_t *filter, uint16_t sample) {
+	uint16_t window[SENSOR_FILTER_MEDIAN_MAX];
+	uint32_t n = filter->median_window;
+
+	filter->median_history[filter->median_index] = sample;
+	filter->median_index = (uint8_t)((filter->median_index + 1) % n);
+	if (filter->median_count < n) {
+		filter->median_count++;
+		return sample;
+	}
+
+	// Insertion sort of a copy of the window
+	for (uint32_t i = 0; i < n; i++) {
+		uint16_t value = filter->median_history[i];
+		uint32_t j = i;
+		while (j > 0 && window[j - 1] > value) {
+			window[j] = window[j - 1];
+			j--;
+		}
+		window[j] = value;
+	}
+	return window[n / 2];
+}
+
+uint32_t sensor_filter_process(sensor_filter_t *filter, const uint16_t *in, uint32_t count, uint16_t *out) {
+	uint32_t outputs = 0;
+	uint32_t order = filter->order;
+
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t x = in[i];
+		if (filter->median_window) {
+			x = sensor_filter_median(filter, (uint16_t)x);
+		}
+
+		// Integrator cascade at the input rate
+		filter->integrator[0] += x;
+		for (uint32_t k = 1; k < order; k++) {
+			filter->integrator[k] += filter->integrator[k - 1];
+		}
+
+		// Comb cascade at the output rate (differential delay 1), then remove the gain
+		if (++filter->phase == filter->decimation) {
+			uint32_t y = filter->integrator[order - 1];
+			filter->phase = 0;
+			for (uint32_t k = 0; k < order; k++) {
+				uint32_t delayed = filter->comb_delay[k];
+				filter->comb_delay[k] = y;
+				y -= delayed;
+			}
+			out[outputs++] = (uint16_t)((y + filter->gain / 2) / filter->gain);
+		}
+	}
+	return outputs;
+}
@@ -0,0 +1,34 @@
+#ifndef __SENSOR_FILTER_H
+#define __SENSOR_FILTER_H
+
+#include <stdint.h>
+
+// Limits of the filter configuration
+#define SENSOR_FILTER_MAX_ORDER       3   // CIC stages
+#define SENSOR_FILTER_MAX_DECIMATION  64  // 4095 * 64^3 still fits into 32 bits
+#define SENSOR_FILTER_MEDIAN_MAX      5   // Largest median window
+
+// State of one channel's filter: optional median despike followed by a decimating CIC.
+// A first-order CIC is a boxcar (moving-average) decimator.
+typedef struct {
+	uint32_t integrator[SENSOR_FILTER_MAX_ORDER];	// Integrators, run at the input rate
+	uint32_t comb_delay[SENSOR_FILTER_MAX_ORDER];	// Comb delay elements, run at the output rate
+	uint32_t gain;					// decimation ^ order, removed from every output
+	uint16_t median_history[SENSOR_FILTER_MEDIAN_MAX];
+	uint8_t order;
+	uint8_t decimation;
+	uint8_t median_window;				// 0 or 1 = despike off, otherwise 3 or 5
+	uint8_t median_count;				// Samples in the median history so far
+	uint8_t median_index;				// Next history slot to overwrite
+	uint8_t phase;					// Input samples since the last output
+} sensor_filter_t;
+
+// Set up a filter. order is clamped to 1..SENSOR_FILTER_MAX_ORDER, decimation to
+// 1..SENSOR_FILTER_MAX_DECIMATION, and median_window to 0, 3 or 5.
+void sensor_filter_init(sensor_filter_t *filter, uint32_t order, uint32_t decimation, uint32_t median_window);
+
+// Run 'count' input samples through the filter. Writes one output per 'decimation' inputs
+// to 'out' (at most count / decimation + 1 values) and returns the number written.
+uint32_t sensor_filter_process(sensor_filter_t *filter, const uint16_t *in, uint32_t count, uint16_t *out);
+
+#endif /* __SENSOR_FILTER_H */
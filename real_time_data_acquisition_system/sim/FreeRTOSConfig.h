@@ -0,0 +1,69 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+//------------------------------------------------------------------------------
+// Host simulation: FreeRTOS configuration for the POSIX port. Scheduling
+// parameters follow the target configuration (RTE/RTOS/FreeRTOSConfig.h);
+// stack and heap sizes are scaled for pthreads.
+//------------------------------------------------------------------------------
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+#define configUSE_TICKLESS_IDLE                 0
+#define configCPU_CLOCK_HZ                      (SystemCoreClock)
+#define configTICK_RATE_HZ                      ((TickType_t)1000)
+#define configMAX_PRIORITIES                    56
+#define configMINIMAL_STACK_SIZE                ((unsigned short)PTHREAD_STACK_MIN)
+#define configTOTAL_HEAP_SIZE                   ((size_t)(1024 * 1024))
+#define configMAX_TASK_NAME_LEN                 24
+#define configUSE_16_BIT_TICKS                  0
+#define configIDLE_SHOULD_YIELD                 1
+#define configUSE_TASK_NOTIFICATIONS            1
+#define configTASK_NOTIFICATION_ARRAY_ENTRIES   1
+#define configUSE_MUTEXES                       1
+#define configUSE_RECURSIVE_MUTEXES             1
+#define configUSE_COUNTING_SEMAPHORES           1
+#define configQUEUE_REGISTRY_SIZE               0
+#define configUSE_QUEUE_SETS                    0
+#define configUSE_TIME_SLICING                  1
+#define configSUPPORT_STATIC_ALLOCATION         0
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+
+#define configUSE_IDLE_HOOK                     1   // Idle time for the benchmark report (bench.h)
+#define configUSE_TICK_HOOK                     0
+#define configCHECK_FOR_STACK_OVERFLOW          0
+#define configUSE_MALLOC_FAILED_HOOK            0
+#define configUSE_DAEMON_TASK_STARTUP_HOOK      0
+
+#define configGENERATE_RUN_TIME_STATS           0
+#define configUSE_TRACE_FACILITY                0   // No Tracealyzer recorder on the host
+#define configUSE_STATS_FORMATTING_FUNCTIONS    0
+
+#define configUSE_TIMERS                        1
+#define configTIMER_TASK_PRIORITY               (configMAX_PRIORITIES - 2) // Below the simulated hardware
+#define configTIMER_QUEUE_LENGTH                10
+#define configTIMER_TASK_STACK_DEPTH            configMINIMAL_STACK_SIZE
+
+#define INCLUDE_vTaskPrioritySet                1
+#define INCLUDE_uxTaskPriorityGet               1
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_xTaskDelayUntil                 1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+#define INCLUDE_xTaskGetIdleTaskHandle          1
+#define INCLUDE_eTaskGetState                   1
+#define INCLUDE_xTimerPendFunctionCall          1
+
+#define configASSERT(x) if ((x) == 0) { taskDISABLE_INTERRUPTS(); abort(); }
+
+#ifndef __ASSEMBLER__
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+extern uint32_t SystemCoreClock;
+#endif
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,9 @@
+#ifndef RTE_COMPONENTS_H
+#define RTE_COMPONENTS_H
+
+// Host simulation: stands in for the file generated by the Keil run-time environment
+#define CMSIS_device_header "stm32l476xx.h"
+
+#define RTE_RTOS_FreeRTOS_CORE
+
+#endif /* RTE_COMPONENTS_H */
@@ -0,0 +1,27 @@
+#ifndef __CMSIS_NVIC_VIRTUAL_H
+#define __CMSIS_NVIC_VIRTUAL_H
+
+//------------------------------------------------------------------------------
+// Host simulation: NVIC access routed to the interrupt model in sim_hw.c.
+// Included by core_cm4.h when CMSIS_NVIC_VIRTUAL is defined.
+//------------------------------------------------------------------------------
+
+void sim_nvic_enable(int irq);
+void sim_nvic_disable(int irq);
+void sim_nvic_set_priority(int irq, uint32_t priority);
+uint32_t sim_nvic_get_priority(int irq);
+
+#define NVIC_SetPriorityGrouping    __NVIC_SetPriorityGrouping
+#define NVIC_GetPriorityGrouping    __NVIC_GetPriorityGrouping
+#define NVIC_EnableIRQ(irq)         sim_nvic_enable((int)(irq))
+#define NVIC_GetEnableIRQ           __NVIC_GetEnableIRQ
+#define NVIC_DisableIRQ(irq)        sim_nvic_disable((int)(irq))
+#define NVIC_GetPendingIRQ          __NVIC_GetPendingIRQ
+#define NVIC_SetPendingIRQ          __NVIC_SetPendingIRQ
+#define NVIC_ClearPendingIRQ        __NVIC_ClearPendingIRQ
+#define NVIC_GetActive              __NVIC_GetActive
+#define NVIC_SetPriority(irq, p)    sim_nvic_set_priority((int)(irq), (p))
+#define NVIC_GetPriority(irq)       sim_nvic_get_priority((int)(irq))
+#define NVIC_SystemReset()          exit(0)
+
+#endif /* __CMSIS_NVIC_VIRTUAL_H */
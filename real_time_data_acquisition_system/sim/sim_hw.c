@@ -0,0 +1,756 @@
+#include "sim_hw.h"
+#include <stm32l476xx.h>	// Through the include path: the wrapper, not a same-directory lookup
+#ifndef SIM_BARE_METAL
+#include "task.h"
+#endif
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+//------------------------------------------------------------------------------
+// Register blocks
+// The peripheral regions are mapped at their STM32L476 addresses before main()
+// runs, so everything built from the CMSIS headers reaches them: the instance
+// macros (ADC1, DMA1, USART2, ...), the core_cm4.h helpers and the factory
+// calibration values in system memory.
+//------------------------------------------------------------------------------
+#define SIM_PAGE_SIZE 0x1000UL
+
+static const struct {
+	uintptr_t base;
+	size_t size;
+} sim_regions[] = {
+	{ PERIPH_BASE, 0x30000 },		// APB1, APB2, AHB1: TIM6, USART2, PWR, SYSCFG, EXTI, DMA1, RCC, FLASH
+	{ GPIOA_BASE, 0x2000 },			// AHB2: GPIOA..GPIOH
+	{ ADC1_BASE, SIM_PAGE_SIZE },	// AHB2: ADC1..ADC3 and the common registers
+	{ ITM_BASE, 0x100000 },			// Private peripheral bus: ITM, DWT, SysTick, NVIC, SCB, CoreDebug
+	{ 0x1FFF7000UL, SIM_PAGE_SIZE },	// System memory: VREFINT and temperature sensor calibration
+};
+
+#define SIM_VREFINT_CAL_ADDR ((uint16_t *)0x1FFF75AAUL)	// See sensor_ADC_driver.c
+
+__attribute__((constructor)) static void sim_map_registers(void) {
+	for (uint32_t i = 0; i < sizeof(sim_regions) / sizeof(sim_regions[0]); i++) {
+		void *base = (void *)sim_regions[i].base;
+
+		if (mmap(base, sim_regions[i].size, PROT_READ | PROT_WRITE,
+		         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0) != base) {
+			fprintf(stderr, "sim: cannot map the registers at 0x%08lx\n", (unsigned long)sim_regions[i].base);
+			exit(1);
+		}
+	}
+	*SIM_VREFINT_CAL_ADDR = SIM_VREFINT_CAL;
+}
+
+//------------------------------------------------------------------------------
+// System clock (replaces system_stm32l4xx.c)
+//------------------------------------------------------------------------------
+uint32_t SystemCoreClock = 4000000;
+
+static const uint32_t sim_msi_range_hz[12] = {
+	100000, 200000, 400000, 800000, 1000000, 2000000,
+	4000000, 8000000, 16000000, 24000000, 32000000, 48000000
+};
+static const uint8_t sim_ahb_shift[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9 };
+
+// Same derivation as the CMSIS system file: SWS, MSI range, PLL M/N/R, AHB prescaler
+void SystemCoreClockUpdate(void) {
+	uint32_t msi;
+	uint32_t sysclk;
+
+	if (RCC->CR & RCC_CR_MSIRGSEL) {
+		msi = sim_msi_range_hz[(RCC->CR & RCC_CR_MSIRANGE) >> RCC_CR_MSIRANGE_Pos];
+	} else {
+		msi = sim_msi_range_hz[(RCC->CSR & RCC_CSR_MSISRANGE) >> RCC_CSR_MSISRANGE_Pos];
+	}
+
+	switch ((RCC->CFGR & RCC_CFGR_SWS) >> RCC_CFGR_SWS_Pos) {
+		case 1:	sysclk = 16000000; break;	// HSI16
+		case 2:	sysclk = 8000000; break;	// HSE (not fitted; assumed 8 MHz)
+		case 3: {
+			uint32_t source = ((RCC->PLLCFGR & RCC_PLLCFGR_PLLSRC) == RCC_PLLCFGR_PLLSRC_HSI) ? 16000000 : msi;
+			uint32_t m = ((RCC->PLLCFGR & RCC_PLLCFGR_PLLM) >> RCC_PLLCFGR_PLLM_Pos) + 1;
+			uint32_t n = (RCC->PLLCFGR & RCC_PLLCFGR_PLLN) >> RCC_PLLCFGR_PLLN_Pos;
+			uint32_t r = (((RCC->PLLCFGR & RCC_PLLCFGR_PLLR) >> RCC_PLLCFGR_PLLR_Pos) + 1) * 2;
+			sysclk = source / m * n / r;
+			break;
+		}
+		default: sysclk = msi; break;
+	}
+	SystemCoreClock = sysclk >> sim_ahb_shift[(RCC->CFGR & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos];
+}
+
+// APB1 clock (USART2, TIM6)
+static uint32_t sim_pclk1_hz(void) {
+	uint32_t ppre1 = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;
+	return ppre1 < 4 ? SystemCoreClock : SystemCoreClock >> (ppre1 - 3);
+}
+
+//------------------------------------------------------------------------------
+// Interrupt model
+// FreeRTOS: PRIMASK maps onto the POSIX port's interrupt masking. Interrupt
+// handlers are only called from the hardware task, which runs at the highest
+// priority, so a handler can never wake a task of higher priority and never has
+// to yield.
+// Bare metal (SIM_BARE_METAL): PRIMASK is a mutex, held by the main loop while
+// it has interrupts masked and by the hardware thread while a handler runs. The
+// main loop is not stopped during a handler; only masked sections exclude it.
+// WFI waits until a handler has run, or one tick at most.
+//------------------------------------------------------------------------------
+#define SIM_IRQ_COUNT 82
+
+#ifdef SIM_BARE_METAL
+static __thread uint32_t sim_primask;	// Per thread: set in the hardware thread while a handler runs
+static pthread_mutex_t sim_irq_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sim_irq_done = PTHREAD_COND_INITIALIZER;
+#else
+static volatile uint32_t sim_primask;
+#endif
+static uint8_t sim_nvic_enabled[SIM_IRQ_COUNT];
+static uint8_t sim_nvic_priority[SIM_IRQ_COUNT];
+
+uint32_t sim_get_primask(void) {
+	return sim_primask;
+}
+
+void sim_set_primask(uint32_t primask) {
+	if (primask) {
+		sim_disable_irq();
+	} else {
+		sim_enable_irq();
+	}
+}
+
+#ifdef SIM_BARE_METAL
+void sim_disable_irq(void) {
+	if (!sim_primask) {
+		pthread_mutex_lock(&sim_irq_lock);
+		sim_primask = 1;
+	}
+}
+
+void sim_enable_irq(void) {
+	if (sim_primask) {
+		sim_primask = 0;
+		pthread_mutex_unlock(&sim_irq_lock);
+	}
+}
+
+void sim_wfi(void) {
+	struct timespec until;
+
+	clock_gettime(CLOCK_REALTIME, &until);
+	until.tv_nsec += 1000000000 / SIM_TICK_HZ;
+	if (until.tv_nsec >= 1000000000) {
+		until.tv_sec++;
+		until.tv_nsec -= 1000000000;
+	}
+	if (sim_primask) {
+		// Masked, as in the usual check-then-sleep sequence: the wait releases the mask
+		pthread_cond_timedwait(&sim_irq_done, &sim_irq_lock, &until);
+	} else {
+		pthread_mutex_lock(&sim_irq_lock);
+		pthread_cond_timedwait(&sim_irq_done, &sim_irq_lock, &until);
+		pthread_mutex_unlock(&sim_irq_lock);
+	}
+}
+#else
+void sim_disable_irq(void) {
+	portDISABLE_INTERRUPTS();
+	sim_primask = 1;
+}
+
+void sim_enable_irq(void) {
+	sim_primask = 0;
+	portENABLE_INTERRUPTS();
+}
+
+void sim_wfi(void) {
+	usleep(1000000 / SIM_TICK_HZ);	// Until the next tick; its signal ends the sleep early
+}
+#endif
+
+void sim_nvic_enable(int irq) {
+	if (irq >= 0 && irq < SIM_IRQ_COUNT) {
+		sim_nvic_enabled[irq] = 1;
+	}
+}
+
+void sim_nvic_disable(int irq) {
+	if (irq >= 0 && irq < SIM_IRQ_COUNT) {
+		sim_nvic_enabled[irq] = 0;
+	}
+}
+
+void sim_nvic_set_priority(int irq, uint32_t priority) {
+	if (irq >= 0 && irq < SIM_IRQ_COUNT) {
+		sim_nvic_priority[irq] = (uint8_t)priority;
+	}
+}
+
+uint32_t sim_nvic_get_priority(int irq) {
+	return (irq >= 0 && irq < SIM_IRQ_COUNT) ? sim_nvic_priority[irq] : 0;
+}
+
+// Handlers of the application; weak, so that unused vectors need not exist
+void EXTI0_IRQHandler(void) __attribute__((weak));
+void ADC1_2_IRQHandler(void) __attribute__((weak));
+void DMA1_Channel1_IRQHandler(void) __attribute__((weak));
+void DMA1_Channel7_IRQHandler(void) __attribute__((weak));
+void USART2_IRQHandler(void) __attribute__((weak));
+
+// DWT cycle counter, derived from host time at the current core clock
+static void sim_dwt_update(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	DWT->CYCCNT = (uint32_t)(((uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec) *
+	                         (SystemCoreClock / 1000000) / 1000);
+}
+
+// Enter an interrupt handler, as the NVIC would with the interrupt enabled and PRIMASK clear
+static void sim_irq(IRQn_Type irq, void (*handler)(void)) {
+	if (handler == NULL || !sim_nvic_enabled[irq]) {
+		return;
+	}
+	sim_dwt_update();
+#ifdef SIM_BARE_METAL
+	pthread_mutex_lock(&sim_irq_lock);
+	sim_primask = 1;
+	handler();
+	sim_primask = 0;
+	pthread_cond_broadcast(&sim_irq_done);	// Ends a WFI
+	pthread_mutex_unlock(&sim_irq_lock);
+#else
+	portDISABLE_INTERRUPTS();
+	handler();
+	portENABLE_INTERRUPTS();
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Register thread
+// Answers the status flags that drivers busy-wait on. It runs outside the RTOS,
+// so the waits also work before the scheduler starts and inside handlers.
+// Event flags (EOC, DMA transfer flags, EXTI pending) are not handled here: the
+// hardware task sets them around each handler call, since RAM cannot tell a
+// write-1-to-clear from any other write.
+//------------------------------------------------------------------------------
+static volatile uint32_t sim_adc_stopped;	// Set when a conversion sequence is stopped by ADSTP
+
+static void sim_reg_set(volatile uint32_t *reg, uint32_t bits) {
+	if ((*reg & bits) != bits) {
+		__atomic_fetch_or((uint32_t *)reg, bits, __ATOMIC_SEQ_CST);
+	}
+}
+
+static void sim_reg_clear(volatile uint32_t *reg, uint32_t bits) {
+	if (*reg & bits) {
+		__atomic_fetch_and((uint32_t *)reg, ~bits, __ATOMIC_SEQ_CST);
+	}
+}
+
+static void sim_register_update(void) {
+	// ADC1: calibration completes at once, ready follows enable, stop ends the sequence
+	sim_reg_clear(&ADC1->CR, ADC_CR_ADCAL);
+	if (ADC1->CR & ADC_CR_ADDIS) {
+		sim_reg_clear(&ADC1->CR, ADC_CR_ADDIS | ADC_CR_ADEN);
+		sim_reg_clear(&ADC1->ISR, ADC_ISR_ADRDY);
+	} else if (ADC1->CR & ADC_CR_ADEN) {
+		sim_reg_set(&ADC1->ISR, ADC_ISR_ADRDY);
+	}
+	if (ADC1->CR & ADC_CR_ADSTP) {
+		sim_reg_clear(&ADC1->CR, ADC_CR_ADSTP | ADC_CR_ADSTART);
+		sim_adc_stopped = 1;
+	}
+
+	// USART2: enable acknowledges, transmit data register always empty
+	if (USART2->CR1 & USART_CR1_UE) {
+		if (USART2->CR1 & USART_CR1_TE) {
+			sim_reg_set(&USART2->ISR, USART_ISR_TEACK | USART_ISR_TXE | USART_ISR_TC);
+		}
+		if (USART2->CR1 & USART_CR1_RE) {
+			sim_reg_set(&USART2->ISR, USART_ISR_REACK);
+		}
+	}
+
+	// RCC: oscillators and PLL are ready as soon as they are switched on, the switch is immediate
+	if (RCC->CR & RCC_CR_MSION) sim_reg_set(&RCC->CR, RCC_CR_MSIRDY); else sim_reg_clear(&RCC->CR, RCC_CR_MSIRDY);
+	if (RCC->CR & RCC_CR_HSION) sim_reg_set(&RCC->CR, RCC_CR_HSIRDY); else sim_reg_clear(&RCC->CR, RCC_CR_HSIRDY);
+	if (RCC->CR & RCC_CR_PLLON) sim_reg_set(&RCC->CR, RCC_CR_PLLRDY); else sim_reg_clear(&RCC->CR, RCC_CR_PLLRDY);
+	uint32_t sws = (RCC->CFGR & RCC_CFGR_SW) << RCC_CFGR_SWS_Pos;
+	if ((RCC->CFGR & RCC_CFGR_SWS) != sws) {
+		sim_reg_clear(&RCC->CFGR, RCC_CFGR_SWS);
+		sim_reg_set(&RCC->CFGR, sws);
+	}
+}
+
+static void *sim_register_thread(void *argument) {
+	sigset_t signals;
+
+	// Keep the port's tick and yield signals away from this thread
+	sigfillset(&signals);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+	for (;;) {
+		sim_register_update();
+		usleep(10);
+	}
+	return NULL;
+}
+
+//------------------------------------------------------------------------------
+// DMA1 model: one transfer per peripheral request, 16-bit or 8-bit memory side
+//------------------------------------------------------------------------------
+#define SIM_DMA_TCIF(channel)  (2UL << (4 * (channel)))
+#define SIM_DMA_HTIF(channel)  (4UL << (4 * (channel)))
+#define SIM_DMA_GIF(channel)   (1UL << (4 * (channel)))
+
+static DMA_Channel_TypeDef * const sim_dma_channel[7] = {
+	DMA1_Channel1, DMA1_Channel2, DMA1_Channel3, DMA1_Channel4, DMA1_Channel5, DMA1_Channel6, DMA1_Channel7
+};
+static uint32_t sim_dma_total[7];	// CNDTR when the channel was enabled (reload value)
+static uint8_t sim_dma_active[7];
+
+// Transfer count and position of a channel; 0 if it is not serving requests
+static uint32_t sim_dma_ready(uint32_t channel) {
+	DMA_Channel_TypeDef *ch = sim_dma_channel[channel];
+
+	if (!(ch->CCR & DMA_CCR_EN)) {
+		sim_dma_active[channel] = 0;
+		return 0;
+	}
+	if (!sim_dma_active[channel]) {
+		sim_dma_total[channel] = ch->CNDTR;
+		sim_dma_active[channel] = 1;
+	}
+	return ch->CNDTR;
+}
+
+// Memory address of the next transfer
+static uint8_t *sim_dma_memory(uint32_t channel) {
+	DMA_Channel_TypeDef *ch = sim_dma_channel[channel];
+	uint32_t size = 1UL << ((ch->CCR & DMA_CCR_MSIZE) >> DMA_CCR_MSIZE_Pos);
+	uint32_t done = (ch->CCR & DMA_CCR_MINC) ? sim_dma_total[channel] - ch->CNDTR : 0;
+
+	return (uint8_t *)(uintptr_t)ch->CMAR + done * size;
+}
+
+// Account for 'count' finished transfers; returns the flags raised (HT, TC)
+static uint32_t sim_dma_advance(uint32_t channel, uint32_t count) {
+	DMA_Channel_TypeDef *ch = sim_dma_channel[channel];
+	uint32_t total = sim_dma_total[channel];
+	uint32_t before = ch->CNDTR;
+	uint32_t flags = 0;
+
+	ch->CNDTR = before - count;
+	if (before > total / 2 && ch->CNDTR <= total / 2 && (ch->CCR & DMA_CCR_HTIE)) {
+		flags |= SIM_DMA_HTIF(channel);
+	}
+	if (ch->CNDTR == 0) {
+		if (ch->CCR & DMA_CCR_TCIE) {
+			flags |= SIM_DMA_TCIF(channel);
+		}
+		if (ch->CCR & DMA_CCR_CIRC) {
+			ch->CNDTR = total;
+		} else {
+			sim_dma_active[channel] = 0;
+		}
+	}
+	return flags;
+}
+
+// Raise DMA flags, run the channel handler, and drop the flags again (the handler clears them)
+static void sim_dma_interrupt(uint32_t channel, uint32_t flags, IRQn_Type irq, void (*handler)(void)) {
+	if (flags == 0) {
+		return;
+	}
+	DMA1->ISR |= flags | SIM_DMA_GIF(channel);
+	sim_irq(irq, handler);
+	DMA1->ISR &= ~(flags | SIM_DMA_GIF(channel));
+	DMA1->IFCR = 0;
+}
+
+//------------------------------------------------------------------------------
+// ADC1 model
+// Each conversion returns the scripted value of the converted channel. Sequences
+// start on ADSTART (software), run back to back (CONT) or start on TIM6_TRGO.
+//------------------------------------------------------------------------------
+static uint16_t sim_adc_value[19];	// Scripted input code per channel
+static uint32_t sim_adc_rank;		// Next rank of the regular sequence
+static uint64_t sim_adc_timer_acc;	// TIM6 ticks not yet making up a whole period
+static uint32_t sim_adc_cont_acc;	// Continuous-mode conversions carried between ticks
+static uint32_t sim_adc_conversions;
+static uint32_t sim_adc_overruns;
+
+static uint32_t sim_adc_channel(uint32_t rank) {
+	const volatile uint32_t *sqr[4] = { &ADC1->SQR1, &ADC1->SQR2, &ADC1->SQR3, &ADC1->SQR4 };
+	uint32_t index = rank + 1;	// SQ1 follows the L field in SQR1
+
+	return (*sqr[index / 5] >> (6 * (index % 5))) & 0x1F;
+}
+
+static void sim_adc_interrupt(uint32_t flags) {
+	if (flags == 0) {
+		return;
+	}
+	ADC1->ISR |= flags;
+	sim_irq(ADC1_2_IRQn, ADC1_2_IRQHandler);
+	ADC1->ISR &= ~flags;
+}
+
+// One conversion of the current rank
+static void sim_adc_convert(void) {
+	uint32_t length = ((ADC1->SQR1 & ADC_SQR1_L) >> ADC_SQR1_L_Pos) + 1;
+	uint32_t channel = sim_adc_channel(sim_adc_rank);
+	uint16_t code = channel < 19 ? sim_adc_value[channel] : 0;
+
+	sim_adc_conversions++;
+	ADC1->DR = code;
+	sim_adc_rank = (sim_adc_rank + 1) % length;
+
+	if (ADC1->CFGR & ADC_CFGR_DMAEN) {
+		// The DMA must take the result before the next conversion, or the ADC overruns
+		if (sim_dma_ready(0) == 0) {
+			sim_adc_overruns++;
+			sim_adc_interrupt((ADC1->IER & ADC_IER_OVR) ? ADC_ISR_OVR : 0);
+			return;
+		}
+		*(uint16_t *)sim_dma_memory(0) = code;
+		sim_dma_interrupt(0, sim_dma_advance(0, 1), DMA1_Channel1_IRQn, DMA1_Channel1_IRQHandler);
+	} else {
+		sim_adc_interrupt((ADC1->IER & ADC_IER_EOC) ? ADC_ISR_EOC : 0);
+	}
+}
+
+// One full regular sequence
+static void sim_adc_sequence(void) {
+	uint32_t length = ((ADC1->SQR1 & ADC_SQR1_L) >> ADC_SQR1_L_Pos) + 1;
+
+	for (uint32_t i = 0; i < length && (ADC1->CR & ADC_CR_ADSTART); i++) {
+		sim_adc_convert();
+	}
+}
+
+// Advance the ADC by one tick
+static void sim_adc_tick(void) {
+	if (sim_adc_stopped) {
+		sim_adc_stopped = 0;
+		sim_adc_rank = 0;	// A new sequence starts at rank 1
+	}
+	if (!(ADC1->CR & ADC_CR_ADEN) || !(ADC1->CR & ADC_CR_ADSTART)) {
+		sim_adc_rank = 0;
+		return;
+	}
+
+	uint32_t exten = ADC1->CFGR & ADC_CFGR_EXTEN;
+	uint32_t extsel = (ADC1->CFGR & ADC_CFGR_EXTSEL) >> ADC_CFGR_EXTSEL_Pos;
+
+	if (exten && extsel == 13) {
+		// TIM6_TRGO: one sequence per timer update
+		if (!(TIM6->CR1 & TIM_CR1_CEN)) {
+			return;
+		}
+		uint32_t ppre1 = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;
+		uint64_t timer_hz = ppre1 < 4 ? sim_pclk1_hz() : 2ULL * sim_pclk1_hz();
+		uint64_t period = (uint64_t)(TIM6->PSC + 1) * (TIM6->ARR + 1) * SIM_TICK_HZ;
+
+		sim_adc_timer_acc += timer_hz;
+		while (sim_adc_timer_acc >= period && (ADC1->CR & ADC_CR_ADSTART)) {
+			sim_adc_timer_acc -= period;
+			sim_adc_sequence();
+		}
+	} else if (exten) {
+		return;		// Other trigger sources are not modelled
+	} else if (ADC1->CFGR & ADC_CFGR_CONT) {
+		sim_adc_cont_acc += SIM_ADC_CONTINUOUS_HZ;
+		while (sim_adc_cont_acc >= SIM_TICK_HZ && (ADC1->CR & ADC_CR_ADSTART)) {
+			sim_adc_cont_acc -= SIM_TICK_HZ;
+			sim_adc_convert();
+		}
+	} else {
+		// Software trigger: one sequence, then ADSTART is cleared by hardware
+		sim_adc_sequence();
+		ADC1->CR &= ~ADC_CR_ADSTART;
+	}
+}
+
+//------------------------------------------------------------------------------
+// USART2 TX model: the transmitter runs at the programmed baud rate (10 bits per
+// byte), fed either by DMA1 Channel 7 or by the TXE interrupt; every byte goes to
+// the capture file
+//------------------------------------------------------------------------------
+#define SIM_UART_TDR_EMPTY 0xFFFF	// Not a valid frame: no byte written during a TXE interrupt
+
+static FILE *sim_uart_out;
+static uint32_t sim_uart_budget;	// Bit times carried between ticks, x SIM_TICK_HZ
+static uint32_t sim_uart_bytes;
+
+static uint32_t sim_uart_baud(void) {
+	uint32_t brr = USART2->BRR;
+
+	if (brr == 0) {
+		return 0;
+	}
+	if (USART2->CR1 & USART_CR1_OVER8) {
+		uint32_t usartdiv = (brr & 0xFFF0) | ((brr & 0x7) << 1);
+		return usartdiv ? 2 * sim_pclk1_hz() / usartdiv : 0;
+	}
+	return sim_pclk1_hz() / brr;
+}
+
+// Interrupt-driven transmission: one USART2 interrupt per byte time while TXEIE or TCIE is
+// set. The byte the handler writes to TDR is sent; once it stops writing, TC is due.
+static void sim_uart_irq_tick(void) {
+	if (!(USART2->CR1 & (USART_CR1_TXEIE | USART_CR1_TCIE))) {
+		sim_uart_budget = 0;
+		return;
+	}
+
+	sim_uart_budget += sim_uart_baud();
+	while (sim_uart_budget >= 10 * SIM_TICK_HZ && (USART2->CR1 & (USART_CR1_TXEIE | USART_CR1_TCIE))) {
+		sim_uart_budget -= 10 * SIM_TICK_HZ;
+		USART2->TDR = SIM_UART_TDR_EMPTY;
+		sim_irq(USART2_IRQn, USART2_IRQHandler);
+		if (USART2->TDR != SIM_UART_TDR_EMPTY) {
+			fputc(USART2->TDR & 0xFF, sim_uart_out);
+			sim_uart_bytes++;
+		}
+	}
+}
+
+static void sim_uart_tick(void) {
+	if ((USART2->CR1 & USART_CR1_UE) && !(USART2->CR3 & USART_CR3_DMAT)) {
+		sim_uart_irq_tick();
+		return;
+	}
+
+	uint32_t pending = sim_dma_ready(6);
+
+	if (!(USART2->CR1 & USART_CR1_UE) || pending == 0) {
+		sim_uart_budget = 0;
+		return;
+	}
+
+	sim_uart_budget += sim_uart_baud();
+	uint32_t count = sim_uart_budget / (10 * SIM_TICK_HZ);
+	if (count == 0) {
+		return;
+	}
+	if (count > pending) {
+		count = pending;
+	}
+	sim_uart_budget -= count * 10 * SIM_TICK_HZ;
+
+	fwrite(sim_dma_memory(6), 1, count, sim_uart_out);
+	sim_uart_bytes += count;
+	sim_dma_interrupt(6, sim_dma_advance(6, count), DMA1_Channel7_IRQn, DMA1_Channel7_IRQHandler);
+}
+
+//------------------------------------------------------------------------------
+// USART2 RX model: scripted text arrives at the programmed baud rate, one RXNE
+// interrupt per byte, followed by the idle-line interrupt. The handler is assumed
+// to read RDR and clear IDLE, which plain RAM registers cannot model.
+//------------------------------------------------------------------------------
+static const char *sim_uart_rx_next;	// Next scripted character, NULL when the line is idle
+static uint32_t sim_uart_rx_budget;
+
+static void sim_uart_rx_start(const char *text) {
+	sim_uart_rx_next = text;
+	sim_uart_rx_budget = 0;
+}
+
+static void sim_uart_rx_tick(void) {
+	if (sim_uart_rx_next == NULL || (USART2->CR1 & (USART_CR1_UE | USART_CR1_RE)) != (USART_CR1_UE | USART_CR1_RE)) {
+		return;
+	}
+
+	sim_uart_rx_budget += sim_uart_baud();
+	while (sim_uart_rx_budget >= 10 * SIM_TICK_HZ && *sim_uart_rx_next != '\0') {
+		sim_uart_rx_budget -= 10 * SIM_TICK_HZ;
+		USART2->RDR = (uint8_t)*sim_uart_rx_next++;
+		sim_reg_set(&USART2->ISR, USART_ISR_RXNE);
+		if (USART2->CR1 & USART_CR1_RXNEIE) {
+			sim_irq(USART2_IRQn, USART2_IRQHandler);
+		}
+		sim_reg_clear(&USART2->ISR, USART_ISR_RXNE);
+	}
+	if (*sim_uart_rx_next == '\0') {
+		sim_uart_rx_next = NULL;
+		sim_reg_set(&USART2->ISR, USART_ISR_IDLE);
+		if (USART2->CR1 & USART_CR1_IDLEIE) {
+			sim_irq(USART2_IRQn, USART2_IRQHandler);
+		}
+		sim_reg_clear(&USART2->ISR, USART_ISR_IDLE);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Stimulus script, one event per line:
+//   <time ms> adc <channel> <code>   input value converted on a channel from then on
+//   <time ms> button                 press of the user button (EXTI0 rising edge)
+//   <time ms> uart <text>            text received on USART2, followed by CR
+//   <time ms> end                    stop the simulation
+// Blank lines and lines starting with '#' are ignored.
+//------------------------------------------------------------------------------
+typedef enum { SIM_EVENT_ADC, SIM_EVENT_BUTTON, SIM_EVENT_UART, SIM_EVENT_END } sim_event_type_t;
+
+typedef struct {
+	uint32_t time_ms;
+	uint8_t type;		// sim_event_type_t
+	uint8_t channel;
+	uint16_t code;
+	char text[SIM_UART_TEXT_LENGTH + 2];	// UART text, with CR
+} sim_event_t;
+
+static sim_event_t sim_events[SIM_MAX_EVENTS];
+static uint32_t sim_event_count;
+static uint32_t sim_event_next;
+
+static void sim_script_load(const char *path) {
+	FILE *file = fopen(path, "r");
+	char line[128];
+
+	if (file == NULL) {
+		fprintf(stderr, "sim: cannot open script %s\n", path);
+		exit(1);
+	}
+	while (fgets(line, sizeof(line), file) && sim_event_count < SIM_MAX_EVENTS) {
+		sim_event_t *event = &sim_events[sim_event_count];
+		char command[16];
+		unsigned time_ms, channel, code;
+
+		if (line[0] == '#' || sscanf(line, "%u %15s", &time_ms, command) != 2) {
+			continue;
+		}
+		event->time_ms = time_ms;
+		if (strcmp(command, "adc") == 0 && sscanf(line, "%*u %*s %u %u", &channel, &code) == 2 && channel < 19) {
+			event->type = SIM_EVENT_ADC;
+			event->channel = (uint8_t)channel;
+			event->code = (uint16_t)(code & 0xFFF);
+		} else if (strcmp(command, "button") == 0) {
+			event->type = SIM_EVENT_BUTTON;
+		} else if (strcmp(command, "uart") == 0 &&
+		           sscanf(line, "%*u %*s %" SIM_STRINGIFY(SIM_UART_TEXT_LENGTH) "[^\r\n]", event->text) == 1) {
+			event->type = SIM_EVENT_UART;
+			strcat(event->text, "\r");
+		} else if (strcmp(command, "end") == 0) {
+			event->type = SIM_EVENT_END;
+		} else {
+			fprintf(stderr, "sim: ignoring script line: %s", line);
+			continue;
+		}
+		sim_event_count++;
+	}
+	fclose(file);
+}
+
+static void sim_finish(uint32_t time_ms) {
+	fflush(sim_uart_out);
+	printf("sim: %lu ms, %lu conversions, %lu ADC overruns, %lu UART bytes\n",
+	       (unsigned long)time_ms, (unsigned long)sim_adc_conversions,
+	       (unsigned long)sim_adc_overruns, (unsigned long)sim_uart_bytes);
+	exit(0);
+}
+
+// Apply every event due at 'time_ms'
+static void sim_script_tick(uint32_t time_ms) {
+	while (sim_event_next < sim_event_count && sim_events[sim_event_next].time_ms <= time_ms) {
+		const sim_event_t *event = &sim_events[sim_event_next++];
+
+		switch (event->type) {
+			case SIM_EVENT_ADC:
+				sim_adc_value[event->channel] = event->code;
+				break;
+			case SIM_EVENT_BUTTON:
+				if (EXTI->IMR1 & EXTI_IMR1_IM0) {
+					EXTI->PR1 |= EXTI_PR1_PIF0;
+					sim_irq(EXTI0_IRQn, EXTI0_IRQHandler);
+					EXTI->PR1 &= ~EXTI_PR1_PIF0;
+				}
+				break;
+			case SIM_EVENT_UART:
+				sim_uart_rx_start(event->text);
+				break;
+			default:
+				sim_finish(time_ms);
+				break;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Hardware task (a plain thread for bare metal): advances every model once per tick
+//------------------------------------------------------------------------------
+static void sim_hw_tick(uint32_t time_ms) {
+	sim_script_tick(time_ms);
+	sim_adc_tick();
+	sim_uart_tick();
+	sim_uart_rx_tick();
+}
+
+#ifdef SIM_BARE_METAL
+static void *sim_hw_thread(void *argument) {
+	struct timespec wake;
+
+	clock_gettime(CLOCK_MONOTONIC, &wake);
+	for (uint32_t tick = 0;; tick++) {
+		sim_hw_tick(tick * (1000 / SIM_TICK_HZ));
+
+		wake.tv_nsec += 1000000000 / SIM_TICK_HZ;
+		if (wake.tv_nsec >= 1000000000) {
+			wake.tv_sec++;
+			wake.tv_nsec -= 1000000000;
+		}
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake, NULL);
+	}
+	return NULL;
+}
+#else
+static void sim_hw_task(void *argument) {
+	TickType_t wake = xTaskGetTickCount();
+
+	for (;;) {
+		sim_hw_tick((uint32_t)(wake * (1000 / SIM_TICK_HZ)));
+		vTaskDelayUntil(&wake, 1);
+	}
+}
+#endif
+
+void sim_hw_init(void) {
+	const char *script = getenv("SIM_SCRIPT");
+	const char *uart_out = getenv("SIM_UART_OUT");
+	pthread_t thread;
+
+	// Reset values that differ from zero: MSI on at 4 MHz (range 6), internal channels at mid-scale
+	RCC->CR = RCC_CR_MSION | RCC_CR_MSIRDY | (6UL << RCC_CR_MSIRANGE_Pos);
+	RCC->CSR = 6UL << RCC_CSR_MSISRANGE_Pos;
+	ADC1->CR = ADC_CR_DEEPPWD;
+	for (uint32_t channel = 0; channel < 19; channel++) {
+		sim_adc_value[channel] = 2048;
+	}
+	sim_adc_value[0] = SIM_VREFINT_CAL;		// VREFINT: VDDA = 3.0 V
+
+	sim_script_load(script ? script : "sim_script.txt");
+	sim_uart_out = fopen(uart_out ? uart_out : "sim_uart.log", "wb");
+	if (sim_uart_out == NULL) {
+		fprintf(stderr, "sim: cannot create UART capture file\n");
+		exit(1);
+	}
+
+	pthread_create(&thread, NULL, sim_register_thread, NULL);
+}
+
+void sim_hw_start(void) {
+#ifdef SIM_BARE_METAL
+	pthread_t thread;
+	pthread_create(&thread, NULL, sim_hw_thread, NULL);
+#else
+	xTaskCreate(sim_hw_task, "Sim Hardware", configMINIMAL_STACK_SIZE, NULL, configMAX_PRIORITIES - 1, NULL);
+#endif
+}
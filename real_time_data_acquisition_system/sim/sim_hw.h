@@ -0,0 +1,81 @@
+#ifndef __SIM_HW_H
+#define __SIM_HW_H
+
+#include <stdint.h>
+#include <limits.h>
+#ifndef SIM_BARE_METAL
+#include "FreeRTOS.h"
+#endif
+
+//------------------------------------------------------------------------------
+// Host simulation of the data acquisition system on the FreeRTOS POSIX port.
+//
+// The application and the drivers are built unchanged against the CMSIS headers;
+// sim/stm32l476xx.h only replaces the instructions a host cannot execute (PRIMASK,
+// WFI, LDREX/STREX). The peripheral register blocks (ADC1, DMA1, USART2, GPIOx,
+// EXTI, RCC, TIM6, ...) and the core peripherals are mapped at their device
+// addresses in RAM. Two models give them behaviour:
+//  - a register thread (plain pthread, never calls the RTOS) that answers the
+//    status flags the drivers poll: calibration done, ADC ready, TEACK, PLL lock...
+//  - a hardware task at the highest priority that advances the peripherals once
+//    per tick: conversions from the scripted input values (software-, continuous-
+//    or TIM6-triggered, with DMA or the EOC interrupt), USART2 TX (DMA or TXE
+//    interrupt) at the programmed baud rate into the capture file, scripted USART2
+//    reception (RXNE and idle-line interrupts), and button presses. Interrupt
+//    handlers are called from this task with interrupts masked, as the NVIC would.
+//
+// The bare-metal variant (../real_time_data_acquisition_system_BareMetal) runs on the
+// same models without the RTOS (SIM_BARE_METAL): the hardware task becomes a thread
+// and WFI waits for the next handler.
+//
+// Both variants are built by ../host/CMakeLists.txt (RTDAS_SIM=ON), 32-bit since the
+// drivers store buffer addresses in 32-bit DMA registers, against the FreeRTOS POSIX
+// port; see there for the flags and the dependencies.
+//
+// Environment:
+//   SIM_SCRIPT    stimulus script (default sim_script.txt, see sim/example_script.txt)
+//   SIM_UART_OUT  file receiving everything transmitted on USART2 (default sim_uart.log)
+//------------------------------------------------------------------------------
+
+#ifdef SIM_BARE_METAL
+#define SIM_TICK_HZ           1000	// Model update rate
+#else
+#define SIM_TICK_HZ           configTICK_RATE_HZ
+
+// Extra stack depth per task: every task runs on a pthread of at least PTHREAD_STACK_MIN bytes
+#define SIM_TASK_STACK_EXTRA  (PTHREAD_STACK_MIN / sizeof(StackType_t))
+#endif
+
+// Factory VREFINT calibration: a typical part, VREFINT = 1.212 V converted at VDDA = 3.0 V
+#define SIM_VREFINT_CAL       1655
+
+// Continuous-mode conversion rate; matches the 640.5-cycle sampling time at 4 MHz
+#define SIM_ADC_CONTINUOUS_HZ 6000
+
+// Longest stimulus script, in events
+#define SIM_MAX_EVENTS        256
+
+// Longest text of a scripted UART reception
+#define SIM_UART_TEXT_LENGTH  30
+#define SIM_STRINGIFY(x)      SIM_STRINGIFY_(x)
+#define SIM_STRINGIFY_(x)     #x
+
+// Start the register thread and load the stimulus script. Call first thing in main().
+void sim_hw_init(void);
+
+// Create the hardware task. Call after the application tasks, before vTaskStartScheduler(),
+// or, for bare metal, once the peripherals are configured.
+void sim_hw_start(void);
+
+// Core and interrupt controller, mapped by sim/stm32l476xx.h and sim/cmsis_nvic_virtual.h
+uint32_t sim_get_primask(void);
+void sim_set_primask(uint32_t primask);
+void sim_disable_irq(void);
+void sim_enable_irq(void);
+void sim_wfi(void);
+void sim_nvic_enable(int irq);
+void sim_nvic_disable(int irq);
+void sim_nvic_set_priority(int irq, uint32_t priority);
+uint32_t sim_nvic_get_priority(int irq);
+
+#endif /* __SIM_HW_H */
@@ -0,0 +1,53 @@
+#ifndef __SIM_STM32L476XX_H
+#define __SIM_STM32L476XX_H
+
+//------------------------------------------------------------------------------
+// Host simulation: the CMSIS device header, unchanged. The register blocks live at
+// their device addresses (sim_hw.c maps those regions before main() runs), so the
+// peripheral instances, the core_cm4.h helpers and fixed addresses such as
+// VREFINT_CAL_ADDR all reach the models. Only the instructions that have no host
+// equivalent are replaced below.
+//------------------------------------------------------------------------------
+
+#include_next "stm32l476xx.h"
+#include <stdlib.h>
+
+// Interrupt masking and sleep map onto the interrupt model of sim_hw.c
+uint32_t sim_get_primask(void);
+void sim_set_primask(uint32_t primask);
+void sim_disable_irq(void);
+void sim_enable_irq(void);
+void sim_wfi(void);
+
+#define __get_PRIMASK()     sim_get_primask()
+#define __set_PRIMASK(x)    sim_set_primask(x)
+#define __disable_irq()     sim_disable_irq()
+#define __enable_irq()      sim_enable_irq()
+#define __DSB()             __sync_synchronize()
+#define __DMB()             __sync_synchronize()
+#define __ISB()             __sync_synchronize()
+#define __WFI()             sim_wfi()
+#define __NOP()             ((void)0)
+
+// Exclusive access: the value seen by LDREX is kept per thread, and STREX becomes a
+// compare-and-swap against it, so it fails whenever another context wrote in between
+// (a write of the same value goes unnoticed, which the ring algorithms tolerate)
+static __thread uint32_t sim_exclusive_value;
+
+static inline uint32_t sim_ldrexw(volatile uint32_t *addr) {
+    sim_exclusive_value = __atomic_load_n(addr, __ATOMIC_SEQ_CST);
+    return sim_exclusive_value;
+}
+
+static inline uint32_t sim_strexw(uint32_t value, volatile uint32_t *addr) {
+    return !__sync_bool_compare_and_swap(addr, sim_exclusive_value, value);
+}
+
+#undef __LDREXW
+#undef __STREXW
+#undef __CLREX
+#define __LDREXW(addr)          sim_ldrexw(addr)
+#define __STREXW(value, addr)   sim_strexw((value), (addr))
+#define __CLREX()               ((void)0)
+
+#endif /* __SIM_STM32L476XX_H */
@@ -0,0 +1,127 @@
+#include "telemetry.h"
+
+uint16_t telemetry_crc16(const uint8_t *data, size_t length) {
+	uint16_t crc = 0xFFFF;
+
+	while (length--) {
+		crc ^= (uint16_t)(*data++) << 8;
+		for (uint32_t bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+//------------------------------------------------------------------------------
+// COBS (Consistent Overhead Byte Stuffing)
+// Every run of up to 254 non-zero bytes is prefixed with a code byte holding
+// the distance to the next zero, and the zero itself is dropped.
+//------------------------------------------------------------------------------
+size_t cobs_encode(const uint8_t *in, size_t length, uint8_t *out) {
+	size_t read = 0;
+	size_t write = 1;
+	size_t code_index = 0;
+	uint8_t code = 1;
+
+	while (read < length) {
+		if (in[read] == 0) {
+			out[code_index] = code;
+			code = 1;
+			code_index = write++;
+			read++;
+		} else {
+			out[write++] = in[read++];
+			if (++code == 0xFF) {
+				out[code_index] = code;
+				code = 1;
+				code_index = write++;
+			}
+		}
+	}
+	out[code_index] = code;
+	return write;
+}
+
+size_t cobs_decode(const uint8_t *in, size_t length, uint8_t *out) {
+	size_t read = 0;
+	size_t write = 0;
+
+	while (read < length) {
+		uint8_t code = in[read++];
+		if (code == 0 || read + code - 1 > length) {
+			return 0;
+		}
+		for (uint32_t i = 1; i < code; i++) {
+			if (in[read] == 0) {
+				return 0;
+			}
+			out[write++] = in[read++];
+		}
+		// A code below 0xFF stands for a zero, except at the end of the frame
+		if (code != 0xFF && read < length) {
+			out[write++] = 0;
+		}
+	}
+	return write;
+}
+
+static uint8_t *put_u16(uint8_t *p, uint16_t value) {
+	p[0] = (uint8_t)value;
+	p[1] = (uint8_t)(value >> 8);
+	return p + 2;
+}
+
+static uint16_t get_u16(const uint8_t *p) {
+	return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+size_t telemetry_encode(const telemetry_packet_t *packet, uint8_t *out) {
+	uint8_t raw[TELEMETRY_MAX_PACKET];
+	uint8_t *p = raw;
+	uint32_t count = packet->count;
+
+	if (count > TELEMETRY_MAX_ENTRIES) {
+		count = TELEMETRY_MAX_ENTRIES;
+	}
+
+	p = put_u16(p, packet->sequence);
+	p = put_u16(p, (uint16_t)packet->timestamp);
+	p = put_u16(p, (uint16_t)(packet->timestamp >> 16));
+	*p++ = (uint8_t)count;
+	for (uint32_t i = 0; i < count; i++) {
+		*p++ = packet->entries[i].channel;
+		p = put_u16(p, packet->entries[i].raw);
+		p = put_u16(p, (uint16_t)packet->entries[i].value);
+	}
+	p = put_u16(p, telemetry_crc16(raw, (size_t)(p - raw)));
+
+	size_t length = cobs_encode(raw, (size_t)(p - raw), out);
+	out[length++] = 0x00;	// Frame delimiter
+	return length;
+}
+
+int telemetry_parse(const uint8_t *data, size_t length, telemetry_packet_t *packet) {
+	if (length < TELEMETRY_HEADER_SIZE + TELEMETRY_CRC_SIZE) {
+		return 0;
+	}
+
+	uint32_t count = data[6];
+	if (count > TELEMETRY_MAX_ENTRIES ||
+	    length != TELEMETRY_HEADER_SIZE + count * TELEMETRY_ENTRY_SIZE + TELEMETRY_CRC_SIZE) {
+		return 0;
+	}
+	if (telemetry_crc16(data, length - TELEMETRY_CRC_SIZE) != get_u16(&data[length - TELEMETRY_CRC_SIZE])) {
+		return 0;
+	}
+
+	packet->sequence = get_u16(&data[0]);
+	packet->timestamp = get_u16(&data[2]) | ((uint32_t)get_u16(&data[4]) << 16);
+	packet->count = (uint8_t)count;
+	for (uint32_t i = 0; i < count; i++) {
+		const uint8_t *entry = &data[TELEMETRY_HEADER_SIZE + i * TELEMETRY_ENTRY_SIZE];
+		packet->entries[i].channel = entry[0];
+		packet->entries[i].raw = get_u16(&entry[1]);
+		packet->entries[i].value = (int16_t)get_u16(&entry[3]);
+	}
+	return 1;
+}
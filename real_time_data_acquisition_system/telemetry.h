@@ -0,0 +1,56 @@
+#ifndef __TELEMETRY_H
+#define __TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------
+// Binary telemetry packet, little endian, before framing:
+//   sequence   uint16  packet counter
+//   timestamp  uint32  RTOS tick (ms) when the samples were acquired
+//   count      uint8   number of channel entries that follow
+//   count x { channel uint8, raw uint16, value int16 }
+//   crc        uint16  CRC-16/CCITT-FALSE over all preceding bytes
+// The packet is COBS-encoded (so it contains no 0x00 bytes) and terminated by a
+// single 0x00 delimiter. This file has no target dependencies and is shared with
+// the host-side decoder.
+//------------------------------------------------------------------------------
+
+#define TELEMETRY_MAX_ENTRIES   4
+#define TELEMETRY_HEADER_SIZE   7
+#define TELEMETRY_ENTRY_SIZE    5
+#define TELEMETRY_CRC_SIZE      2
+#define TELEMETRY_MAX_PACKET    (TELEMETRY_HEADER_SIZE + TELEMETRY_MAX_ENTRIES * TELEMETRY_ENTRY_SIZE + TELEMETRY_CRC_SIZE)
+// COBS adds one byte per started 254-byte run, plus the 0x00 delimiter
+#define TELEMETRY_MAX_FRAME     (TELEMETRY_MAX_PACKET + 1 + 1)
+
+typedef struct {
+	uint8_t channel;	// ADC input channel
+	uint16_t raw;		// Filtered ADC code
+	int16_t value;		// Converted value: centi-degrees C for the temperature sensor, mV for VREFINT
+} telemetry_entry_t;
+
+typedef struct {
+	uint16_t sequence;
+	uint32_t timestamp;
+	uint8_t count;
+	telemetry_entry_t entries[TELEMETRY_MAX_ENTRIES];
+} telemetry_packet_t;
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF)
+uint16_t telemetry_crc16(const uint8_t *data, size_t length);
+
+// COBS encode 'length' bytes; 'out' needs length + length / 254 + 1 bytes. Returns the encoded length.
+size_t cobs_encode(const uint8_t *in, size_t length, uint8_t *out);
+
+// COBS decode one frame (without its 0x00 delimiter). Returns the decoded length, or 0 if malformed.
+size_t cobs_decode(const uint8_t *in, size_t length, uint8_t *out);
+
+// Serialize, append the CRC, COBS-encode and append the delimiter.
+// 'out' needs TELEMETRY_MAX_FRAME bytes. Returns the number of bytes to transmit.
+size_t telemetry_encode(const telemetry_packet_t *packet, uint8_t *out);
+
+// Parse a COBS-decoded packet. Returns 1 if the length and CRC are valid, 0 otherwise.
+int telemetry_parse(const uint8_t *data, size_t length, telemetry_packet_t *packet);
+
+#endif /* __TELEMETRY_H */
@@ -0,0 +1,42 @@
+#include "temp_convert.h"
+
+//------------------------------------------------------------------------------
+// Calibration table
+// The table is generated by the preprocessor from the coefficients in
+// temp_convert.h, so changing a coefficient regenerates all 4096 entries at
+// build time. Every entry is a constant expression evaluated by the compiler;
+// nothing is computed at run time.
+//------------------------------------------------------------------------------
+
+// Microvolts per hundredth of a degree
+#define TEMP_LUT_SCALE  (TEMP_SENSOR_UV_PER_DEGREE / 100)
+
+// Positive bias (a multiple of TEMP_LUT_SCALE) so the numerator is never negative
+// and the division rounds to nearest instead of truncating toward zero
+#define TEMP_LUT_BIAS   ((TEMP_SENSOR_OFFSET_UV / TEMP_LUT_SCALE + 1) * TEMP_LUT_SCALE)
+
+#define TEMP_CENTI_C(code)                                                       \
+	((int16_t)((((uint32_t)(code) * TEMP_SENSOR_UV_PER_CODE + TEMP_LUT_BIAS     \
+	             - TEMP_SENSOR_OFFSET_UV + TEMP_LUT_SCALE / 2) / TEMP_LUT_SCALE) \
+	           - (int32_t)(TEMP_LUT_BIAS / TEMP_LUT_SCALE)))
+
+#define TEMP_LUT_1(c)     TEMP_CENTI_C(c),
+#define TEMP_LUT_4(c)     TEMP_LUT_1(c)    TEMP_LUT_1((c) + 1)     TEMP_LUT_1((c) + 2)     TEMP_LUT_1((c) + 3)
+#define TEMP_LUT_16(c)    TEMP_LUT_4(c)    TEMP_LUT_4((c) + 4)     TEMP_LUT_4((c) + 8)     TEMP_LUT_4((c) + 12)
+#define TEMP_LUT_64(c)    TEMP_LUT_16(c)   TEMP_LUT_16((c) + 16)   TEMP_LUT_16((c) + 32)   TEMP_LUT_16((c) + 48)
+#define TEMP_LUT_256(c)   TEMP_LUT_64(c)   TEMP_LUT_64((c) + 64)   TEMP_LUT_64((c) + 128)  TEMP_LUT_64((c) + 192)
+#define TEMP_LUT_1024(c)  TEMP_LUT_256(c)  TEMP_LUT_256((c) + 256) TEMP_LUT_256((c) + 512) TEMP_LUT_256((c) + 768)
+#define TEMP_LUT_4096(c)  TEMP_LUT_1024(c) TEMP_LUT_1024((c) + 1024) TEMP_LUT_1024((c) + 2048) TEMP_LUT_1024((c) + 3072)
+
+static const int16_t temp_centi_c_lut[TEMP_LUT_SIZE] = {
+	TEMP_LUT_4096(0)
+};
+
+int32_t temp_code_to_centi_c(uint32_t adc_code) {
+	return temp_centi_c_lut[adc_code & (TEMP_LUT_SIZE - 1)];
+}
+
+int32_t temp_code_to_centi_c_float(uint32_t adc_code) {
+	float voltage = (0.00081 * adc_code);	// voltage in V
+	return (int32_t)((voltage - 0.5) * 10000);
+}
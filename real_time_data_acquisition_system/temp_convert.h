@@ -0,0 +1,21 @@
+#ifndef __TEMP_CONVERT_H
+#define __TEMP_CONVERT_H
+
+#include <stdint.h>
+
+// Sensor coefficients (analog temperature sensor on PA1, 12-bit ADC)
+#define TEMP_SENSOR_UV_PER_CODE    810     // 0.00081 V per ADC code
+#define TEMP_SENSOR_OFFSET_UV      500000  // 0.5 V output at 0 C
+#define TEMP_SENSOR_UV_PER_DEGREE  10000   // 10 mV per degree C
+
+// One table entry per ADC code
+#define TEMP_ADC_BITS      12
+#define TEMP_LUT_SIZE      (1U << TEMP_ADC_BITS)
+
+// Fixed-point path: ADC code -> temperature in hundredths of a degree C (table lookup)
+int32_t temp_code_to_centi_c(uint32_t adc_code);
+
+// Floating-point reference path: the original voltage/temperature formula, same units
+int32_t temp_code_to_centi_c_float(uint32_t adc_code);
+
+#endif /* __TEMP_CONVERT_H */
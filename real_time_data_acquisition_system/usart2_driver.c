@@ -1,4 +1,5 @@
 #include "usart2_driver.h"
+#include <string.h>
 
 // UART Ports:
 // ===================================================
@@ -6,6 +7,9 @@
 // PA3 = USART2_RX (AF7)
 
 
+static uint32_t usart2_baud_requested = USART2_BAUD;	// Kept for USART2_ClockChanged()
+usart_baud_t usart2_baud;
+
 // This function initializes the USART2 module
 void USART2_Init(void) {
 	// Enable the USART2 clock in the APB1 peripheral clock enable register
@@ -13,7 +17,7 @@ void USART2_Init(void) {
 	// Initialize the TX and RX pins for USART2 communication
 	USART2_Pin_Init();
 	// Set up USART2 with the specified configurations
-	USART_Init(USART2);
+	USART_Init(USART2, usart2_baud_requested, &usart2_baud);
 
 }
 // This function initializes the GPIO pins used for USART2 communication.
@@ -34,9 +38,9 @@ void USART2_Pin_Init(void) {
 
 // This function initializes USART module with specified settings for communication.
 // This function is modular and can be utilized with any USART module passed as an argument.
-void USART_Init (USART_TypeDef * USARTx) {
+void USART_Init (USART_TypeDef * USARTx, uint32_t baud, usart_baud_t *result) {
 	// data format to be set: 8 data bits, no parity, 1 start bit, and 1 stop bit		
-	// baud rate to be set: 9600
+	// baud rate to be set: 'baud'
 	
 	// Disabling USART to allow configuration
 	USARTx->CR1 &= ~USART_CR1_UE;  
@@ -49,15 +53,8 @@ void USART_Init (USART_TypeDef * USARTx) {
 	// STOP bits settings: 00 = 1 Stop bit, 01 = 0.5 Stop bit, 10 = 2 Stop bits, 11 = 1.5 Stop bits
 	USARTx->CR2 &= ~USART_CR2_STOP;
 	
-	// Setting the oversampling mode to 16 
-	// OVER8 = 0 for oversampling by 16, 1 for oversampling by 8
-	USARTx->CR1 &= ~USART_CR1_OVER8;  
-	
-                                    
-	// Setting the baud rate to 9600 using the default APB frequency of 4,000,000 Hz
-	// Calculation depends on the oversampling mode: if OVER8 = 0 (16x), BRR = f_CK / USARTDIV
-	// For 9600 baud with f_CK = 4,000,000 Hz and 16x oversampling: USARTDIV = 4,000,000 / 9,600 = 417
-	USARTx->BRR  = 417; 
+	// Setting the oversampling mode (OVER8) and the baud rate from the current kernel clock
+	USART_SetBaudRate(USARTx, baud, result);
 
 	// Enabling the transmitter and receiver
 	USARTx->CR1  |= (USART_CR1_RE | USART_CR1_TE);  
@@ -77,36 +74,335 @@ void USART_Init (USART_TypeDef * USARTx) {
 	//while ( (USARTx->ISR & USART_ISR_REACK) == 0); 
 }
 
-/*
-// This function serves as the interrupt handler for USART2.
-void USART2_IRQHandler(void){
-	uint8_t data;
+//-------------------------------------------------------------------------------------------
+// Baud rate
+// BRR is computed from the USART kernel clock at the time of the call, so a clock change
+// (clock_set() in clock_manager.h) needs the rate to be set again: USART2_ClockChanged().
+// Oversampling by 16 is used while the kernel clock is at least 16x the baud rate; faster
+// rates switch to oversampling by 8, which reaches kernel clock / 8 (10 Mbaud at 80 MHz).
+//-------------------------------------------------------------------------------------------
+static const uint8_t usart_ahb_shift[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9 };
+
+uint32_t USART_KernelClock(USART_TypeDef * USARTx) {
+	uint32_t sel, ppre;
+
+	SystemCoreClockUpdate();	// HCLK, in case the clock was changed since the last update
+	if (USARTx == USART1) {
+		sel  = (RCC->CCIPR & RCC_CCIPR_USART1SEL) >> RCC_CCIPR_USART1SEL_Pos;
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos;	// APB2
+	} else if (USARTx == USART3) {
+		sel  = (RCC->CCIPR & RCC_CCIPR_USART3SEL) >> RCC_CCIPR_USART3SEL_Pos;
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;	// APB1
+	} else {
+		sel  = (RCC->CCIPR & RCC_CCIPR_USART2SEL) >> RCC_CCIPR_USART2SEL_Pos;
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;	// APB1
+	}
+
+	switch (sel) {
+		case 1:  return SystemCoreClock << usart_ahb_shift[(RCC->CFGR & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos];	// SYSCLK
+		case 2:  return USART_HSI16_HZ;
+		case 3:  return USART_LSE_HZ;
+		default: return ppre < 4 ? SystemCoreClock : SystemCoreClock >> (ppre - 3);	// PCLK: APB prescaler 1..16
+	}
+}
+
+int USART_SetBaudRate(USART_TypeDef * USARTx, uint32_t baud, usart_baud_t *result) {
+	uint32_t kernel_hz = USART_KernelClock(USARTx);
+	uint32_t over8 = 0;
+	uint32_t usartdiv = 0;
+	uint32_t actual = 0;
+	int32_t error_ppm = 0;
+
+	if (baud != 0) {
+		// Oversampling by 16: USARTDIV = f_CK / baud, rounded to nearest
+		usartdiv = (uint32_t)(((uint64_t)kernel_hz + baud / 2) / baud);
+		if (usartdiv < 16) {
+			// Oversampling by 8: USARTDIV = 2 * f_CK / baud
+			over8 = 1;
+			usartdiv = (uint32_t)((2 * (uint64_t)kernel_hz + baud / 2) / baud);
+		}
+		if (usartdiv >= 16 && usartdiv <= 0xFFFF) {
+			actual = (uint32_t)(((uint64_t)kernel_hz << over8) / usartdiv);
+			error_ppm = (int32_t)(((int64_t)actual - baud) * 1000000 / baud);
+		}
+	}
+	if (result != NULL) {
+		result->kernel_hz = kernel_hz;
+		result->baud = actual;
+		result->error_ppm = error_ppm;
+		result->over8 = over8;
+	}
+	if (actual == 0 || error_ppm > USART_BAUD_MAX_ERROR_PPM || error_ppm < -USART_BAUD_MAX_ERROR_PPM) {
+		return 0;
+	}
+
+	// With OVER8, BRR[2:0] = USARTDIV[3:0] >> 1 and BRR[3] must be 0
+	uint32_t brr = over8 ? (usartdiv & 0xFFF0) | ((usartdiv & 0xF) >> 1) : usartdiv;
+
+	// BRR and OVER8 can only be written while the USART is disabled
+	uint32_t enabled = USARTx->CR1 & USART_CR1_UE;
+	if (enabled) {
+		while ((USARTx->CR1 & USART_CR1_TE) && !(USARTx->ISR & USART_ISR_TC));	// Let the byte in flight finish
+		USARTx->CR1 &= ~USART_CR1_UE;
+	}
+	USARTx->CR1 = over8 ? (USARTx->CR1 | USART_CR1_OVER8) : (USARTx->CR1 & ~USART_CR1_OVER8);
+	USARTx->BRR = brr;
+	if (enabled) {
+		USARTx->CR1 |= USART_CR1_UE;
+		while ((USARTx->CR1 & USART_CR1_TE) && !(USARTx->ISR & USART_ISR_TEACK));
+	}
+	return 1;
+}
+
+static uint32_t USART2_TxStop(void);
+
+int USART2_SetBaudRate(uint32_t baud) {
+	usart_baud_t result;
+
+	uint32_t primask = USART2_TxStop();
+	int applied = USART_SetBaudRate(USART2, baud, &result);
+	__set_PRIMASK(primask);
+	if (!applied) {
+		return 0;
+	}
+	usart2_baud_requested = baud;
+	usart2_baud = result;
+	return 1;
+}
+
+int USART2_ClockChanged(void) {
+	return USART2_SetBaudRate(usart2_baud_requested);
+}
+
+//-------------------------------------------------------------------------------------------
+// USART2 transmit ring buffer
+// Producers copy bytes into usart2_tx_buffer and return immediately. DMA1 Channel 7 moves the
+// bytes from the ring into USART2_TDR; each transfer covers the contiguous run of pending bytes
+// up to the end of the buffer, and the transfer-complete interrupt starts the next run.
+// usart2_tx_head and usart2_tx_tail are free-running counters, masked when indexing the buffer.
+//-------------------------------------------------------------------------------------------
+static uint8_t usart2_tx_buffer[USART2_TX_BUFFER_SIZE];
+static volatile uint32_t usart2_tx_head = 0;		// Total bytes written by producers
+static volatile uint32_t usart2_tx_tail = 0;		// Total bytes handed to the USART
+static volatile uint32_t usart2_tx_dma_length = 0;	// Bytes in the running DMA transfer (0 = idle)
+static usart2_tx_callback_t usart2_tx_callback;
+
+volatile uint32_t usart2_tx_rejected = 0;
+
+// This function configures DMA1 Channel 7 to drain the USART2 transmit ring buffer.
+void USART2_TxInit(usart2_tx_callback_t callback) {
+	usart2_tx_callback = callback;
+	
+	// Enable the DMA1 clock
+	RCC->AHB1ENR |= RCC_AHB1ENR_DMA1EN;
+	
+	// Disable the channel before configuring it
+	DMA1_Channel7->CCR &= ~DMA_CCR_EN;
 	
-	// Check if the RXNE (Receive Not Empty) interrupt is triggered, indicating new data is available in the USART_RDR register.
-	if(USART2->ISR & USART_ISR_RXNE) {	
+	// Route request 2 (USART2_TX) to DMA1 Channel 7: C7S[3:0] = 0010
+	DMA1_CSELR->CSELR &= ~DMA_CSELR_C7S;
+	DMA1_CSELR->CSELR |= (2U << DMA_CSELR_C7S_Pos);
+	
+	// Destination: USART2 transmit data register
+	DMA1_Channel7->CPAR = (uint32_t) &USART2->TDR;
+	
+	// DIR = 1: read from memory; MINC = 1; PSIZE = MSIZE = 00 (8-bit); interrupt on transfer complete
+	DMA1_Channel7->CCR = DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_TCIE;
+	
+	// The completion callback may call into the RTOS, so stay below configMAX_SYSCALL_INTERRUPT_PRIORITY
+	NVIC_SetPriority(DMA1_Channel7_IRQn, 5);
+	NVIC_EnableIRQ(DMA1_Channel7_IRQn);
+	
+	// Let USART2 issue a DMA request whenever TDR is empty
+	USART2->CR3 |= USART_CR3_DMAT;
+}
+
+// Start a DMA transfer for the next contiguous run of pending bytes.
+// Must run with interrupts masked or from the DMA interrupt itself.
+static void USART2_TxStart(void) {
+	uint32_t pending = usart2_tx_head - usart2_tx_tail;
+	uint32_t index = usart2_tx_tail & (USART2_TX_BUFFER_SIZE - 1);
+	
+	if (usart2_tx_dma_length != 0 || pending == 0) {
+		return; // Transfer already running, or nothing to send
+	}
+	
+	// Stop at the end of the buffer; the wrapped part follows in the next transfer
+	if (pending > USART2_TX_BUFFER_SIZE - index) {
+		pending = USART2_TX_BUFFER_SIZE - index;
+	}
+	usart2_tx_dma_length = pending;
+	
+	DMA1_Channel7->CCR &= ~DMA_CCR_EN;
+	DMA1_Channel7->CMAR  = (uint32_t) &usart2_tx_buffer[index];
+	DMA1_Channel7->CNDTR = pending;
+	DMA1_Channel7->CCR |= DMA_CCR_EN;
+}
+
+// Bring transmission to a stop for a change of BRR: clearing UE while the DMA is running would
+// lose the byte it writes into TDR meanwhile. Waits until the ring has drained and masks
+// interrupts from the moment it is empty, so no producer can queue more before the change.
+// With interrupts already masked the DMA interrupt cannot move the tail: then only the running
+// transfer is waited for, and its completion interrupt sends the rest once they are unmasked.
+// Returns the PRIMASK to restore; USART_SetBaudRate() then waits for TC.
+static uint32_t USART2_TxStop(void) {
+	uint32_t primask = __get_PRIMASK();
+	
+	for (;;) {
+		__disable_irq();
+		if (primask || usart2_tx_head == usart2_tx_tail) {
+			break;
+		}
+		__set_PRIMASK(primask);
+		while (usart2_tx_head != usart2_tx_tail);	// Moved on by the DMA interrupt
+	}
+	while (usart2_tx_dma_length != 0 && DMA1_Channel7->CNDTR != 0);	// Last byte into TDR
+	return primask;
+}
+
+uint32_t USART2_Write(const uint8_t *data, uint32_t length) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if (length > USART2_TX_BUFFER_SIZE - (usart2_tx_head - usart2_tx_tail)) {
+		usart2_tx_rejected++;
+		__set_PRIMASK(primask);
+		return 0;
+	}
+	
+	// Copy in at most two pieces: up to the end of the buffer, then from the start
+	uint32_t index = usart2_tx_head & (USART2_TX_BUFFER_SIZE - 1);
+	uint32_t first = USART2_TX_BUFFER_SIZE - index;
+	if (first > length) {
+		first = length;
+	}
+	memcpy(&usart2_tx_buffer[index], data, first);
+	memcpy(usart2_tx_buffer, data + first, length - first);
+	usart2_tx_head += length;
+	
+	USART2_TxStart();
+	
+	__set_PRIMASK(primask);
+	return length;
+}
+
+uint32_t USART2_WriteString(const char *str) {
+	return USART2_Write((const uint8_t *) str, strlen(str));
+}
+
+uint32_t USART2_TxPending(void) {
+	return usart2_tx_head - usart2_tx_tail;
+}
+
+uint32_t USART2_TxHead(void) {
+	return usart2_tx_head;
+}
+
+uint32_t USART2_TxTail(void) {
+	return usart2_tx_tail;
+}
+
+void USART2_TxFlush(void) {
+	while (usart2_tx_head != usart2_tx_tail);		// Wait until the DMA has handed every byte to the USART
+	while ((USART2->ISR & USART_ISR_TC) == 0);	// Wait until the last frame has left the shift register
+}
+
+// This function serves as the interrupt handler for DMA1 Channel 7 (USART2_TX).
+void DMA1_Channel7_IRQHandler(void) {
+	if ((DMA1->ISR & DMA_ISR_TCIF7) == DMA_ISR_TCIF7) {
+		DMA1->IFCR = DMA_IFCR_CTCIF7;
 		
-		// Read data from the receiver data register (RDR), which also clears the RXNE flag.		
-		data = USART2->RDR;         
+		// The finished run is free again; continue with whatever was queued meanwhile
+		usart2_tx_tail += usart2_tx_dma_length;
+		usart2_tx_dma_length = 0;
+		USART2_TxStart();
 		
-		if(data == '1')
-		{
-			// Set TIMx_CR1 CEN bit to enable the timers 
-			TIM2->CR1  |= TIM_CR1_CEN; 
-			TIM4->CR1  |= TIM_CR1_CEN; 
-
-			// Turn on the LED to indicate active status.
-			turn_on_LED();
-		}
-		if(data == '2')
-		{
-			// Clear TIMx_CR1 CEN bit to disable the timers 
-			TIM2->CR1  &= ~TIM_CR1_CEN; 
-			TIM4->CR1  &= ~TIM_CR1_CEN; 
-			// Turn off the LED to indicate inactive status.
-			turn_off_LED();
+		if (usart2_tx_callback) {
+			usart2_tx_callback();
 		}
+	}
+}
 
-	} 
+//-------------------------------------------------------------------------------------------
+// USART2 receive ring buffer
+// The RXNE interrupt stores each byte in usart2_rx_buffer. The consumer (the command
+// interpreter) reads the bytes where they are and releases them once a line is done, so the
+// interrupt never overwrites a line that is still being parsed. Single producer (interrupt),
+// single consumer: usart2_rx_head is only written by the interrupt, usart2_rx_tail only by
+// the consumer. Both are free-running counters, masked when indexing the buffer.
+//-------------------------------------------------------------------------------------------
+static uint8_t usart2_rx_buffer[USART2_RX_BUFFER_SIZE];
+static volatile uint32_t usart2_rx_head = 0;		// Total bytes received
+static volatile uint32_t usart2_rx_tail = 0;		// Total bytes released by the consumer
+static usart2_rx_callback_t usart2_rx_callback;
 
+volatile uint32_t usart2_rx_overrun = 0;
+
+// This function registers the receive callback and enables the idle-line interrupt.
+void USART2_RxInit(usart2_rx_callback_t callback) {
+	usart2_rx_callback = callback;
+	
+	// The callback may call into the RTOS, so stay below configMAX_SYSCALL_INTERRUPT_PRIORITY
+	NVIC_SetPriority(USART2_IRQn, 5);
+	USART2->ICR = USART_ICR_IDLECF;
+	USART2->CR1 |= USART_CR1_IDLEIE;
+}
+
+const uint8_t *USART2_RxRing(void) {
+	return usart2_rx_buffer;
+}
+
+uint32_t USART2_RxHead(void) {
+	uint32_t head = usart2_rx_head;
+	__DMB();	// Read the bytes only after the head that publishes them
+	return head;
+}
+
+uint32_t USART2_RxTail(void) {
+	return usart2_rx_tail;
+}
+
+void USART2_RxRelease(uint32_t position) {
+	__DMB();	// Finish reading before the slots are handed back
+	usart2_rx_tail = position;
+}
+
+// This function serves as the interrupt handler for USART2: store received bytes and wake the
+// consumer at the end of each line or burst.
+void USART2_IRQHandler(void) {
+	uint32_t isr = USART2->ISR;
+	uint32_t wake = 0;
+	
+	// Overrun: a byte arrived before the previous one was read
+	if (isr & USART_ISR_ORE) {
+		USART2->ICR = USART_ICR_ORECF;
+		usart2_rx_overrun++;
+	}
+	
+	// Received data: reading RDR clears RXNE
+	if (isr & USART_ISR_RXNE) {
+		uint8_t data = (uint8_t)USART2->RDR;
+		uint32_t head = usart2_rx_head;
+		uint32_t used = head - usart2_rx_tail;
+		
+		if (used < USART2_RX_BUFFER_SIZE) {
+			usart2_rx_buffer[head & (USART2_RX_BUFFER_SIZE - 1)] = data;
+			__DMB();	// Store the byte before publishing it
+			usart2_rx_head = head + 1;
+			// End of a line, or a long line about to fill the ring
+			wake = (data == '\r' || data == '\n' || used + 1 == USART2_RX_BUFFER_SIZE / 2);
+		} else {
+			usart2_rx_overrun++;	// Ring full: the consumer is behind
+		}
+	}
+	
+	// Idle line: one frame time without reception after a burst
+	if (isr & USART_ISR_IDLE) {
+		USART2->ICR = USART_ICR_IDLECF;
+		wake = 1;
+	}
+	
+	if (wake && usart2_rx_callback) {
+		usart2_rx_callback();
+	}
 }
-*/
@@ -12,8 +12,95 @@ void USART2_Init(void);
 // This function initializes the GPIO pins used for USART2 communication.
 void USART2_Pin_Init(void);
 
+// Baud rate setting, as computed by USART_SetBaudRate()
+typedef struct {
+	uint32_t kernel_hz;	// USART kernel clock the divider was computed from
+	uint32_t baud;		// Nearest rate the divider can produce (0: none)
+	int32_t error_ppm;	// Deviation of 'baud' from the requested rate, in parts per million
+	uint8_t over8;		// 1 - oversampling by 8, for rates above kernel_hz / 16
+} usart_baud_t;
+
+#define USART_BAUD_MAX_ERROR_PPM 20000	// 2 %: beyond this, a rate is refused
+#define USART_HSI16_HZ 16000000
+#define USART_LSE_HZ   32768
+
 // This function initializes USART module with specified settings for communication.
 // This function is modular and can be utilized with any USART module passed as an argument.
-void USART_Init(USART_TypeDef * USARTx);
+// 'result' (may be NULL) receives the baud rate setting, see USART_SetBaudRate().
+void USART_Init(USART_TypeDef * USARTx, uint32_t baud, usart_baud_t *result);
+
+// Kernel clock of USART1..3 as selected in RCC_CCIPR (PCLK by default), from the current
+// clock configuration. Updates SystemCoreClock.
+uint32_t USART_KernelClock(USART_TypeDef * USARTx);
+
+// Program BRR and OVER8 for 'baud' from the current kernel clock, up to kernel clock / 8.
+// Returns 1 once programmed, 0 if the rate is out of range or off by more than
+// USART_BAUD_MAX_ERROR_PPM (the USART is left unchanged). 'result' (may be NULL) receives the
+// nearest rate either way. An enabled USART is briefly disabled after its current byte.
+int USART_SetBaudRate(USART_TypeDef * USARTx, uint32_t baud, usart_baud_t *result);
+
+// Baud rate set by USART2_Init()
+#ifndef USART2_BAUD
+#define USART2_BAUD 9600
+#endif
+
+extern usart_baud_t usart2_baud; // Current USART2 setting
+
+// Change the USART2 baud rate. Returns 1 if applied, 0 if the rate cannot be produced from
+// the current clock (the previous rate is kept). Waits for the TX ring to drain first; called
+// with interrupts masked, only for the running DMA transfer, and the rest follows at the new rate.
+int USART2_SetBaudRate(uint32_t baud);
+
+// Recompute the USART2 divider for the current baud rate; call after every clock change.
+// Returns 0 if the rate cannot be produced from the new clock.
+int USART2_ClockChanged(void);
+
+// USART2 transmit ring buffer, drained by DMA1 Channel 7 (size must be a power of two)
+#define USART2_TX_BUFFER_SIZE 256
+
+// Called from the DMA interrupt each time a transfer has completed and ring space was freed
+typedef void (*usart2_tx_callback_t)(void);
+
+extern volatile uint32_t usart2_tx_rejected; // Writes refused because the ring was full
+
+// This function configures DMA1 Channel 7 to drain the USART2 transmit ring buffer.
+void USART2_TxInit(usart2_tx_callback_t callback);
+
+// Non-blocking enqueue: copies all 'length' bytes into the ring and returns 'length',
+// or copies nothing and returns 0 if they do not fit. Safe to call from tasks and interrupts.
+uint32_t USART2_Write(const uint8_t *data, uint32_t length);
+uint32_t USART2_WriteString(const char *str);
+
+// Number of bytes queued but not yet handed to the USART
+uint32_t USART2_TxPending(void);
+
+// Free-running ring positions, for tracking when a write has been sent: bytes before
+// USART2_TxTail() have been handed to the USART, USART2_TxHead() is just past the last byte
+// written. Both are current for the TX callback.
+uint32_t USART2_TxHead(void);
+uint32_t USART2_TxTail(void);
+
+// Wait until every queued byte has left the shift register
+void USART2_TxFlush(void);
+
+// USART2 receive ring buffer, filled by the RXNE interrupt (size must be a power of two)
+#define USART2_RX_BUFFER_SIZE 64
+
+// Called from the USART2 interrupt when a line has ended (CR or LF), when the line goes idle
+// after receiving, and when the ring reaches half full
+typedef void (*usart2_rx_callback_t)(void);
+
+extern volatile uint32_t usart2_rx_overrun; // Bytes lost: ring full, or USART overrun (ORE)
+
+// This function registers the receive callback. Call after USART2_Init().
+void USART2_RxInit(usart2_rx_callback_t callback);
+
+// Zero-copy access for the single consumer: received bytes are read in place in the ring,
+// at free-running positions masked with USART2_RX_BUFFER_SIZE - 1. Bytes from the tail up to
+// the head are valid; they stay untouched until the consumer releases them.
+const uint8_t *USART2_RxRing(void);
+uint32_t USART2_RxHead(void);				// Position after the last byte received
+uint32_t USART2_RxTail(void);				// Position of the oldest byte not released
+void USART2_RxRelease(uint32_t position);	// Hand every byte before 'position' back to the ring
 
 #endif /* __STM32L476G_USART2_H */
\ No newline at end of file
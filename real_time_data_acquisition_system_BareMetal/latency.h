@@ -0,0 +1,103 @@
+#ifndef __LATENCY_H
+#define __LATENCY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+//------------------------------------------------------------------------------
+// Pipeline latency instrumentation
+// Samples are stamped with a free-running 32-bit counter when converted, and
+// re-stamped at each hand-off. The difference between two stamps is recorded
+// in a per-stage histogram with power-of-two microsecond buckets.
+// Time source: the DWT cycle counter on target, clock_gettime(CLOCK_MONOTONIC)
+// in nanoseconds when built with LATENCY_HOST_CLOCK (host simulation).
+// Stamps wrap after 2^32 ticks (about 53 s at 80 MHz, 4.3 s on the host), which
+// bounds the longest latency that can be measured.
+//------------------------------------------------------------------------------
+
+#ifdef LATENCY_HOST_CLOCK
+#include <time.h>
+
+static inline uint32_t latency_now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+#define LATENCY_TICKS_PER_US 1000
+#else
+#include "stm32l476xx.h"
+
+static inline uint32_t latency_now(void) {
+	return DWT->CYCCNT;
+}
+
+#define LATENCY_TICKS_PER_US (SystemCoreClock / 1000000)
+#endif
+
+// Pipeline stages, in the order a sample passes through them
+typedef enum {
+	LATENCY_STAGE_ACQUIRE = 0,	// Conversion to hand-off (unused: the EOC interrupt is the hand-off)
+	LATENCY_STAGE_QUEUE,		// EOC interrupt to the main loop picking the sample up
+	LATENCY_STAGE_PROCESS,		// Conversion and queuing of the line for one sample
+	LATENCY_STAGE_TX,			// Line queued into the TX ring until its last byte has been sent
+	LATENCY_STAGE_END_TO_END,	// Conversion until the line's last byte has been sent
+	LATENCY_STAGES
+} latency_stage_t;
+
+// Bucket 0 counts latencies below 2 us, bucket b latencies in [2^b, 2^(b+1)) us,
+// and the last bucket everything from 2^(LATENCY_BUCKETS-1) us up
+#define LATENCY_BUCKETS 16
+
+typedef struct {
+	uint32_t count;
+	uint32_t min_us;
+	uint32_t max_us;
+	uint64_t sum_us;
+	uint32_t buckets[LATENCY_BUCKETS];
+} latency_histogram_t;
+
+// Start the time source and clear the histograms; ticks_per_us is the stamp rate,
+// LATENCY_TICKS_PER_US once SystemCoreClock is up to date
+void latency_init(uint32_t ticks_per_us);
+
+// Record the time between two stamps. Each stage must be recorded from a single context.
+void latency_record(latency_stage_t stage, uint32_t start, uint32_t end);
+
+// Snapshot of one histogram, and reset of all of them
+void latency_get(latency_stage_t stage, latency_histogram_t *out);
+void latency_reset(void);
+
+// Upper bound in us of the bucket holding the given percentile (0-100); 0 if nothing recorded
+uint32_t latency_percentile_us(const latency_histogram_t *hist, uint32_t percent);
+
+// Short stage name for reports
+const char *latency_stage_name(latency_stage_t stage);
+
+//------------------------------------------------------------------------------
+// Transmit completion: a line written into the UART TX ring is registered with
+// the ring position just past its last byte, and closed by the TX interrupt once
+// the driver has sent up to that position. Bytes sent after the line in the same
+// uninterrupted run are taken off at one frame time each, so the stamp is that of
+// the line's own last byte. Closing records LATENCY_STAGE_TX (from 'queued') and
+// LATENCY_STAGE_END_TO_END (from 'sampled'), from the TX interrupt only.
+//------------------------------------------------------------------------------
+
+#define LATENCY_TX_LINES 32	// Lines in the TX ring measured at once (power of two)
+
+extern volatile uint32_t latency_tx_untracked;	// Lines not measured: LATENCY_TX_LINES already pending
+
+// Register a line ending at ring position 'end'. Call with interrupts masked, in the same
+// masked section as the write, so the TX interrupt cannot send the line before it is known.
+void latency_tx_queued(uint32_t end, uint32_t sampled, uint32_t queued);
+
+// TX interrupt: every byte before ring position 'sent' has been sent, the last one just now;
+// frame_ticks is the time of one frame on the wire in stamp ticks
+void latency_tx_sent(uint32_t sent, uint32_t frame_ticks);
+
+// One-line summary of a stage, short enough for a message pool block:
+// "<name> <p50>/<p99>/<max>us n=<count>", where p50 and p99 are bucket upper bounds.
+// Returns the snprintf() result.
+int latency_format(latency_stage_t stage, char *buffer, size_t size);
+
+#endif /* __LATENCY_H */
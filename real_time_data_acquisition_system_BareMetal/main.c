@@ -4,18 +4,61 @@
 #include "usart2_driver.h"
 #include "button.h"
 #include "led.h"
+#include "latency.h"
+#include "bench.h"
+#include "log.h"
 //#include "trcRecorder.h"
+#ifdef SIMULATION
+#include "sim_hw.h"
+#endif
 
 
+// Benchmark build: 1 - run the common workload of bench.h and print its report
+#ifndef BENCHMARK
+#define BENCHMARK 0
+#endif
+
 // Constants
-#define TEMP_BUFFER_LENGTH 25 
+#define TEMP_BUFFER_LENGTH 25
+#if BENCHMARK
+#define SAMPLE_RATE_HZ BENCH_SAMPLE_RATE_HZ
+#define SAMPLES_PER_LINE BENCH_SAMPLES_PER_LINE
+#else
+#define SAMPLE_RATE_HZ 10 // Conversions per second, triggered by TIM6
+#define SAMPLES_PER_LINE 1 // Samples per temperature line
+#endif
+
+// Events posted by the interrupt handlers and consumed by the main loop
+#define EVENT_ADC_SAMPLE  (1UL << 0) // A conversion result is waiting in sample_code
+#define EVENT_BUTTON      (1UL << 1) // The user button was pressed
+#define EVENT_UART_TX     (1UL << 2) // Every queued UART byte has been transmitted
+
+// Longest formatted log line; the log is only drained while the TX ring has this much room
+#define LOG_LINE_LENGTH 48
+
+// Log messages, recorded from interrupts and printed by the main loop
+enum {
+    LOG_BUTTON_IRQ,
+    LOG_SAMPLE_OVERRUN,
+};
+
+const char * const log_formats[] = {
+    [LOG_BUTTON_IRQ]     = "EXTI0 interrupt\n\r",
+    [LOG_SAMPLE_OVERRUN] = "Sample overrun: %lu\n\r",
+};
+const uint32_t log_format_count = sizeof(log_formats) / sizeof(log_formats[0]);
 
 // Global variables
 char tempC_buffer[TEMP_BUFFER_LENGTH]; // Temperature buffer
 uint32_t temperature_C; // Temperature in Celsius
 float voltage_raw; // Raw voltage value from sensor
 float voltage; // Voltage in mV (stored after conversion)
-volatile uint8_t button_pressed = 0; // Flag for button press
+volatile uint32_t pending_events; // EVENT_* bits set by interrupts, cleared by the main loop
+volatile uint32_t sample_code; // Latest conversion result
+volatile uint32_t sample_stamp; // Latency stamp of sample_code
+uint32_t samples_since_line; // Samples processed since the last temperature line
+volatile uint32_t sample_overrun; // Samples replaced before the main loop processed them
+uint32_t lines_dropped; // Lines lost because the UART ring was full
 
 //------------------------------------------------------------------------------
 // Function Prototypes
@@ -24,56 +67,185 @@ void send_string_via_usart(const char *str);
 void process_sensor_data(void);
 void handle_button_press(void);
 void EXTI0_IRQHandler(void);
+void adc_sample_ready(uint32_t sample);
+void uart_tx_done(void);
+void report_bench(void);
+void drain_log(void);
+
+// Post events from interrupt context. All handlers run at the same NVIC priority and cannot
+// preempt each other, so the read-modify-write only has to be protected in the main loop.
+static void post_event(uint32_t events) {
+    pending_events |= events;
+}
+
+// Take every pending event, or sleep until an interrupt posts one.
+// Interrupts are masked between the check and WFI, so an event posted in between still ends
+// the sleep: WFI wakes on a pending interrupt even with PRIMASK set, which then runs as soon
+// as PRIMASK is cleared.
+static uint32_t wait_for_events(void) {
+    for (;;) {
+        __disable_irq();
+        uint32_t events = pending_events;
+        pending_events = 0;
+        if (events == 0) {
+            uint32_t start = latency_now();
+            __WFI();
+            bench_idle(start, latency_now()); // The handler has not run yet: only sleep is counted
+        }
+        __enable_irq();
+        if (events != 0) {
+            return events;
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+// Transmit latency: a temperature line is registered with the TX ring position
+// of its end as it is written, and the transmission-complete interrupt closes
+// the measurement once the ring has drained, with the line's last byte off the
+// wire (latency_tx_sent() in latency.h).
+//------------------------------------------------------------------------------
+
+// Queue a line that reports the sample converted at 'sampled'
+static void send_tracked_line(const char *str, uint32_t sampled) {
+    uint32_t queued = latency_now();
+    __disable_irq(); // The TC interrupt must not see the line sent before it is registered
+    if (USART2_WriteString(str)) {
+        latency_tx_queued(USART2_TxHead(), sampled, queued);
+    } else {
+        lines_dropped++;
+    }
+    __enable_irq();
+}
+
+// Time of one 10-bit frame at the current baud rate, in latency stamp ticks
+static uint32_t usart_frame_ticks(void) {
+    if (usart2_baud.baud == 0) {
+        return 0;
+    }
+    return (uint32_t)((uint64_t)LATENCY_TICKS_PER_US * 10000000u / usart2_baud.baud);
+}
 
 int main(void) {
+#ifdef SIMULATION
+    sim_hw_init(); // Register model first: the drivers below poll status flags
+#endif
+
     // Configuration
     config_button_pin();
     config_EXTI();
     led_gpio_config();
-    
+
     // Initialization
     SystemCoreClockUpdate();
+    latency_init(LATENCY_TICKS_PER_US);
+    log_init();
+    bench_init(LATENCY_TICKS_PER_US);
     ADC_Init();
     USART2_Init();
-		
+    USART2_TxInit(uart_tx_done);
+    ADC_Timer_Init(SAMPLE_RATE_HZ, adc_sample_ready);
+
 		//vTraceEnable(TRC_START);
-	
+
     led_off(); // LED initial state
     send_string_via_usart("Temperature Sensor Initialized\n\r");
 
+    ADC_Timer_Start(); // Conversions now run at SAMPLE_RATE_HZ without CPU involvement
+
+#ifdef SIMULATION
+    sim_hw_start(); // Peripheral models, scripted stimulus and UART capture
+#endif
+
+    // Event loop: the core sleeps in WFI whenever no event is pending
     while (1) {
-			  
-        // Sensor acquisition
-        ADC1->CR |= ADC_CR_ADSTART; // Start ADC conversion
-        voltage_raw = adc_result; // Capture ADC result
-        ADC1->CR &= ~ADC_CR_ADSTART; // Stop ADC conversion
+        uint32_t events = wait_for_events();
+
+        // Sensor acquisition: one temperature line per SAMPLES_PER_LINE samples
+        if (events & EVENT_ADC_SAMPLE) {
+            __disable_irq();
+            uint32_t code = sample_code;
+            uint32_t stamp = sample_stamp;
+            __enable_irq();
 
-        // Process sensor data
-        process_sensor_data();
+            uint32_t stamp_start = latency_now();
+            latency_record(LATENCY_STAGE_QUEUE, stamp, stamp_start);
+            bench_samples(1);
+            if (++samples_since_line >= SAMPLES_PER_LINE) {
+                samples_since_line = 0;
+                voltage_raw = code; // Capture ADC result
+                process_sensor_data();
+                send_tracked_line(tempC_buffer, stamp);
+            }
+            latency_record(LATENCY_STAGE_PROCESS, stamp_start, latency_now());
+        }
 
         // Handle button press if detected
-        if (button_pressed) {
+        if (events & EVENT_BUTTON) {
             handle_button_press();
-            button_pressed = 0; // Reset flag
         }
 
-        // Simulate periodic delay
-        for (volatile int i = 0; i < 10000; i++);
+        // UART idle: report lines that did not fit while it was busy
+        if ((events & EVENT_UART_TX) && lines_dropped) {
+            snprintf(tempC_buffer, TEMP_BUFFER_LENGTH, "Dropped %u lines\n\r", (unsigned)lines_dropped);
+            lines_dropped = 0;
+            send_string_via_usart(tempC_buffer);
+        }
+
+#if BENCHMARK
+        report_bench();
+#endif
+        drain_log();
     }
 }
 
+// Print deferred log records, as far as the TX ring has room. Whatever is left waits for the
+// next event: the ring drains (EVENT_UART_TX) or a new interrupt comes in.
+void drain_log(void) {
+    char line[LOG_LINE_LENGTH];
+    static uint32_t dropped_reported;
+
+    while (USART2_TX_BUFFER_SIZE - USART2_TxPending() >= LOG_LINE_LENGTH) {
+        uint32_t dropped = log_dropped;
+        if (dropped != dropped_reported) {
+            snprintf(line, sizeof(line), "Log overflow: %lu lost\n\r", (unsigned long)(dropped - dropped_reported));
+            dropped_reported = dropped;
+        } else if (log_drain(line, sizeof(line)) == 0) {
+            break;
+        }
+        send_string_via_usart(line);
+    }
+}
+
+// Benchmark report every BENCH_REPORT_PERIOD_MS. It is longer than most of the TX ring, so a
+// report that does not fit is kept and retried once the ring has drained.
+void report_bench(void) {
+    static char report[BENCH_REPORT_SIZE];
+    static uint8_t report_pending;
+
+    if (!report_pending && bench_due()) {
+        bench_report("baremetal", report, sizeof(report));
+        report_pending = 1;
+    }
+    if (report_pending && USART2_WriteString(report)) {
+        report_pending = 0;
+    }
+}
+
+// Queue a string for interrupt-driven transmission; never waits for the UART
 void send_string_via_usart(const char *str) {
-    while (*str) {
-        while (!(USART2->ISR & USART_ISR_TXE)); // Wait until TXE (Transmit Data Register Empty)
-        USART2->TDR = *str++; // Load the next character into TDR
+    if (!USART2_WriteString(str)) {
+        lines_dropped++; // Ring full: the line is lost, reported once the UART is idle
     }
 }
 
+// Convert the captured sample and format the line into tempC_buffer
 void process_sensor_data(void) {
+    uint32_t start = latency_now();
     voltage = (0.00081 * voltage_raw);
     temperature_C = (voltage - 0.5) * 100;
+    bench_convert(start, latency_now()); // The conversion only, not the formatting
     sprintf(tempC_buffer, "Temperature: %u C\n\r", temperature_C);
-    send_string_via_usart(tempC_buffer);
 }
 
 void handle_button_press(void) {
@@ -82,11 +254,27 @@ void handle_button_press(void) {
     led_off();
 }
 
+// ADC callback (interrupt context): one conversion triggered by TIM6 has completed
+void adc_sample_ready(uint32_t sample) {
+    if (pending_events & EVENT_ADC_SAMPLE) {
+        sample_overrun++; // The previous sample was never processed
+        LOG1(LOG_SAMPLE_OVERRUN, sample_overrun);
+    }
+    sample_code = sample;
+    sample_stamp = latency_now();
+    post_event(EVENT_ADC_SAMPLE);
+}
+
+// USART2 callback (interrupt context): the transmit ring has drained
+void uart_tx_done(void) {
+    latency_tx_sent(USART2_TxTail(), usart_frame_ticks());
+    post_event(EVENT_UART_TX);
+}
+
 void EXTI0_IRQHandler(void) {
-		led_on(); // indicator for interrupt start
     if ((EXTI->PR1 & EXTI_PR1_PIF0) == EXTI_PR1_PIF0) {
         EXTI->PR1 |= EXTI_PR1_PIF0; // Clear interrupt flag
-        button_pressed = 1; // Set flag for button press       
+        LOG0(LOG_BUTTON_IRQ); // Time-stamped entry, in place of the LED timing indicator
+        post_event(EVENT_BUTTON); // Handled by the main loop
     }
-		led_off(); // indicator for interrupt stop
 }
@@ -4,6 +4,8 @@
 
 volatile uint32_t adc_result = 0; //Definition of global variable 'adc_result' declared in "ADC.h"
 
+static adc_sample_callback_t adc_sample_callback;
+
 //-------------------------------------------------------------------------------------------
 // ADC1 Wakeup
 // By default, the ADC modules are in deep-power-down mode where their power supply is internally switched off
@@ -184,8 +186,112 @@ void ADC1_2_IRQHandler(void){
   ADC1->ISR |= ADC_ISR_EOC;
 	// Read the sampled data from ADC1_DR and store it in the global variable 'adc_result'
 	adc_result = ADC1->DR;
+	if (adc_sample_callback) {
+		adc_sample_callback(adc_result);
+	}
+	}
+
+}
+
+
+//-------------------------------------------------------------------------------------------
+// 	Timer-triggered sampling
+//  TIM6 runs at the sample rate and its update event is routed to TRGO (MMS = 010). ADC1
+//  converts once on each rising edge of TIM6_TRGO (EXTSEL = 1101, EXTEN = 01), so the sample
+//  period is set by the timer alone. Each result is handed to the callback from the EOC
+//  interrupt.
+//-------------------------------------------------------------------------------------------
+
+// Counter clock of TIM6: PCLK1, doubled by hardware when the APB1 prescaler is not 1
+static uint32_t ADC_Timer_ClockHz(void){
+	uint32_t ppre1 = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;
+	
+	if (ppre1 < 4) {
+		return SystemCoreClock;		// 0xx: HCLK not divided
 	}
+	return (SystemCoreClock >> (ppre1 - 3)) * 2;	// 100: /2, 101: /4, 110: /8, 111: /16
+}
+
+// Fastest sample rate: a conversion must end before the next trigger, and every result costs an
+// EOC interrupt. Conversion time = sampling time (SMPx) + 12.5 ADC clock cycles, ADC clock = HCLK.
+uint32_t ADC_Timer_GetMaxRate(void){
+	static const uint16_t smp_half_cycles[8] = { 5, 13, 25, 49, 95, 185, 495, 1281 };
+	uint32_t channel = (ADC1->SQR1 & ADC_SQR1_SQ1) >> ADC_SQR1_SQ1_Pos;
+	uint32_t smp;
+	
+	if (channel < 10) {
+		smp = (ADC1->SMPR1 >> (3 * channel)) & 7UL;
+	} else {
+		smp = (ADC1->SMPR2 >> (3 * (channel - 10))) & 7UL;
+	}
+	return (uint32_t)((uint64_t)SystemCoreClock * 2 / (smp_half_cycles[smp] + 25));
+}
+
+// Configure TIM6 as the conversion trigger. Must be called after ADC_Init(); returns the
+// sample rate actually programmed.
+uint32_t ADC_Timer_Init(uint32_t sample_rate_hz, adc_sample_callback_t callback){
+	
+	adc_sample_callback = callback;
+	
+	// 1. Enable the clock of TIM6 and stop the counter
+	RCC->APB1ENR1 |= RCC_APB1ENR1_TIM6EN;
+	TIM6->CR1 = 0;
+	
+	// 2. ARPE = 1: buffered ARR, so rate changes take effect at the next update
+	//    MMS[2:0] = 010: the update event is output on TRGO
+	TIM6->CR1 = TIM_CR1_ARPE;
+	TIM6->CR2 = (TIM6->CR2 & ~TIM_CR2_MMS) | TIM_CR2_MMS_1;
+	
+	// 3. Program the period and load PSC and ARR with an update event while the ADC is idle
+	uint32_t actual = ADC_Timer_SetRate(sample_rate_hz);
+	TIM6->EGR = TIM_EGR_UG;
+	TIM6->SR = 0;
+	
+	// 4. One conversion per trigger: EXTSEL[3:0] = 1101 (TIM6_TRGO), EXTEN[1:0] = 01 (rising edge)
+	ADC1->CFGR &= ~(ADC_CFGR_CONT | ADC_CFGR_EXTSEL | ADC_CFGR_EXTEN);
+	ADC1->CFGR |= (13UL << ADC_CFGR_EXTSEL_Pos) | ADC_CFGR_EXTEN_0;
+	
+	return actual;
+}
+
+// Set the sample rate (also while running); returns the rate actually programmed, 0 if out of range
+uint32_t ADC_Timer_SetRate(uint32_t sample_rate_hz){
+	uint32_t clock_hz = ADC_Timer_ClockHz();
+	
+	uint32_t max_rate_hz = ADC_Timer_GetMaxRate();
+	
+	if (sample_rate_hz == 0 || sample_rate_hz > clock_hz || sample_rate_hz > max_rate_hz) {
+		return 0;
+	}
+	
+	// Period in timer ticks, split into a 16-bit prescaler and a 16-bit auto-reload value
+	uint32_t period_ticks = clock_hz / sample_rate_hz;
+	uint32_t prescaler = (period_ticks - 1) / 65536;
+	uint32_t reload = period_ticks / (prescaler + 1) - 1;
+	if (reload < 1) {
+		return 0;	// ARR = 0 stops the timer: the rate is within one tick of the timer clock
+	}
+	if (clock_hz / ((prescaler + 1) * (reload + 1)) > max_rate_hz) {
+		return 0;	// Rounding of the period would push the rate past the conversion time
+	}
+	
+	TIM6->PSC = prescaler;
+	TIM6->ARR = reload;
+	return clock_hz / ((prescaler + 1) * (reload + 1));
+}
+
+// Arm the ADC for hardware triggers, then start the timer
+void ADC_Timer_Start(void){
+	ADC1->CR |= ADC_CR_ADSTART;
+	TIM6->CNT = 0;
+	TIM6->CR1 |= TIM_CR1_CEN;
+}
 
+// Stop the timer, then the ADC
+void ADC_Timer_Stop(void){
+	TIM6->CR1 &= ~TIM_CR1_CEN;
+	ADC1->CR |= ADC_CR_ADSTP;
+	while((ADC1->CR & ADC_CR_ADSTART) == ADC_CR_ADSTART); // ADSTART is cleared once the ADC has stopped
 }
 
 
@@ -20,6 +20,22 @@ void ADC_Common_Configuration(void);
 // Modular function to initialize ADC
 void ADC_Init(void);
 
+// Called from the ADC interrupt with every conversion result
+typedef void (*adc_sample_callback_t)(uint32_t sample);
+
+// Modular function to trigger conversions from TIM6 at a fixed rate; returns the rate programmed
+uint32_t ADC_Timer_Init(uint32_t sample_rate_hz, adc_sample_callback_t callback);
+
+// Change the sample rate (also while running); returns the rate programmed, 0 if out of range
+uint32_t ADC_Timer_SetRate(uint32_t sample_rate_hz);
+
+// Fastest sample rate the configured channel can be converted at with the current clock
+uint32_t ADC_Timer_GetMaxRate(void);
+
+// Start/stop timer-triggered sampling
+void ADC_Timer_Start(void);
+void ADC_Timer_Stop(void);
+
 
 
 #endif /* __STM32L476G_ADC_H */
@@ -1,4 +1,5 @@
 #include "usart2_driver.h"
+#include <string.h>
 
 // UART Ports:
 // ===================================================
@@ -6,6 +7,9 @@
 // PA3 = USART2_RX (AF7)
 
 
+static uint32_t usart2_baud_requested = USART2_BAUD;	// Kept for USART2_ClockChanged()
+usart_baud_t usart2_baud;
+
 // This function initializes the USART2 module
 void USART2_Init(void) {
 	// Enable the USART2 clock in the APB1 peripheral clock enable register
@@ -13,7 +17,7 @@ void USART2_Init(void) {
 	// Initialize the TX and RX pins for USART2 communication
 	USART2_Pin_Init();
 	// Set up USART2 with the specified configurations
-	USART_Init(USART2);
+	USART_Init(USART2, usart2_baud_requested, &usart2_baud);
 
 }
 // This function initializes the GPIO pins used for USART2 communication.
@@ -34,9 +38,9 @@ void USART2_Pin_Init(void) {
 
 // This function initializes USART module with specified settings for communication.
 // This function is modular and can be utilized with any USART module passed as an argument.
-void USART_Init (USART_TypeDef * USARTx) {
+void USART_Init (USART_TypeDef * USARTx, uint32_t baud, usart_baud_t *result) {
 	// data format to be set: 8 data bits, no parity, 1 start bit, and 1 stop bit		
-	// baud rate to be set: 9600
+	// baud rate to be set: 'baud'
 	
 	// Disabling USART to allow configuration
 	USARTx->CR1 &= ~USART_CR1_UE;  
@@ -49,15 +53,8 @@ void USART_Init (USART_TypeDef * USARTx) {
 	// STOP bits settings: 00 = 1 Stop bit, 01 = 0.5 Stop bit, 10 = 2 Stop bits, 11 = 1.5 Stop bits
 	USARTx->CR2 &= ~USART_CR2_STOP;
 	
-	// Setting the oversampling mode to 16 
-	// OVER8 = 0 for oversampling by 16, 1 for oversampling by 8
-	USARTx->CR1 &= ~USART_CR1_OVER8;  
-	
-                                    
-	// Setting the baud rate to 9600 using the default APB frequency of 4,000,000 Hz
-	// Calculation depends on the oversampling mode: if OVER8 = 0 (16x), BRR = f_CK / USARTDIV
-	// For 9600 baud with f_CK = 4,000,000 Hz and 16x oversampling: USARTDIV = 4,000,000 / 9,600 = 417
-	USARTx->BRR  = 417; 
+	// Setting the oversampling mode (OVER8) and the baud rate from the current kernel clock
+	USART_SetBaudRate(USARTx, baud, result);
 
 	// Enabling the transmitter and receiver
 	USARTx->CR1  |= (USART_CR1_RE | USART_CR1_TE);  
@@ -77,6 +74,189 @@ void USART_Init (USART_TypeDef * USARTx) {
 	//while ( (USARTx->ISR & USART_ISR_REACK) == 0); 
 }
 
+//-------------------------------------------------------------------------------------------
+// Baud rate
+// BRR is computed from the USART kernel clock at the time of the call, so a clock change
+// (e.g. to 80 MHz by system_clock_80MHz()) needs the rate to be set again afterwards.
+// Oversampling by 16 is used while the kernel clock is at least 16x the baud rate; faster
+// rates switch to oversampling by 8, which reaches kernel clock / 8 (10 Mbaud at 80 MHz).
+//-------------------------------------------------------------------------------------------
+static const uint8_t usart_ahb_shift[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 6, 7, 8, 9 };
+
+uint32_t USART_KernelClock(USART_TypeDef * USARTx) {
+	uint32_t sel, ppre;
+
+	SystemCoreClockUpdate();	// HCLK, in case the clock was changed since the last update
+	if (USARTx == USART1) {
+		sel  = (RCC->CCIPR & RCC_CCIPR_USART1SEL) >> RCC_CCIPR_USART1SEL_Pos;
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE2) >> RCC_CFGR_PPRE2_Pos;	// APB2
+	} else if (USARTx == USART3) {
+		sel  = (RCC->CCIPR & RCC_CCIPR_USART3SEL) >> RCC_CCIPR_USART3SEL_Pos;
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;	// APB1
+	} else {
+		sel  = (RCC->CCIPR & RCC_CCIPR_USART2SEL) >> RCC_CCIPR_USART2SEL_Pos;
+		ppre = (RCC->CFGR & RCC_CFGR_PPRE1) >> RCC_CFGR_PPRE1_Pos;	// APB1
+	}
+
+	switch (sel) {
+		case 1:  return SystemCoreClock << usart_ahb_shift[(RCC->CFGR & RCC_CFGR_HPRE) >> RCC_CFGR_HPRE_Pos];	// SYSCLK
+		case 2:  return USART_HSI16_HZ;
+		case 3:  return USART_LSE_HZ;
+		default: return ppre < 4 ? SystemCoreClock : SystemCoreClock >> (ppre - 3);	// PCLK: APB prescaler 1..16
+	}
+}
+
+int USART_SetBaudRate(USART_TypeDef * USARTx, uint32_t baud, usart_baud_t *result) {
+	uint32_t kernel_hz = USART_KernelClock(USARTx);
+	uint32_t over8 = 0;
+	uint32_t usartdiv = 0;
+	uint32_t actual = 0;
+	int32_t error_ppm = 0;
+
+	if (baud != 0) {
+		// Oversampling by 16: USARTDIV = f_CK / baud, rounded to nearest
+		usartdiv = (uint32_t)(((uint64_t)kernel_hz + baud / 2) / baud);
+		if (usartdiv < 16) {
+			// Oversampling by 8: USARTDIV = 2 * f_CK / baud
+			over8 = 1;
+			usartdiv = (uint32_t)((2 * (uint64_t)kernel_hz + baud / 2) / baud);
+		}
+		if (usartdiv >= 16 && usartdiv <= 0xFFFF) {
+			actual = (uint32_t)(((uint64_t)kernel_hz << over8) / usartdiv);
+			error_ppm = (int32_t)(((int64_t)actual - baud) * 1000000 / baud);
+		}
+	}
+	if (result != NULL) {
+		result->kernel_hz = kernel_hz;
+		result->baud = actual;
+		result->error_ppm = error_ppm;
+		result->over8 = over8;
+	}
+	if (actual == 0 || error_ppm > USART_BAUD_MAX_ERROR_PPM || error_ppm < -USART_BAUD_MAX_ERROR_PPM) {
+		return 0;
+	}
+
+	// With OVER8, BRR[2:0] = USARTDIV[3:0] >> 1 and BRR[3] must be 0
+	uint32_t brr = over8 ? (usartdiv & 0xFFF0) | ((usartdiv & 0xF) >> 1) : usartdiv;
+
+	// BRR and OVER8 can only be written while the USART is disabled
+	uint32_t enabled = USARTx->CR1 & USART_CR1_UE;
+	if (enabled) {
+		while ((USARTx->CR1 & USART_CR1_TE) && !(USARTx->ISR & USART_ISR_TC));	// Let the byte in flight finish
+		USARTx->CR1 &= ~USART_CR1_UE;
+	}
+	USARTx->CR1 = over8 ? (USARTx->CR1 | USART_CR1_OVER8) : (USARTx->CR1 & ~USART_CR1_OVER8);
+	USARTx->BRR = brr;
+	if (enabled) {
+		USARTx->CR1 |= USART_CR1_UE;
+		while ((USARTx->CR1 & USART_CR1_TE) && !(USARTx->ISR & USART_ISR_TEACK));
+	}
+	return 1;
+}
+
+int USART2_SetBaudRate(uint32_t baud) {
+	usart_baud_t result;
+
+	if (!USART_SetBaudRate(USART2, baud, &result)) {
+		return 0;
+	}
+	usart2_baud_requested = baud;
+	usart2_baud = result;
+	return 1;
+}
+
+int USART2_ClockChanged(void) {
+	return USART2_SetBaudRate(usart2_baud_requested);
+}
+
+//------------------------------------------------------------------------------
+// Interrupt-driven transmission
+// Producers copy bytes into usart2_tx_buffer and return immediately. The TXE
+// interrupt feeds the USART one byte at a time; once the ring is empty it
+// switches to the TC interrupt, which reports that the last byte has left the
+// shift register. usart2_tx_head and usart2_tx_tail are free-running counters,
+// masked when indexing the buffer.
+//------------------------------------------------------------------------------
+static uint8_t usart2_tx_buffer[USART2_TX_BUFFER_SIZE];
+static volatile uint32_t usart2_tx_head = 0;		// Total bytes written by producers
+static volatile uint32_t usart2_tx_tail = 0;		// Total bytes handed to the USART
+static usart2_tx_callback_t usart2_tx_callback;
+
+volatile uint32_t usart2_tx_rejected = 0;
+
+// This function registers the completion callback. Call after USART2_Init().
+void USART2_TxInit(usart2_tx_callback_t callback) {
+	usart2_tx_callback = callback;
+}
+
+uint32_t USART2_Write(const uint8_t *data, uint32_t length) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	
+	if (length > USART2_TX_BUFFER_SIZE - (usart2_tx_head - usart2_tx_tail)) {
+		usart2_tx_rejected++;
+		__set_PRIMASK(primask);
+		return 0;
+	}
+	
+	for (uint32_t i = 0; i < length; i++) {
+		usart2_tx_buffer[(usart2_tx_head + i) & (USART2_TX_BUFFER_SIZE - 1)] = data[i];
+	}
+	usart2_tx_head += length;
+	
+	// Start (or keep) feeding the transmitter
+	USART2->CR1 = (USART2->CR1 & ~USART_CR1_TCIE) | USART_CR1_TXEIE;
+	
+	__set_PRIMASK(primask);
+	return length;
+}
+
+uint32_t USART2_WriteString(const char *str) {
+	return USART2_Write((const uint8_t *)str, strlen(str));
+}
+
+uint32_t USART2_TxPending(void) {
+	return usart2_tx_head - usart2_tx_tail;
+}
+
+uint32_t USART2_TxHead(void) {
+	return usart2_tx_head;
+}
+
+uint32_t USART2_TxTail(void) {
+	return usart2_tx_tail;
+}
+
+// USART2 interrupt: receive (bytes are discarded, no receiver is implemented) and transmit
+void USART2_IRQHandler(void) {
+	uint32_t isr = USART2->ISR;
+	
+	// RXNEIE is enabled by USART_Init(): read RDR to clear RXNE (and ORE, which shares the interrupt)
+	if (isr & (USART_ISR_RXNE | USART_ISR_ORE)) {
+		(void)USART2->RDR;
+		USART2->ICR = USART_ICR_ORECF;
+	}
+	
+	// Transmit data register empty: next byte, or wait for the last one to complete
+	if ((USART2->CR1 & USART_CR1_TXEIE) && (isr & USART_ISR_TXE)) {
+		if (usart2_tx_tail != usart2_tx_head) {
+			USART2->TDR = usart2_tx_buffer[usart2_tx_tail & (USART2_TX_BUFFER_SIZE - 1)];
+			usart2_tx_tail++;
+		} else {
+			USART2->CR1 = (USART2->CR1 & ~USART_CR1_TXEIE) | USART_CR1_TCIE;
+		}
+	}
+	
+	// Transmission complete: everything written so far is on the wire
+	if ((USART2->CR1 & USART_CR1_TCIE) && (isr & USART_ISR_TC)) {
+		USART2->CR1 &= ~USART_CR1_TCIE;
+		USART2->ICR = USART_ICR_TCCF;
+		if (usart2_tx_callback) {
+			usart2_tx_callback();
+		}
+	}
+}
+
 /*
 // This function serves as the interrupt handler for USART2.
 void USART2_IRQHandler(void){
@@ -34,6 +34,10 @@ int main(void){
 	
 	  sprintf(clk, "%u Hz\n\r", sys_clk);
 		display(clk);
+
+		// Baud rate produced by the divider, computed from the USART2 kernel clock
+		sprintf(clk, "USART2: %lu baud, %ld ppm\n\r", (unsigned long)usart2_baud.baud, (long)usart2_baud.error_ppm);
+		display(clk);
 	
 		while(1);
 }